@@ -4,6 +4,7 @@
 #include <opencv2/opencv.hpp>
 #include <QObject>
 #include <QPoint>
+#include "segmentation/PackedMask.h"
 
 class BrushTool : public QObject {
     Q_OBJECT
@@ -23,11 +24,11 @@ public:
     void setBrushMode(bool erase) { eraseMode = erase; }
     bool isEraseMode() const { return eraseMode; }
     
-    // Mask operations
+    // Mask operations. The mask is stored bit-packed; getMask unpacks it
     void clearMask();
     bool hasMask() const { return !mask.empty(); }
-    cv::Mat getMask() const { return mask.clone(); }
-    void setMask(const cv::Mat& newMask) { mask = newMask.clone(); }
+    cv::Mat getMask() const { return mask.toMat(); }
+    void setMask(const cv::Mat& newMask) { mask = PackedMask::fromMat(newMask); }
     
     // Apply mask to image processing
     cv::Mat applyMaskToResult(const cv::Mat& original, const cv::Mat& processed) const;
@@ -39,7 +40,7 @@ signals:
     void maskUpdated();
     
 private:
-    cv::Mat mask;           // Binary mask (0 = not selected, 255 = selected)
+    PackedMask mask;        // Selected pixels
     int brushSize;          // Brush radius in pixels
     bool eraseMode;         // false = paint, true = erase
     bool isDrawing;         // Currently drawing
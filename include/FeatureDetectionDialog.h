@@ -10,6 +10,7 @@
 #include <QCheckBox>
 #include <opencv2/opencv.hpp>
 #include "ImageCanvas.h"
+#include "features/FeatureDetector.h"
 
 /**
  * @brief Dialog for feature detection (corners, keypoints)
@@ -50,6 +51,10 @@ private:
     void detectShiTomasiCorners();
     void detectFASTCorners();
     void detectORBFeatures();
+    FeatureDetector::Options gridOptions(FeatureDetector::Method method) const;
+    void runDetection(const FeatureDetector::Options& options);
+    void showDetection(const QString& summary);
+    void exportKeypoints();
 
     cv::Mat inputImage;
     cv::Mat detectedImage;
@@ -58,6 +63,12 @@ private:
     QString detectionType;
     bool applied;
     int featureCount;
+    FeatureDetector::Result lastResult;
+    
+    // Collected responses per method, reused while only thresholds,
+    // suppression or grid settings change
+    FeatureDetector::CandidateSet candidateCache[4];
+    double lastCollectMs;
 
     // UI Components
     QComboBox* methodCombo;
@@ -70,6 +81,7 @@ private:
     QLabel* harrisKLabel;
     QSlider* harrisThresholdSlider;
     QLabel* harrisThresholdLabel;
+    QSpinBox* harrisNmsRadiusSpin;
     
     // Shi-Tomasi parameters
     QSpinBox* shiTomasiMaxCornersSpin;
@@ -90,6 +102,10 @@ private:
     QSpinBox* orbLevelsSpin;
     QSpinBox* orbEdgeThresholdSpin;
     
+    // Keypoint distribution (all methods)
+    QSpinBox* gridCellSpin;
+    QSpinBox* maxPerCellSpin;
+    
     // Parameter containers
     QWidget* harrisParams;
     QWidget* shiTomasiParams;
@@ -98,6 +114,7 @@ private:
     
     QPushButton* applyButton;
     QPushButton* resetButton;
+    QPushButton* exportButton;
     
     QLabel* infoLabel;
     QLabel* featureCountLabel;
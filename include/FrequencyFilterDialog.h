@@ -8,7 +8,11 @@
 #include <QSpinBox>
 #include <QPushButton>
 #include <opencv2/opencv.hpp>
+#include <functional>
+#include <vector>
 #include "ImageCanvas.h"
+#include "ImageProcessor.h"
+#include "transforms/FrequencyDomain.h"
 
 /**
  * @brief Dialog for advanced frequency domain filtering
@@ -55,10 +59,37 @@ private:
     // Helper methods
     void createFrequencyFilter(cv::Mat& filter, int type, double cutoff, int order = 2);
     void createBandFilter(cv::Mat& filter, int type, double centerFreq, double bandwidth);
-    void applyFrequencyFilter(const cv::Mat& input, cv::Mat& output, const cv::Mat& filter);
-    void shiftDFT(cv::Mat& fImage);
+    void applyFrequencyFilter(const cv::Mat& filter, cv::Mat& output, bool homomorphic = false);
+    
+    // Forward spectra of the filtered planes (log of them for homomorphic),
+    // computed once per color mode at the optimal DFT size in packed CCS
+    // layout. Parameter changes only rebuild the filter and run the inverses.
+    // Only the set for the current domain is kept; switching domains frees
+    // the other one.
+    const std::vector<cv::Mat>& forwardSpectra(bool logDomain);
+    // Real filter laid out like the packed spectrum (FrequencyDomain::radialMask);
+    // 'response' maps the radial frequency to the gain. Masks are cached by
+    // (filter type, parameters), so revisiting a setting is free. The cache
+    // is bounded by mask bytes, so large images keep fewer masks.
+    cv::Mat buildPackedFilter(int filterIndex, double param1, double param2, double param3,
+                              const std::function<float(double)>& response);
+
+    struct CachedFilter {
+        int filterIndex;
+        double params[3];
+        cv::Mat mask;
+    };
+    static const size_t MAX_CACHED_FILTER_BYTES = size_t(64) << 20;
+    std::vector<CachedFilter> filterCache;  // most recently used first
 
     cv::Mat inputImage;
+    cv::Size dftSize;
+    std::vector<FrequencyDomain> engines;   // one per filtered plane, kept while the dialog is open
+    int spectraColorMode;
+    std::vector<cv::Mat> colorPlanes;   // split of inputImage for spectraColorMode
+    int filteredPlaneCount;
+    std::vector<cv::Mat> spectra;
+    std::vector<cv::Mat> logSpectra;
     cv::Mat filteredImage;
     cv::Mat previewImage;
     
@@ -67,6 +98,7 @@ private:
 
     // UI Components
     QComboBox* filterTypeCombo;
+    QComboBox* colorModeCombo;
     ImageCanvas* previewCanvas;
     
     // Common parameters
@@ -3,6 +3,9 @@
 
 #include <opencv2/opencv.hpp>
 #include <QString>
+#include <functional>
+#include <vector>
+#include "transforms/FrequencyDomain.h"
 
 class ImageProcessor {
 public:
@@ -37,9 +40,34 @@ public:
     static void applyMorphGradient(const cv::Mat& src, cv::Mat& dst, int kernelSize = 5);
     
     // FFT Operations
-    static void applyFFT(const cv::Mat& src, cv::Mat& magnitude, cv::Mat& phase);
-    static void applyLowPassFilter(const cv::Mat& src, cv::Mat& dst, int radius = 30);
-    static void applyHighPassFilter(const cv::Mat& src, cv::Mat& dst, int radius = 30);
+    // Which planes of a color image go through the frequency domain: a gray
+    // conversion, only the luminance of YCrCb / Lab (chroma untouched), or
+    // all three BGR channels. Filtered planes run concurrently.
+    enum FrequencyColorMode { FREQ_GRAY, FREQ_LUMINANCE_YCRCB, FREQ_LUMINANCE_LAB, FREQ_ALL_CHANNELS };
+    
+    // Engines and mask a caller keeps across frequency-domain calls, so
+    // repeated calls on same-sized images stop allocating after the first.
+    // Calls without one use temporary engines.
+    struct FrequencyWorkspace {
+        std::vector<FrequencyDomain> engines;   // one per concurrently filtered plane
+        cv::Mat mask;
+    };
+    
+    static void applyFFT(const cv::Mat& src, cv::Mat& magnitude, cv::Mat& phase,
+                         FrequencyColorMode mode = FREQ_GRAY, FrequencyWorkspace* workspace = nullptr);
+    static void applyLowPassFilter(const cv::Mat& src, cv::Mat& dst, int radius = 30,
+                                   FrequencyColorMode mode = FREQ_GRAY, FrequencyWorkspace* workspace = nullptr);
+    static void applyHighPassFilter(const cv::Mat& src, cv::Mat& dst, int radius = 30,
+                                    FrequencyColorMode mode = FREQ_GRAY, FrequencyWorkspace* workspace = nullptr);
+    
+    // Split 'src' into the planes for 'mode'. The leading planes that should be
+    // filtered are converted to CV_32F and their count is returned; any
+    // remaining planes (chroma, alpha) are left as they are.
+    static int splitFrequencyPlanes(const cv::Mat& src, FrequencyColorMode mode, std::vector<cv::Mat>& planes);
+    // Inverse of splitFrequencyPlanes. The filtered planes are min-max scaled
+    // to 8 bits with one shared range so the color balance survives.
+    static void mergeFrequencyPlanes(std::vector<cv::Mat>& planes, int filteredCount,
+                                     FrequencyColorMode mode, cv::Mat& dst);
     
     // Transforms
     static void flipHorizontal(const cv::Mat& src, cv::Mat& dst);
@@ -51,6 +79,15 @@ public:
     static void rotate(const cv::Mat& src, cv::Mat& dst, double angle);
     static void zoom(const cv::Mat& src, cv::Mat& dst, double scale);
     
+    // 3x3 matrices (destination <- source pixel coordinates) of the transforms
+    // above, for composing several of them into one resampling. outputSize
+    // receives the canvas size the transform produces for 'size'.
+    static cv::Matx33d flipMatrix(cv::Size size, int flipCode);
+    static cv::Matx33d skewMatrix(cv::Size size, double skewX, double skewY);
+    static cv::Matx33d translationMatrix(int tx, int ty);
+    static cv::Matx33d rotationMatrix(cv::Size size, double angle);
+    static cv::Matx33d zoomMatrix(cv::Size size, double scale, cv::Size& outputSize);
+    
     // ========== PHASE 16: THRESHOLDING & SEGMENTATION =========
     
     // Simple thresholding
@@ -75,7 +112,8 @@ public:
     // ========== IMAGE RESTORATION ==========
     
     // Wiener filter for restoration (deconvolution)
-    static void applyWienerFilter(const cv::Mat& src, cv::Mat& dst, const cv::Mat& psf, double noiseVariance = 0.01);
+    static void applyWienerFilter(const cv::Mat& src, cv::Mat& dst, const cv::Mat& psf, double noiseVariance = 0.01,
+                                  FrequencyWorkspace* workspace = nullptr);
     
     // Constrained Least Squares (CLS) restoration
     static void applyCLSRestoration(const cv::Mat& src, cv::Mat& dst, const cv::Mat& psf, double gamma = 0.1);
@@ -83,15 +121,49 @@ public:
     // Inverse filtering
     static void applyInverseFilter(const cv::Mat& src, cv::Mat& dst, const cv::Mat& psf, double epsilon = 0.001);
     
-    // Motion blur restoration
-    static void restoreMotionBlur(const cv::Mat& src, cv::Mat& dst, int length, double angle);
-    
-    // Atmospheric turbulence restoration
-    static void restoreAtmosphericBlur(const cv::Mat& src, cv::Mat& dst, double k = 0.001);
+    // Iterative Richardson-Lucy deconvolution with optional total-variation
+    // regularization (RL-TV). Channels are restored in parallel, in lock-step,
+    // so 'progress' is always called on the calling thread once per iteration;
+    // returning false from it cancels and keeps the current estimate.
+    struct DeconvolutionOptions {
+        int maxIterations = 40;
+        double tvWeight = 0.002;        // 0 disables TV (plain RL)
+        double tolerance = 5e-4;        // stop when the relative L1 change falls below
+        bool accelerate = true;         // Biggs-Andrews vector extrapolation
+        std::function<bool(int iteration, int maxIterations)> progress;
+    };
+    struct DeconvolutionResult {
+        int iterations = 0;
+        bool converged = false;
+        bool cancelled = false;
+    };
+    static DeconvolutionResult applyRichardsonLucy(const cv::Mat& src, cv::Mat& dst, const cv::Mat& psf,
+                                                   const DeconvolutionOptions& options = DeconvolutionOptions());
+    
+    // Blind estimate of linear motion blur from the cepstrum, whose negative
+    // peak sits at the blur length along the blur direction. A central window
+    // of a downsampled copy is analyzed; the (angle, length) grid is searched
+    // coarse-to-fine in parallel. Angle is in degrees [0, 180), in the
+    // convention of restoreMotionBlur.
+    struct MotionBlurEstimate {
+        double length = 0.0;
+        double angle = 0.0;
+        double confidence = 0.0;   // peak prominence over the search grid (z-score)
+        double elapsedMs = 0.0;
+    };
+    static MotionBlurEstimate estimateMotionBlur(const cv::Mat& src);
+    
+    // Motion blur restoration (Wiener, or RL-TV when highQuality is given)
+    static DeconvolutionResult restoreMotionBlur(const cv::Mat& src, cv::Mat& dst, int length, double angle,
+                                                 const DeconvolutionOptions* highQuality = nullptr);
+    
+    // Atmospheric turbulence restoration (Wiener, or RL-TV when highQuality is given)
+    static DeconvolutionResult restoreAtmosphericBlur(const cv::Mat& src, cv::Mat& dst, double k = 0.001,
+                                                      const DeconvolutionOptions* highQuality = nullptr);
     
     // ========== GEOMETRIC DISTORTION ==========
     
-    // Barrel distortion correction
+    // Barrel distortion correction; remap tables are cached (see LensRemapCache)
     static void correctBarrelDistortion(const cv::Mat& src, cv::Mat& dst, double k1, double k2 = 0.0);
     
     // Pincushion distortion correction
@@ -7,12 +7,18 @@
 #include <functional>
 #include <opencv2/opencv.hpp>
 
+// Geometric layers describe themselves as a 3x3 matrix (destination <- source
+// pixel coordinates) for a given input size, and report the output size.
+// rebuildFromLayers composes runs of such layers into one resampling.
+using LayerGeometry = std::function<cv::Matx33d(const cv::Size& inputSize, cv::Size& outputSize)>;
+
 struct ProcessingLayer {
     QString name;
     QString type;  // "filter", "transform", "adjustment"
     cv::Mat image;
     bool visible;
     std::function<cv::Mat(const cv::Mat&)> operation;  // Store the operation function
+    LayerGeometry geometry;  // Set for pure geometric transforms
 };
 
 class LayerManager : public QObject {
@@ -23,7 +29,8 @@ public:
     ~LayerManager();
 
     void addLayer(const QString& name, const QString& type, const cv::Mat& image,
-                  std::function<cv::Mat(const cv::Mat&)> operation = nullptr);
+                  std::function<cv::Mat(const cv::Mat&)> operation = nullptr,
+                  LayerGeometry geometry = nullptr);
     void removeLayer(int index);
     void clearLayers();
 
@@ -42,6 +49,9 @@ signals:
     void layerRemoved(int index);
 
 private:
+    // One warp for layers [first, last], all of which have a geometry
+    cv::Mat applyGeometricRun(const cv::Mat& input, int first, int last) const;
+
     QVector<ProcessingLayer> layers;
 };
 
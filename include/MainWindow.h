@@ -13,6 +13,7 @@
 #include <QKeyEvent>
 #include <opencv2/opencv.hpp>
 #include <functional>
+#include "ImageProcessor.h"
 
 class ImageCanvas;
 class RightSidebarWidget;
@@ -81,6 +82,7 @@ private slots:
     void toggleSelectionMode();
     void setSelectionMethod(int method);  // 0=Rect, 1=Polygon, 2=MagicWand, 3=Threshold, 4=Edge
     void clearSelection();
+    void invertSelection();
     void applyMagicWand();
     void applyThresholdSelection();
     void saveSelectionAsLayer();  // Save current selection mask as a layer
@@ -120,6 +122,7 @@ private slots:
     void applyPyramidalFilter();
     void applyCircularFilter();
     void applyConeFilter();
+    void applyCustomKernelFilter();
     
     // Phase 13: Basic Edge Detectors
     void applyPrewittEdge();
@@ -145,9 +148,11 @@ private slots:
     
     // Phase 17: Advanced Segmentation - NEW
     void showAdvancedSegmentationDialog();
+    void analyzeBlobs();
     
     // Phase 19: Feature Detection - NEW
     void showFeatureDetectionDialog();
+    void registerSecondImage();
     
     // Phase 19: Advanced Frequency Filters - NEW
     void showFrequencyFilterDialog();
@@ -171,6 +176,8 @@ private slots:
     void correctPincushion();
     void correctPerspective();
     void correctKeystone();
+    void correctLensProfile();
+    void undistortFolderWithProfile();
 
     // Morphology Operations
     void applyErosion();
@@ -201,7 +208,8 @@ private:
     void keyPressEvent(QKeyEvent *event) override;
     
     // Helper Functions
-    void updateDisplay();
+    void updateDisplay();       // after the processed image changed
+    void refreshDisplay();      // redraw only, e.g. after a selection change
     void updateStatus(const QString& message, const QString& type = "info", int progress = -1);
     void finalizeProcessing(const QString& layerName, const QString& layerType);
     void updateMetricsDisplay();
@@ -215,6 +223,12 @@ private:
         const QString& layerType,
         const QString& successMessage
     );
+    
+    // Lens profile selection; false if the dialog was cancelled
+    bool chooseLensProfile();
+    
+    // Live magic wand tolerance; false if the dialog was cancelled
+    bool chooseMagicWandTolerance();
 
     // UI Components
     CollapsibleToolbar *leftToolbar;
@@ -258,6 +272,12 @@ private:
     QPoint roiEndPoint;
     bool roiSelecting;
     RectangleROI *currentROI;
+    
+    // Lens profile used by the last correction
+    QString lensProfilePath;
+    
+    // FFT engines reused by the frequency menu actions
+    ImageProcessor::FrequencyWorkspace frequencyWorkspace;
 };
 
 #endif // MAINWINDOW_H
@@ -9,6 +9,7 @@
 #include <QRadioButton>
 #include <QButtonGroup>
 #include <QComboBox>
+#include <QDoubleSpinBox>
 #include <opencv2/opencv.hpp>
 
 class ResolutionEnhancementDialog : public QDialog {
@@ -20,7 +21,8 @@ public:
         Bilinear,     // Good for 2x
         Bicubic,      // Better quality
         Lanczos4,     // Best quality, slower
-        EdgeDirected  // Custom edge-preserving
+        EdgeDirected, // Custom edge-preserving
+        BackProjection // Edge-directed estimate + iterative back-projection
     };
 
     explicit ResolutionEnhancementDialog(const cv::Mat& inputImage, QWidget* parent = nullptr);
@@ -28,6 +30,8 @@ public:
     cv::Mat getResultImage() const { return resultImage; }
     double getScaleFactor() const { return scaleSlider->value() / 100.0; }
     InterpolationMethod getMethod() const { return currentMethod; }
+    int getIterations() const { return iterationSpinBox->value(); }
+    double getTolerance() const { return toleranceSpinBox->value(); }
 
 private slots:
     void onScaleChanged(int value);
@@ -54,6 +58,10 @@ private:
     QLabel* targetSizeLabel;
 
     QComboBox* methodCombo;
+    QSpinBox* iterationSpinBox;
+    QDoubleSpinBox* toleranceSpinBox;
+    QWidget* backProjectionOptions;
+    QLabel* timingLabel;
     
     QSlider* sharpenSlider;
     QSpinBox* sharpenSpinBox;
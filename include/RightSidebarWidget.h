@@ -21,7 +21,8 @@ public:
 
     void updateHistogram(const cv::Mat& image);
     void addLayer(const QString& name, const QString& type, const cv::Mat& image,
-                  std::function<cv::Mat(const cv::Mat&)> operation = nullptr);
+                  std::function<cv::Mat(const cv::Mat&)> operation = nullptr,
+                  LayerGeometry geometry = nullptr);
     void clearLayers();
     void resetHistogram();
     void removeLayer(int layerIndex);
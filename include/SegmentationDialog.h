@@ -7,8 +7,11 @@
 #include <QLabel>
 #include <QSpinBox>
 #include <QPushButton>
+#include <QCheckBox>
 #include <opencv2/opencv.hpp>
 #include "ImageCanvas.h"
+#include "segmentation/RegionStatistics.h"
+#include "segmentation/CoarseToFineGrabCut.h"
 
 /**
  * @brief Dialog for advanced region-based segmentation techniques
@@ -49,6 +52,9 @@ private:
     void applyMeanShift();
     void applyGrabCut();
     void applySuperpixelSLIC();
+    
+    // Per-region statistics of the last preview
+    void showRegionStatistics();
 
     cv::Mat inputImage;
     cv::Mat segmentedImage;
@@ -56,6 +62,9 @@ private:
     
     QString segmentationType;
     bool applied;
+    
+    // Label map statistics of the current preview (empty for Mean Shift)
+    RegionStatistics::Table regionTable;
 
     // UI Components
     QComboBox* methodCombo;
@@ -74,6 +83,14 @@ private:
     
     // GrabCut parameters
     QSpinBox* grabCutIterationsSpin;
+    QCheckBox* grabCutCoarseCheck;
+    
+    // GrabCut models persist across iteration changes; the last mask of
+    // either mode is kept to measure how closely the other one matches it
+    CoarseToFineGrabCut grabCutEngine;
+    cv::Mat lastGrabCutMask;
+    bool lastGrabCutCoarse = false;
+    int lastGrabCutIterations = 0;
     
     // SLIC Superpixel parameters
     QSpinBox* slicRegionsSpin;
@@ -88,6 +105,7 @@ private:
     
     QPushButton* applyButton;
     QPushButton* resetButton;
+    QPushButton* statsButton;
     
     QLabel* infoLabel;
 };
@@ -6,6 +6,8 @@
 #include <QPoint>
 #include <QRect>
 #include <vector>
+#include "segmentation/ComponentTree.h"
+#include "segmentation/PackedMask.h"
 
 enum class SelectionMode {
     Rectangle,
@@ -15,6 +17,14 @@ enum class SelectionMode {
     EdgeBased
 };
 
+// How a new selection combines with the current one
+enum class SelectionCombine {
+    Replace,
+    Add,
+    Subtract,
+    Intersect
+};
+
 class SelectionTool : public QObject {
     Q_OBJECT
 
@@ -25,6 +35,8 @@ public:
     void setMode(SelectionMode mode) { currentMode = mode; }
     SelectionMode getMode() const { return currentMode; }
     QString getModeName() const;
+    void setCombineMode(SelectionCombine mode) { combineMode = mode; }
+    SelectionCombine getCombineMode() const { return combineMode; }
     
     // Rectangle selection
     void startRectangle(const QPoint& pos);
@@ -36,9 +48,18 @@ public:
     void closePolygon(const cv::Size& imageSize);
     void clearPolygon();
     
-    // Magic wand (color-based)
+    // Magic wand (color-based). The component tree is built once per image,
+    // after that any seed and tolerance is a tree lookup. The tree is matched
+    // to its image by buffer only, so whoever changes the image contents
+    // must release it. Images above MAX_WAND_TREE_PIXELS (or not 8-bit)
+    // use cv::floodFill per click instead.
     void magicWandSelect(const cv::Mat& image, const QPoint& seedPoint, int tolerance = 30);
-    void setMagicWandTolerance(int tolerance) { magicWandTolerance = tolerance; }
+    // Re-selects at the last wand seed; the flood fill path needs the image
+    // the click was made on
+    void setMagicWandTolerance(int tolerance, const cv::Mat& image = cv::Mat());
+    int getMagicWandTolerance() const { return magicWandTolerance; }
+    bool magicWandBuildsTree(const cv::Mat& image) const;  // true if a click would build the tree
+    void releaseMagicWandTree();
     
     // Threshold-based
     void thresholdSelect(const cv::Mat& image, int minThreshold, int maxThreshold);
@@ -46,11 +67,15 @@ public:
     // Edge-based (intelligent selection)
     void edgeBasedSelect(const cv::Mat& image, const QPoint& seedPoint);
     
-    // Mask operations
+    // Mask operations. The selection is stored bit-packed; the cv::Mat
+    // accessors unpack it at the point of use
     cv::Mat getMask(const cv::Size& imageSize) const;
-    bool hasMask() const { return !mask.empty(); }
+    bool hasMask() const { return !selection.empty(); }
     void clearMask();
-    void setMask(const cv::Mat& newMask) { mask = newMask.clone(); }
+    void setMask(const cv::Mat& newMask) { selection = PackedMask::fromMat(newMask); }
+    const PackedMask& getSelection() const { return selection; }
+    void setSelection(const PackedMask& newSelection) { selection = newSelection; }
+    void invertSelection(const cv::Size& imageSize);
     
     // Apply mask to processing
     cv::Mat applyMaskToResult(const cv::Mat& original, const cv::Mat& processed) const;
@@ -71,7 +96,8 @@ signals:
     
 private:
     SelectionMode currentMode;
-    cv::Mat mask;
+    SelectionCombine combineMode;
+    PackedMask selection;
     
     // Rectangle mode
     QPoint rectStart;
@@ -81,13 +107,25 @@ private:
     // Polygon mode
     std::vector<QPoint> polygonPoints;
     
-    // Magic wand settings
+    // Magic wand settings. The tree retains about 21 bytes per pixel and
+    // peaks near 60 during the build, hence the cap.
+    static const int MAX_WAND_TREE_PIXELS = 8 << 20;
     int magicWandTolerance;
+    ComponentTree wandTree;
+    const uchar* wandData;      // image of the last click, identified but not kept alive
+    cv::Size wandSize;
+    int wandType;
+    cv::Point wandSeed;
+    PackedMask wandBase;        // selection before the last wand click
     
     // Helper functions
-    void createRectangleMask(const cv::Size& imageSize);
-    void createPolygonMask(const cv::Size& imageSize);
-    void floodFillSelection(const cv::Mat& image, const cv::Point& seed, int tolerance);
+    PackedMask createRectangleMask(const cv::Size& imageSize) const;
+    PackedMask createPolygonMask(const cv::Size& imageSize) const;
+    PackedMask combined(const PackedMask& base, const PackedMask& shape) const;
+    void commitSelection(const PackedMask& shape) { selection = combined(selection, shape); }
+    bool wandUsesTree(const cv::Mat& image) const;
+    bool isWandImage(const cv::Mat& image) const;
+    PackedMask floodFillShape(const cv::Mat& image, const cv::Point& seed, int tolerance) const;
 };
 
 #endif // SELECTIONTOOL_H
@@ -6,8 +6,10 @@
 #include <QLabel>
 #include <QSlider>
 #include <QSpinBox>
+#include <QCheckBox>
 #include <QGroupBox>
 #include <opencv2/opencv.hpp>
+#include <vector>
 #include "WaveletTransform.h"
 
 class ImageCanvas;
@@ -46,15 +48,21 @@ private:
     
     QSlider *thresholdSlider;
     QLabel *thresholdLabel;
+    QCheckBox *autoThresholdCheck;
+    QCheckBox *stationaryCheck;
     
     QSpinBox *levelsSpinBox;
     
+    QSlider *bitrateSlider;
+    QLabel *bitrateLabel;
+    
     QPushButton *applyButton;
     QPushButton *resetButton;
     QLabel *infoLabel;
     
     QWidget *denoiseParams;
     QWidget *decompositionParams;
+    QWidget *codecParams;
     
     // Image canvases
     ImageCanvas *originalCanvas;
@@ -68,10 +76,16 @@ private:
     QString operationType;
     bool applied;
     
+    // Embedded codec stream, encoded once per wavelet type at the maximum
+    // bitrate; slider changes only decode a shorter prefix
+    std::vector<uchar> codecStream;
+    int codecStreamType;
+    
     // Helper methods
     void setupUI();
     void updatePreview();
     void performDenoising();
     void performDecomposition();
     void performReconstruction();
+    void performCodecComparison();
 };
@@ -7,27 +7,122 @@
 
 class WaveletTransform {
 public:
-    enum WaveletType { HAAR, DB2, DB4, DB6 };
+    // HAAR, CDF53 and CDF97 run through the lifting scheme; the Daubechies
+    // filters use a periodized polyphase filter bank on the same float rows.
+    enum WaveletType { HAAR, DB2, DB4, DB6, CDF53, CDF97 };
     enum ThresholdMethod { SOFT, HARD };
-    
-    static void dwt2D(const cv::Mat& input, cv::Mat& approx, cv::Mat& horiz, 
+
+    // Sub-bands are CV_32F views into one shared Mallat-layout buffer
+    static void dwt2D(const cv::Mat& input, cv::Mat& approx, cv::Mat& horiz,
                       cv::Mat& vert, cv::Mat& diag, WaveletType type = HAAR);
-    static void idwt2D(const cv::Mat& approx, const cv::Mat& horiz, 
-                       const cv::Mat& vert, const cv::Mat& diag, 
+    static void idwt2D(const cv::Mat& approx, const cv::Mat& horiz,
+                       const cv::Mat& vert, const cv::Mat& diag,
                        cv::Mat& recon, WaveletType type = HAAR);
-    static void denoise(const cv::Mat& input, cv::Mat& output, double threshold, 
+    static void denoise(const cv::Mat& input, cv::Mat& output, double threshold,
                         ThresholdMethod method = SOFT, int levels = 3, WaveletType type = HAAR);
-    static cv::Mat visualizeDecomposition(const cv::Mat& approx, const cv::Mat& horiz, 
+    // Automatic mode: noise sigma from the finest diagonal band (MAD), one
+    // BayesShrink threshold per sub-band. Color input is denoised per YCrCb
+    // channel in parallel. Returns the estimated noise sigma of the first channel.
+    static double denoiseBayesShrink(const cv::Mat& input, cv::Mat& output,
+                                     ThresholdMethod method = SOFT, int levels = 3,
+                                     WaveletType type = HAAR);
+    static cv::Mat visualizeDecomposition(const cv::Mat& approx, const cv::Mat& horiz,
                                           const cv::Mat& vert, const cv::Mat& diag);
     static std::string getWaveletName(WaveletType type);
-    
+    static bool isLifting(WaveletType type);
+
+    // Stationary (undecimated, a trous) transform. Every sub-band keeps the
+    // input size and channel count, so it can be overlaid on the image.
+    struct StationaryLevel {
+        cv::Mat horiz, vert, diag;
+    };
+    struct StationaryDecomposition {
+        cv::Mat approx;                         // coarsest approximation
+        std::vector<StationaryLevel> details;   // finest level first
+        WaveletType type;
+        size_t peakBytes;                       // peak float32 working set, (3 * levels + 3) planes
+    };
+    static StationaryDecomposition swt2D(const cv::Mat& input, int levels = 3, WaveletType type = HAAR);
+    static cv::Mat iswt2D(const StationaryDecomposition& decomposition);
+    // Shift-invariant denoising; a negative threshold selects BayesShrink with
+    // a per-level noise estimate. Color is handled per YCrCb channel. Only one
+    // combined band per level is kept, so the peak is (levels + 4) planes per
+    // channel rather than swt2D's (3 * levels + 3).
+    static void denoiseStationary(const cv::Mat& input, cv::Mat& output, double threshold,
+                                  ThresholdMethod method = SOFT, int levels = 3,
+                                  WaveletType type = HAAR, size_t* peakBytes = nullptr);
+
+    // One decomposition level in place on a CV_32FC1 plane (or ROI) with even
+    // dimensions. Layout afterwards: approx top-left, vert top-right,
+    // horiz bottom-left, diag bottom-right.
+    static void forwardInPlace(cv::Mat& plane, WaveletType type = HAAR);
+    static void inverseInPlace(cv::Mat& plane, WaveletType type = HAAR);
+
 private:
-    static void getWaveletFilters(WaveletType type, std::vector<double>& lowpass, 
+    static void getWaveletFilters(WaveletType type, std::vector<double>& lowpass,
                                   std::vector<double>& highpass);
-    static void convolve1D(const std::vector<double>& signal, const std::vector<double>& filter, 
-                          std::vector<double>& output, int stride = 1);
-    static void upsample(const std::vector<double>& input, std::vector<double>& output);
+    static void getFloatFilters(WaveletType type, std::vector<float>& lowpass,
+                                std::vector<float>& highpass);
+
+    // Gray CV_32F copy of the input, replicate-padded to a multiple of 'multiple'
+    static cv::Mat preparePlane(const cv::Mat& input, int multiple);
+
+    // 1D transforms over 'n' lines of 'width' floats each. Forward leaves the
+    // low-pass lines first and the high-pass lines second; inverse expects that
+    // order. 'work' must hold (n + taps) * width floats.
+    static void forward1D(float* lines, float* work, int n, int width, WaveletType type,
+                          const std::vector<float>& lowpass, const std::vector<float>& highpass);
+    static void inverse1D(float* lines, float* work, int n, int width, WaveletType type,
+                          const std::vector<float>& lowpass, const std::vector<float>& highpass);
+    static void liftForward(float* x, int n, int width, WaveletType type);
+    static void liftInverse(float* x, int n, int width, WaveletType type);
+
+    static void transformRows(cv::Mat& plane, WaveletType type, bool forward);
+    static void transformColumns(cv::Mat& plane, WaveletType type, bool forward);
+    static int columnStripWidth(int rows, int cols);
+
+    // Filters for the a trous transform; taps[k] sits at offset (k - origin)
+    // times the level dilation. Synthesis filters include the 1/2 gain.
+    struct AtrousFilter {
+        std::vector<float> taps;
+        int origin;
+    };
+    static void getStationaryFilters(WaveletType type, AtrousFilter& lowpass, AtrousFilter& highpass,
+                                     AtrousFilter& synthLowpass, AtrousFilter& synthHighpass);
+    static int extendIndex(int index, int length, bool symmetric);
+    // The merges treat an empty low or high input as zero
+    static void filterLine(const float* center, const AtrousFilter& filter, int step,
+                           int length, float* out);
+    static void atrousRows(const cv::Mat& src, const AtrousFilter& lowpass, const AtrousFilter& highpass,
+                           int dilation, bool symmetric, cv::Mat& low, cv::Mat& high);
+    static void atrousRowsMerge(const cv::Mat& low, const cv::Mat& high, const AtrousFilter& lowpass,
+                                const AtrousFilter& highpass, int dilation, bool symmetric, cv::Mat& dst);
+    static void atrousColumns(const cv::Mat& src, const AtrousFilter& lowpass, const AtrousFilter& highpass,
+                              int dilation, bool symmetric, cv::Mat& low, cv::Mat& high);
+    static void atrousColumnsMerge(const cv::Mat& low, const cv::Mat& high, const AtrousFilter& lowpass,
+                                   const AtrousFilter& highpass, int dilation, bool symmetric, cv::Mat& dst);
+
+    // Color denoising runs on decorrelated YCrCb channels; alpha is passed through
+    static void splitDecorrelated(const cv::Mat& input, std::vector<cv::Mat>& channels, cv::Mat& alpha);
+    static void mergeDecorrelated(std::vector<cv::Mat>& channels, const cv::Mat& alpha,
+                                  bool isColor, cv::Mat& output);
+
     static void applyThreshold(cv::Mat& coeffs, double threshold, ThresholdMethod method);
+    static double estimateNoiseSigma(const cv::Mat& diag);
+    static double bayesShrinkThreshold(const cv::Mat& band, double noiseSigma);
+    // Per level, the factor white noise is scaled by in the 1D low and high
+    // bands (1 for orthonormal wavelets, not for the integer CDF 5/3)
+    static void bandNoiseGains(WaveletType type, int levels, std::vector<double>& lowGain,
+                               std::vector<double>& highGain);
+
+    // Stationary denoise of one channel; returns the CV_32F result
+    static cv::Mat denoiseStationaryPlane(const cv::Mat& input, double threshold, ThresholdMethod method,
+                                          int levels, WaveletType type, size_t& peakBytes);
+
+    // Multi-level denoise of a prepared plane in place. A negative threshold
+    // selects BayesShrink. Returns the estimated noise sigma (0 if not estimated).
+    static double denoisePlane(cv::Mat& plane, double threshold, ThresholdMethod method,
+                               int levels, WaveletType type);
 };
 
 #endif // WAVELETTRANSFORM_H
@@ -0,0 +1,333 @@
+#include "ColorQuantizer.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+
+namespace {
+
+// Per-stripe histograms use 32-bit sums: 255 * 16M pixels still fits
+const int MAX_STRIPE_PIXELS = 1 << 24;
+
+// Points are clustered in this many fixed chunks so the partial sums, and
+// therefore the result, do not depend on the thread count
+const int POINT_CHUNKS = 16;
+
+struct WeightedColors {
+    int dims = 0;
+    std::vector<float> colors;      // dims floats per point
+    std::vector<double> weights;
+    std::vector<int> binToPoint;    // -1 for empty bins
+};
+
+inline int colorKey(const uchar* p, int bits) {
+    const int shift = 8 - bits;
+    return ((p[0] >> shift) << (2 * bits)) | ((p[1] >> shift) << bits) | (p[2] >> shift);
+}
+
+// Weighted list of the non-empty bins, each at the mean color of its pixels
+WeightedColors buildHistogram(const cv::Mat& src, int bits) {
+    const int cn = src.channels();
+    const int dims = (cn >= 3) ? 3 : 1;
+    const int bins = (dims == 3) ? (1 << (3 * bits)) : 256;
+
+    const long long pixels = static_cast<long long>(src.rows) * src.cols;
+    int stripes = std::min(std::max(1, cv::getNumThreads()), 8);
+    stripes = std::max(stripes, static_cast<int>((pixels + MAX_STRIPE_PIXELS - 1) / MAX_STRIPE_PIXELS));
+    stripes = std::min(stripes, src.rows);
+
+    std::vector<std::vector<uint32_t>> counts(stripes), sums(stripes);
+    cv::parallel_for_(cv::Range(0, stripes), [&](const cv::Range& range) {
+        for (int s = range.start; s < range.end; s++) {
+            std::vector<uint32_t>& count = counts[s];
+            std::vector<uint32_t>& sum = sums[s];
+            count.assign(bins, 0);
+            sum.assign(static_cast<size_t>(bins) * dims, 0);
+
+            const int r0 = static_cast<int>(static_cast<long long>(src.rows) * s / stripes);
+            const int r1 = static_cast<int>(static_cast<long long>(src.rows) * (s + 1) / stripes);
+            for (int y = r0; y < r1; y++) {
+                const uchar* p = src.ptr<uchar>(y);
+                if (dims == 1) {
+                    for (int x = 0; x < src.cols; x++, p += cn) {
+                        count[p[0]]++;
+                        sum[p[0]] += p[0];
+                    }
+                } else {
+                    for (int x = 0; x < src.cols; x++, p += cn) {
+                        const int key = colorKey(p, bits);
+                        count[key]++;
+                        sum[key * 3] += p[0];
+                        sum[key * 3 + 1] += p[1];
+                        sum[key * 3 + 2] += p[2];
+                    }
+                }
+            }
+        }
+    });
+
+    WeightedColors hist;
+    hist.dims = dims;
+    hist.binToPoint.assign(bins, -1);
+    for (int b = 0; b < bins; b++) {
+        uint64_t count = 0;
+        double sum[3] = {0.0, 0.0, 0.0};
+        for (int s = 0; s < stripes; s++) {
+            count += counts[s][b];
+            for (int d = 0; d < dims; d++) sum[d] += sums[s][static_cast<size_t>(b) * dims + d];
+        }
+        if (count == 0) continue;
+
+        hist.binToPoint[b] = static_cast<int>(hist.weights.size());
+        hist.weights.push_back(static_cast<double>(count));
+        for (int d = 0; d < dims; d++) {
+            hist.colors.push_back(static_cast<float>(sum[d] / count));
+        }
+    }
+    return hist;
+}
+
+inline float distance(const float* a, const float* b, int dims) {
+    float sum = 0.0f;
+    for (int d = 0; d < dims; d++) {
+        float diff = a[d] - b[d];
+        sum += diff * diff;
+    }
+    return std::sqrt(sum);
+}
+
+// Weighted k-means++ seeding
+std::vector<float> seedCenters(const WeightedColors& hist, int k, unsigned int seed) {
+    const int n = static_cast<int>(hist.weights.size());
+    const int dims = hist.dims;
+    cv::RNG rng(seed);
+
+    auto pick = [&](const std::vector<double>& mass) {
+        double total = 0.0;
+        for (double m : mass) total += m;
+        double target = rng.uniform(0.0, 1.0) * total;
+        for (int i = 0; i < n; i++) {
+            target -= mass[i];
+            if (target <= 0.0) return i;
+        }
+        return n - 1;
+    };
+
+    std::vector<float> centers;
+    centers.reserve(static_cast<size_t>(k) * dims);
+    int first = pick(hist.weights);
+    centers.insert(centers.end(), &hist.colors[first * dims], &hist.colors[first * dims] + dims);
+
+    std::vector<double> mass(n);
+    std::vector<float> nearest(n, std::numeric_limits<float>::max());
+    for (int c = 1; c < k; c++) {
+        const float* last = &centers[(c - 1) * dims];
+        for (int i = 0; i < n; i++) {
+            nearest[i] = std::min(nearest[i], distance(&hist.colors[i * dims], last, dims));
+            mass[i] = hist.weights[i] * nearest[i] * nearest[i];
+        }
+        int next = pick(mass);
+        centers.insert(centers.end(), &hist.colors[next * dims], &hist.colors[next * dims] + dims);
+    }
+    return centers;
+}
+
+} // namespace
+
+namespace ColorQuantizer {
+
+Result kmeans(const cv::Mat& src, cv::Mat& dst, int k, const Options& options, cv::Mat* labels) {
+    if (src.depth() != CV_8U || (src.channels() != 1 && src.channels() != 3 && src.channels() != 4)) {
+        throw std::runtime_error("Color quantization needs an 8-bit gray, BGR or BGRA image");
+    }
+    if (k < 1) {
+        throw std::runtime_error("Color quantization needs at least one cluster");
+    }
+
+    Result result;
+    auto start = std::chrono::high_resolution_clock::now();
+    auto lap = [&start]() {
+        auto now = std::chrono::high_resolution_clock::now();
+        double ms = std::chrono::duration<double, std::milli>(now - start).count();
+        start = now;
+        return ms;
+    };
+
+    const int bits = std::min(6, std::max(4, options.bitsPerChannel));
+    WeightedColors hist = buildHistogram(src, bits);
+    const int n = static_cast<int>(hist.weights.size());
+    const int dims = hist.dims;
+    k = std::min(k, n);
+    result.histogramColors = n;
+    result.histogramMs = lap();
+
+    // Hamerly's bounds: upper[i] >= distance to the assigned center,
+    // lower[i] <= distance to every other center
+    std::vector<float> centers = seedCenters(hist, k, options.seed);
+    std::vector<int> assignment(n, 0);
+    std::vector<float> upper(n), lower(n);
+
+    auto assignFully = [&](int i) {
+        const float* x = &hist.colors[i * dims];
+        float best = std::numeric_limits<float>::max(), second = best;
+        int bestIndex = 0;
+        for (int c = 0; c < k; c++) {
+            float d = distance(x, &centers[c * dims], dims);
+            if (d < best) {
+                second = best;
+                best = d;
+                bestIndex = c;
+            } else if (d < second) {
+                second = d;
+            }
+        }
+        bool changed = (assignment[i] != bestIndex);
+        assignment[i] = bestIndex;
+        upper[i] = best;
+        lower[i] = second;
+        return changed;
+    };
+
+    auto chunkRange = [n](int chunk) {
+        return cv::Range(static_cast<int>(static_cast<long long>(n) * chunk / POINT_CHUNKS),
+                         static_cast<int>(static_cast<long long>(n) * (chunk + 1) / POINT_CHUNKS));
+    };
+
+    cv::parallel_for_(cv::Range(0, POINT_CHUNKS), [&](const cv::Range& range) {
+        for (int chunk = range.start; chunk < range.end; chunk++) {
+            cv::Range points = chunkRange(chunk);
+            for (int i = points.start; i < points.end; i++) assignFully(i);
+        }
+    });
+
+    std::vector<std::vector<double>> chunkSums(POINT_CHUNKS, std::vector<double>(static_cast<size_t>(k) * dims));
+    std::vector<std::vector<double>> chunkWeights(POINT_CHUNKS, std::vector<double>(k));
+    std::vector<int> chunkChanges(POINT_CHUNKS);
+    std::vector<float> moves(k), halfGap(k);
+
+    for (int it = 0; it < options.maxIterations; it++) {
+        // Weighted means of the current clusters
+        cv::parallel_for_(cv::Range(0, POINT_CHUNKS), [&](const cv::Range& range) {
+            for (int chunk = range.start; chunk < range.end; chunk++) {
+                std::vector<double>& sum = chunkSums[chunk];
+                std::vector<double>& weight = chunkWeights[chunk];
+                std::fill(sum.begin(), sum.end(), 0.0);
+                std::fill(weight.begin(), weight.end(), 0.0);
+                cv::Range points = chunkRange(chunk);
+                for (int i = points.start; i < points.end; i++) {
+                    const int c = assignment[i];
+                    const double w = hist.weights[i];
+                    weight[c] += w;
+                    for (int d = 0; d < dims; d++) sum[c * dims + d] += w * hist.colors[i * dims + d];
+                }
+            }
+        });
+
+        float maxMove = 0.0f, secondMove = 0.0f;
+        int maxMoveIndex = -1;
+        for (int c = 0; c < k; c++) {
+            double weight = 0.0;
+            double sum[3] = {0.0, 0.0, 0.0};
+            for (int chunk = 0; chunk < POINT_CHUNKS; chunk++) {
+                weight += chunkWeights[chunk][c];
+                for (int d = 0; d < dims; d++) sum[d] += chunkSums[chunk][c * dims + d];
+            }
+            float updated[3];
+            for (int d = 0; d < dims; d++) {
+                updated[d] = (weight > 0) ? static_cast<float>(sum[d] / weight) : centers[c * dims + d];
+            }
+            moves[c] = distance(updated, &centers[c * dims], dims);
+            std::copy(updated, updated + dims, &centers[c * dims]);
+            if (moves[c] > maxMove) {
+                secondMove = maxMove;
+                maxMove = moves[c];
+                maxMoveIndex = c;
+            } else if (moves[c] > secondMove) {
+                secondMove = moves[c];
+            }
+        }
+        result.iterations = it + 1;
+        if (maxMove < options.epsilon) {
+            break;
+        }
+
+        // Half the distance from each center to its closest other center
+        for (int c = 0; c < k; c++) {
+            float closest = std::numeric_limits<float>::max();
+            for (int o = 0; o < k; o++) {
+                if (o != c) closest = std::min(closest, distance(&centers[c * dims], &centers[o * dims], dims));
+            }
+            halfGap[c] = 0.5f * closest;
+        }
+
+        // Reassign only points whose bounds no longer prove their assignment
+        cv::parallel_for_(cv::Range(0, POINT_CHUNKS), [&](const cv::Range& range) {
+            for (int chunk = range.start; chunk < range.end; chunk++) {
+                int changes = 0;
+                cv::Range points = chunkRange(chunk);
+                for (int i = points.start; i < points.end; i++) {
+                    const int a = assignment[i];
+                    upper[i] += moves[a];
+                    lower[i] -= (a == maxMoveIndex) ? secondMove : maxMove;
+
+                    const float bound = std::max(halfGap[a], lower[i]);
+                    if (upper[i] <= bound) continue;
+                    upper[i] = distance(&hist.colors[i * dims], &centers[a * dims], dims);
+                    if (upper[i] <= bound) continue;
+                    if (assignFully(i)) changes++;
+                }
+                chunkChanges[chunk] = changes;
+            }
+        });
+
+        int changes = 0;
+        for (int c : chunkChanges) changes += c;
+        if (changes == 0) {
+            break;
+        }
+    }
+
+    for (int i = 0; i < n; i++) {
+        float d = distance(&hist.colors[i * dims], &centers[assignment[i] * dims], dims);
+        result.compactness += hist.weights[i] * d * d;
+    }
+    result.centers = cv::Mat(k, dims, CV_32F, centers.data()).clone();
+    result.clusterMs = lap();
+
+    // Recolor through a bin -> color table in a single pass
+    const int bins = static_cast<int>(hist.binToPoint.size());
+    std::vector<uchar> colorLut(static_cast<size_t>(bins) * dims, 0);
+    std::vector<int> labelLut(bins, 0);
+    for (int b = 0; b < bins; b++) {
+        int p = hist.binToPoint[b];
+        if (p < 0) continue;
+        labelLut[b] = assignment[p];
+        for (int d = 0; d < dims; d++) {
+            colorLut[b * dims + d] = cv::saturate_cast<uchar>(centers[assignment[p] * dims + d]);
+        }
+    }
+
+    const int cn = src.channels();
+    dst.create(src.size(), src.type());
+    if (labels) labels->create(src.size(), CV_32S);
+    cv::parallel_for_(cv::Range(0, src.rows), [&](const cv::Range& range) {
+        for (int y = range.start; y < range.end; y++) {
+            const uchar* s = src.ptr<uchar>(y);
+            uchar* o = dst.ptr<uchar>(y);
+            int* l = labels ? labels->ptr<int>(y) : nullptr;
+            for (int x = 0; x < src.cols; x++, s += cn, o += cn) {
+                const int key = (dims == 3) ? colorKey(s, bits) : s[0];
+                const uchar* color = &colorLut[key * dims];
+                for (int d = 0; d < dims; d++) o[d] = color[d];
+                if (cn == 4) o[3] = s[3];
+                if (l) l[x] = labelLut[key];
+            }
+        }
+    });
+    result.recolorMs = lap();
+    return result;
+}
+
+} // namespace ColorQuantizer
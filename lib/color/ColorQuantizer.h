@@ -0,0 +1,47 @@
+#ifndef COLORQUANTIZER_H
+#define COLORQUANTIZER_H
+
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+// K-means color quantization on a compressed color histogram. The image is
+// first reduced to a weighted list of colors (exact gray levels, or color
+// bins of bitsPerChannel bits holding the mean of their pixels), k-means++
+// and Lloyd iterations with Hamerly's triangle-inequality bounds run on that
+// list in parallel, and the image is recolored in one pass through a
+// bin -> cluster lookup table. The cost of clustering no longer depends on
+// the pixel count.
+namespace ColorQuantizer {
+
+struct Options {
+    int maxIterations = 100;
+    double epsilon = 0.25;          // stop when no center moves further (color units)
+    int bitsPerChannel = 5;         // color bin resolution, 4..6
+    unsigned int seed = 0x12345;    // k-means++ seeding is deterministic
+};
+
+struct Result {
+    cv::Mat centers;                // k x channels, CV_32F (BGR order for color)
+    int iterations = 0;
+    int histogramColors = 0;        // non-empty bins clustered
+    double compactness = 0.0;       // weighted SSE over the histogram
+    double histogramMs = 0.0;
+    double clusterMs = 0.0;
+    double recolorMs = 0.0;
+};
+
+/**
+ * @brief Quantize an 8-bit gray, BGR or BGRA image to k colors
+ * @param src Source image (alpha is passed through)
+ * @param dst Recolored image, same type as src
+ * @param k Number of clusters
+ * @param options Iteration limits and histogram resolution
+ * @param labels Optional CV_32S cluster index per pixel
+ * @return Centers, iteration count and timings
+ */
+Result kmeans(const cv::Mat& src, cv::Mat& dst, int k, const Options& options = Options(),
+              cv::Mat* labels = nullptr);
+
+} // namespace ColorQuantizer
+
+#endif // COLORQUANTIZER_H
@@ -0,0 +1,450 @@
+#include "WaveletCodec.h"
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+
+// Thrown when the encoder hits its byte budget or the decoder runs out of bits
+struct BitstreamEnd {};
+
+class BitEncoder {
+public:
+    static const bool ENCODING = true;
+
+    BitEncoder(std::vector<uchar>& out, size_t limit)
+        : out(out), limit(limit), current(0), bitCount(0) {}
+
+    bool code(bool bit) {
+        current = (uchar)((current << 1) | (bit ? 1 : 0));
+        if (++bitCount == 8) {
+            if (limit > 0 && out.size() >= limit) {
+                throw BitstreamEnd();
+            }
+            out.push_back(current);
+            current = 0;
+            bitCount = 0;
+        }
+        return bit;
+    }
+
+    void flush() {
+        if (bitCount > 0 && (limit == 0 || out.size() < limit)) {
+            out.push_back((uchar)(current << (8 - bitCount)));
+        }
+        current = 0;
+        bitCount = 0;
+    }
+
+private:
+    std::vector<uchar>& out;
+    size_t limit;
+    uchar current;
+    int bitCount;
+};
+
+class BitDecoder {
+public:
+    static const bool ENCODING = false;
+
+    BitDecoder(const uchar* data, size_t size) : data(data), size(size), position(0) {}
+
+    bool code(bool) {
+        if (position >= size * 8) {
+            throw BitstreamEnd();
+        }
+        bool bit = ((data[position >> 3] >> (7 - (position & 7))) & 1) != 0;
+        position++;
+        return bit;
+    }
+
+private:
+    const uchar* data;
+    size_t size;
+    size_t position;
+};
+
+struct LisEntry {
+    int index;      // -1 once removed during a pass
+    bool typeB;     // false: D(i,j), true: L(i,j)
+};
+
+// SPIHT state for one channel. Coefficients are kept as magnitude + sign so
+// the encoder and decoder share the same representation.
+struct SpihtChannel {
+    int rows, cols;             // padded plane size
+    int llRows, llCols;         // coarsest approximation band
+    int levels;
+
+    std::vector<uint32_t> magnitude;
+    std::vector<uchar> negative;
+    std::vector<int8_t> lowestPlane;    // decoder: lowest bit plane known
+    std::vector<uint32_t> maxDescendant; // encoder: max |c| over D(i,j)
+
+    std::vector<int> lip, lsp;
+    std::vector<LisEntry> lis;
+
+    void init(int r, int c, int lv) {
+        rows = r;
+        cols = c;
+        levels = lv;
+        llRows = rows >> levels;
+        llCols = cols >> levels;
+        magnitude.assign((size_t)rows * cols, 0);
+        negative.assign((size_t)rows * cols, 0);
+        lowestPlane.assign((size_t)rows * cols, -1);
+
+        lip.clear();
+        lsp.clear();
+        lis.clear();
+        for (int i = 0; i < llRows; i++) {
+            for (int j = 0; j < llCols; j++) {
+                lip.push_back(i * cols + j);
+                lis.push_back({i * cols + j, false});
+            }
+        }
+    }
+
+    // Approximation coefficients own the three coarsest details at the same
+    // position; every detail coefficient owns the 2x2 block one level finer.
+    int children(int index, int out[4]) const {
+        int i = index / cols;
+        int j = index % cols;
+        if (i < llRows && j < llCols) {
+            out[0] = i * cols + (j + llCols);
+            out[1] = (i + llRows) * cols + j;
+            out[2] = (i + llRows) * cols + (j + llCols);
+            return 3;
+        }
+        if (2 * i >= rows || 2 * j >= cols) {
+            return 0;
+        }
+        out[0] = (2 * i) * cols + 2 * j;
+        out[1] = out[0] + 1;
+        out[2] = out[0] + cols;
+        out[3] = out[2] + 1;
+        return 4;
+    }
+
+    bool hasGrandchildren(int index) const {
+        int i = index / cols;
+        int j = index % cols;
+        if (i < llRows && j < llCols) {
+            return levels >= 2;
+        }
+        return 4 * i < rows && 4 * j < cols;
+    }
+
+    // Children always sit at larger raster indices, so one reverse sweep
+    // sees every child before its parent
+    void computeDescendantMaxima() {
+        maxDescendant.assign(magnitude.size(), 0);
+        int kids[4];
+        for (int index = (int)magnitude.size() - 1; index >= 0; index--) {
+            int count = children(index, kids);
+            uint32_t m = 0;
+            for (int k = 0; k < count; k++) {
+                m = std::max(m, std::max(magnitude[kids[k]], maxDescendant[kids[k]]));
+            }
+            maxDescendant[index] = m;
+        }
+    }
+};
+
+template <class Coder>
+bool codeSignificance(SpihtChannel& ch, int index, int plane, Coder& coder) {
+    const uint32_t threshold = 1u << plane;
+    bool significant = coder.code(Coder::ENCODING ? ch.magnitude[index] >= threshold : false);
+    if (significant) {
+        ch.negative[index] = coder.code(ch.negative[index] != 0) ? 1 : 0;
+        ch.magnitude[index] |= threshold;
+        ch.lowestPlane[index] = (int8_t)plane;
+        ch.lsp.push_back(index);
+    }
+    return significant;
+}
+
+template <class Coder>
+void sortingPass(SpihtChannel& ch, int plane, Coder& coder) {
+    const uint32_t threshold = 1u << plane;
+
+    // List of insignificant pixels
+    size_t kept = 0;
+    for (size_t k = 0; k < ch.lip.size(); k++) {
+        int index = ch.lip[k];
+        if (!codeSignificance(ch, index, plane, coder)) {
+            ch.lip[kept++] = index;
+        }
+    }
+    ch.lip.resize(kept);
+
+    // List of insignificant sets; entries appended here are handled in this pass
+    int kids[4];
+    for (size_t k = 0; k < ch.lis.size(); k++) {
+        LisEntry entry = ch.lis[k];
+        int count = ch.children(entry.index, kids);
+
+        if (!entry.typeB) {
+            bool significant = coder.code(Coder::ENCODING ? ch.maxDescendant[entry.index] >= threshold : false);
+            if (!significant) {
+                continue;
+            }
+            for (int c = 0; c < count; c++) {
+                if (!codeSignificance(ch, kids[c], plane, coder)) {
+                    ch.lip.push_back(kids[c]);
+                }
+            }
+            ch.lis[k].index = -1;
+            if (ch.hasGrandchildren(entry.index)) {
+                ch.lis.push_back({entry.index, true});
+            }
+        } else {
+            uint32_t maxGrand = 0;
+            if (Coder::ENCODING) {
+                for (int c = 0; c < count; c++) {
+                    maxGrand = std::max(maxGrand, ch.maxDescendant[kids[c]]);
+                }
+            }
+            bool significant = coder.code(maxGrand >= threshold);
+            if (!significant) {
+                continue;
+            }
+            ch.lis[k].index = -1;
+            for (int c = 0; c < count; c++) {
+                ch.lis.push_back({kids[c], false});
+            }
+        }
+    }
+
+    ch.lis.erase(std::remove_if(ch.lis.begin(), ch.lis.end(),
+                                [](const LisEntry& e) { return e.index < 0; }),
+                 ch.lis.end());
+}
+
+template <class Coder>
+void refinementPass(SpihtChannel& ch, int plane, size_t previousSize, Coder& coder) {
+    const uint32_t bit = 1u << plane;
+    for (size_t k = 0; k < previousSize; k++) {
+        int index = ch.lsp[k];
+        if (coder.code((ch.magnitude[index] & bit) != 0)) {
+            ch.magnitude[index] |= bit;
+        }
+        ch.lowestPlane[index] = (int8_t)plane;
+    }
+}
+
+// Channels are interleaved per bit plane so a truncated stream degrades
+// luma and chroma together
+template <class Coder>
+void runSpiht(std::vector<SpihtChannel>& channels, int topPlane, Coder& coder) {
+    for (int plane = topPlane; plane >= 0; plane--) {
+        for (SpihtChannel& ch : channels) {
+            size_t previousSize = ch.lsp.size();
+            sortingPass(ch, plane, coder);
+            refinementPass(ch, plane, previousSize, coder);
+        }
+    }
+}
+
+void writeUInt32(std::vector<uchar>& out, uint32_t value) {
+    for (int b = 0; b < 4; b++) {
+        out.push_back((uchar)((value >> (8 * b)) & 0xFF));
+    }
+}
+
+uint32_t readUInt32(const uchar* data) {
+    return (uint32_t)data[0] | ((uint32_t)data[1] << 8) |
+           ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+int paddedSize(int size, int levels) {
+    int multiple = 1 << levels;
+    return ((size + multiple - 1) / multiple) * multiple;
+}
+
+} // namespace
+
+std::vector<uchar> WaveletCodec::encode(const cv::Mat& image, int levels,
+                                        WaveletTransform::WaveletType type, size_t maxBytes) {
+    if (image.empty()) {
+        throw std::runtime_error("Cannot encode an empty image");
+    }
+
+    cv::Mat src8u;
+    if (image.depth() != CV_8U) {
+        image.convertTo(src8u, CV_8U);
+    } else {
+        src8u = image;
+    }
+
+    // Color is coded in YCrCb so most of the energy lands in one channel
+    std::vector<cv::Mat> channels;
+    if (src8u.channels() == 1) {
+        channels.push_back(src8u);
+    } else {
+        cv::Mat bgr = src8u;
+        if (src8u.channels() == 4) {
+            cv::cvtColor(src8u, bgr, cv::COLOR_BGRA2BGR);
+        }
+        cv::Mat ycrcb;
+        cv::cvtColor(bgr, ycrcb, cv::COLOR_BGR2YCrCb);
+        cv::split(ycrcb, channels);
+    }
+
+    const int rows = src8u.rows;
+    const int cols = src8u.cols;
+    levels = std::max(1, std::min(levels, 10));
+    while (levels > 1 && (1 << levels) > std::min(rows, cols)) {
+        levels--;
+    }
+    const int padRows = paddedSize(rows, levels);
+    const int padCols = paddedSize(cols, levels);
+
+    // Transform and quantize every channel concurrently
+    std::vector<SpihtChannel> states(channels.size());
+    cv::parallel_for_(cv::Range(0, (int)channels.size()), [&](const cv::Range& range) {
+        for (int c = range.start; c < range.end; c++) {
+            cv::Mat plane;
+            channels[c].convertTo(plane, CV_32F, 1.0, -128.0);
+            if (padRows != rows || padCols != cols) {
+                cv::Mat padded;
+                cv::copyMakeBorder(plane, padded, 0, padRows - rows, 0, padCols - cols, cv::BORDER_REPLICATE);
+                plane = padded;
+            }
+
+            for (int level = 0; level < levels; level++) {
+                cv::Mat band = plane(cv::Rect(0, 0, padCols >> level, padRows >> level));
+                WaveletTransform::forwardInPlace(band, type);
+            }
+
+            SpihtChannel& state = states[c];
+            state.init(padRows, padCols, levels);
+            for (int i = 0; i < padRows; i++) {
+                const float* row = plane.ptr<float>(i);
+                for (int j = 0; j < padCols; j++) {
+                    size_t index = (size_t)i * padCols + j;
+                    state.magnitude[index] = (uint32_t)std::lround(std::abs(row[j]));
+                    state.negative[index] = row[j] < 0.0f ? 1 : 0;
+                }
+            }
+            state.computeDescendantMaxima();
+        }
+    });
+
+    uint32_t maxMagnitude = 0;
+    for (const SpihtChannel& state : states) {
+        for (uint32_t m : state.magnitude) {
+            maxMagnitude = std::max(maxMagnitude, m);
+        }
+    }
+    int topPlane = -1;
+    while (topPlane < 31 && (maxMagnitude >> (topPlane + 1)) != 0) {
+        topPlane++;
+    }
+
+    std::vector<uchar> stream;
+    stream.reserve(maxBytes > 0 ? maxBytes : (size_t)rows * cols * channels.size() / 2 + HEADER_SIZE);
+    stream.push_back('N');
+    stream.push_back('W');
+    stream.push_back('C');
+    stream.push_back('1');
+    writeUInt32(stream, (uint32_t)rows);
+    writeUInt32(stream, (uint32_t)cols);
+    stream.push_back((uchar)channels.size());
+    stream.push_back((uchar)levels);
+    stream.push_back((uchar)type);
+    stream.push_back((uchar)(int8_t)topPlane);
+
+    if (maxBytes > 0 && maxBytes <= HEADER_SIZE) {
+        return stream;
+    }
+
+    BitEncoder encoder(stream, maxBytes);
+    try {
+        runSpiht(states, topPlane, encoder);
+        encoder.flush();
+    } catch (const BitstreamEnd&) {
+        // Byte budget reached: the stream is a valid embedded prefix
+    }
+
+    return stream;
+}
+
+cv::Mat WaveletCodec::decode(const std::vector<uchar>& stream, size_t maxBytes) {
+    if (stream.size() < HEADER_SIZE || stream[0] != 'N' || stream[1] != 'W' ||
+        stream[2] != 'C' || stream[3] != '1') {
+        throw std::runtime_error("Not a wavelet codec stream");
+    }
+
+    const int rows = (int)readUInt32(&stream[4]);
+    const int cols = (int)readUInt32(&stream[8]);
+    const int numChannels = stream[12];
+    const int levels = stream[13];
+    const WaveletTransform::WaveletType type = static_cast<WaveletTransform::WaveletType>(stream[14]);
+    const int topPlane = (int8_t)stream[15];
+
+    if (rows <= 0 || cols <= 0 || (numChannels != 1 && numChannels != 3) || levels < 1 || levels > 10) {
+        throw std::runtime_error("Corrupt wavelet codec header");
+    }
+
+    const int padRows = paddedSize(rows, levels);
+    const int padCols = paddedSize(cols, levels);
+
+    std::vector<SpihtChannel> states(numChannels);
+    for (SpihtChannel& state : states) {
+        state.init(padRows, padCols, levels);
+    }
+
+    size_t available = stream.size();
+    if (maxBytes > 0) {
+        available = std::min(available, std::max(maxBytes, HEADER_SIZE));
+    }
+
+    BitDecoder decoder(stream.data() + HEADER_SIZE, available - HEADER_SIZE);
+    try {
+        runSpiht(states, topPlane, decoder);
+    } catch (const BitstreamEnd&) {
+        // Truncated stream: reconstruct from what was decoded
+    }
+
+    // Dequantize at the middle of each coefficient's remaining uncertainty
+    // interval and run the inverse transforms concurrently
+    std::vector<cv::Mat> channels(numChannels);
+    cv::parallel_for_(cv::Range(0, numChannels), [&](const cv::Range& range) {
+        for (int c = range.start; c < range.end; c++) {
+            const SpihtChannel& state = states[c];
+            cv::Mat plane(padRows, padCols, CV_32F);
+            for (int i = 0; i < padRows; i++) {
+                float* row = plane.ptr<float>(i);
+                for (int j = 0; j < padCols; j++) {
+                    size_t index = (size_t)i * padCols + j;
+                    int lowest = state.lowestPlane[index];
+                    if (lowest < 0) {
+                        row[j] = 0.0f;
+                        continue;
+                    }
+                    float value = (float)state.magnitude[index] + (float)((1u << lowest) >> 1);
+                    row[j] = state.negative[index] ? -value : value;
+                }
+            }
+
+            for (int level = levels - 1; level >= 0; level--) {
+                cv::Mat band = plane(cv::Rect(0, 0, padCols >> level, padRows >> level));
+                WaveletTransform::inverseInPlace(band, type);
+            }
+
+            plane(cv::Rect(0, 0, cols, rows)).convertTo(channels[c], CV_8U, 1.0, 128.0);
+        }
+    });
+
+    cv::Mat result;
+    if (numChannels == 1) {
+        result = channels[0];
+    } else {
+        cv::Mat ycrcb;
+        cv::merge(channels, ycrcb);
+        cv::cvtColor(ycrcb, result, cv::COLOR_YCrCb2BGR);
+    }
+    return result;
+}
@@ -0,0 +1,32 @@
+#ifndef WAVELETCODEC_H
+#define WAVELETCODEC_H
+
+#include <opencv2/opencv.hpp>
+#include <vector>
+#include "WaveletTransform.h"
+
+// Embedded wavelet image codec: SPIHT bit-plane coding of the
+// WaveletTransform Mallat layout. The stream is ordered most significant
+// bit plane first, so it can be cut at any byte count and the prefix still
+// decodes to a (lower quality) image. Color images are coded as YCrCb with
+// the three channels interleaved per bit plane.
+//
+// Stream layout: 16-byte header ("NWC1", rows, cols, channels, levels,
+// wavelet type, top bit plane) followed by the packed SPIHT bits.
+class WaveletCodec {
+public:
+    static const size_t HEADER_SIZE = 16;
+
+    // Encode an 8-bit gray, BGR or BGRA image (alpha is dropped).
+    // maxBytes limits the whole stream including the header; 0 codes every
+    // bit plane (near-lossless for 9/7, lossless for 5/3).
+    static std::vector<uchar> encode(const cv::Mat& image, int levels = 5,
+                                     WaveletTransform::WaveletType type = WaveletTransform::CDF97,
+                                     size_t maxBytes = 0);
+
+    // Decode the first maxBytes of a stream (0 = everything available).
+    // Returns CV_8UC1 or CV_8UC3.
+    static cv::Mat decode(const std::vector<uchar>& stream, size_t maxBytes = 0);
+};
+
+#endif // WAVELETCODEC_H
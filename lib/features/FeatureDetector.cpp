@@ -0,0 +1,553 @@
+#include "FeatureDetector.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+
+namespace {
+
+const char KEYPOINT_MAGIC[4] = {'N', 'K', 'P', '1'};
+const int ORB_PATCH_SIZE = 31;
+const int ORB_HALF_PATCH = 15;
+
+struct KeypointRecord {
+    float x, y, size, angle, response;
+    int32_t octave;
+};
+static_assert(sizeof(KeypointRecord) == 24, "keypoint records are written as raw 24-byte structs");
+
+using FeatureDetector::Candidate;
+
+// Strict ordering: higher response wins, equal responses go to the earlier pixel
+inline bool stronger(const Candidate& a, const Candidate& b) {
+    return a.response > b.response || (a.response == b.response && a.index < b.index);
+}
+
+double msSince(std::chrono::high_resolution_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(
+        std::chrono::high_resolution_clock::now() - start).count();
+}
+
+cv::Rect expand(const cv::Rect& r, int by, const cv::Rect& bounds) {
+    return cv::Rect(r.x - by, r.y - by, r.width + 2 * by, r.height + 2 * by) & bounds;
+}
+
+// 3x3 local maximum. Earlier neighbors must be strictly weaker and later
+// ones no stronger, so a plateau yields exactly one pixel.
+bool isLocalMax(const cv::Mat& response, int x, int y) {
+    const float v = response.at<float>(y, x);
+    for (int dy = -1; dy <= 1; dy++) {
+        const int ny = y + dy;
+        if (ny < 0 || ny >= response.rows) continue;
+        const float* row = response.ptr<float>(ny);
+        for (int dx = -1; dx <= 1; dx++) {
+            const int nx = x + dx;
+            if (nx < 0 || nx >= response.cols || (dx == 0 && dy == 0)) continue;
+            const bool earlier = dy < 0 || (dy == 0 && dx < 0);
+            if (earlier ? row[nx] >= v : row[nx] > v) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Keeps the candidates inside core that have no stronger candidate closer
+// than radius. Candidates in the halo around core only act as suppressors,
+// which makes the outcome independent of where the tile borders fall.
+void suppressRadius(std::vector<Candidate>& candidates, const cv::Rect& core,
+                    const cv::Rect& outer, int radius) {
+    const int cellsX = outer.width / radius + 1;
+    const int cellsY = outer.height / radius + 1;
+    std::vector<int> start(static_cast<size_t>(cellsX) * cellsY + 1, 0);
+    std::vector<int> cellOf(candidates.size());
+    for (size_t i = 0; i < candidates.size(); i++) {
+        const int c = ((candidates[i].y - outer.y) / radius) * cellsX + (candidates[i].x - outer.x) / radius;
+        cellOf[i] = c;
+        start[c + 1]++;
+    }
+    std::partial_sum(start.begin(), start.end(), start.begin());
+    std::vector<int> members(candidates.size());
+    std::vector<int> fill(start.begin(), start.end() - 1);
+    for (size_t i = 0; i < candidates.size(); i++) {
+        members[fill[cellOf[i]]++] = static_cast<int>(i);
+    }
+
+    const int r2 = radius * radius;
+    std::vector<Candidate> kept;
+    for (size_t i = 0; i < candidates.size(); i++) {
+        const Candidate& c = candidates[i];
+        if (!core.contains(cv::Point(c.x, c.y))) continue;
+
+        const int gx = cellOf[i] % cellsX;
+        const int gy = cellOf[i] / cellsX;
+        bool suppressed = false;
+        for (int cy = std::max(0, gy - 1); cy <= std::min(cellsY - 1, gy + 1) && !suppressed; cy++) {
+            for (int cx = std::max(0, gx - 1); cx <= std::min(cellsX - 1, gx + 1) && !suppressed; cx++) {
+                const int cell = cy * cellsX + cx;
+                for (int m = start[cell]; m < start[cell + 1]; m++) {
+                    const Candidate& o = candidates[members[m]];
+                    const int dx = o.x - c.x;
+                    const int dy = o.y - c.y;
+                    if (dx * dx + dy * dy < r2 && stronger(o, c)) {
+                        suppressed = true;
+                        break;
+                    }
+                }
+            }
+        }
+        if (!suppressed) {
+            kept.push_back(c);
+        }
+    }
+    candidates.swap(kept);
+}
+
+// Ranks candidates within their grid cell and drops those past the per-cell
+// cap. The order of the list is preserved.
+void bucket(std::vector<Candidate>& candidates, int cellSize, int maxPerCell, int levelCols) {
+    if (cellSize <= 0 || candidates.empty()) return;
+
+    const int cellsX = (levelCols + cellSize - 1) / cellSize;
+    auto cellOf = [&](const Candidate& c) { return (c.y / cellSize) * cellsX + c.x / cellSize; };
+    std::vector<int> order(candidates.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](int a, int b) {
+        const int ca = cellOf(candidates[a]);
+        const int cb = cellOf(candidates[b]);
+        return ca != cb ? ca < cb : stronger(candidates[a], candidates[b]);
+    });
+
+    int previous = -1;
+    int rank = 0;
+    for (int i : order) {
+        const int cell = cellOf(candidates[i]);
+        rank = cell == previous ? rank + 1 : 0;
+        previous = cell;
+        candidates[i].rank = rank;
+    }
+
+    if (maxPerCell > 0) {
+        candidates.erase(std::remove_if(candidates.begin(), candidates.end(),
+                                        [&](const Candidate& c) { return c.rank >= maxPerCell; }),
+                         candidates.end());
+    }
+}
+
+// Keeps count candidates: every cell's best before any cell's second best,
+// by response within a rank. The list order is preserved.
+void selectBest(std::vector<Candidate>& candidates, int count) {
+    if (count <= 0 || candidates.size() <= static_cast<size_t>(count)) return;
+
+    std::vector<int> order(candidates.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::nth_element(order.begin(), order.begin() + count, order.end(), [&](int a, int b) {
+        const Candidate& ca = candidates[a];
+        const Candidate& cb = candidates[b];
+        if (ca.rank != cb.rank) return ca.rank < cb.rank;
+        if (ca.response != cb.response) return ca.response > cb.response;
+        return a < b;
+    });
+    order.resize(count);
+    std::sort(order.begin(), order.end());
+
+    std::vector<Candidate> kept;
+    kept.reserve(count);
+    for (int i : order) {
+        kept.push_back(candidates[i]);
+    }
+    candidates.swap(kept);
+}
+
+// Features per pyramid level in the proportions cv::ORB uses (geometric in
+// the level area), so the descriptors see the same scale distribution
+std::vector<int> orbLevelQuota(int features, float scaleFactor, int levels) {
+    std::vector<int> quota(levels, 0);
+    const double factor = 1.0 / scaleFactor;
+    double desired = features * (1.0 - factor) / (1.0 - std::pow(factor, levels));
+    int sum = 0;
+    for (int level = 0; level < levels - 1; level++) {
+        quota[level] = cvRound(desired);
+        sum += quota[level];
+        desired *= factor;
+    }
+    quota[levels - 1] = std::max(features - sum, 0);
+    return quota;
+}
+
+// Intensity-centroid orientation over the circular ORB patch, as cv::ORB
+// computes it; provided keypoints keep their angle in ORB::compute
+float intensityCentroidAngle(const cv::Mat& image, int x, int y, const std::vector<int>& umax) {
+    const uchar* center = image.ptr<uchar>(y) + x;
+    const int step = static_cast<int>(image.step1());
+    int m01 = 0;
+    int m10 = 0;
+    for (int u = -ORB_HALF_PATCH; u <= ORB_HALF_PATCH; u++) {
+        m10 += u * center[u];
+    }
+    for (int v = 1; v <= ORB_HALF_PATCH; v++) {
+        int vSum = 0;
+        const int d = umax[v];
+        for (int u = -d; u <= d; u++) {
+            const int plus = center[u + v * step];
+            const int minus = center[u - v * step];
+            vSum += plus - minus;
+            m10 += u * (plus + minus);
+        }
+        m01 += v * vSum;
+    }
+    return cv::fastAtan2(static_cast<float>(m01), static_cast<float>(m10));
+}
+
+std::vector<int> circularPatchExtent() {
+    std::vector<int> umax(ORB_HALF_PATCH + 2);
+    const int vmax = cvFloor(ORB_HALF_PATCH * std::sqrt(2.0) / 2 + 1);
+    const int vmin = cvCeil(ORB_HALF_PATCH * std::sqrt(2.0) / 2);
+    for (int v = 0; v <= vmax; v++) {
+        umax[v] = cvRound(std::sqrt(static_cast<double>(ORB_HALF_PATCH * ORB_HALF_PATCH - v * v)));
+    }
+    // Make the patch symmetric in u and v
+    for (int v = ORB_HALF_PATCH, v0 = 0; v >= vmin; v--) {
+        while (umax[v0] == umax[v0 + 1]) v0++;
+        umax[v] = v0;
+        v0++;
+    }
+    return umax;
+}
+
+cv::Mat toGray(const cv::Mat& image) {
+    if (image.channels() == 1) {
+        return image;
+    }
+    cv::Mat gray;
+    cv::cvtColor(image, gray, image.channels() == 4 ? cv::COLOR_BGRA2GRAY : cv::COLOR_BGR2GRAY);
+    return gray;
+}
+
+} // namespace
+
+namespace FeatureDetector {
+
+CandidateSet collect(const cv::Mat& image, const Options& options) {
+    if (image.empty() || image.depth() != CV_8U) {
+        throw std::runtime_error("Feature detection expects a non-empty 8-bit image");
+    }
+
+    const auto start = std::chrono::high_resolution_clock::now();
+    const bool responseMethod = options.method == Method::Harris || options.method == Method::ShiTomasi;
+    const bool orb = options.method == Method::ORB;
+    const int tileSize = std::max(64, options.tileSize);
+
+    CandidateSet set;
+    set.options = options;
+
+    // Level 0 is the image itself; ORB adds the scale pyramid, built from
+    // the previous level exactly as cv::ORB does
+    const int border = orb ? std::max(options.edgeThreshold, ORB_HALF_PATCH + 1) : 0;
+    set.pyramid.push_back(toGray(image));
+    set.scales.push_back(1.0f);
+    for (int level = 1; orb && level < options.levels; level++) {
+        const float scale = std::pow(options.scaleFactor, static_cast<float>(level));
+        const cv::Size size(cvRound(image.cols / scale), cvRound(image.rows / scale));
+        if (size.width <= 2 * border || size.height <= 2 * border) break;
+        cv::Mat next;
+        cv::resize(set.pyramid.back(), next, size, 0, 0, cv::INTER_LINEAR_EXACT);
+        set.pyramid.push_back(next);
+        set.scales.push_back(scale);
+    }
+    const cv::Mat& gray = set.pyramid[0];
+
+    for (int level = 0; level < static_cast<int>(set.pyramid.size()); level++) {
+        const cv::Mat& img = set.pyramid[level];
+        for (int y = 0; y < img.rows; y += tileSize) {
+            for (int x = 0; x < img.cols; x += tileSize) {
+                set.tiles.push_back({level, cv::Rect(x, y, std::min(tileSize, img.cols - x),
+                                                     std::min(tileSize, img.rows - y)), {}});
+            }
+        }
+    }
+    const int tileCount = static_cast<int>(set.tiles.size());
+
+    // Harris / Shi-Tomasi response, computed per tile over a halo wide
+    // enough for the derivative and block windows
+    cv::Mat response;
+    float floor = 0.0f;
+    if (responseMethod) {
+        response.create(gray.size(), CV_32F);
+        std::vector<double> tileMin(tileCount), tileMax(tileCount);
+        const int halo = options.apertureSize / 2 + options.blockSize / 2 + 1;
+        const cv::Rect bounds(0, 0, gray.cols, gray.rows);
+        cv::parallel_for_(cv::Range(0, tileCount), [&](const cv::Range& range) {
+            for (int i = range.start; i < range.end; i++) {
+                const cv::Rect& core = set.tiles[i].core;
+                const cv::Rect outer = expand(core, halo, bounds);
+                cv::Mat tileResponse;
+                if (options.method == Method::Harris) {
+                    cv::cornerHarris(gray(outer), tileResponse, options.blockSize,
+                                     options.apertureSize, options.harrisK);
+                } else {
+                    cv::cornerMinEigenVal(gray(outer), tileResponse, options.blockSize, options.apertureSize);
+                }
+                tileResponse(core - outer.tl()).copyTo(response(core));
+                cv::minMaxLoc(response(core), &tileMin[i], &tileMax[i]);
+            }
+        });
+
+        set.minResponse = *std::min_element(tileMin.begin(), tileMin.end());
+        set.maxResponse = *std::max_element(tileMax.begin(), tileMax.end());
+        // Every threshold either method can select lies above this
+        floor = options.method == Method::Harris ? static_cast<float>(set.minResponse) : 0.0f;
+    }
+
+    // Every 3x3 local maximum above the floor (or every FAST corner) of the
+    // tile core, strongest first
+    cv::parallel_for_(cv::Range(0, tileCount), [&](const cv::Range& range) {
+        for (int i = range.start; i < range.end; i++) {
+            TileCandidates& tile = set.tiles[i];
+            const cv::Mat& img = set.pyramid[tile.level];
+            const cv::Rect& core = tile.core;
+
+            if (responseMethod) {
+                for (int y = core.y; y < core.y + core.height; y++) {
+                    const float* row = response.ptr<float>(y);
+                    for (int x = core.x; x < core.x + core.width; x++) {
+                        if (row[x] > floor && isLocalMax(response, x, y)) {
+                            tile.candidates.push_back({x, y, row[x], y * img.cols + x, 0});
+                        }
+                    }
+                }
+            } else {
+                // FAST tests a radius-3 circle and its suppression needs the
+                // neighbors' scores, so it sees four more pixels on each side
+                const cv::Rect fastArea = expand(core, 4, cv::Rect(0, 0, img.cols, img.rows));
+                std::vector<cv::KeyPoint> corners;
+                cv::FAST(img(fastArea), corners, options.fastThreshold, options.fastNonMaxSuppression,
+                         static_cast<cv::FastFeatureDetector::DetectorType>(options.fastType));
+                for (const cv::KeyPoint& kp : corners) {
+                    const int x = cvRound(kp.pt.x) + fastArea.x;
+                    const int y = cvRound(kp.pt.y) + fastArea.y;
+                    if (!core.contains(cv::Point(x, y))) continue;
+                    if (orb && (x < border || y < border || x >= img.cols - border || y >= img.rows - border)) continue;
+                    tile.candidates.push_back({x, y, kp.response, y * img.cols + x, 0});
+                }
+            }
+            std::sort(tile.candidates.begin(), tile.candidates.end(), stronger);
+        }
+    });
+
+    set.collectMs = msSince(start);
+    return set;
+}
+
+bool canSelect(const CandidateSet& set, const Options& options) {
+    const Options& collected = set.options;
+    if (set.empty() || collected.method != options.method || collected.tileSize != options.tileSize) {
+        return false;
+    }
+
+    switch (options.method) {
+        case Method::Harris:
+            return collected.blockSize == options.blockSize && collected.apertureSize == options.apertureSize &&
+                   collected.harrisK == options.harrisK;
+        case Method::ShiTomasi:
+            return collected.blockSize == options.blockSize && collected.apertureSize == options.apertureSize;
+        case Method::FAST:
+            if (collected.fastType != options.fastType ||
+                collected.fastNonMaxSuppression != options.fastNonMaxSuppression) {
+                return false;
+            }
+            return collected.fastThreshold == options.fastThreshold ||
+                   (collected.fastThreshold < options.fastThreshold && collected.fastNonMaxSuppression &&
+                    collected.fastType == cv::FastFeatureDetector::TYPE_9_16);
+        case Method::ORB:
+            return collected.scaleFactor == options.scaleFactor && collected.levels == options.levels &&
+                   collected.edgeThreshold == options.edgeThreshold &&
+                   collected.fastThreshold == options.fastThreshold;
+    }
+    return false;
+}
+
+Result select(const CandidateSet& set, const Options& options) {
+    if (set.empty()) {
+        throw std::runtime_error("No feature candidates have been collected");
+    }
+
+    const auto start = std::chrono::high_resolution_clock::now();
+    const Method method = set.options.method;
+    const bool orb = method == Method::ORB;
+    const int radius = std::max(0, options.nmsRadius);
+    const int tileCount = static_cast<int>(set.tiles.size());
+
+    // The threshold cuts every strongest-first list at one point
+    float cut = -std::numeric_limits<float>::max();
+    bool strict = false;
+    if (method == Method::Harris) {
+        cut = static_cast<float>(set.minResponse + (set.maxResponse - set.minResponse) * options.threshold / 255.0);
+        strict = true;
+    } else if (method == Method::ShiTomasi) {
+        cut = static_cast<float>(set.maxResponse * options.threshold);
+        strict = true;
+    } else if (method == Method::FAST && options.fastThreshold > set.options.fastThreshold) {
+        cut = static_cast<float>(options.fastThreshold);
+    }
+    std::vector<int> selected(tileCount);
+    for (int i = 0; i < tileCount; i++) {
+        const std::vector<Candidate>& list = set.tiles[i].candidates;
+        selected[i] = static_cast<int>(std::partition_point(list.begin(), list.end(), [&](const Candidate& c) {
+            return strict ? c.response > cut : c.response >= cut;
+        }) - list.begin());
+    }
+
+    // Radius suppression per tile; selected candidates of neighboring tiles
+    // within the radius act as suppressors
+    std::vector<std::vector<Candidate>> kept(tileCount);
+    cv::parallel_for_(cv::Range(0, tileCount), [&](const cv::Range& range) {
+        for (int i = range.start; i < range.end; i++) {
+            const TileCandidates& tile = set.tiles[i];
+            std::vector<Candidate>& candidates = kept[i];
+            candidates.assign(tile.candidates.begin(), tile.candidates.begin() + selected[i]);
+            if (radius <= 1) continue;
+
+            const cv::Mat& img = set.pyramid[tile.level];
+            const cv::Rect outer = expand(tile.core, radius, cv::Rect(0, 0, img.cols, img.rows));
+            for (int j = 0; j < tileCount; j++) {
+                const TileCandidates& other = set.tiles[j];
+                if (j == i || other.level != tile.level || (other.core & outer).area() == 0) continue;
+                for (int k = 0; k < selected[j]; k++) {
+                    const Candidate& c = other.candidates[k];
+                    if (outer.contains(cv::Point(c.x, c.y))) {
+                        candidates.push_back(c);
+                    }
+                }
+            }
+            suppressRadius(candidates, tile.core, outer, radius);
+        }
+    });
+
+    // Merge in tile order, bucket and apply the feature cap per level
+    const int levels = static_cast<int>(set.pyramid.size());
+    std::vector<int> quota(levels, options.maxFeatures);
+    if (orb && options.maxFeatures > 0) {
+        quota = orbLevelQuota(options.maxFeatures, set.options.scaleFactor, set.options.levels);
+        quota.resize(levels);
+    }
+
+    Result result;
+    result.tiles = tileCount;
+    const std::vector<int> umax = orb ? circularPatchExtent() : std::vector<int>();
+    const float keypointSize = method == Method::Harris || method == Method::ShiTomasi
+        ? static_cast<float>(2 * std::max(radius, 1) + 1) : 7.0f;
+    for (int level = 0; level < levels; level++) {
+        std::vector<Candidate> candidates;
+        for (int i = 0; i < tileCount; i++) {
+            if (set.tiles[i].level != level) continue;
+            candidates.insert(candidates.end(), kept[i].begin(), kept[i].end());
+        }
+        bucket(candidates, std::max(0, options.cellSize), options.maxPerCell, set.pyramid[level].cols);
+        result.candidates += static_cast<int>(candidates.size());
+        selectBest(candidates, quota[level]);
+
+        const float scale = set.scales[level];
+        for (const Candidate& c : candidates) {
+            if (orb) {
+                result.keypoints.emplace_back(c.x * scale, c.y * scale, ORB_PATCH_SIZE * scale,
+                                              intensityCentroidAngle(set.pyramid[level], c.x, c.y, umax),
+                                              c.response, level);
+            } else {
+                result.keypoints.emplace_back(static_cast<float>(c.x), static_cast<float>(c.y),
+                                              keypointSize, -1.0f, c.response, 0);
+            }
+        }
+    }
+    result.detectMs = msSince(start);
+
+    if (orb && !result.keypoints.empty()) {
+        const auto describeStart = std::chrono::high_resolution_clock::now();
+        cv::Ptr<cv::ORB> extractor = cv::ORB::create(static_cast<int>(result.keypoints.size()),
+                                                     set.options.scaleFactor, set.options.levels,
+                                                     set.options.edgeThreshold, 0, 2, cv::ORB::HARRIS_SCORE,
+                                                     ORB_PATCH_SIZE, set.options.fastThreshold);
+        extractor->compute(set.pyramid[0], result.keypoints, result.descriptors);
+        result.describeMs = msSince(describeStart);
+    }
+
+    return result;
+}
+
+Result detect(const cv::Mat& image, const Options& options) {
+    const CandidateSet set = collect(image, options);
+    Result result = select(set, options);
+    result.detectMs += set.collectMs;
+    return result;
+}
+
+bool save(const std::string& path, const std::vector<cv::KeyPoint>& keypoints, const cv::Mat& descriptors) {
+    if (!descriptors.empty() && (descriptors.rows != static_cast<int>(keypoints.size()) || descriptors.channels() != 1)) {
+        return false;
+    }
+    std::ofstream file(path, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+
+    int32_t header[3] = {static_cast<int32_t>(keypoints.size()), descriptors.empty() ? 0 : descriptors.cols,
+                         descriptors.empty() ? CV_8U : descriptors.type()};
+    file.write(KEYPOINT_MAGIC, sizeof(KEYPOINT_MAGIC));
+    file.write(reinterpret_cast<const char*>(header), sizeof(header));
+
+    std::vector<KeypointRecord> records;
+    records.reserve(keypoints.size());
+    for (const cv::KeyPoint& kp : keypoints) {
+        records.push_back({kp.pt.x, kp.pt.y, kp.size, kp.angle, kp.response, kp.octave});
+    }
+    file.write(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(KeypointRecord));
+    for (int i = 0; i < descriptors.rows; i++) {
+        file.write(descriptors.ptr<char>(i), descriptors.cols * descriptors.elemSize());
+    }
+    return static_cast<bool>(file);
+}
+
+bool load(const std::string& path, std::vector<cv::KeyPoint>& keypoints, cv::Mat& descriptors) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+
+    char magic[4];
+    int32_t header[3];
+    file.read(magic, sizeof(magic));
+    file.read(reinterpret_cast<char*>(header), sizeof(header));
+    if (!file || std::memcmp(magic, KEYPOINT_MAGIC, sizeof(magic)) != 0 ||
+        header[0] < 0 || header[0] > (1 << 26) || header[1] < 0 || header[1] > 4096 ||
+        CV_MAT_CN(header[2]) != 1 || CV_MAT_DEPTH(header[2]) > CV_64F) {
+        return false;
+    }
+
+    std::vector<KeypointRecord> records(header[0]);
+    file.read(reinterpret_cast<char*>(records.data()), records.size() * sizeof(KeypointRecord));
+    cv::Mat rows;
+    if (header[1] > 0 && header[0] > 0) {
+        rows.create(header[0], header[1], header[2]);
+        for (int i = 0; i < rows.rows; i++) {
+            file.read(rows.ptr<char>(i), rows.cols * rows.elemSize());
+        }
+    }
+    if (!file) {
+        return false;
+    }
+
+    keypoints.clear();
+    keypoints.reserve(records.size());
+    for (const KeypointRecord& r : records) {
+        keypoints.emplace_back(r.x, r.y, r.size, r.angle, r.response, r.octave);
+    }
+    descriptors = rows;
+    return true;
+}
+
+} // namespace FeatureDetector
@@ -0,0 +1,140 @@
+#ifndef FEATUREDETECTOR_H
+#define FEATUREDETECTOR_H
+
+#include <opencv2/opencv.hpp>
+#include <opencv2/features2d.hpp>
+#include <string>
+#include <vector>
+
+// Tiled keypoint detection in two stages. collect() does the expensive,
+// threshold-independent work in parallel tiles - grayscale and ORB pyramid,
+// Harris / Shi-Tomasi response or FAST scores, 3x3 local maxima - and keeps
+// each tile's candidates sorted strongest first. select() then applies the
+// threshold as a prefix of every list, radius non-maximum suppression
+// (tiles see their neighbors' candidates, so tile borders do not change the
+// result), grid bucketing and the feature cap. Bucketing ranks candidates
+// within their grid cell and the cap takes every cell's best before any
+// cell's second best, which spreads the keypoints over the image instead of
+// piling them on the strongest texture.
+namespace FeatureDetector {
+
+enum class Method { Harris, ShiTomasi, FAST, ORB };
+
+struct Options {
+    Method method = Method::Harris;
+    int tileSize = 512;
+    int cellSize = 64;              // bucketing grid (level pixels), 0 disables bucketing
+    int maxPerCell = 0;             // 0 = no per-cell cap
+    int maxFeatures = 0;            // 0 = keep every candidate; ORB splits it over levels
+    int nmsRadius = 0;              // a stronger candidate closer than this suppresses (px)
+
+    // Harris / Shi-Tomasi
+    int blockSize = 2;
+    int apertureSize = 3;
+    double harrisK = 0.04;
+    double threshold = 100.0;       // Harris: 0..255 on the min-max normalized map,
+                                    // Shi-Tomasi: fraction of the strongest response
+
+    // FAST / ORB
+    int fastThreshold = 10;
+    bool fastNonMaxSuppression = true;
+    int fastType = cv::FastFeatureDetector::TYPE_9_16;
+
+    // ORB
+    float scaleFactor = 1.2f;
+    int levels = 8;
+    int edgeThreshold = 31;
+};
+
+struct Candidate {
+    int x, y;                       // level coordinates
+    float response;
+    int index;                      // raster index in the level, breaks response ties
+    int rank;                       // position within its bucketing cell, best first
+};
+
+struct TileCandidates {
+    int level = 0;
+    cv::Rect core;
+    std::vector<Candidate> candidates;  // strongest first
+};
+
+// Everything select() needs, reusable while only thresholds, suppression
+// radius, grid or feature limits change (see canSelect)
+struct CandidateSet {
+    Options options;                // parameters the set was collected with
+    std::vector<cv::Mat> pyramid;   // level 0 is the grayscale image
+    std::vector<float> scales;
+    std::vector<TileCandidates> tiles;
+    double minResponse = 0.0;       // Harris / Shi-Tomasi response range
+    double maxResponse = 0.0;
+    double collectMs = 0.0;
+
+    bool empty() const { return pyramid.empty(); }
+};
+
+struct Result {
+    std::vector<cv::KeyPoint> keypoints;
+    cv::Mat descriptors;            // ORB: one CV_8U row of 32 bytes per keypoint
+    int candidates = 0;             // after suppression, before the feature cap
+    int tiles = 0;
+    double detectMs = 0.0;          // select() only; detect() adds collect()
+    double describeMs = 0.0;
+};
+
+/**
+ * @brief Threshold-independent stage: responses and sorted tile candidates
+ *
+ * Harris and Shi-Tomasi keep every 3x3 local maximum, so any threshold can
+ * be selected later. FAST keeps the corners at options.fastThreshold with
+ * their scores.
+ * @param image 8-bit gray, BGR or BGRA image
+ * @param options Method and the parameters that shape the responses
+ */
+CandidateSet collect(const cv::Mat& image, const Options& options);
+
+/**
+ * @brief Whether select() can serve options from a set of the same image
+ *
+ * True when every parameter that shapes the responses matches. A higher
+ * FAST threshold is served from a lower one only for the 9/16 test with
+ * suppression, where OpenCV's score is exactly the highest threshold at
+ * which the corner survives.
+ */
+bool canSelect(const CandidateSet& set, const Options& options);
+
+/**
+ * @brief Threshold, suppression, bucketing and cap over a collected set
+ * @return Keypoints in level-0 coordinates, ORB descriptors and timings
+ */
+Result select(const CandidateSet& set, const Options& options);
+
+/**
+ * @brief collect() and select() in one call
+ * @param image 8-bit gray, BGR or BGRA image
+ * @param options Method, grid and detector parameters
+ * @return Keypoints in level-0 coordinates, ORB descriptors and timings
+ */
+Result detect(const cv::Mat& image, const Options& options = Options());
+
+/**
+ * @brief Write keypoints and descriptors to a compact binary file
+ *
+ * Layout: "NKP1", int32 count, descriptor columns and type, then one
+ * 24-byte record per keypoint (float x, y, size, angle, response, int32
+ * octave) followed by the raw descriptor rows.
+ * @param descriptors Empty, or one row per keypoint
+ * @return True if the file was written
+ */
+bool save(const std::string& path, const std::vector<cv::KeyPoint>& keypoints,
+          const cv::Mat& descriptors);
+
+/**
+ * @brief Read a file written by save()
+ * @return False if the file is missing, truncated or not a keypoint file
+ */
+bool load(const std::string& path, std::vector<cv::KeyPoint>& keypoints, cv::Mat& descriptors);
+
+} // namespace FeatureDetector
+
+#endif // FEATUREDETECTOR_H
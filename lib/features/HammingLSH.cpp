@@ -0,0 +1,165 @@
+#include "HammingLSH.h"
+#include <opencv2/core/hal/hal.hpp>
+#include <algorithm>
+#include <climits>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+
+namespace {
+
+// Keeps the two smallest distances seen for one query
+struct BestTwo {
+    int index = -1;
+    int distance = INT_MAX;
+    int second = INT_MAX;
+
+    void offer(int i, int d) {
+        if (d < distance) {
+            second = distance;
+            distance = d;
+            index = i;
+        } else if (d < second) {
+            second = d;
+        }
+    }
+};
+
+} // namespace
+
+HammingLSH::HammingLSH(const Options& options) : options(options) {
+    this->options.tables = std::max(1, options.tables);
+    this->options.keyBits = std::min(24, std::max(1, options.keyBits));
+    this->options.probeLevel = std::min(2, std::max(0, options.probeLevel));
+}
+
+int HammingLSH::hamming(const uchar* a, const uchar* b, int bytes) {
+    return cv::hal::normHamming(a, b, bytes);
+}
+
+uint32_t HammingLSH::key(const uchar* descriptor, int table) const {
+    uint32_t k = 0;
+    const std::vector<int>& bits = bitPositions[table];
+    for (int i = 0; i < indexKeyBits; i++) {
+        k |= static_cast<uint32_t>((descriptor[bits[i] >> 3] >> (bits[i] & 7)) & 1) << i;
+    }
+    return k;
+}
+
+void HammingLSH::build(const cv::Mat& trainDescriptors) {
+    if (trainDescriptors.empty()) {
+        descriptors = cv::Mat();
+        indexKeyBits = 0;
+        return;
+    }
+    if (trainDescriptors.type() != CV_8UC1) {
+        throw std::runtime_error("LSH index expects CV_8U binary descriptors");
+    }
+
+    descriptors = trainDescriptors;
+    const int totalBits = descriptors.cols * 8;
+    // Short descriptors lower the key width of this index only; options keep
+    // the requested width for the next build
+    const int keyBits = std::min(options.keyBits, totalBits);
+    indexKeyBits = keyBits;
+
+    // Distinct bit positions per table, drawn with a fixed seed so the
+    // index (and every match it returns) is reproducible
+    std::mt19937 rng(options.seed);
+    std::vector<int> positions(totalBits);
+    std::iota(positions.begin(), positions.end(), 0);
+    bitPositions.assign(options.tables, std::vector<int>());
+    for (int t = 0; t < options.tables; t++) {
+        std::shuffle(positions.begin(), positions.end(), rng);
+        bitPositions[t].assign(positions.begin(), positions.begin() + keyBits);
+    }
+
+    const int buckets = 1 << keyBits;
+    bucketStart.assign(options.tables, std::vector<int>());
+    bucketItems.assign(options.tables, std::vector<int>());
+    cv::parallel_for_(cv::Range(0, options.tables), [&](const cv::Range& range) {
+        std::vector<uint32_t> keys(descriptors.rows);
+        for (int t = range.start; t < range.end; t++) {
+            std::vector<int>& start = bucketStart[t];
+            start.assign(buckets + 1, 0);
+            for (int i = 0; i < descriptors.rows; i++) {
+                keys[i] = key(descriptors.ptr<uchar>(i), t);
+                start[keys[i] + 1]++;
+            }
+            std::partial_sum(start.begin(), start.end(), start.begin());
+
+            std::vector<int>& items = bucketItems[t];
+            items.resize(descriptors.rows);
+            std::vector<int> fill(start.begin(), start.end() - 1);
+            for (int i = 0; i < descriptors.rows; i++) {
+                items[fill[keys[i]]++] = i;
+            }
+        }
+    });
+}
+
+std::vector<HammingLSH::Match> HammingLSH::knnMatch(const cv::Mat& queries) const {
+    std::vector<Match> matches(queries.rows);
+    if (queries.empty()) {
+        return matches;
+    }
+    if (queries.type() != CV_8UC1 || (!empty() && queries.cols != descriptors.cols)) {
+        throw std::runtime_error("LSH queries must be CV_8U descriptors of the indexed length");
+    }
+
+    const int bytes = queries.cols;
+    const int keyBits = indexKeyBits;
+
+    // Explicit chunks, so the visited stamps are allocated once per chunk
+    // and not once per range the scheduler hands out
+    const int chunks = std::min(queries.rows, std::max(1, cv::getNumThreads()) * 4);
+    cv::parallel_for_(cv::Range(0, chunks), [&](const cv::Range& range) {
+        // A descriptor reached through several tables or probes is compared
+        // once per query; stamping with the query index needs no clearing
+        std::vector<int> visited(descriptors.rows, -1);
+        const int first = static_cast<int>(static_cast<long long>(queries.rows) * range.start / chunks);
+        const int last = static_cast<int>(static_cast<long long>(queries.rows) * range.end / chunks);
+        for (int q = first; q < last; q++) {
+            const uchar* query = queries.ptr<uchar>(q);
+            BestTwo best;
+
+            auto probe = [&](int table, uint32_t k) {
+                const std::vector<int>& start = bucketStart[table];
+                const std::vector<int>& items = bucketItems[table];
+                for (int j = start[k]; j < start[k + 1]; j++) {
+                    const int i = items[j];
+                    if (visited[i] == q) continue;
+                    visited[i] = q;
+                    best.offer(i, hamming(query, descriptors.ptr<uchar>(i), bytes));
+                }
+            };
+
+            for (int t = 0; !empty() && t < options.tables; t++) {
+                const uint32_t k = key(query, t);
+                probe(t, k);
+                for (int a = 0; options.probeLevel >= 1 && a < keyBits; a++) {
+                    probe(t, k ^ (1u << a));
+                    for (int b = a + 1; options.probeLevel >= 2 && b < keyBits; b++) {
+                        probe(t, k ^ (1u << a) ^ (1u << b));
+                    }
+                }
+            }
+            matches[q] = {q, best.index, best.distance, best.second};
+        }
+    });
+    return matches;
+}
+
+std::vector<HammingLSH::Match> HammingLSH::bruteForceMatch(const cv::Mat& queries) const {
+    std::vector<Match> matches(queries.rows);
+    cv::parallel_for_(cv::Range(0, queries.rows), [&](const cv::Range& range) {
+        for (int q = range.start; q < range.end; q++) {
+            BestTwo best;
+            for (int i = 0; i < descriptors.rows; i++) {
+                best.offer(i, hamming(queries.ptr<uchar>(q), descriptors.ptr<uchar>(i), queries.cols));
+            }
+            matches[q] = {q, best.index, best.distance, best.second};
+        }
+    });
+    return matches;
+}
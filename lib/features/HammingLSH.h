@@ -0,0 +1,59 @@
+#ifndef HAMMINGLSH_H
+#define HAMMINGLSH_H
+
+#include <opencv2/opencv.hpp>
+#include <cstdint>
+#include <vector>
+
+// Multi-probe locality-sensitive hashing for binary descriptors (ORB, BRIEF).
+// Every table hashes a descriptor to keyBits of its bits, chosen at random
+// with a fixed seed, and stores the descriptor indices bucketed by key in
+// one flat array. A query visits its own bucket and, with probe level 1,
+// the keyBits buckets one bit flip away in every table, so near neighbors
+// that differ in one sampled bit are still found; probe level 2 also visits
+// the keyBits*(keyBits-1)/2 buckets two flips away. Only the candidates
+// collected that way are compared with the full Hamming distance.
+class HammingLSH {
+public:
+    struct Options {
+        int tables = 8;
+        int keyBits = 14;           // 2^keyBits buckets per table, at most 24
+        int probeLevel = 1;         // 0 = own bucket only, 1 = also one bit flip away,
+                                    // 2 = also two flips away (clamped to 0..2)
+        unsigned int seed = 0x5eed;
+    };
+
+    struct Match {
+        int queryIdx;
+        int trainIdx;               // -1 when no candidate was found
+        int distance;               // Hamming distance in bits
+        int secondDistance;         // next best distance, INT_MAX if none
+    };
+
+    explicit HammingLSH(const Options& options = Options());
+
+    // Indexes the rows of a CV_8U descriptor matrix; the matrix is referenced, not copied
+    void build(const cv::Mat& descriptors);
+    bool empty() const { return descriptors.empty(); }
+    int size() const { return descriptors.rows; }
+
+    // Best and second-best neighbor of every query row, queries in parallel
+    std::vector<Match> knnMatch(const cv::Mat& queries) const;
+
+    // Exact search over all indexed rows, for measuring recall
+    std::vector<Match> bruteForceMatch(const cv::Mat& queries) const;
+
+    static int hamming(const uchar* a, const uchar* b, int bytes);
+
+private:
+    uint32_t key(const uchar* descriptor, int table) const;
+
+    Options options;
+    int indexKeyBits = 0;       // options.keyBits limited to the indexed descriptor length
+    cv::Mat descriptors;
+    std::vector<std::vector<int>> bitPositions;     // [table][keyBit]
+    std::vector<std::vector<int>> bucketStart;      // [table][key], 2^keyBits + 1 offsets
+    std::vector<std::vector<int>> bucketItems;      // [table] indices grouped by key
+};
+
+#endif // HAMMINGLSH_H
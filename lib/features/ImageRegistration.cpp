@@ -0,0 +1,243 @@
+#include "ImageRegistration.h"
+#include "FeatureDetector.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+
+namespace {
+
+const int MIN_INLIERS = 10;
+const int RANSAC_BATCH = 128;       // hypotheses scored between stopping checks
+const int MAX_SAMPLE_ATTEMPTS = 100;
+
+double msSince(std::chrono::high_resolution_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(
+        std::chrono::high_resolution_clock::now() - start).count();
+}
+
+double cross(const cv::Point2f& a, const cv::Point2f& b, const cv::Point2f& c) {
+    return static_cast<double>(b.x - a.x) * (c.y - a.y) - static_cast<double>(b.y - a.y) * (c.x - a.x);
+}
+
+// A homography preserves the orientation of every triangle of the sample;
+// collinear or mirrored samples cannot produce a valid model
+bool consistentSample(const cv::Point2f* from, const cv::Point2f* to) {
+    static const int triangles[4][3] = {{0, 1, 2}, {1, 2, 3}, {0, 2, 3}, {0, 1, 3}};
+    for (const auto& t : triangles) {
+        if (cross(from[t[0]], from[t[1]], from[t[2]]) * cross(to[t[0]], to[t[1]], to[t[2]]) <= 0.0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int countInliers(const cv::Matx33d& H, const std::vector<cv::Point2f>& from,
+                 const std::vector<cv::Point2f>& to, double threshold2, uchar* mask) {
+    int count = 0;
+    for (size_t i = 0; i < from.size(); i++) {
+        const double x = from[i].x, y = from[i].y;
+        const double w = H(2, 0) * x + H(2, 1) * y + H(2, 2);
+        bool inlier = false;
+        if (std::abs(w) > 1e-12) {
+            const double dx = (H(0, 0) * x + H(0, 1) * y + H(0, 2)) / w - to[i].x;
+            const double dy = (H(1, 0) * x + H(1, 1) * y + H(1, 2)) / w - to[i].y;
+            inlier = dx * dx + dy * dy <= threshold2;
+        }
+        count += inlier;
+        if (mask) mask[i] = inlier;
+    }
+    return count;
+}
+
+// Iterations needed to draw one all-inlier sample with the given confidence
+int requiredIterations(int inliers, int total, const ImageRegistration::Options& options) {
+    const double sampleGood = std::pow(static_cast<double>(inliers) / total, 4.0);
+    if (sampleGood >= 1.0) return 1;
+    if (sampleGood <= 0.0) return options.maxIterations;
+    const double needed = std::log(1.0 - options.confidence) / std::log(1.0 - sampleGood);
+    return static_cast<int>(std::min<double>(options.maxIterations, std::ceil(needed)));
+}
+
+cv::Mat withChannels(const cv::Mat& image, int channels) {
+    if (image.channels() == channels) {
+        return image;
+    }
+    int code;
+    if (image.channels() == 1) {
+        code = channels == 4 ? cv::COLOR_GRAY2BGRA : cv::COLOR_GRAY2BGR;
+    } else if (image.channels() == 3) {
+        code = channels == 4 ? cv::COLOR_BGR2BGRA : cv::COLOR_BGR2GRAY;
+    } else {
+        code = channels == 3 ? cv::COLOR_BGRA2BGR : cv::COLOR_BGRA2GRAY;
+    }
+    cv::Mat converted;
+    cv::cvtColor(image, converted, code);
+    return converted;
+}
+
+} // namespace
+
+namespace ImageRegistration {
+
+std::vector<cv::DMatch> matchDescriptors(const cv::Mat& referenceDescriptors,
+                                         const cv::Mat& movingDescriptors,
+                                         const Options& options) {
+    std::vector<cv::DMatch> matches;
+    if (referenceDescriptors.empty() || movingDescriptors.empty()) {
+        return matches;
+    }
+
+    HammingLSH index(options.index);
+    index.build(referenceDescriptors);
+    for (const HammingLSH::Match& m : index.knnMatch(movingDescriptors)) {
+        if (m.trainIdx < 0 || m.distance > options.maxDistance) continue;
+        if (m.distance >= options.ratio * m.secondDistance) continue;
+        matches.emplace_back(m.queryIdx, m.trainIdx, static_cast<float>(m.distance));
+    }
+    return matches;
+}
+
+cv::Mat estimateHomography(const std::vector<cv::Point2f>& from, const std::vector<cv::Point2f>& to,
+                           const Options& options, std::vector<uchar>* inlierMask, int* iterations) {
+    if (from.size() != to.size()) {
+        throw std::runtime_error("Homography needs the same number of points in both images");
+    }
+    const int n = static_cast<int>(from.size());
+    if (inlierMask) inlierMask->assign(n, 0);
+    if (iterations) *iterations = 0;
+    if (n < 4) {
+        return cv::Mat();
+    }
+
+    const double threshold2 = options.ransacThreshold * options.ransacThreshold;
+    std::vector<cv::Matx33d> models(RANSAC_BATCH);
+    std::vector<int> counts(RANSAC_BATCH);
+    cv::Matx33d best;
+    int bestCount = 0;
+    int limit = std::max(1, options.maxIterations);
+    int scored = 0;
+
+    while (scored < limit) {
+        const int batch = std::min(RANSAC_BATCH, limit - scored);
+        cv::parallel_for_(cv::Range(0, batch), [&](const cv::Range& range) {
+            for (int h = range.start; h < range.end; h++) {
+                // Seeded by the hypothesis number, not the thread
+                cv::RNG rng(0x9E3779B97F4A7C15ULL * static_cast<uint64_t>(scored + h + 1));
+                counts[h] = 0;
+                for (int attempt = 0; attempt < MAX_SAMPLE_ATTEMPTS; attempt++) {
+                    int sample[4];
+                    for (int k = 0; k < 4; k++) {
+                        do {
+                            sample[k] = rng.uniform(0, n);
+                        } while (std::find(sample, sample + k, sample[k]) != sample + k);
+                    }
+                    cv::Point2f a[4], b[4];
+                    for (int k = 0; k < 4; k++) {
+                        a[k] = from[sample[k]];
+                        b[k] = to[sample[k]];
+                    }
+                    if (!consistentSample(a, b)) continue;
+
+                    models[h] = cv::getPerspectiveTransform(a, b);
+                    counts[h] = countInliers(models[h], from, to, threshold2, nullptr);
+                    break;
+                }
+            }
+        });
+
+        // Reduce in hypothesis order; ties keep the earlier model
+        for (int h = 0; h < batch; h++) {
+            if (counts[h] > bestCount) {
+                bestCount = counts[h];
+                best = models[h];
+            }
+        }
+        scored += batch;
+        if (bestCount >= 4) {
+            limit = std::min(limit, requiredIterations(bestCount, n, options));
+        }
+    }
+    if (iterations) *iterations = scored;
+    if (bestCount < 4) {
+        return cv::Mat();
+    }
+
+    // Least-squares refinement over the inliers of the best hypothesis
+    std::vector<uchar> mask(n);
+    countInliers(best, from, to, threshold2, mask.data());
+    std::vector<cv::Point2f> inFrom, inTo;
+    for (int i = 0; i < n; i++) {
+        if (!mask[i]) continue;
+        inFrom.push_back(from[i]);
+        inTo.push_back(to[i]);
+    }
+    cv::Mat refined = cv::findHomography(inFrom, inTo, 0);
+    if (!refined.empty()) {
+        const cv::Matx33d candidate = refined;
+        std::vector<uchar> refinedMask(n);
+        if (countInliers(candidate, from, to, threshold2, refinedMask.data()) >= bestCount) {
+            best = candidate;
+            mask.swap(refinedMask);
+        }
+    }
+
+    if (inlierMask) inlierMask->swap(mask);
+    return cv::Mat(best);
+}
+
+bool align(const cv::Mat& reference, const cv::Mat& moving, cv::Mat& aligned,
+           const Options& options, Report* report) {
+    if (reference.empty() || moving.empty() || reference.depth() != CV_8U || moving.depth() != CV_8U) {
+        throw std::runtime_error("Registration expects two non-empty 8-bit images");
+    }
+
+    const auto start = std::chrono::high_resolution_clock::now();
+    Report local;
+    Report& r = report ? *report : local;
+    r = Report();
+    aligned.release();
+
+    // ORB at the detector dialog's FAST threshold, bucketed so the
+    // correspondences cover the whole image
+    FeatureDetector::Options detectOptions;
+    detectOptions.method = FeatureDetector::Method::ORB;
+    detectOptions.maxFeatures = options.maxFeatures;
+    detectOptions.fastThreshold = 20;
+    const FeatureDetector::Result ref = FeatureDetector::detect(reference, detectOptions);
+    const FeatureDetector::Result mov = FeatureDetector::detect(moving, detectOptions);
+    r.referenceKeypoints = static_cast<int>(ref.keypoints.size());
+    r.movingKeypoints = static_cast<int>(mov.keypoints.size());
+    r.detectMs = msSince(start);
+
+    auto stageStart = std::chrono::high_resolution_clock::now();
+    const std::vector<cv::DMatch> matches = matchDescriptors(ref.descriptors, mov.descriptors, options);
+    r.matches = static_cast<int>(matches.size());
+    r.matchMs = msSince(stageStart);
+
+    stageStart = std::chrono::high_resolution_clock::now();
+    std::vector<cv::Point2f> from, to;
+    from.reserve(matches.size());
+    to.reserve(matches.size());
+    for (const cv::DMatch& m : matches) {
+        from.push_back(mov.keypoints[m.queryIdx].pt);
+        to.push_back(ref.keypoints[m.trainIdx].pt);
+    }
+    std::vector<uchar> mask;
+    r.homography = estimateHomography(from, to, options, &mask, &r.iterations);
+    r.inliers = static_cast<int>(std::count(mask.begin(), mask.end(), 1));
+    r.ransacMs = msSince(stageStart);
+
+    const bool found = !r.homography.empty() && r.inliers >= MIN_INLIERS;
+    if (found) {
+        stageStart = std::chrono::high_resolution_clock::now();
+        cv::warpPerspective(withChannels(moving, reference.channels()), aligned, r.homography,
+                            reference.size(), cv::INTER_LINEAR, cv::BORDER_CONSTANT, cv::Scalar::all(0));
+        r.warpMs = msSince(stageStart);
+    }
+    r.totalMs = msSince(start);
+    return found;
+}
+
+} // namespace ImageRegistration
@@ -0,0 +1,80 @@
+#ifndef IMAGEREGISTRATION_H
+#define IMAGEREGISTRATION_H
+
+#include <opencv2/opencv.hpp>
+#include <vector>
+#include "HammingLSH.h"
+
+// Feature-based registration of a second image onto a reference. ORB
+// features of both images are matched through a multi-probe LSH index with
+// Lowe's ratio test, a homography is estimated by RANSAC whose hypotheses
+// are scored in parallel batches, refined on the inliers, and the moving
+// image is warped onto the reference grid.
+namespace ImageRegistration {
+
+struct Options {
+    int maxFeatures = 5000;         // ORB keypoints per image
+    double ratio = 0.8;             // best / second-best distance limit
+    int maxDistance = 64;           // Hamming bits, of 256
+    double ransacThreshold = 3.0;   // reprojection error in reference pixels
+    int maxIterations = 2000;
+    double confidence = 0.995;      // stops RANSAC once an all-inlier sample is this likely
+    HammingLSH::Options index;
+};
+
+struct Report {
+    int referenceKeypoints = 0;
+    int movingKeypoints = 0;
+    int matches = 0;                // after the ratio test
+    int inliers = 0;
+    int iterations = 0;             // RANSAC hypotheses scored
+    cv::Mat homography;             // 3x3 CV_64F, moving -> reference
+    double detectMs = 0.0;
+    double matchMs = 0.0;           // index build and queries
+    double ransacMs = 0.0;
+    double warpMs = 0.0;
+    double totalMs = 0.0;
+};
+
+/**
+ * @brief Match binary descriptors through an LSH index of the reference
+ * @return One match per moving descriptor that passes the ratio test,
+ *         queryIdx into moving, trainIdx into reference
+ */
+std::vector<cv::DMatch> matchDescriptors(const cv::Mat& referenceDescriptors,
+                                         const cv::Mat& movingDescriptors,
+                                         const Options& options = Options());
+
+/**
+ * @brief RANSAC homography with hypotheses scored in parallel
+ *
+ * Every hypothesis draws its four-point sample from its own seeded
+ * generator and batches are reduced in hypothesis order, so the result
+ * does not depend on the thread count. The best model is refined by least
+ * squares over its inliers.
+ * @param from Points in the moving image
+ * @param to Corresponding points in the reference image
+ * @param inlierMask Optional, one 0/1 entry per correspondence
+ * @param iterations Optional, number of hypotheses scored
+ * @return 3x3 CV_64F homography, empty if no model was found
+ */
+cv::Mat estimateHomography(const std::vector<cv::Point2f>& from, const std::vector<cv::Point2f>& to,
+                           const Options& options = Options(), std::vector<uchar>* inlierMask = nullptr,
+                           int* iterations = nullptr);
+
+/**
+ * @brief Align moving onto reference
+ * @param reference Reference image (8-bit)
+ * @param moving Image to align (8-bit, any channel count)
+ * @param aligned Moving warped to the reference size, with the reference's
+ *        channel count so both can be compared directly
+ * @param options Matching and RANSAC parameters
+ * @param report Optional counts, homography and timings
+ * @return False if too few consistent matches were found
+ */
+bool align(const cv::Mat& reference, const cv::Mat& moving, cv::Mat& aligned,
+           const Options& options = Options(), Report* report = nullptr);
+
+} // namespace ImageRegistration
+
+#endif // IMAGEREGISTRATION_H
@@ -123,16 +123,62 @@ void applyPrewitt(const cv::Mat& src, cv::Mat& dst, char direction = 'b');
  */
 void applyScharr(const cv::Mat& src, cv::Mat& dst, char direction = 'b');
 
+/**
+ * @brief How a kernel was applied and what each strategy was estimated to cost
+ *
+ * Costs are multiply-adds per output pixel and channel. The separable cost is
+ * 0 when the kernel is not rank 1.
+ */
+struct ConvolutionReport {
+    enum Method { DIRECT, SEPARABLE, FFT_BLOCKS };
+    Method method = DIRECT;
+    double directCost = 0.0;
+    double separableCost = 0.0;
+    double fftCost = 0.0;
+    int fftTileSize = 0;
+    double elapsedMs = 0.0;
+};
+
+/**
+ * @brief Display name of a convolution method
+ */
+const char* methodName(ConvolutionReport::Method method);
+
+/**
+ * @brief Correlate with an arbitrary kernel (same semantics as cv::filter2D)
+ *
+ * Picks the cheapest of direct filtering, two 1D passes (rank-1 kernels,
+ * detected by SVD) and block FFT convolution, from the kernel and image size.
+ * Direct filtering stays spatial for every kernel size (cv::filter2D would
+ * switch to its own DFT for large kernels).
+ * @param src Source image (any channel count)
+ * @param dst Destination image
+ * @param ddepth Output depth (-1 = source depth)
+ * @param kernel Kernel, anchored at its center
+ * @param borderType Border handling type (default: BORDER_DEFAULT)
+ * @param report Optional report of the chosen method and timing
+ */
+void convolve(const cv::Mat& src, cv::Mat& dst, int ddepth,
+              const cv::Mat& kernel,
+              int borderType = cv::BORDER_DEFAULT,
+              ConvolutionReport* report = nullptr);
+
 /**
  * @brief Apply custom convolution kernel
+ * 
+ * Large kernels (e.g. 31x31 to 101x101 PSFs) automatically switch to
+ * separable or FFT convolution; the choice and timing are returned in
+ * the report.
  * @param src Source image
  * @param dst Destination image
  * @param kernel Custom kernel matrix
  * @param normalize Whether to normalize the result
+ * @param report Optional report of the chosen method and timing
  */
 void applyCustomKernel(const cv::Mat& src, cv::Mat& dst, 
                        const cv::Mat& kernel,
-                       bool normalize = true);
+                       bool normalize = true,
+                       ConvolutionReport* report = nullptr);
 
 /**
  * @brief Sharpen image using unsharp masking
@@ -0,0 +1,195 @@
+#include "CoarseToFineGrabCut.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+
+namespace {
+
+// Tiles whose band has too few samples of either class keep the upsampled labels
+const int MIN_CLASS_PIXELS = 64;
+
+double elapsedMs(const std::chrono::high_resolution_clock::time_point& start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+cv::Mat innerBoundary(const cv::Mat& mask) {
+    cv::Mat binary = (mask != 0), eroded;
+    cv::erode(binary, eroded, cv::Mat());
+    return binary & ~eroded;
+}
+
+} // namespace
+
+CoarseToFineGrabCut::CoarseToFineGrabCut(const Options& options)
+    : options(options) {
+}
+
+void CoarseToFineGrabCut::setImage(const cv::Mat& newImage, const cv::Rect& newRect) {
+    if (newImage.type() != CV_8UC3) {
+        throw std::runtime_error("GrabCut needs an 8-bit BGR image");
+    }
+
+    reset();
+    image = newImage;
+    rect = newRect & cv::Rect(0, 0, image.cols, image.rows);
+    if (rect.area() == 0) {
+        throw std::runtime_error("GrabCut rectangle lies outside the image");
+    }
+
+    coarseImage = image;
+    while (std::max(coarseImage.cols, coarseImage.rows) > options.coarseMaxSide) {
+        cv::pyrDown(coarseImage, coarseImage);
+        level++;
+    }
+
+    const double scale = 1.0 / (1 << level);
+    coarseRect = cv::Rect(cv::Point(cvFloor(rect.x * scale), cvFloor(rect.y * scale)),
+                          cv::Point(cvCeil(rect.br().x * scale), cvCeil(rect.br().y * scale)))
+                 & cv::Rect(0, 0, coarseImage.cols, coarseImage.rows);
+}
+
+void CoarseToFineGrabCut::reset() {
+    image.release();
+    coarseImage.release();
+    snapshots.clear();
+    level = 0;
+}
+
+void CoarseToFineGrabCut::segment(int iterations, cv::Mat& mask, Report* report) {
+    if (!hasImage()) {
+        throw std::runtime_error("GrabCut has no image");
+    }
+    iterations = std::max(1, iterations);
+
+    Report local;
+    Report& r = report ? *report : local;
+    r = Report();
+    r.level = level;
+    r.coarseSize = coarseImage.size();
+    r.cachedIterations = std::min(iterations, static_cast<int>(snapshots.size()));
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    // One iteration per snapshot; cv::grabCut with GC_EVAL continues exactly
+    // where the previous call stopped
+    while (static_cast<int>(snapshots.size()) < iterations) {
+        Snapshot next;
+        if (snapshots.empty()) {
+            cv::grabCut(coarseImage, next.mask, coarseRect, next.bgModel, next.fgModel, 1, cv::GC_INIT_WITH_RECT);
+        } else {
+            const Snapshot& last = snapshots.back();
+            next.mask = last.mask.clone();
+            next.bgModel = last.bgModel.clone();
+            next.fgModel = last.fgModel.clone();
+            cv::grabCut(coarseImage, next.mask, cv::Rect(), next.bgModel, next.fgModel, 1, cv::GC_EVAL);
+        }
+        snapshots.push_back(next);
+    }
+    const Snapshot& snapshot = snapshots[iterations - 1];
+    r.coarseMs = elapsedMs(start);
+
+    if (level == 0) {
+        mask = snapshot.mask.clone();
+    } else {
+        auto refineStart = std::chrono::high_resolution_clock::now();
+        refineBand(snapshot.mask, snapshot, mask, r);
+        r.refineMs = elapsedMs(refineStart);
+    }
+    r.totalMs = elapsedMs(start);
+}
+
+void CoarseToFineGrabCut::refineBand(const cv::Mat& coarseMask, const Snapshot& models,
+                                     cv::Mat& mask, Report& report) const {
+    const int radius = options.bandRadius > 0 ? options.bandRadius : 2 << level;
+
+    // GC_FGD and GC_PR_FGD are the odd values
+    cv::Mat coarseForeground, foreground;
+    cv::bitwise_and(coarseMask, cv::Scalar(1), coarseForeground);
+    cv::resize(coarseForeground * 255, foreground, image.size(), 0, 0, cv::INTER_LINEAR);
+    cv::threshold(foreground, foreground, 127, 255, cv::THRESH_BINARY);
+
+    cv::Mat inside = cv::Mat::zeros(image.size(), CV_8U);
+    inside(rect).setTo(255);
+    foreground &= inside;
+
+    cv::Mat kernel = cv::getStructuringElement(cv::MORPH_RECT, cv::Size(2 * radius + 1, 2 * radius + 1));
+    cv::Mat dilated, eroded, band;
+    cv::dilate(foreground, dilated, kernel);
+    cv::erode(foreground, eroded, kernel);
+    band = (dilated != eroded) & inside;
+
+    // Definite labels outside the band, probable ones inside it
+    cv::Mat initial(image.size(), CV_8U);
+    cv::parallel_for_(cv::Range(0, image.rows), [&](const cv::Range& range) {
+        for (int y = range.start; y < range.end; y++) {
+            const uchar* fg = foreground.ptr<uchar>(y);
+            const uchar* b = band.ptr<uchar>(y);
+            uchar* m = initial.ptr<uchar>(y);
+            for (int x = 0; x < image.cols; x++) {
+                m[x] = b[x] ? (fg[x] ? cv::GC_PR_FGD : cv::GC_PR_BGD) : (fg[x] ? cv::GC_FGD : cv::GC_BGD);
+            }
+        }
+    });
+    report.bandFraction = static_cast<double>(cv::countNonZero(band)) / (static_cast<double>(image.rows) * image.cols);
+
+    const int tile = std::max(32, options.tileSize);
+    std::vector<cv::Rect> cores;
+    for (int y = 0; y < image.rows; y += tile) {
+        for (int x = 0; x < image.cols; x += tile) {
+            cv::Rect core = cv::Rect(x, y, tile, tile) & cv::Rect(0, 0, image.cols, image.rows);
+            if (cv::countNonZero(band(core)) > 0) {
+                cores.push_back(core);
+            }
+        }
+    }
+
+    // Tiles read the initial labels (margins overlap) and write disjoint cores
+    mask = initial.clone();
+    const int margin = 2 * radius;
+    std::atomic<int> refined(0);
+    cv::parallel_for_(cv::Range(0, static_cast<int>(cores.size())), [&](const cv::Range& range) {
+        for (int t = range.start; t < range.end; t++) {
+            const cv::Rect& core = cores[t];
+            cv::Rect roi = cv::Rect(core.x - margin, core.y - margin, core.width + 2 * margin, core.height + 2 * margin)
+                           & cv::Rect(0, 0, image.cols, image.rows);
+
+            cv::Mat tileMask = initial(roi).clone();
+            cv::Mat odd;
+            cv::bitwise_and(tileMask, cv::Scalar(1), odd);
+            const int fgPixels = cv::countNonZero(odd);
+            if (fgPixels < MIN_CLASS_PIXELS || static_cast<int>(roi.area()) - fgPixels < MIN_CLASS_PIXELS) {
+                continue;
+            }
+
+            // Start from the coarse GMMs; GrabCut re-learns them from the tile
+            cv::Mat bgModel = models.bgModel.clone(), fgModel = models.fgModel.clone();
+            try {
+                cv::grabCut(image(roi), tileMask, cv::Rect(), bgModel, fgModel,
+                            options.refineIterations, cv::GC_EVAL);
+            } catch (const cv::Exception&) {
+                continue;
+            }
+            tileMask(core - roi.tl()).copyTo(mask(core));
+            refined++;
+        }
+    });
+    report.tilesRefined = refined;
+}
+
+double CoarseToFineGrabCut::boundaryFScore(const cv::Mat& a, const cv::Mat& b, int tolerance) {
+    cv::Mat boundaryA = innerBoundary(a), boundaryB = innerBoundary(b);
+    const int countA = cv::countNonZero(boundaryA), countB = cv::countNonZero(boundaryB);
+    if (countA == 0 || countB == 0) {
+        return (countA == countB) ? 1.0 : 0.0;
+    }
+
+    // Distance to the nearest boundary pixel of the other mask
+    cv::Mat distanceA, distanceB;
+    cv::distanceTransform(~boundaryA, distanceA, cv::DIST_L2, 3);
+    cv::distanceTransform(~boundaryB, distanceB, cv::DIST_L2, 3);
+
+    const double precision = static_cast<double>(cv::countNonZero((distanceB <= tolerance) & boundaryA)) / countA;
+    const double recall = static_cast<double>(cv::countNonZero((distanceA <= tolerance) & boundaryB)) / countB;
+    return (precision + recall > 0) ? 2.0 * precision * recall / (precision + recall) : 0.0;
+}
@@ -0,0 +1,66 @@
+#ifndef COARSETOFINEGRABCUT_H
+#define COARSETOFINEGRABCUT_H
+
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+// Multi-resolution GrabCut. The iterations run on a pyramid level no larger
+// than coarseMaxSide, the mask is upsampled, and only a narrow band around
+// the upsampled boundary is re-solved at full resolution (in parallel tiles,
+// everything else is fixed as definite foreground/background).
+//
+// The coarse mask and GMMs are snapshotted after every iteration, so changing
+// the iteration count only runs the missing iterations (or none at all).
+class CoarseToFineGrabCut {
+public:
+    struct Options {
+        int coarseMaxSide = 640;    // longest side of the level GrabCut iterates on
+        int bandRadius = 0;         // full-resolution pixels; 0 = two coarse pixels
+        int refineIterations = 2;   // GrabCut iterations inside the band
+        int tileSize = 256;
+    };
+
+    struct Report {
+        int level = 0;              // pyramid level the iterations ran on
+        cv::Size coarseSize;
+        int cachedIterations = 0;   // iterations reused from earlier calls
+        int tilesRefined = 0;
+        double bandFraction = 0.0;  // share of pixels re-solved at full resolution
+        double coarseMs = 0.0;
+        double refineMs = 0.0;
+        double totalMs = 0.0;
+    };
+
+    explicit CoarseToFineGrabCut(const Options& options = Options());
+
+    // New image (8-bit BGR) and initial rectangle; drops all cached models
+    void setImage(const cv::Mat& image, const cv::Rect& rect);
+    bool hasImage() const { return !image.empty(); }
+    void reset();
+
+    // Full-resolution mask with cv::GC_* values, like cv::grabCut
+    void segment(int iterations, cv::Mat& mask, Report* report = nullptr);
+
+    // Boundary F-score of two binary masks: the share of boundary pixels of
+    // each that lie within tolerance pixels of the other's boundary
+    static double boundaryFScore(const cv::Mat& a, const cv::Mat& b, int tolerance);
+
+private:
+    struct Snapshot {
+        cv::Mat mask;
+        cv::Mat bgModel;
+        cv::Mat fgModel;
+    };
+
+    void refineBand(const cv::Mat& coarseMask, const Snapshot& models, cv::Mat& mask, Report& report) const;
+
+    Options options;
+    cv::Mat image;
+    cv::Rect rect;
+    int level = 0;
+    cv::Mat coarseImage;
+    cv::Rect coarseRect;
+    std::vector<Snapshot> snapshots;    // [i] = state after i + 1 iterations
+};
+
+#endif // COARSETOFINEGRABCUT_H
@@ -0,0 +1,258 @@
+#include "ComponentTree.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+
+namespace {
+
+// Pixels per stripe when writing a large selection into the mask
+const int FILL_STRIPE = 1 << 16;
+
+inline int findRoot(std::vector<int>& parent, int i) {
+    while (parent[i] != i) {
+        parent[i] = parent[parent[i]];
+        i = parent[i];
+    }
+    return i;
+}
+
+template <int CN>
+inline uchar maxDifference(const uchar* a, const uchar* b) {
+    int d = 0;
+    for (int c = 0; c < CN; c++) {
+        d = std::max(d, std::abs(a[c] - b[c]));
+    }
+    return static_cast<uchar>(d);
+}
+
+// Difference to the right neighbor at out[2x], to the lower one at out[2x + 1]
+template <int CN>
+void neighborDifferences(const cv::Mat& image, int y, uchar* out) {
+    const uchar* row = image.ptr<uchar>(y);
+    const uchar* below = (y + 1 < image.rows) ? image.ptr<uchar>(y + 1) : nullptr;
+    for (int x = 0; x < image.cols; x++) {
+        const uchar* p = row + x * CN;
+        if (x + 1 < image.cols) out[2 * x] = maxDifference<CN>(p, p + CN);
+        if (below) out[2 * x + 1] = maxDifference<CN>(p, below + x * CN);
+    }
+}
+
+} // namespace
+
+void ComponentTree::clear() {
+    imageSize = cv::Size();
+    pixelNode.clear();
+    order.clear();
+    parent.clear();
+    level.clear();
+    start.clear();
+    count.clear();
+}
+
+void ComponentTree::build(const cv::Mat& image) {
+    const int cn = image.channels();
+    if (image.empty() || image.depth() != CV_8U || (cn != 1 && cn != 3 && cn != 4)) {
+        throw std::runtime_error("Component tree expects an 8-bit image with 1, 3 or 4 channels");
+    }
+    if (static_cast<long long>(image.rows) * image.cols > std::numeric_limits<int>::max() / 2) {
+        throw std::runtime_error("Image is too large for a component tree");
+    }
+
+    const auto startTime = std::chrono::high_resolution_clock::now();
+    clear();
+    imageSize = image.size();
+    const int rows = image.rows, cols = image.cols;
+    const int n = rows * cols;
+
+    // Edge 2i joins pixel i to its right neighbor, edge 2i + 1 to the one below
+    std::vector<uchar> weight(2 * static_cast<size_t>(n), 0);
+    cv::parallel_for_(cv::Range(0, rows), [&](const cv::Range& range) {
+        for (int y = range.start; y < range.end; y++) {
+            uchar* out = &weight[2 * static_cast<size_t>(y) * cols];
+            switch (cn) {
+                case 1: neighborDifferences<1>(image, y, out); break;
+                case 3: neighborDifferences<3>(image, y, out); break;
+                default: neighborDifferences<4>(image, y, out); break;
+            }
+        }
+    });
+
+    // Counting sort of the edges by difference
+    std::vector<int> levelStart(257, 0);
+    for (int y = 0; y < rows; y++) {
+        for (int x = 0; x < cols; x++) {
+            const size_t i = static_cast<size_t>(y) * cols + x;
+            if (x + 1 < cols) levelStart[weight[2 * i] + 1]++;
+            if (y + 1 < rows) levelStart[weight[2 * i + 1] + 1]++;
+        }
+    }
+    std::partial_sum(levelStart.begin(), levelStart.end(), levelStart.begin());
+    std::vector<uint32_t> edges(levelStart[256]);
+    std::vector<int> fill(levelStart.begin(), levelStart.end() - 1);
+    for (int y = 0; y < rows; y++) {
+        for (int x = 0; x < cols; x++) {
+            const size_t i = static_cast<size_t>(y) * cols + x;
+            if (x + 1 < cols) edges[fill[weight[2 * i]]++] = static_cast<uint32_t>(2 * i);
+            if (y + 1 < rows) edges[fill[weight[2 * i + 1]]++] = static_cast<uint32_t>(2 * i + 1);
+        }
+    }
+    std::vector<uchar>().swap(weight);
+
+    // Kruskal merge. Each set keeps its top node and its pixels as a linked
+    // list; lists are only ever concatenated, so every node stays contiguous.
+    std::vector<int> uf(n), setNode(n, -1), head(n), tail(n), next(n, -1);
+    std::vector<uchar> rank(n, 0);
+    std::iota(uf.begin(), uf.end(), 0);
+    std::iota(head.begin(), head.end(), 0);
+    std::iota(tail.begin(), tail.end(), 0);
+    std::vector<int> nodeHead;
+    pixelNode.assign(n, -1);
+
+    auto attach = [&](int set, int node) {
+        const int child = setNode[set];
+        if (child >= 0) {
+            parent[child] = node;
+            count[node] += count[child];
+        } else {
+            pixelNode[set] = node;      // a set without a node is a single pixel
+            count[node] += 1;
+        }
+    };
+
+    for (int w = 0; w < 256; w++) {
+        for (int j = levelStart[w]; j < levelStart[w + 1]; j++) {
+            const int p = static_cast<int>(edges[j] >> 1);
+            const int q = (edges[j] & 1) ? p + cols : p + 1;
+            int a = findRoot(uf, p), b = findRoot(uf, q);
+            if (a == b) continue;
+
+            // Join a node already at this level, larger first; otherwise
+            // open a new one. The joined node's pixels come first in the list.
+            const int na = setNode[a], nb = setNode[b];
+            const bool aAtLevel = na >= 0 && level[na] == w;
+            const bool bAtLevel = nb >= 0 && level[nb] == w;
+            int node;
+            if (aAtLevel && (!bAtLevel || count[na] >= count[nb])) {
+                node = na;
+                attach(b, node);
+            } else if (bAtLevel) {
+                node = nb;
+                attach(a, node);
+                std::swap(a, b);
+            } else {
+                node = static_cast<int>(parent.size());
+                parent.push_back(-1);
+                level.push_back(static_cast<uchar>(w));
+                count.push_back(0);
+                nodeHead.push_back(head[a]);
+                attach(a, node);
+                attach(b, node);
+            }
+
+            next[tail[a]] = head[b];
+            const int listHead = head[a], listTail = tail[b];
+            if (rank[a] < rank[b]) std::swap(a, b);
+            if (rank[a] == rank[b]) rank[a]++;
+            uf[b] = a;
+            setNode[a] = node;
+            head[a] = listHead;
+            tail[a] = listTail;
+        }
+    }
+
+    // Release the merge-only buffers before the order is allocated, and trim
+    // the node arrays to size; only the tree outlives the build
+    std::vector<uint32_t>().swap(edges);
+    std::vector<int>().swap(fill);
+    std::vector<int>().swap(setNode);
+    std::vector<int>().swap(tail);
+    std::vector<uchar>().swap(rank);
+    const int root = head[findRoot(uf, 0)];
+    std::vector<int>().swap(head);
+    parent.shrink_to_fit();
+    level.shrink_to_fit();
+    count.shrink_to_fit();
+
+    // Flatten the final list; uf is reused as the position of each pixel
+    order.resize(n);
+    int position = 0;
+    for (int p = root; p >= 0; p = next[p]) {
+        order[position] = p;
+        uf[p] = position++;
+    }
+    std::vector<int>().swap(next);
+    start.resize(parent.size());
+    for (size_t k = 0; k < parent.size(); k++) {
+        start[k] = uf[nodeHead[k]];
+    }
+
+    lastBuildMs = std::chrono::duration<double, std::milli>(
+        std::chrono::high_resolution_clock::now() - startTime).count();
+}
+
+int ComponentTree::nodeAt(const cv::Point& seed, int tolerance) const {
+    if (empty() || !cv::Rect(0, 0, imageSize.width, imageSize.height).contains(seed)) {
+        return -1;
+    }
+    int node = pixelNode[seed.y * imageSize.width + seed.x];
+    if (node < 0 || level[node] > tolerance) {
+        return -1;
+    }
+    while (parent[node] >= 0 && level[parent[node]] <= tolerance) {
+        node = parent[node];
+    }
+    return node;
+}
+
+int ComponentTree::select(const cv::Point& seed, int tolerance, cv::Mat& mask) const {
+    if (empty()) {
+        throw std::runtime_error("Component tree has not been built");
+    }
+    mask = cv::Mat::zeros(imageSize, CV_8UC1);
+    if (!cv::Rect(0, 0, imageSize.width, imageSize.height).contains(seed)) {
+        return 0;
+    }
+
+    const int node = nodeAt(seed, tolerance);
+    if (node < 0) {
+        mask.at<uchar>(seed) = 255;
+        return 1;
+    }
+
+    uchar* data = mask.ptr<uchar>();
+    const int* pixels = order.data() + start[node];
+    const int size = count[node];
+    cv::parallel_for_(cv::Range(0, size), [&](const cv::Range& range) {
+        for (int i = range.start; i < range.end; i++) {
+            data[pixels[i]] = 255;
+        }
+    }, std::max(1.0, static_cast<double>(size) / FILL_STRIPE));
+    return size;
+}
+
+int ComponentTree::select(const cv::Point& seed, int tolerance, PackedMask& mask) const {
+    if (empty()) {
+        throw std::runtime_error("Component tree has not been built");
+    }
+    mask = PackedMask(imageSize);
+    if (!cv::Rect(0, 0, imageSize.width, imageSize.height).contains(seed)) {
+        return 0;
+    }
+
+    const int node = nodeAt(seed, tolerance);
+    if (node < 0) {
+        mask.set(seed.x, seed.y);
+        return 1;
+    }
+
+    // Pixels of one word may be far apart in the order, so bits are set serially
+    const int* pixels = order.data() + start[node];
+    for (int i = 0; i < count[node]; i++) {
+        mask.set(pixels[i] % imageSize.width, pixels[i] / imageSize.width);
+    }
+    return count[node];
+}
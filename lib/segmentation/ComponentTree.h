@@ -0,0 +1,51 @@
+#ifndef COMPONENTTREE_H
+#define COMPONENTTREE_H
+
+#include <opencv2/opencv.hpp>
+#include <vector>
+#include "PackedMask.h"
+
+// Component tree of an image's 4-connected neighbor differences (an alpha
+// tree). The difference of two neighbors is the largest per-channel
+// absolute difference; merging all neighbors in increasing difference
+// order builds a tree whose node at level t holds exactly the pixels a
+// floating-range cv::floodFill with tolerance t reaches from any of them.
+//
+// Every node's pixels are one contiguous range of a single pixel ordering,
+// so selecting a seed and tolerance is a walk up the tree from the seed
+// followed by writing that range into the mask. Only the build touches the
+// whole image; tolerance changes cost as much as the selection is large.
+class ComponentTree {
+public:
+    // 8-bit image with 1, 3 or 4 channels; replaces any previous tree
+    void build(const cv::Mat& image);
+    void clear();
+    bool empty() const { return pixelNode.empty(); }
+    cv::Size size() const { return imageSize; }
+    int nodeCount() const { return static_cast<int>(parent.size()); }
+    double buildMs() const { return lastBuildMs; }
+
+    // Largest node containing seed with level <= tolerance, -1 if the seed
+    // differs from all its neighbors by more than tolerance
+    int nodeAt(const cv::Point& seed, int tolerance) const;
+
+    // CV_8UC1 mask, 255 on the pixels cv::floodFill would select from seed
+    // (4-connected, floating range, loDiff = upDiff = tolerance per channel)
+    // @return Number of selected pixels
+    int select(const cv::Point& seed, int tolerance, cv::Mat& mask) const;
+
+    // Same selection as a packed mask, without a full-size byte image
+    int select(const cv::Point& seed, int tolerance, PackedMask& mask) const;
+
+private:
+    cv::Size imageSize;
+    std::vector<int> pixelNode;     // lowest node per pixel, -1 before its first merge
+    std::vector<int> order;         // pixels ordered so every node is a contiguous range
+    std::vector<int> parent;        // per node, -1 for the root
+    std::vector<uchar> level;       // per node, the difference it was merged at
+    std::vector<int> start;         // per node, first position in order
+    std::vector<int> count;         // per node, number of pixels
+    double lastBuildMs = 0.0;
+};
+
+#endif // COMPONENTTREE_H
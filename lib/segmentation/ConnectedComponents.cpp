@@ -0,0 +1,336 @@
+#include "ConnectedComponents.h"
+#include "RegionStatistics.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+
+namespace {
+
+// Stripes are kept at least this tall so boundary merging stays negligible
+const int MIN_STRIPE_ROWS = 32;
+
+inline int findRoot(std::vector<int>& parent, int i) {
+    while (parent[i] != i) {
+        parent[i] = parent[parent[i]];
+        i = parent[i];
+    }
+    return i;
+}
+
+// Union by smaller index, so every root precedes the members of its set
+inline int unite(std::vector<int>& parent, int a, int b) {
+    a = findRoot(parent, a);
+    b = findRoot(parent, b);
+    if (a < b) {
+        parent[b] = a;
+        return a;
+    }
+    parent[a] = b;
+    return b;
+}
+
+// Only what RegionStatistics does not measure: perimeter edges and the
+// raw second moments for the ellipse
+struct BlobSums {
+    long long edges = 0;
+    double sumXX = 0.0, sumYY = 0.0, sumXY = 0.0;
+
+    void add(const BlobSums& o) {
+        edges += o.edges;
+        sumXX += o.sumXX;
+        sumYY += o.sumYY;
+        sumXY += o.sumXY;
+    }
+};
+
+struct Stripe {
+    int r0 = 0, r1 = 0;
+    std::vector<int> compact;       // provisional label -> 1..count within the stripe
+    int count = 0;
+    int offset = 0;                 // global id of compact label 1 is offset + 1
+    std::vector<BlobSums> sums;     // by compact label
+};
+
+// Same component test: binary images join any two foreground pixels,
+// label images only pixels with the same value
+template <typename T, bool Binary>
+inline bool joins(T a, T b) {
+    return Binary ? (b != 0) : (a == b);
+}
+
+// First pass over one stripe: provisional labels and local equivalences
+template <typename T, bool Binary>
+void labelStripe(const cv::Mat& src, cv::Mat& labels, Stripe& stripe, bool eightConnected) {
+    std::vector<int> parent(1, 0);
+    parent.reserve(1024);
+
+    for (int y = stripe.r0; y < stripe.r1; y++) {
+        const T* row = src.ptr<T>(y);
+        const T* up = (y > stripe.r0) ? src.ptr<T>(y - 1) : nullptr;
+        int* L = labels.ptr<int>(y);
+        const int* LU = up ? labels.ptr<int>(y - 1) : nullptr;
+
+        for (int x = 0; x < src.cols; x++) {
+            const T v = row[x];
+            if (v == 0) {
+                L[x] = 0;
+                continue;
+            }
+
+            int l = 0;
+            auto consider = [&](T nv, int nl) {
+                if (nl && joins<T, Binary>(v, nv)) {
+                    l = l ? (l == nl ? l : unite(parent, l, nl)) : nl;
+                }
+            };
+            if (x > 0) consider(row[x - 1], L[x - 1]);
+            if (up) {
+                consider(up[x], LU[x]);
+                if (eightConnected) {
+                    if (x > 0) consider(up[x - 1], LU[x - 1]);
+                    if (x + 1 < src.cols) consider(up[x + 1], LU[x + 1]);
+                }
+            }
+            if (!l) {
+                l = static_cast<int>(parent.size());
+                parent.push_back(l);
+            }
+            L[x] = l;
+        }
+    }
+
+    // Roots come before their members, so one forward sweep compacts
+    stripe.compact.assign(parent.size(), 0);
+    stripe.count = 0;
+    for (size_t i = 1; i < parent.size(); i++) {
+        const int root = findRoot(parent, static_cast<int>(i));
+        stripe.compact[i] = (root == static_cast<int>(i)) ? ++stripe.count : stripe.compact[root];
+    }
+}
+
+// Join components that touch across the top row of a stripe
+template <typename T, bool Binary>
+void mergeBoundary(const cv::Mat& src, const cv::Mat& labels, const Stripe& above, const Stripe& below,
+                   std::vector<int>& parent, bool eightConnected) {
+    const int y = below.r0;
+    const T* row = src.ptr<T>(y);
+    const T* up = src.ptr<T>(y - 1);
+    const int* L = labels.ptr<int>(y);
+    const int* LU = labels.ptr<int>(y - 1);
+
+    for (int x = 0; x < src.cols; x++) {
+        if (!L[x]) continue;
+        const int g = below.offset + below.compact[L[x]];
+        auto consider = [&](int nx) {
+            if (LU[nx] && joins<T, Binary>(row[x], up[nx])) {
+                unite(parent, g, above.offset + above.compact[LU[nx]]);
+            }
+        };
+        consider(x);
+        if (eightConnected) {
+            if (x > 0) consider(x - 1);
+            if (x + 1 < src.cols) consider(x + 1);
+        }
+    }
+}
+
+// Final labels plus the perimeter and moment sums of one stripe. Perimeter edges only need
+// the input: a 4-neighbour that joins the pixel is always in its component.
+template <typename T, bool Binary>
+void finishStripe(const cv::Mat& src, cv::Mat& labels, Stripe& stripe, const std::vector<int>& resolved) {
+    stripe.sums.assign(stripe.count + 1, BlobSums());
+    for (int y = stripe.r0; y < stripe.r1; y++) {
+        const T* row = src.ptr<T>(y);
+        const T* up = (y > 0) ? src.ptr<T>(y - 1) : nullptr;
+        const T* down = (y + 1 < src.rows) ? src.ptr<T>(y + 1) : nullptr;
+        int* L = labels.ptr<int>(y);
+
+        for (int x = 0; x < src.cols; x++) {
+            if (!L[x]) continue;
+            const int c = stripe.compact[L[x]];
+            L[x] = resolved[stripe.offset + c];
+
+            const T v = row[x];
+            BlobSums& s = stripe.sums[c];
+            s.sumXX += static_cast<double>(x) * x;
+            s.sumYY += static_cast<double>(y) * y;
+            s.sumXY += static_cast<double>(x) * y;
+            s.edges += !(x > 0 && row[x - 1] != 0 && joins<T, Binary>(v, row[x - 1]))
+                     + !(x + 1 < src.cols && row[x + 1] != 0 && joins<T, Binary>(v, row[x + 1]))
+                     + !(up && up[x] != 0 && joins<T, Binary>(v, up[x]))
+                     + !(down && down[x] != 0 && joins<T, Binary>(v, down[x]));
+        }
+    }
+}
+
+ConnectedComponents::Blob makeBlob(int label, const RegionStatistics::Region& region, const BlobSums& s) {
+    ConnectedComponents::Blob blob;
+    blob.label = label;
+    blob.area = region.area;
+    blob.perimeter = s.edges;
+    blob.bounds = region.bounds;
+    blob.centroid = region.centroid;
+
+    const double area = static_cast<double>(region.area);
+    const double cx = region.centroid.x, cy = region.centroid.y;
+
+    // Ellipse with the same second central moments (pixels as unit squares)
+    const double mu20 = s.sumXX / area - cx * cx + 1.0 / 12.0;
+    const double mu02 = s.sumYY / area - cy * cy + 1.0 / 12.0;
+    const double mu11 = s.sumXY / area - cx * cy;
+    const double common = std::sqrt(0.25 * (mu20 - mu02) * (mu20 - mu02) + mu11 * mu11);
+    const double major = 4.0 * std::sqrt(std::max(0.0, 0.5 * (mu20 + mu02) + common));
+    const double minor = 4.0 * std::sqrt(std::max(0.0, 0.5 * (mu20 + mu02) - common));
+    const double angle = 0.5 * std::atan2(2.0 * mu11, mu20 - mu02) * 180.0 / CV_PI;
+    blob.ellipse = cv::RotatedRect(cv::Point2f(static_cast<float>(cx), static_cast<float>(cy)),
+                                   cv::Size2f(static_cast<float>(major), static_cast<float>(minor)),
+                                   static_cast<float>(angle));
+
+    blob.circularity = s.edges > 0 ? 4.0 * CV_PI * area / (static_cast<double>(s.edges) * s.edges) : 0.0;
+    return blob;
+}
+
+template <typename T, bool Binary>
+ConnectedComponents::Result run(const cv::Mat& src, const ConnectedComponents::Options& options) {
+    using Clock = std::chrono::high_resolution_clock;
+    auto start = Clock::now();
+    const bool eightConnected = options.connectivity != 4;
+
+    ConnectedComponents::Result result;
+    result.labels.create(src.size(), CV_32S);
+    cv::Mat& labels = result.labels;
+
+    int stripeCount = std::max(1, std::min(cv::getNumThreads() * 4, src.rows / MIN_STRIPE_ROWS));
+    std::vector<Stripe> stripes(stripeCount);
+    for (int s = 0; s < stripeCount; s++) {
+        stripes[s].r0 = static_cast<int>(static_cast<long long>(src.rows) * s / stripeCount);
+        stripes[s].r1 = static_cast<int>(static_cast<long long>(src.rows) * (s + 1) / stripeCount);
+    }
+
+    cv::parallel_for_(cv::Range(0, stripeCount), [&](const cv::Range& range) {
+        for (int s = range.start; s < range.end; s++) {
+            labelStripe<T, Binary>(src, labels, stripes[s], eightConnected);
+        }
+    });
+
+    int total = 0;
+    for (Stripe& stripe : stripes) {
+        stripe.offset = total;
+        total += stripe.count;
+    }
+
+    std::vector<int> parent(total + 1);
+    for (int i = 0; i <= total; i++) parent[i] = i;
+    for (int s = 1; s < stripeCount; s++) {
+        mergeBoundary<T, Binary>(src, labels, stripes[s - 1], stripes[s], parent, eightConnected);
+    }
+
+    std::vector<int> resolved(total + 1, 0);
+    int components = 0;
+    for (int g = 1; g <= total; g++) {
+        const int root = findRoot(parent, g);
+        resolved[g] = (root == g) ? ++components : resolved[root];
+    }
+    result.componentCount = components;
+    result.labelMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    start = Clock::now();
+
+    cv::parallel_for_(cv::Range(0, stripeCount), [&](const cv::Range& range) {
+        for (int s = range.start; s < range.end; s++) {
+            finishStripe<T, Binary>(src, labels, stripes[s], resolved);
+        }
+    });
+
+    std::vector<BlobSums> sums(components + 1);
+    for (const Stripe& stripe : stripes) {
+        for (int c = 1; c <= stripe.count; c++) {
+            sums[resolved[stripe.offset + c]].add(stripe.sums[c]);
+        }
+    }
+
+    // Area, bounds and centroid come from the shared region pass
+    const RegionStatistics::Table table = RegionStatistics::compute(labels, cv::Mat(), false);
+
+    // Size filter; dropped blobs are cleared and the rest renumbered
+    const long long maxArea = options.maxArea > 0 ? options.maxArea : std::numeric_limits<long long>::max();
+    std::vector<int> remap(components + 1, 0);
+    result.blobs.reserve(components);
+    for (int l = 1; l <= components; l++) {
+        const RegionStatistics::Region* region = table.find(l);
+        if (!region || region->area < options.minArea || region->area > maxArea) continue;
+        remap[l] = static_cast<int>(result.blobs.size()) + 1;
+        result.blobs.push_back(makeBlob(remap[l], *region, sums[l]));
+    }
+    if (static_cast<int>(result.blobs.size()) != components) {
+        cv::parallel_for_(cv::Range(0, labels.rows), [&](const cv::Range& range) {
+            for (int y = range.start; y < range.end; y++) {
+                int* L = labels.ptr<int>(y);
+                for (int x = 0; x < labels.cols; x++) L[x] = remap[L[x]];
+            }
+        });
+    }
+    result.statsMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    return result;
+}
+
+} // namespace
+
+namespace ConnectedComponents {
+
+Result analyze(const cv::Mat& src, const Options& options) {
+    if (src.empty() || src.channels() != 1) {
+        throw std::runtime_error("Connected components need a single-channel image");
+    }
+
+    switch (src.depth()) {
+        case CV_8U: return run<uchar, true>(src, options);
+        case CV_16U: return run<ushort, false>(src, options);
+        case CV_32S: return run<int, false>(src, options);
+        default:
+            throw std::runtime_error("Connected components need an 8-bit binary or a 16/32-bit label image");
+    }
+}
+
+void colorize(const cv::Mat& labels, cv::Mat& dst) {
+    dst.create(labels.size(), CV_8UC3);
+    cv::parallel_for_(cv::Range(0, labels.rows), [&](const cv::Range& range) {
+        for (int y = range.start; y < range.end; y++) {
+            const int* L = labels.ptr<int>(y);
+            cv::Vec3b* out = dst.ptr<cv::Vec3b>(y);
+            for (int x = 0; x < labels.cols; x++) {
+                if (L[x] <= 0) {
+                    out[x] = cv::Vec3b(0, 0, 0);
+                    continue;
+                }
+                // Knuth multiplicative hash, kept away from black
+                const uint32_t h = static_cast<uint32_t>(L[x]) * 2654435761u;
+                out[x] = cv::Vec3b(64 + (h & 0xbf), 64 + ((h >> 8) & 0xbf), 64 + ((h >> 16) & 0xbf));
+            }
+        }
+    });
+}
+
+bool writeCsv(const std::string& path, const std::vector<Blob>& blobs) {
+    std::ofstream out(path);
+    if (!out) {
+        return false;
+    }
+
+    out << "Label,Area,Perimeter,X,Y,Width,Height,Centroid X,Centroid Y,"
+           "Major Axis,Minor Axis,Angle,Circularity\n";
+    for (const Blob& blob : blobs) {
+        out << blob.label << "," << blob.area << "," << blob.perimeter << ","
+            << blob.bounds.x << "," << blob.bounds.y << ","
+            << blob.bounds.width << "," << blob.bounds.height << ","
+            << blob.centroid.x << "," << blob.centroid.y << ","
+            << blob.ellipse.size.width << "," << blob.ellipse.size.height << ","
+            << blob.ellipse.angle << "," << blob.circularity << "\n";
+    }
+    return out.good();
+}
+
+} // namespace ConnectedComponents
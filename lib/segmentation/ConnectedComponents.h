@@ -0,0 +1,62 @@
+#ifndef CONNECTEDCOMPONENTS_H
+#define CONNECTEDCOMPONENTS_H
+
+#include <opencv2/opencv.hpp>
+#include <string>
+#include <vector>
+
+// Connected-component labeling and blob measurements. Row stripes are
+// labeled in parallel with a local union-find each; equivalences across
+// stripe boundaries are merged in one global union-find. The final
+// relabeling pass gathers the perimeter and second moments; area, bounds
+// and centroid come from RegionStatistics on the finished label map.
+namespace ConnectedComponents {
+
+struct Options {
+    int connectivity = 8;           // 4 or 8
+    long long minArea = 0;          // blobs outside [minArea, maxArea] are dropped
+    long long maxArea = 0;          // 0 = no upper limit
+};
+
+struct Blob {
+    int label = 0;                  // value in Result::labels
+    long long area = 0;
+    long long perimeter = 0;        // exposed pixel edges (crack length)
+    cv::Rect bounds;
+    cv::Point2d centroid;
+    cv::RotatedRect ellipse;        // same second moments as the blob
+    double circularity = 0.0;       // 4*pi*area / perimeter^2
+};
+
+struct Result {
+    cv::Mat labels;                 // CV_32S, 0 = background, blobs 1..n
+    std::vector<Blob> blobs;        // blobs[i].label == i + 1
+    int componentCount = 0;         // before size filtering
+    double labelMs = 0.0;
+    double statsMs = 0.0;
+};
+
+/**
+ * @brief Label connected components and measure every blob
+ * @param src CV_8U: nonzero pixels are foreground (binary image);
+ *            CV_16U / CV_32S: a label image, connected pixels with the same
+ *            nonzero value form a component
+ * @param options Connectivity and size filter
+ * @return Label map and per-blob statistics
+ */
+Result analyze(const cv::Mat& src, const Options& options = Options());
+
+/**
+ * @brief Paint each label with a stable pseudo-random color (background black)
+ */
+void colorize(const cv::Mat& labels, cv::Mat& dst);
+
+/**
+ * @brief Write one row per blob to a CSV file
+ * @return false if the file cannot be written
+ */
+bool writeCsv(const std::string& path, const std::vector<Blob>& blobs);
+
+} // namespace ConnectedComponents
+
+#endif // CONNECTEDCOMPONENTS_H
@@ -0,0 +1,207 @@
+#include "MeanShiftFilter.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+// Color bounds and sums of one spatial cell
+struct Cell {
+    uchar lo[3], hi[3];
+    int count, sx, sy, s0, s1, s2;
+};
+
+// The image bucketed into square cells that know the color box of their
+// pixels. A cell whose box lies entirely inside a window's color ball
+// contributes its sums at once, one entirely outside is skipped, and only
+// cells straddling the ball (or the window edge) are scanned pixel by pixel.
+// The grid covers the whole image and is shared read-only by the tiles, so
+// a trajectory can wander any distance from its tile.
+struct ImageGrid {
+    cv::Rect region;
+    int cell = 1;
+    int cellsX = 0, cellsY = 0;
+    std::vector<Cell> cells;
+
+    void build(const cv::Mat& src, int cellSize) {
+        region = cv::Rect(0, 0, src.cols, src.rows);
+        cell = cellSize;
+        cellsX = (region.width + cell - 1) / cell;
+        cellsY = (region.height + cell - 1) / cell;
+        cells.assign(static_cast<size_t>(cellsX) * cellsY, Cell{{255, 255, 255}, {0, 0, 0}, 0, 0, 0, 0, 0, 0});
+
+        // Rows of cells are independent
+        cv::parallel_for_(cv::Range(0, cellsY), [&](const cv::Range& range) {
+            for (int y = range.start * cell; y < std::min(range.end * cell, region.height); y++) {
+                const cv::Vec3b* row = src.ptr<cv::Vec3b>(y);
+                Cell* rowCells = &cells[static_cast<size_t>(y / cell) * cellsX];
+                for (int x = 0; x < region.width; x++) {
+                    const cv::Vec3b& c = row[x];
+                    Cell& g = rowCells[x / cell];
+                    for (int k = 0; k < 3; k++) {
+                        g.lo[k] = std::min(g.lo[k], c[k]);
+                        g.hi[k] = std::max(g.hi[k], c[k]);
+                    }
+                    g.count++;
+                    g.sx += x;
+                    g.sy += y;
+                    g.s0 += c[0];
+                    g.s1 += c[1];
+                    g.s2 += c[2];
+                }
+            }
+        });
+    }
+};
+
+void filterTile(const cv::Mat& src, const ImageGrid& grid, cv::Mat& dst, const cv::Rect& core,
+                const MeanShiftFilter::Options& options) {
+    const int sp = options.spatialRadius;
+    const int sr2 = static_cast<int>(options.colorRadius * options.colorRadius);
+    const cv::Rect& region = grid.region;
+
+    for (int y = core.y; y < core.y + core.height; y++) {
+        const cv::Vec3b* in = src.ptr<cv::Vec3b>(y);
+        cv::Vec3b* out = dst.ptr<cv::Vec3b>(y);
+        for (int x = core.x; x < core.x + core.width; x++) {
+            int x0 = x, y0 = y;
+            int c0 = in[x][0], c1 = in[x][1], c2 = in[x][2];
+
+            for (int iter = 0; iter < options.maxIterations; iter++) {
+                // Window in region coordinates
+                const int wx0 = std::max(x0 - sp, region.x) - region.x;
+                const int wx1 = std::min(x0 + sp, region.x + region.width - 1) - region.x;
+                const int wy0 = std::max(y0 - sp, region.y) - region.y;
+                const int wy1 = std::min(y0 + sp, region.y + region.height - 1) - region.y;
+                const int c[3] = {c0, c1, c2};
+
+                // Positions are image coordinates, so their sums can pass 2^31
+                int count = 0, s0 = 0, s1 = 0, s2 = 0;
+                int64_t sx = 0, sy = 0;
+                for (int cy = wy0 / grid.cell; cy <= wy1 / grid.cell; cy++) {
+                    const int cellY0 = cy * grid.cell, cellY1 = std::min(cellY0 + grid.cell, region.height) - 1;
+                    for (int cx = wx0 / grid.cell; cx <= wx1 / grid.cell; cx++) {
+                        const int cellX0 = cx * grid.cell, cellX1 = std::min(cellX0 + grid.cell, region.width) - 1;
+                        const Cell& g = grid.cells[static_cast<size_t>(cy) * grid.cellsX + cx];
+
+                        int nearest = 0, farthest = 0;
+                        for (int k = 0; k < 3; k++) {
+                            const int n = c[k] < g.lo[k] ? g.lo[k] - c[k] : (c[k] > g.hi[k] ? c[k] - g.hi[k] : 0);
+                            const int f = std::max(c[k] - g.lo[k], g.hi[k] - c[k]);
+                            nearest += n * n;
+                            farthest += f * f;
+                        }
+                        if (nearest > sr2) continue;
+
+                        const bool inside = cellX0 >= wx0 && cellX1 <= wx1 && cellY0 >= wy0 && cellY1 <= wy1;
+                        if (inside && farthest <= sr2) {
+                            count += g.count;
+                            sx += g.sx;
+                            sy += g.sy;
+                            s0 += g.s0;
+                            s1 += g.s1;
+                            s2 += g.s2;
+                            continue;
+                        }
+
+                        // Scan the part of the cell inside the window
+                        const int px0 = std::max(cellX0, wx0), px1 = std::min(cellX1, wx1);
+                        for (int py = std::max(cellY0, wy0); py <= std::min(cellY1, wy1); py++) {
+                            const cv::Vec3b* row = src.ptr<cv::Vec3b>(region.y + py) + region.x;
+                            for (int px = px0; px <= px1; px++) {
+                                const int d0 = row[px][0] - c0, d1 = row[px][1] - c1, d2 = row[px][2] - c2;
+                                if (d0 * d0 + d1 * d1 + d2 * d2 > sr2) continue;
+                                count++;
+                                sx += px;
+                                sy += py;
+                                s0 += row[px][0];
+                                s1 += row[px][1];
+                                s2 += row[px][2];
+                            }
+                        }
+                    }
+                }
+                if (count == 0) break;
+
+                const double inv = 1.0 / count;
+                const int x1 = cvRound(sx * inv) + region.x;
+                const int y1 = cvRound(sy * inv) + region.y;
+                const int n0 = cvRound(s0 * inv), n1 = cvRound(s1 * inv), n2 = cvRound(s2 * inv);
+
+                // Termination test of cv::pyrMeanShiftFiltering
+                const bool stop = (x0 == x1 && y0 == y1) ||
+                    std::abs(x1 - x0) + std::abs(y1 - y0) +
+                    (n0 - c0) * (n0 - c0) + (n1 - c1) * (n1 - c1) + (n2 - c2) * (n2 - c2) <= options.epsilon;
+                x0 = x1;
+                y0 = y1;
+                c0 = n0;
+                c1 = n1;
+                c2 = n2;
+                if (stop) break;
+            }
+            out[x] = cv::Vec3b(static_cast<uchar>(c0), static_cast<uchar>(c1), static_cast<uchar>(c2));
+        }
+    }
+}
+
+} // namespace
+
+namespace MeanShiftFilter {
+
+bool filter(const cv::Mat& src, cv::Mat& dst, const Options& options,
+            const std::function<bool(int done, int total)>& progress, Report* report) {
+    if (src.type() != CV_8UC3) {
+        throw std::runtime_error("Mean shift filtering needs an 8-bit BGR image");
+    }
+    if (options.spatialRadius < 1 || options.colorRadius <= 0) {
+        throw std::runtime_error("Mean shift radii must be positive");
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+    cv::Mat result(src.size(), src.type());
+
+    const int tile = std::max(16, options.tileSize);
+    std::vector<cv::Rect> tiles;
+    for (int y = 0; y < src.rows; y += tile) {
+        for (int x = 0; x < src.cols; x += tile) {
+            tiles.push_back(cv::Rect(x, y, tile, tile) & cv::Rect(0, 0, src.cols, src.rows));
+        }
+    }
+
+    Report local;
+    Report& r = report ? *report : local;
+    r = Report();
+    r.tiles = static_cast<int>(tiles.size());
+
+    ImageGrid grid;
+    grid.build(src, std::max(4, options.spatialRadius / 2));
+
+    // Batches of a few tiles per thread keep progress (and cancelling) responsive
+    const int batch = std::max(1, cv::getNumThreads()) * 2;
+    for (int first = 0; first < r.tiles; first += batch) {
+        const int last = std::min(r.tiles, first + batch);
+        cv::parallel_for_(cv::Range(first, last), [&](const cv::Range& range) {
+            for (int t = range.start; t < range.end; t++) {
+                filterTile(src, grid, result, tiles[t], options);
+            }
+        });
+        r.tilesDone = last;
+
+        if (progress && !progress(last, r.tiles)) {
+            r.cancelled = true;
+            break;
+        }
+    }
+
+    r.elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    if (r.cancelled) {
+        return false;
+    }
+    dst = result;
+    return true;
+}
+
+} // namespace MeanShiftFilter
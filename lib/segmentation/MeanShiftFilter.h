@@ -0,0 +1,49 @@
+#ifndef MEANSHIFTFILTER_H
+#define MEANSHIFTFILTER_H
+
+#include <opencv2/opencv.hpp>
+#include <functional>
+
+// Mean-shift filtering (the single-level form of cv::pyrMeanShiftFiltering)
+// split into tiles that run in parallel. The image is bucketed once into
+// spatial cells that record the color bounding box and sums of their
+// pixels. A window skips cells whose box lies outside its color ball, adds
+// whole cells whose box lies inside it, and only scans the pixels of cells
+// that straddle the ball or the window edge.
+namespace MeanShiftFilter {
+
+struct Options {
+    int spatialRadius = 20;
+    double colorRadius = 40.0;
+    int maxIterations = 5;          // same defaults as cv::pyrMeanShiftFiltering
+    double epsilon = 1.0;
+    int tileSize = 128;
+};
+
+struct Report {
+    int tiles = 0;
+    int tilesDone = 0;
+    bool cancelled = false;
+    double elapsedMs = 0.0;
+};
+
+/**
+ * @brief Tiled, multi-threaded mean-shift filtering
+ *
+ * Tiles only split the output; every window reads the shared cell grid of
+ * the whole image, so trajectories are never clamped and the result does
+ * not depend on the tile size.
+ * @param src Source image (8-bit BGR)
+ * @param dst Filtered image, same type as src
+ * @param options Radii, termination and tile size
+ * @param progress Called after every batch of tiles; return false to cancel
+ * @param report Optional tile counts and timing
+ * @return false if cancelled (dst is left unchanged)
+ */
+bool filter(const cv::Mat& src, cv::Mat& dst, const Options& options = Options(),
+            const std::function<bool(int done, int total)>& progress = nullptr,
+            Report* report = nullptr);
+
+} // namespace MeanShiftFilter
+
+#endif // MEANSHIFTFILTER_H
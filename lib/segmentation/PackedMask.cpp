@@ -0,0 +1,186 @@
+#include "PackedMask.h"
+#include <opencv2/core/hal/hal.hpp>
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+const uint64_t LOW_7_BITS = 0x7F7F7F7F7F7F7F7FULL;
+const uint64_t HIGH_BITS = 0x8080808080808080ULL;
+// Moves bit 0 of byte i to bit 56 + i (little-endian byte order)
+const uint64_t GATHER_BYTES = 0x0102040810204080ULL;
+
+// 8 mask bytes -> 8 bits, nonzero bytes set
+inline uint64_t packBytes(const uchar* bytes) {
+    uint64_t v;
+    std::memcpy(&v, bytes, 8);
+    const uint64_t nonzero = (((v & LOW_7_BITS) + LOW_7_BITS) | v) & HIGH_BITS;
+    return ((nonzero >> 7) * GATHER_BYTES) >> 56;
+}
+
+// 8 bits -> 8 mask bytes of 0 or 255
+const uint64_t* expansionTable() {
+    static const std::vector<uint64_t> table = [] {
+        std::vector<uint64_t> t(256);
+        for (int bits = 0; bits < 256; bits++) {
+            uint64_t bytes = 0;
+            for (int i = 0; i < 8; i++) {
+                if (bits & (1 << i)) bytes |= uint64_t(0xFF) << (8 * i);
+            }
+            t[bits] = bytes;
+        }
+        return t;
+    }();
+    return table.data();
+}
+
+// Bits [x0, x1) of one row
+void setRange(uint64_t* row, int x0, int x1, bool value) {
+    while (x0 < x1) {
+        const int word = x0 >> 6;
+        const int first = x0 & 63;
+        const int last = std::min(64, first + (x1 - x0));
+        const uint64_t bits = (last == 64 ? ~uint64_t(0) : (uint64_t(1) << last) - 1) & ~((uint64_t(1) << first) - 1);
+        row[word] = value ? (row[word] | bits) : (row[word] & ~bits);
+        x0 += last - first;
+    }
+}
+
+} // namespace
+
+PackedMask::PackedMask(const cv::Size& size) {
+    if (size.width <= 0 || size.height <= 0) {
+        return;
+    }
+    maskSize = size;
+    stride = (size.width + 63) / 64;
+    words.assign(static_cast<size_t>(stride) * size.height, 0);
+}
+
+PackedMask PackedMask::fromMat(const cv::Mat& mask) {
+    if (mask.empty()) {
+        return PackedMask();
+    }
+    if (mask.type() != CV_8UC1) {
+        throw std::runtime_error("Packed masks are built from CV_8UC1 masks");
+    }
+
+    PackedMask packed(mask.size());
+    const int cols = mask.cols;
+    cv::parallel_for_(cv::Range(0, mask.rows), [&](const cv::Range& range) {
+        for (int y = range.start; y < range.end; y++) {
+            const uchar* src = mask.ptr<uchar>(y);
+            uint64_t* dst = packed.row(y);
+            int x = 0;
+            for (; x + 64 <= cols; x += 64) {
+                uint64_t word = 0;
+                for (int b = 0; b < 8; b++) {
+                    word |= packBytes(src + x + 8 * b) << (8 * b);
+                }
+                dst[x >> 6] = word;
+            }
+            for (; x < cols; x++) {
+                if (src[x]) dst[x >> 6] |= uint64_t(1) << (x & 63);
+            }
+        }
+    });
+    return packed;
+}
+
+cv::Mat PackedMask::toMat() const {
+    if (empty()) {
+        return cv::Mat();
+    }
+
+    cv::Mat mask(maskSize, CV_8UC1);
+    const uint64_t* table = expansionTable();
+    const int cols = maskSize.width;
+    cv::parallel_for_(cv::Range(0, maskSize.height), [&](const cv::Range& range) {
+        for (int y = range.start; y < range.end; y++) {
+            const uint64_t* src = row(y);
+            uchar* dst = mask.ptr<uchar>(y);
+            for (int x = 0; x < cols; x += 8) {
+                const uint64_t bytes = table[(src[x >> 6] >> (x & 63)) & 0xFF];
+                std::memcpy(dst + x, &bytes, std::min(8, cols - x));
+            }
+        }
+    });
+    return mask;
+}
+
+bool PackedMask::any() const {
+    return std::any_of(words.begin(), words.end(), [](uint64_t w) { return w != 0; });
+}
+
+long long PackedMask::count() const {
+    long long total = 0;
+    for (int y = 0; y < maskSize.height; y++) {
+        total += cv::hal::normHamming(reinterpret_cast<const uchar*>(row(y)),
+                                      stride * static_cast<int>(sizeof(uint64_t)));
+    }
+    return total;
+}
+
+void PackedMask::fill(const cv::Rect& rect, bool value) {
+    const cv::Rect r = rect & cv::Rect(0, 0, maskSize.width, maskSize.height);
+    for (int y = r.y; y < r.y + r.height; y++) {
+        setRange(row(y), r.x, r.x + r.width, value);
+    }
+}
+
+void PackedMask::paint(const cv::Mat& patch, const cv::Point& offset, bool value) {
+    if (patch.type() != CV_8UC1) {
+        throw std::runtime_error("Packed masks are painted with CV_8UC1 patches");
+    }
+    const cv::Rect r = cv::Rect(offset.x, offset.y, patch.cols, patch.rows) &
+                       cv::Rect(0, 0, maskSize.width, maskSize.height);
+    for (int y = r.y; y < r.y + r.height; y++) {
+        const uchar* src = patch.ptr<uchar>(y - offset.y);
+        for (int x = r.x; x < r.x + r.width; x++) {
+            if (!src[x - offset.x]) continue;
+            if (value) set(x, y); else reset(x, y);
+        }
+    }
+}
+
+void PackedMask::checkSameSize(const PackedMask& other) const {
+    if (maskSize != other.maskSize) {
+        throw std::runtime_error("Packed mask operands differ in size");
+    }
+}
+
+PackedMask& PackedMask::operator|=(const PackedMask& other) {
+    checkSameSize(other);
+    for (size_t i = 0; i < words.size(); i++) words[i] |= other.words[i];
+    return *this;
+}
+
+PackedMask& PackedMask::operator&=(const PackedMask& other) {
+    checkSameSize(other);
+    for (size_t i = 0; i < words.size(); i++) words[i] &= other.words[i];
+    return *this;
+}
+
+PackedMask& PackedMask::operator-=(const PackedMask& other) {
+    checkSameSize(other);
+    for (size_t i = 0; i < words.size(); i++) words[i] &= ~other.words[i];
+    return *this;
+}
+
+PackedMask& PackedMask::operator^=(const PackedMask& other) {
+    checkSameSize(other);
+    for (size_t i = 0; i < words.size(); i++) words[i] ^= other.words[i];
+    return *this;
+}
+
+void PackedMask::invert() {
+    // Padding bits past the last column stay clear
+    const int tail = maskSize.width & 63;
+    const uint64_t lastWord = tail ? (uint64_t(1) << tail) - 1 : ~uint64_t(0);
+    for (int y = 0; y < maskSize.height; y++) {
+        uint64_t* r = row(y);
+        for (int i = 0; i < stride; i++) r[i] = ~r[i];
+        r[stride - 1] &= lastWord;
+    }
+}
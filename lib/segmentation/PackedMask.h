@@ -0,0 +1,68 @@
+#ifndef PACKEDMASK_H
+#define PACKEDMASK_H
+
+#include <opencv2/opencv.hpp>
+#include <cstdint>
+#include <vector>
+
+// Binary mask with one bit per pixel, rows padded to whole 64-bit words
+// (bit x % 64 of word x / 64, padding bits always clear). A selection takes
+// an eighth of the memory of a CV_8UC1 mask, copies are cheap, and union,
+// intersection, difference and inversion work on 64 pixels per operation.
+// Converting to cv::Mat is left to the code that needs the pixels.
+class PackedMask {
+public:
+    PackedMask() = default;
+    explicit PackedMask(const cv::Size& size);   // all pixels clear
+
+    // Nonzero pixels of a CV_8UC1 mask are set
+    static PackedMask fromMat(const cv::Mat& mask);
+    // CV_8UC1, 255 where set
+    cv::Mat toMat() const;
+
+    bool empty() const { return words.empty(); }
+    cv::Size size() const { return maskSize; }
+    bool any() const;
+    long long count() const;
+    size_t memoryBytes() const { return words.size() * sizeof(uint64_t); }
+
+    bool test(int x, int y) const {
+        return (row(y)[x >> 6] >> (x & 63)) & 1;
+    }
+    void set(int x, int y) { row(y)[x >> 6] |= uint64_t(1) << (x & 63); }
+    void reset(int x, int y) { row(y)[x >> 6] &= ~(uint64_t(1) << (x & 63)); }
+
+    // Sets (or clears) every pixel of rect, clipped to the mask
+    void fill(const cv::Rect& rect, bool value = true);
+    // Sets (or clears) the pixels where the CV_8UC1 patch is nonzero; the
+    // patch is placed at offset and clipped to the mask
+    void paint(const cv::Mat& patch, const cv::Point& offset, bool value = true);
+
+    // Set operations; both masks must have the same size
+    PackedMask& operator|=(const PackedMask& other);    // union
+    PackedMask& operator&=(const PackedMask& other);    // intersection
+    PackedMask& operator-=(const PackedMask& other);    // difference
+    PackedMask& operator^=(const PackedMask& other);    // symmetric difference
+    void invert();
+
+    bool operator==(const PackedMask& other) const {
+        return maskSize == other.maskSize && words == other.words;
+    }
+    bool operator!=(const PackedMask& other) const { return !(*this == other); }
+
+private:
+    uint64_t* row(int y) { return words.data() + static_cast<size_t>(y) * stride; }
+    const uint64_t* row(int y) const { return words.data() + static_cast<size_t>(y) * stride; }
+    void checkSameSize(const PackedMask& other) const;
+
+    cv::Size maskSize;
+    int stride = 0;                 // words per row
+    std::vector<uint64_t> words;
+};
+
+inline PackedMask operator|(PackedMask a, const PackedMask& b) { return a |= b; }
+inline PackedMask operator&(PackedMask a, const PackedMask& b) { return a &= b; }
+inline PackedMask operator-(PackedMask a, const PackedMask& b) { return a -= b; }
+inline PackedMask operator^(PackedMask a, const PackedMask& b) { return a ^= b; }
+
+#endif // PACKEDMASK_H
@@ -0,0 +1,253 @@
+#include "RegionStatistics.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#include <unordered_set>
+
+namespace {
+
+// Upper bound for all per-stripe partials together; large label counts
+// (connected components on noise) get fewer stripes instead of more memory
+const size_t PARTIAL_BUDGET = size_t(256) << 20;
+
+struct Partial {
+    std::vector<long long> area;
+    std::vector<double> sumX, sumY;
+    std::vector<double> sum, sumSq;     // labels x channels
+    std::vector<int> minX, minY, maxX, maxY;
+    std::unordered_set<uint64_t> edges;
+
+    void reset(int labelCount, int channels) {
+        area.assign(labelCount, 0);
+        sumX.assign(labelCount, 0.0);
+        sumY.assign(labelCount, 0.0);
+        sum.assign(static_cast<size_t>(labelCount) * channels, 0.0);
+        sumSq.assign(static_cast<size_t>(labelCount) * channels, 0.0);
+        minX.assign(labelCount, std::numeric_limits<int>::max());
+        minY.assign(labelCount, std::numeric_limits<int>::max());
+        maxX.assign(labelCount, -1);
+        maxY.assign(labelCount, -1);
+        edges.clear();
+    }
+};
+
+inline uint64_t edgeKey(int a, int b) {
+    if (a > b) std::swap(a, b);
+    return (static_cast<uint64_t>(a) << 32) | static_cast<uint32_t>(b);
+}
+
+} // namespace
+
+namespace RegionStatistics {
+
+Table compute(const cv::Mat& labels, const cv::Mat& image, bool adjacency) {
+    if (labels.type() != CV_32S) {
+        throw std::runtime_error("Region statistics need a CV_32S label map");
+    }
+    if (!image.empty() && (image.size() != labels.size() || image.depth() != CV_8U || image.channels() > 4)) {
+        throw std::runtime_error("Region statistics need an 8-bit image of the label map's size");
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+    Table table;
+    table.channels = image.empty() ? 0 : image.channels();
+
+    double maxValue = -1.0;
+    if (!labels.empty()) {
+        cv::minMaxLoc(labels, nullptr, &maxValue);
+    }
+    if (maxValue < 0) {
+        return table;
+    }
+
+    const int cn = table.channels;
+    const int labelCount = static_cast<int>(maxValue) + 1;
+    const size_t bytesPerLabel = sizeof(long long) + 2 * sizeof(double) + 4 * sizeof(int) + 2 * cn * sizeof(double);
+    int stripes = std::min(std::max(1, cv::getNumThreads()), labels.rows);
+    stripes = std::max(1, std::min<int>(stripes, static_cast<int>(PARTIAL_BUDGET / (bytesPerLabel * labelCount))));
+
+    std::vector<Partial> partials(stripes);
+    cv::parallel_for_(cv::Range(0, stripes), [&](const cv::Range& range) {
+        for (int s = range.start; s < range.end; s++) {
+            Partial& p = partials[s];
+            p.reset(labelCount, cn);
+
+            const int r0 = labels.rows * s / stripes;
+            const int r1 = labels.rows * (s + 1) / stripes;
+            uint64_t lastEdge = std::numeric_limits<uint64_t>::max();
+            auto link = [&](int a, int b) {
+                uint64_t key = edgeKey(a, b);
+                if (key != lastEdge) {
+                    p.edges.insert(key);
+                    lastEdge = key;
+                }
+            };
+
+            for (int y = r0; y < r1; y++) {
+                const int* row = labels.ptr<int>(y);
+                const int* above = (y > 0) ? labels.ptr<int>(y - 1) : nullptr;
+                const int* below = (y + 1 < labels.rows) ? labels.ptr<int>(y + 1) : nullptr;
+                const uchar* px = cn ? image.ptr<uchar>(y) : nullptr;
+
+                for (int x = 0; x < labels.cols; x++) {
+                    const int v = row[x];
+                    if (v >= 0) {
+                        p.area[v]++;
+                        p.sumX[v] += x;
+                        p.sumY[v] += y;
+                        p.minX[v] = std::min(p.minX[v], x);
+                        p.maxX[v] = std::max(p.maxX[v], x);
+                        p.minY[v] = std::min(p.minY[v], y);
+                        p.maxY[v] = std::max(p.maxY[v], y);
+                        for (int c = 0; c < cn; c++) {
+                            const double value = px[x * cn + c];
+                            p.sum[static_cast<size_t>(v) * cn + c] += value;
+                            p.sumSq[static_cast<size_t>(v) * cn + c] += value * value;
+                        }
+                    }
+                    if (!adjacency) continue;
+
+                    if (v >= 0) {
+                        if (x + 1 < labels.cols && row[x + 1] >= 0 && row[x + 1] != v) link(v, row[x + 1]);
+                        if (below && below[x] >= 0 && below[x] != v) link(v, below[x]);
+                    } else {
+                        // Boundary pixel: the regions around it touch each other
+                        int around[4] = {
+                            above ? above[x] : -1, below ? below[x] : -1,
+                            x > 0 ? row[x - 1] : -1, x + 1 < labels.cols ? row[x + 1] : -1
+                        };
+                        for (int i = 0; i < 4; i++) {
+                            for (int j = i + 1; j < 4; j++) {
+                                if (around[i] >= 0 && around[j] >= 0 && around[i] != around[j]) {
+                                    link(around[i], around[j]);
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    });
+
+    // Merge the stripes
+    table.index.assign(labelCount, -1);
+    for (int v = 0; v < labelCount; v++) {
+        Region region;
+        region.label = v;
+        int minX = std::numeric_limits<int>::max(), minY = minX, maxX = -1, maxY = -1;
+        double sumX = 0.0, sumY = 0.0;
+        cv::Scalar sum, sumSq;
+        for (const Partial& p : partials) {
+            region.area += p.area[v];
+            sumX += p.sumX[v];
+            sumY += p.sumY[v];
+            minX = std::min(minX, p.minX[v]);
+            minY = std::min(minY, p.minY[v]);
+            maxX = std::max(maxX, p.maxX[v]);
+            maxY = std::max(maxY, p.maxY[v]);
+            for (int c = 0; c < cn; c++) {
+                sum[c] += p.sum[static_cast<size_t>(v) * cn + c];
+                sumSq[c] += p.sumSq[static_cast<size_t>(v) * cn + c];
+            }
+        }
+        if (region.area == 0) continue;
+
+        const double area = static_cast<double>(region.area);
+        region.bounds = cv::Rect(minX, minY, maxX - minX + 1, maxY - minY + 1);
+        region.centroid = cv::Point2d(sumX / area, sumY / area);
+        for (int c = 0; c < cn; c++) {
+            region.mean[c] = sum[c] / area;
+            region.variance[c] = std::max(0.0, sumSq[c] / area - region.mean[c] * region.mean[c]);
+        }
+        table.index[v] = static_cast<int>(table.regions.size());
+        table.regions.push_back(region);
+    }
+
+    if (adjacency) {
+        std::vector<uint64_t> edges;
+        for (const Partial& p : partials) {
+            edges.insert(edges.end(), p.edges.begin(), p.edges.end());
+        }
+        std::sort(edges.begin(), edges.end());
+        edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+        // Sorted keys push every neighbour list in ascending order
+        for (uint64_t key : edges) {
+            const int a = static_cast<int>(key >> 32);
+            const int b = static_cast<int>(key & 0xffffffffu);
+            table.regions[table.index[a]].neighbors.push_back(b);
+            table.regions[table.index[b]].neighbors.push_back(a);
+        }
+    }
+
+    table.elapsedMs = std::chrono::duration<double, std::milli>(
+        std::chrono::high_resolution_clock::now() - start).count();
+    return table;
+}
+
+void paintMeans(const cv::Mat& labels, const Table& table, cv::Mat& dst, const cv::Scalar& boundary) {
+    const int cn = table.channels;
+    if (cn == 0) {
+        throw std::runtime_error("Region statistics were computed without an image");
+    }
+
+    const int labelCount = static_cast<int>(table.index.size());
+    std::vector<uchar> colors(static_cast<size_t>(labelCount) * cn, 0);
+    for (const Region& region : table.regions) {
+        for (int c = 0; c < cn; c++) {
+            colors[static_cast<size_t>(region.label) * cn + c] = cv::saturate_cast<uchar>(region.mean[c]);
+        }
+    }
+    uchar edge[4];
+    for (int c = 0; c < 4; c++) edge[c] = cv::saturate_cast<uchar>(boundary[c]);
+
+    dst.create(labels.size(), CV_MAKETYPE(CV_8U, cn));
+    cv::parallel_for_(cv::Range(0, labels.rows), [&](const cv::Range& range) {
+        for (int y = range.start; y < range.end; y++) {
+            const int* row = labels.ptr<int>(y);
+            uchar* out = dst.ptr<uchar>(y);
+            for (int x = 0; x < labels.cols; x++, out += cn) {
+                const int v = row[x];
+                const uchar* color = (v >= 0 && v < labelCount) ? &colors[static_cast<size_t>(v) * cn] : edge;
+                for (int c = 0; c < cn; c++) out[c] = color[c];
+            }
+        }
+    });
+}
+
+bool writeCsv(const std::string& path, const Table& table) {
+    std::ofstream out(path);
+    if (!out) {
+        return false;
+    }
+
+    static const char* BGRA[] = {"B", "G", "R", "A"};
+    out << "Label,Area,X,Y,Width,Height,Centroid X,Centroid Y";
+    for (int c = 0; c < table.channels; c++) {
+        out << ",Mean" << (table.channels > 1 ? std::string(" ") + BGRA[c] : "");
+    }
+    for (int c = 0; c < table.channels; c++) {
+        out << ",Variance" << (table.channels > 1 ? std::string(" ") + BGRA[c] : "");
+    }
+    out << ",Neighbors\n";
+
+    for (const Region& region : table.regions) {
+        out << region.label << "," << region.area << ","
+            << region.bounds.x << "," << region.bounds.y << ","
+            << region.bounds.width << "," << region.bounds.height << ","
+            << region.centroid.x << "," << region.centroid.y;
+        for (int c = 0; c < table.channels; c++) out << "," << region.mean[c];
+        for (int c = 0; c < table.channels; c++) out << "," << region.variance[c];
+        out << ",";
+        for (size_t i = 0; i < region.neighbors.size(); i++) {
+            out << (i ? " " : "") << region.neighbors[i];
+        }
+        out << "\n";
+    }
+    return out.good();
+}
+
+} // namespace RegionStatistics
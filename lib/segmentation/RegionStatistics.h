@@ -0,0 +1,64 @@
+#ifndef REGIONSTATISTICS_H
+#define REGIONSTATISTICS_H
+
+#include <opencv2/opencv.hpp>
+#include <string>
+#include <vector>
+
+// Per-region statistics for any CV_32S label map (SLIC, watershed, k-means,
+// connected components). Everything is gathered in one parallel pass over
+// row stripes, each with its own dense per-label partials, which are merged
+// once at the end. Negative labels (watershed boundaries) are not regions.
+namespace RegionStatistics {
+
+struct Region {
+    int label = 0;
+    long long area = 0;
+    cv::Rect bounds;
+    cv::Point2d centroid;
+    cv::Scalar mean;                // per channel of the sampled image
+    cv::Scalar variance;
+    std::vector<int> neighbors;     // adjacent labels, ascending
+};
+
+struct Table {
+    int channels = 0;               // valid entries of mean / variance
+    std::vector<Region> regions;    // ascending label, empty labels omitted
+    std::vector<int> index;         // label -> position in regions, -1 if absent
+    double elapsedMs = 0.0;
+
+    const Region* find(int label) const {
+        if (label < 0 || label >= static_cast<int>(index.size()) || index[label] < 0) return nullptr;
+        return &regions[index[label]];
+    }
+};
+
+/**
+ * @brief Area, mean/variance, bounding box, centroid and adjacency per label
+ * @param labels Label map (CV_32S)
+ * @param image Optional 8-bit image of the same size (1-4 channels) to sample
+ * @param adjacency Also collect 4-connected neighbours; boundary pixels
+ *                  (negative labels) link the regions that touch them
+ * @return Statistics table
+ */
+Table compute(const cv::Mat& labels, const cv::Mat& image = cv::Mat(), bool adjacency = true);
+
+/**
+ * @brief Paint every region with its mean color
+ * @param labels Label map the table was computed from
+ * @param table Statistics with at least one image channel
+ * @param dst 8-bit output with the table's channel count
+ * @param boundary Color for negative labels
+ */
+void paintMeans(const cv::Mat& labels, const Table& table, cv::Mat& dst,
+                const cv::Scalar& boundary = cv::Scalar(0, 255, 0));
+
+/**
+ * @brief Write one row per region to a CSV file
+ * @return false if the file cannot be written
+ */
+bool writeCsv(const std::string& path, const Table& table);
+
+} // namespace RegionStatistics
+
+#endif // REGIONSTATISTICS_H
@@ -0,0 +1,277 @@
+#include "FrequencyDomain.h"
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+// Extend the top-left 'size' block of 'padded' over the rest of the buffer
+void fillPadding(cv::Mat& padded, cv::Size size, int borderType) {
+    const int extraCols = padded.cols - size.width;
+    const int extraRows = padded.rows - size.height;
+
+    if (borderType == cv::BORDER_CONSTANT) {
+        if (extraCols > 0) padded(cv::Rect(size.width, 0, extraCols, size.height)).setTo(0);
+        if (extraRows > 0) padded(cv::Rect(0, size.height, padded.cols, extraRows)).setTo(0);
+        return;
+    }
+
+    // BORDER_REPLICATE
+    if (extraCols > 0) {
+        for (int i = 0; i < size.height; i++) {
+            float* row = padded.ptr<float>(i);
+            std::fill(row + size.width, row + padded.cols, row[size.width - 1]);
+        }
+    }
+    for (int i = size.height; i < padded.rows; i++) {
+        std::memcpy(padded.ptr<float>(i), padded.ptr<float>(size.height - 1), padded.cols * sizeof(float));
+    }
+}
+
+// |H|^2 of a packed spectrum, written to both the Re and Im slot of every
+// frequency so it can divide the spectrum element-wise
+void packedPower(const cv::Mat& spectrum, cv::Mat& power) {
+    const int rows = spectrum.rows;
+    const int cols = spectrum.cols;
+    power.create(spectrum.size(), CV_32F);
+
+    // Columns 1 .. hold (Re, Im) pairs along each row
+    const int pairEnd = (cols % 2 == 0) ? cols - 1 : cols;
+    cv::parallel_for_(cv::Range(0, rows), [&](const cv::Range& range) {
+        for (int i = range.start; i < range.end; i++) {
+            const float* h = spectrum.ptr<float>(i);
+            float* p = power.ptr<float>(i);
+            for (int j = 1; j + 1 < pairEnd; j += 2) {
+                float value = h[j] * h[j] + h[j + 1] * h[j + 1];
+                p[j] = value;
+                p[j + 1] = value;
+            }
+        }
+    });
+
+    // Column 0 (and the last column for even widths) is packed along the rows
+    const int packedCols[2] = {0, cols - 1};
+    const int packedCount = (cols % 2 == 0) ? 2 : 1;
+    for (int n = 0; n < packedCount; n++) {
+        const int c = packedCols[n];
+        float h0 = spectrum.at<float>(0, c);
+        power.at<float>(0, c) = h0 * h0;
+        int i = 1;
+        for (; i + 1 < rows; i += 2) {
+            float re = spectrum.at<float>(i, c);
+            float im = spectrum.at<float>(i + 1, c);
+            power.at<float>(i, c) = power.at<float>(i + 1, c) = re * re + im * im;
+        }
+        if (i < rows) {
+            float last = spectrum.at<float>(i, c);
+            power.at<float>(i, c) = last * last;
+        }
+    }
+}
+
+} // namespace
+
+cv::Size FrequencyDomain::optimalSize(cv::Size imageSize) {
+    return cv::Size(cv::getOptimalDFTSize(imageSize.width), cv::getOptimalDFTSize(imageSize.height));
+}
+
+void FrequencyDomain::prepare(cv::Size imageSize) {
+    if (imageSize == size && !padded.empty()) {
+        return;
+    }
+
+    size = imageSize;
+    cv::Size optimal = optimalSize(imageSize);
+    padded.create(optimal, CV_32F);
+    spectrumBuffer.create(optimal, CV_32F);
+    spatial.create(optimal, CV_32F);
+    result = spatial(cv::Rect(0, 0, size.width, size.height));
+    power.release();
+
+    // Transfer functions are size dependent
+    transfer.release();
+    psfKey.release();
+}
+
+void FrequencyDomain::release() {
+    *this = FrequencyDomain();
+}
+
+cv::Mat& FrequencyDomain::forward(const cv::Mat& plane, int borderType) {
+    CV_Assert(plane.size() == size && plane.channels() == 1);
+
+    cv::Mat roi = padded(cv::Rect(0, 0, size.width, size.height));
+    plane.convertTo(roi, CV_32F);
+    fillPadding(padded, size, borderType);
+
+    // Zero padding below the image lets the row pass skip those rows
+    int nonzeroRows = (borderType == cv::BORDER_CONSTANT) ? size.height : 0;
+    cv::dft(padded, spectrumBuffer, 0, nonzeroRows);
+    return spectrumBuffer;
+}
+
+cv::Mat& FrequencyDomain::inverse() {
+    // Only the rows inside the crop are needed
+    cv::idft(spectrumBuffer, spatial, cv::DFT_SCALE | cv::DFT_REAL_OUTPUT, size.height);
+    return result;
+}
+
+void FrequencyDomain::inverse(cv::Mat& dst) {
+    inverse().copyTo(dst);
+}
+
+void FrequencyDomain::forwardComplex(const cv::Mat& plane, cv::Mat& complex, int borderType) {
+    CV_Assert(plane.size() == size && plane.channels() == 1);
+
+    cv::Mat roi = padded(cv::Rect(0, 0, size.width, size.height));
+    plane.convertTo(roi, CV_32F);
+    fillPadding(padded, size, borderType);
+    cv::dft(padded, complex, cv::DFT_COMPLEX_OUTPUT);
+}
+
+void FrequencyDomain::multiplyMask(cv::Mat& spectrum, const cv::Mat& mask) {
+    cv::multiply(spectrum, mask, spectrum);
+}
+
+void FrequencyDomain::multiplySpectrum(cv::Mat& spectrum, const cv::Mat& other, bool conjugate) {
+    cv::mulSpectrums(spectrum, other, spectrum, 0, conjugate);
+}
+
+void FrequencyDomain::wienerDivide(cv::Mat& spectrum, const cv::Mat& transferFn, double k) {
+    cv::mulSpectrums(spectrum, transferFn, spectrum, 0, true);
+    packedPower(transferFn, power);
+
+    const float kf = static_cast<float>(k);
+    cv::parallel_for_(cv::Range(0, spectrum.rows), [&](const cv::Range& range) {
+        for (int i = range.start; i < range.end; i++) {
+            float* s = spectrum.ptr<float>(i);
+            const float* p = power.ptr<float>(i);
+            for (int j = 0; j < spectrum.cols; j++) {
+                float denom = p[j] + kf;
+                s[j] = (denom > 0) ? s[j] / denom : 0.0f;
+            }
+        }
+    });
+}
+
+const cv::Mat& FrequencyDomain::transferFunction(const cv::Mat& psf) {
+    cv::Mat psf32;
+    psf.convertTo(psf32, CV_32F);
+
+    if (!transfer.empty() && psfKey.size() == psf32.size() &&
+        cv::norm(psf32, psfKey, cv::NORM_INF) == 0) {
+        return transfer;
+    }
+
+    // Circularly shift the PSF so its center sits at the origin
+    const int rows = padded.rows;
+    const int cols = padded.cols;
+    const int cy = psf32.rows / 2;
+    const int cx = psf32.cols / 2;
+    psfPlane.create(padded.size(), CV_32F);
+    psfPlane.setTo(0);
+    for (int y = 0; y < psf32.rows; y++) {
+        int ty = ((y - cy) % rows + rows) % rows;
+        for (int x = 0; x < psf32.cols; x++) {
+            int tx = ((x - cx) % cols + cols) % cols;
+            psfPlane.at<float>(ty, tx) += psf32.at<float>(y, x);
+        }
+    }
+
+    cv::dft(psfPlane, transfer);
+    psf32.copyTo(psfKey);
+    return transfer;
+}
+
+void FrequencyDomain::radialMask(cv::Size imageSize, const std::function<float(double)>& response, cv::Mat& mask) {
+    const cv::Size dft = optimalSize(imageSize);
+    const int rows = dft.height;
+    const int cols = dft.width;
+    const bool evenCols = (cols % 2 == 0);
+
+    // Distances are expressed for the unpadded image
+    const double scaleX = static_cast<double>(imageSize.width) / cols;
+    const double scaleY = static_cast<double>(imageSize.height) / rows;
+
+    // 1D transfer profile over quantized radial distance; the 2D fill
+    // interpolates it linearly instead of evaluating the response per pixel
+    const float PROFILE_STEP = 0.125f;
+    const double maxDistance = std::sqrt((cols / 2 + 1) * scaleX * (cols / 2 + 1) * scaleX +
+                                         (rows / 2 + 1) * scaleY * (rows / 2 + 1) * scaleY);
+    std::vector<float> profile(static_cast<size_t>(maxDistance / PROFILE_STEP) + 2);
+    for (size_t k = 0; k < profile.size(); k++) {
+        profile[k] = response(k * PROFILE_STEP);
+    }
+
+    // CCS layout: columns 1.. hold (Re, Im) pairs of horizontal frequency
+    // (j + 1) / 2. Column 0 (and the last column for even widths) is itself
+    // packed along the rows; every other column holds all vertical
+    // frequencies, wrapping at rows / 2.
+    std::vector<float> freqX2(cols);
+    for (int j = 0; j < cols; j++) {
+        float fx = static_cast<float>(((j + 1) / 2) * scaleX / PROFILE_STEP);
+        freqX2[j] = fx * fx;
+    }
+
+    auto lookup = [&profile](float d) {
+        int k = static_cast<int>(d);
+        float t = d - k;
+        return profile[k] + t * (profile[k + 1] - profile[k]);
+    };
+    auto packedValue = [&](int i, int j) {
+        float fy = static_cast<float>(((i + 1) / 2) * scaleY / PROFILE_STEP);
+        return lookup(std::sqrt(freqX2[j] + fy * fy));
+    };
+
+    mask.create(rows, cols, CV_32F);
+
+    // Rows i and rows - i see the same vertical frequency, so only the
+    // upper half is evaluated and mirrored; the packed columns are patched
+    cv::parallel_for_(cv::Range(0, rows / 2 + 1), [&](const cv::Range& range) {
+        std::vector<float> distance(cols);
+        for (int i = range.start; i < range.end; i++) {
+            float fy = static_cast<float>(i * scaleY / PROFILE_STEP);
+            float fy2 = fy * fy;
+            for (int j = 0; j < cols; j++) {
+                distance[j] = std::sqrt(freqX2[j] + fy2);
+            }
+
+            float* row = mask.ptr<float>(i);
+            for (int j = 0; j < cols; j++) {
+                row[j] = lookup(distance[j]);
+            }
+
+            int mirror = rows - i;
+            if (mirror < rows && mirror != i) {
+                float* mirrorRow = mask.ptr<float>(mirror);
+                std::memcpy(mirrorRow, row, cols * sizeof(float));
+                mirrorRow[0] = packedValue(mirror, 0);
+                if (evenCols) mirrorRow[cols - 1] = packedValue(mirror, cols - 1);
+            }
+            row[0] = packedValue(i, 0);
+            if (evenCols) row[cols - 1] = packedValue(i, cols - 1);
+        }
+    });
+}
+
+void FrequencyDomain::shiftQuadrants(cv::Mat& m, bool inverse) {
+    // fftshift rolls by floor(n / 2), ifftshift by ceil(n / 2)
+    const int rows = m.rows;
+    const int cols = m.cols;
+    const int sy = (inverse ? rows - rows / 2 : rows / 2) % rows;
+    const int sx = (inverse ? cols - cols / 2 : cols / 2) % cols;
+    if (sy == 0 && sx == 0) {
+        return;
+    }
+
+    cv::Mat tmp = m.clone();
+    auto moveBlock = [&](int y, int x, int h, int w, int ty, int tx) {
+        if (h > 0 && w > 0) {
+            tmp(cv::Rect(x, y, w, h)).copyTo(m(cv::Rect(tx, ty, w, h)));
+        }
+    };
+    moveBlock(0, 0, rows - sy, cols - sx, sy, sx);
+    moveBlock(0, cols - sx, rows - sy, sx, sy, 0);
+    moveBlock(rows - sy, 0, sy, cols - sx, 0, sx);
+    moveBlock(rows - sy, cols - sx, sy, sx, 0, 0);
+}
@@ -0,0 +1,74 @@
+#ifndef FREQUENCYDOMAIN_H
+#define FREQUENCYDOMAIN_H
+
+#include <opencv2/opencv.hpp>
+#include <functional>
+
+// Reusable frequency-domain engine: pad -> real-to-complex DFT -> spectrum
+// products -> inverse DFT -> crop. Spectra use OpenCV's packed CCS layout
+// (real input, same size as the padded plane). The engine owns its padded
+// and spectrum buffers and only reallocates them when the image size
+// changes, so repeated calls on same-sized images do not allocate.
+//
+// An engine holds several DFT-size planes and is not thread safe. Callers
+// own their engines, one per plane processed concurrently, and the buffers
+// go away with the engine (or with release()).
+class FrequencyDomain {
+public:
+    static cv::Size optimalSize(cv::Size imageSize);
+
+    // Set the image size; a no-op when it did not change
+    void prepare(cv::Size imageSize);
+    // Free every buffer; the next prepare() allocates again
+    void release();
+    cv::Size imageSize() const { return size; }
+    cv::Size dftSize() const { return padded.size(); }
+
+    // Forward DFT of a single-channel plane of the prepared size (any depth)
+    // into the owned packed spectrum, which is returned
+    cv::Mat& forward(const cv::Mat& plane, int borderType = cv::BORDER_CONSTANT);
+    cv::Mat& spectrum() { return spectrumBuffer; }
+    // Inverse DFT of the owned spectrum, cropped to the image size (CV_32F).
+    // The result is a view of an owned buffer, valid until the next inverse;
+    // the overload copies it into dst, which is reused when already sized.
+    cv::Mat& inverse();
+    void inverse(cv::Mat& dst);
+
+    // Full complex spectrum (CV_32FC2, DFT size) for display and analysis
+    void forwardComplex(const cv::Mat& plane, cv::Mat& complex, int borderType = cv::BORDER_CONSTANT);
+
+    // In-place products on packed spectra: by a real mask laid out like the
+    // spectrum (see radialMask), or by another spectrum
+    static void multiplyMask(cv::Mat& spectrum, const cv::Mat& mask);
+    static void multiplySpectrum(cv::Mat& spectrum, const cv::Mat& other, bool conjugate = false);
+    // spectrum = spectrum * conj(H) / (|H|^2 + k)
+    void wienerDivide(cv::Mat& spectrum, const cv::Mat& transfer, double k);
+
+    // Packed transfer function of a PSF at the DFT size. The PSF center is
+    // moved to the origin, so filtering with it does not shift the image.
+    // Cached while the PSF and the size stay the same.
+    const cv::Mat& transferFunction(const cv::Mat& psf);
+
+    // Real packed mask at the DFT size of imageSize from a radially symmetric
+    // response. The distance is in frequency units of the unpadded image; the
+    // response is sampled once into a 1D profile and the mask is filled by
+    // interpolated lookup. mask is reused when it already has that size.
+    static void radialMask(cv::Size imageSize, const std::function<float(double)>& response, cv::Mat& mask);
+
+    // fftshift (DC to the center) and its inverse, correct for odd sizes
+    static void shiftQuadrants(cv::Mat& m, bool inverse = false);
+
+private:
+    cv::Size size;
+    cv::Mat padded;
+    cv::Mat spectrumBuffer;
+    cv::Mat spatial;
+    cv::Mat result;         // image-size view of spatial
+    cv::Mat power;          // allocated by the first wienerDivide
+
+    cv::Mat psfPlane;
+    cv::Mat psfKey;
+    cv::Mat transfer;
+};
+
+#endif // FREQUENCYDOMAIN_H
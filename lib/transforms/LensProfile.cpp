@@ -0,0 +1,189 @@
+#include "LensProfile.h"
+#include "LensRemapCache.h"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cmath>
+#include <filesystem>
+#include <stdexcept>
+#include <system_error>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+LensProfile LensProfile::load(const std::string& path) {
+    cv::FileStorage fsIn(path, cv::FileStorage::READ);
+    if (!fsIn.isOpened()) {
+        throw std::runtime_error("Cannot open lens profile: " + path);
+    }
+
+    LensProfile profile;
+    cv::Mat cameraMatrix, distortion;
+    fsIn["camera_name"] >> profile.name;
+    fsIn["image_width"] >> profile.calibrationSize.width;
+    fsIn["image_height"] >> profile.calibrationSize.height;
+    fsIn["camera_matrix"] >> cameraMatrix;
+    fsIn["distortion_coefficients"] >> distortion;
+
+    if (cameraMatrix.rows != 3 || cameraMatrix.cols != 3) {
+        throw std::runtime_error("Lens profile has no 3x3 camera_matrix: " + path);
+    }
+    cameraMatrix.convertTo(cameraMatrix, CV_64F);
+    profile.fx = cameraMatrix.at<double>(0, 0);
+    profile.fy = cameraMatrix.at<double>(1, 1);
+    profile.cx = cameraMatrix.at<double>(0, 2);
+    profile.cy = cameraMatrix.at<double>(1, 2);
+
+    // OpenCV order: k1 k2 p1 p2 [k3]; missing terms are zero
+    if (!distortion.empty()) {
+        distortion = distortion.reshape(1, 1);
+        distortion.convertTo(distortion, CV_64F);
+        const double* d = distortion.ptr<double>();
+        const int n = static_cast<int>(distortion.total());
+        profile.k1 = n > 0 ? d[0] : 0.0;
+        profile.k2 = n > 1 ? d[1] : 0.0;
+        profile.p1 = n > 2 ? d[2] : 0.0;
+        profile.p2 = n > 3 ? d[3] : 0.0;
+        profile.k3 = n > 4 ? d[4] : 0.0;
+    }
+
+    if (profile.name.empty()) {
+        profile.name = fs::path(path).stem().string();
+    }
+    if (!profile.isValid()) {
+        throw std::runtime_error("Lens profile is incomplete (size or focal length missing): " + path);
+    }
+    return profile;
+}
+
+void LensProfile::save(const std::string& path) const {
+    cv::FileStorage fsOut(path, cv::FileStorage::WRITE);
+    if (!fsOut.isOpened()) {
+        throw std::runtime_error("Cannot write lens profile: " + path);
+    }
+
+    cv::Mat cameraMatrix = (cv::Mat_<double>(3, 3) << fx, 0, cx, 0, fy, cy, 0, 0, 1);
+    cv::Mat distortion = (cv::Mat_<double>(1, 5) << k1, k2, p1, p2, k3);
+    fsOut << "camera_name" << name;
+    fsOut << "image_width" << calibrationSize.width;
+    fsOut << "image_height" << calibrationSize.height;
+    fsOut << "camera_matrix" << cameraMatrix;
+    fsOut << "distortion_coefficients" << distortion;
+}
+
+bool LensProfile::isValid() const {
+    return calibrationSize.width > 0 && calibrationSize.height > 0 && fx > 0 && fy > 0;
+}
+
+std::string LensProfile::tableCachePath(const std::string& tableCacheDir, cv::Size size) const {
+    // The name becomes part of a file name; the table header carries the
+    // parameters, so a profile edited under the same name is rebuilt
+    std::string fileName = name;
+    for (char& c : fileName) {
+        if (!std::isalnum(static_cast<unsigned char>(c)) && c != '-' && c != '.') c = '_';
+    }
+    fileName += "_" + std::to_string(size.width) + "x" + std::to_string(size.height) + ".nrm";
+    return (fs::path(tableCacheDir) / fileName).string();
+}
+
+void LensProfile::undistort(const cv::Mat& src, cv::Mat& dst, const std::string& tableCacheDir) const {
+    if (!isValid()) {
+        throw std::runtime_error("Invalid lens profile");
+    }
+
+    const double sx = static_cast<double>(src.cols) / calibrationSize.width;
+    const double sy = static_cast<double>(src.rows) / calibrationSize.height;
+    if (std::abs(sx - sy) > 0.01 * std::max(sx, sy)) {
+        throw std::runtime_error("Image aspect ratio does not match the lens profile '" + name + "'");
+    }
+
+    // An unusable cache directory only costs the rebuild
+    std::string tablePath;
+    if (!tableCacheDir.empty()) {
+        std::error_code error;
+        fs::create_directories(tableCacheDir, error);
+        if (!error) {
+            tablePath = tableCachePath(tableCacheDir, src.size());
+        }
+    }
+
+    // Principal point scales about the pixel-center convention
+    LensRemapCache::TablePtr table = LensRemapCache::instance().brownConradyTable(
+        src.size(), fx * sx, fy * sy,
+        (cx + 0.5) * sx - 0.5, (cy + 0.5) * sy - 0.5,
+        k1, k2, k3, p1, p2, tablePath);
+    LensRemapCache::remap(src, dst, *table);
+}
+
+int LensProfile::undistortFolder(const std::string& inputDir, const std::string& outputDir,
+                                 const std::function<bool(int done, int total)>& progress,
+                                 std::vector<std::string>* failures,
+                                 const std::string& tableCacheDir) const {
+    static const char* EXTENSIONS[] = {".png", ".jpg", ".jpeg", ".bmp", ".tif", ".tiff", ".webp"};
+
+    std::vector<fs::path> files;
+    for (const auto& entry : fs::directory_iterator(inputDir)) {
+        if (!entry.is_regular_file()) continue;
+        std::string ext = entry.path().extension().string();
+        std::transform(ext.begin(), ext.end(), ext.begin(),
+                       [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        if (std::find(std::begin(EXTENSIONS), std::end(EXTENSIONS), ext) != std::end(EXTENSIONS)) {
+            files.push_back(entry.path());
+        }
+    }
+    std::sort(files.begin(), files.end());
+    fs::create_directories(outputDir);
+
+    const int total = static_cast<int>(files.size());
+    const int batchSize = std::max(1, cv::getNumThreads());
+    std::atomic<int> written(0);
+    // One slot per image so workers never share a message
+    std::vector<std::string> errors(total);
+
+    auto processImage = [&](int i) {
+        try {
+            cv::Mat image = cv::imread(files[i].string(), cv::IMREAD_UNCHANGED);
+            if (image.empty()) {
+                errors[i] = files[i].filename().string() + ": unreadable";
+                return;
+            }
+            cv::Mat corrected;
+            undistort(image, corrected, tableCacheDir);
+            if (cv::imwrite((fs::path(outputDir) / files[i].filename()).string(), corrected)) {
+                written++;
+            } else {
+                errors[i] = files[i].filename().string() + ": could not be written";
+            }
+        } catch (const std::exception& e) {
+            errors[i] = files[i].filename().string() + ": " + e.what();
+        }
+    };
+
+    // Decode and encode dominate, so whole images run in parallel. The first
+    // image runs alone on this thread so its remap table is built (or loaded
+    // from tableCacheDir) once and shared, instead of every worker doing it.
+    for (int start = 0, end = 0; start < total; start = end) {
+        if (start == 0) {
+            end = 1;
+            processImage(0);
+        } else {
+            end = std::min(total, start + batchSize);
+            cv::parallel_for_(cv::Range(start, end), [&](const cv::Range& range) {
+                for (int i = range.start; i < range.end; i++) {
+                    processImage(i);
+                }
+            });
+        }
+
+        if (progress && !progress(end, total)) {
+            break;
+        }
+    }
+
+    if (failures) {
+        for (const std::string& error : errors) {
+            if (!error.empty()) failures->push_back(error);
+        }
+    }
+    return written;
+}
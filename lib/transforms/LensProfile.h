@@ -0,0 +1,59 @@
+#ifndef LENSPROFILE_H
+#define LENSPROFILE_H
+
+#include <opencv2/opencv.hpp>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Per-camera lens calibration using the Brown-Conrady model: radial k1..k3,
+// tangential p1/p2, focal length and principal point in pixels of the
+// calibration resolution.
+//
+// Profiles are OpenCV FileStorage files (YAML, JSON or XML) in the layout
+// written by OpenCV's calibration samples, so an existing calibration can
+// be used directly:
+//     camera_name: "..."
+//     image_width: 4000
+//     image_height: 3000
+//     camera_matrix: 3x3 [fx 0 cx; 0 fy cy; 0 0 1]
+//     distortion_coefficients: 1x5 [k1 k2 p1 p2 k3]
+struct LensProfile {
+    std::string name;
+    cv::Size calibrationSize;
+    double fx = 0.0, fy = 0.0;
+    double cx = 0.0, cy = 0.0;
+    double k1 = 0.0, k2 = 0.0, k3 = 0.0;
+    double p1 = 0.0, p2 = 0.0;
+
+    // Throw std::runtime_error on unreadable or incomplete files
+    static LensProfile load(const std::string& path);
+    void save(const std::string& path) const;
+
+    bool isValid() const;
+
+    // Undistort with the remap table of this profile at the image's
+    // resolution. The intrinsics are scaled when the image resolution
+    // differs from the calibration one (same aspect ratio required).
+    // With a tableCacheDir the table is also kept on disk there, one file
+    // per profile name and resolution (tableCachePath), so a later session
+    // loads it instead of rebuilding it.
+    void undistort(const cv::Mat& src, cv::Mat& dst, const std::string& tableCacheDir = std::string()) const;
+
+    // File of the remap table for this profile at 'size' inside tableCacheDir
+    std::string tableCachePath(const std::string& tableCacheDir, cv::Size size) const;
+
+    // Undistort every image of a folder into outputDir (same file names).
+    // Images are decoded, remapped and encoded in parallel batches; progress
+    // is called between batches on the calling thread, and returning false
+    // cancels. Returns the number of images written; images that could not
+    // be read, corrected or written are appended to failures as
+    // "file: reason" when it is given.
+    // tableCacheDir is passed on to undistort.
+    int undistortFolder(const std::string& inputDir, const std::string& outputDir,
+                        const std::function<bool(int done, int total)>& progress = nullptr,
+                        std::vector<std::string>* failures = nullptr,
+                        const std::string& tableCacheDir = std::string()) const;
+};
+
+#endif // LENSPROFILE_H
@@ -0,0 +1,268 @@
+#include "LensRemapCache.h"
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <system_error>
+#include <thread>
+
+namespace {
+
+const char REMAP_MAGIC[4] = {'N', 'R', 'M', '2'};
+
+// Rows converted per task; bounds the float scratch maps
+const int BAND_ROWS = 64;
+
+// Source coordinates of one output row for the centered two-term radial model
+void radialRow(const std::vector<double>& params, cv::Size size, int row, float* mx, float* my) {
+    const float cx = size.width / 2.0f;
+    const float cy = size.height / 2.0f;
+    const float maxRadius = std::sqrt(cx * cx + cy * cy);
+    const float k1 = static_cast<float>(params[0]);
+    const float k2 = static_cast<float>(params[1]);
+
+    const float y = (row - cy) / maxRadius;
+    for (int j = 0; j < size.width; j++) {
+        const float x = (j - cx) / maxRadius;
+        const float r2 = x * x + y * y;
+        const float r = std::sqrt(r2);
+
+        // rd = r * (1 + k1*r^2 + k2*r^4); coordinates scale by rd / r
+        const float gain = r * (1.0f + k1 * r2 + k2 * r2 * r2) / (r + 1e-6f);
+        mx[j] = x * gain * maxRadius + cx;
+        my[j] = y * gain * maxRadius + cy;
+    }
+}
+
+// Brown-Conrady: the undistorted output pixel is projected through the
+// radial (k1..k3) and tangential (p1, p2) terms into the distorted source
+void brownConradyRow(const std::vector<double>& params, cv::Size size, int row, float* mx, float* my) {
+    const double fx = params[0], fy = params[1], cx = params[2], cy = params[3];
+    const double k1 = params[4], k2 = params[5], k3 = params[6];
+    const double p1 = params[7], p2 = params[8];
+
+    const double y = (row - cy) / fy;
+    for (int j = 0; j < size.width; j++) {
+        const double x = (j - cx) / fx;
+        const double r2 = x * x + y * y;
+        const double radial = 1.0 + r2 * (k1 + r2 * (k2 + r2 * k3));
+        const double xd = x * radial + 2.0 * p1 * x * y + p2 * (r2 + 2.0 * x * x);
+        const double yd = y * radial + p1 * (r2 + 2.0 * y * y) + 2.0 * p2 * x * y;
+        mx[j] = static_cast<float>(fx * xd + cx);
+        my[j] = static_cast<float>(fy * yd + cy);
+    }
+}
+
+} // namespace
+
+LensRemapCache& LensRemapCache::instance() {
+    static LensRemapCache cache;
+    return cache;
+}
+
+LensRemapCache::TablePtr LensRemapCache::buildTable(Model model, cv::Size size, const std::vector<double>& params) {
+    auto table = std::make_shared<RemapTable>();
+    table->model = model;
+    table->size = size;
+    table->params = params;
+    table->xy.create(size, CV_16SC2);
+    table->fraction.create(size, CV_16UC1);
+
+    auto fillRow = (model == BROWN_CONRADY) ? brownConradyRow : radialRow;
+
+    // Each band computes float coordinates into scratch rows and converts
+    // them straight into its slice of the fixed-point table
+    const int bands = (size.height + BAND_ROWS - 1) / BAND_ROWS;
+    cv::parallel_for_(cv::Range(0, bands), [&](const cv::Range& range) {
+        cv::Mat mapX(BAND_ROWS, size.width, CV_32FC1);
+        cv::Mat mapY(BAND_ROWS, size.width, CV_32FC1);
+        for (int band = range.start; band < range.end; band++) {
+            const int row0 = band * BAND_ROWS;
+            const int rows = std::min(BAND_ROWS, size.height - row0);
+            for (int b = 0; b < rows; b++) {
+                fillRow(params, size, row0 + b, mapX.ptr<float>(b), mapY.ptr<float>(b));
+            }
+
+            cv::Mat xy = table->xy.rowRange(row0, row0 + rows);
+            cv::Mat fraction = table->fraction.rowRange(row0, row0 + rows);
+            cv::convertMaps(mapX.rowRange(0, rows), mapY.rowRange(0, rows), xy, fraction, CV_16SC2);
+        }
+    });
+    return table;
+}
+
+bool LensRemapCache::sameKey(const RemapTable& table, Model model, cv::Size size,
+                             const std::vector<double>& params) {
+    return table.model == model && table.size == size && table.params == params;
+}
+
+LensRemapCache::TablePtr LensRemapCache::find(Model model, cv::Size size, const std::vector<double>& params) {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto it = entries.begin(); it != entries.end(); ++it) {
+        if (sameKey(**it, model, size, params)) {
+            entries.splice(entries.begin(), entries, it);
+            return entries.front();
+        }
+    }
+    return nullptr;
+}
+
+void LensRemapCache::insert(const TablePtr& table) {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto it = entries.begin(); it != entries.end(); ++it) {
+        if (sameKey(**it, table->model, table->size, table->params)) {
+            usedBytes -= (*it)->bytes();
+            entries.erase(it);
+            break;
+        }
+    }
+    entries.push_front(table);
+    usedBytes += table->bytes();
+    evict();
+}
+
+void LensRemapCache::evict() {
+    // The newest table always stays, even when it alone exceeds the budget
+    while (usedBytes > capacityBytes && entries.size() > 1) {
+        usedBytes -= entries.back()->bytes();
+        entries.pop_back();
+    }
+}
+
+LensRemapCache::TablePtr LensRemapCache::table(Model model, cv::Size size, const std::vector<double>& params,
+                                               const std::string& path) {
+    if (TablePtr cached = find(model, size, params)) {
+        return cached;
+    }
+
+    // A stored table whose key differs (edited profile) is rebuilt and overwritten
+    if (!path.empty()) {
+        TablePtr stored = readTable(path);
+        if (stored && sameKey(*stored, model, size, params)) {
+            insert(stored);
+            return stored;
+        }
+    }
+
+    // Built outside the lock; a concurrent build of the same key just
+    // replaces the other one
+    TablePtr built = buildTable(model, size, params);
+    insert(built);
+    if (!path.empty()) {
+        save(path, *built);
+    }
+    return built;
+}
+
+LensRemapCache::TablePtr LensRemapCache::radialTable(cv::Size size, double k1, double k2) {
+    return table(RADIAL, size, {k1, k2});
+}
+
+LensRemapCache::TablePtr LensRemapCache::brownConradyTable(cv::Size size, double fx, double fy,
+                                                           double cx, double cy, double k1, double k2,
+                                                           double k3, double p1, double p2,
+                                                           const std::string& path) {
+    return table(BROWN_CONRADY, size, {fx, fy, cx, cy, k1, k2, k3, p1, p2}, path);
+}
+
+void LensRemapCache::remap(const cv::Mat& src, cv::Mat& dst, const RemapTable& table) {
+    CV_Assert(src.size() == table.size);
+    cv::remap(src, dst, table.xy, table.fraction, cv::INTER_LINEAR, cv::BORDER_CONSTANT);
+}
+
+void LensRemapCache::correct(const cv::Mat& src, cv::Mat& dst, double k1, double k2) {
+    remap(src, dst, *radialTable(src.size(), k1, k2));
+}
+
+bool LensRemapCache::save(const std::string& path, const RemapTable& table) {
+    // Written under a per-thread name and renamed, so a concurrent writer or
+    // reader of the same path never sees a partial table
+    const std::string temporary =
+        path + "." + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + ".tmp";
+    std::ofstream file(temporary, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+
+    int32_t header[4] = {static_cast<int32_t>(table.model), table.size.width, table.size.height,
+                         static_cast<int32_t>(table.params.size())};
+    file.write(REMAP_MAGIC, sizeof(REMAP_MAGIC));
+    file.write(reinterpret_cast<const char*>(header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(table.params.data()), table.params.size() * sizeof(double));
+    for (int i = 0; i < table.size.height; i++) {
+        file.write(table.xy.ptr<char>(i), table.size.width * table.xy.elemSize());
+    }
+    for (int i = 0; i < table.size.height; i++) {
+        file.write(table.fraction.ptr<char>(i), table.size.width * table.fraction.elemSize());
+    }
+    file.close();
+
+    std::error_code error;
+    if (file.fail()) {
+        std::filesystem::remove(temporary, error);
+        return false;
+    }
+    std::filesystem::rename(temporary, path, error);
+    if (error) {
+        std::filesystem::remove(temporary, error);
+        return false;
+    }
+    return true;
+}
+
+LensRemapCache::TablePtr LensRemapCache::load(const std::string& path) {
+    TablePtr table = readTable(path);
+    if (table) {
+        insert(table);
+    }
+    return table;
+}
+
+LensRemapCache::TablePtr LensRemapCache::readTable(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        return nullptr;
+    }
+
+    char magic[4];
+    int32_t header[4];
+    file.read(magic, sizeof(magic));
+    file.read(reinterpret_cast<char*>(header), sizeof(header));
+    if (!file || std::memcmp(magic, REMAP_MAGIC, sizeof(magic)) != 0 ||
+        (header[0] != RADIAL && header[0] != BROWN_CONRADY) ||
+        header[1] <= 0 || header[2] <= 0 || header[3] < 0 || header[3] > 16) {
+        return nullptr;
+    }
+
+    auto table = std::make_shared<RemapTable>();
+    table->model = static_cast<Model>(header[0]);
+    table->size = cv::Size(header[1], header[2]);
+    table->params.resize(header[3]);
+    file.read(reinterpret_cast<char*>(table->params.data()), table->params.size() * sizeof(double));
+    table->xy.create(table->size, CV_16SC2);
+    table->fraction.create(table->size, CV_16UC1);
+    file.read(table->xy.ptr<char>(), table->xy.total() * table->xy.elemSize());
+    file.read(table->fraction.ptr<char>(), table->fraction.total() * table->fraction.elemSize());
+    if (!file) {
+        return nullptr;
+    }
+    return table;
+}
+
+void LensRemapCache::setCapacity(size_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex);
+    capacityBytes = bytes;
+    evict();
+}
+
+size_t LensRemapCache::cachedBytes() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return usedBytes;
+}
+
+void LensRemapCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    entries.clear();
+    usedBytes = 0;
+}
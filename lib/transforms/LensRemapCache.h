@@ -0,0 +1,82 @@
+#ifndef LENSREMAPCACHE_H
+#define LENSREMAPCACHE_H
+
+#include <opencv2/opencv.hpp>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Remap tables for lens distortion correction. The maps are built
+// row-parallel and stored in OpenCV's fixed-point form (CV_16SC2 integer
+// coordinates + CV_16UC1 interpolation table), about a third of the two
+// CV_32FC1 maps. Tables are kept in an LRU cache keyed by (model, size,
+// parameters) with a byte budget, so repeated corrections with the same
+// parameters (slider drags, batches from one camera) only pay for cv::remap.
+//
+// The cache is shared and thread safe; returned tables are immutable.
+class LensRemapCache {
+public:
+    enum Model {
+        RADIAL,           // params: k1, k2 (centered, normalized by the half diagonal)
+        BROWN_CONRADY     // params: fx, fy, cx, cy, k1, k2, k3, p1, p2 (pixels)
+    };
+
+    struct RemapTable {
+        Model model = RADIAL;
+        cv::Size size;
+        std::vector<double> params;
+        cv::Mat xy;          // CV_16SC2
+        cv::Mat fraction;    // CV_16UC1
+        size_t bytes() const { return xy.total() * xy.elemSize() + fraction.total() * fraction.elemSize(); }
+    };
+    using TablePtr = std::shared_ptr<const RemapTable>;
+
+    static LensRemapCache& instance();
+
+    // Cached table for rd = r * (1 + k1 r^2 + k2 r^4), r normalized by the
+    // half diagonal
+    TablePtr radialTable(cv::Size size, double k1, double k2);
+
+    // Cached undistortion table for the Brown-Conrady model at this size;
+    // the output keeps the input camera matrix. With a path, a table missing
+    // from memory is loaded from that file when its key matches, and a newly
+    // built one is saved there, so later sessions skip the build.
+    TablePtr brownConradyTable(cv::Size size, double fx, double fy, double cx, double cy,
+                               double k1, double k2, double k3, double p1, double p2,
+                               const std::string& path = std::string());
+
+    // remap through a table, and through the cached radial table
+    static void remap(const cv::Mat& src, cv::Mat& dst, const RemapTable& table);
+    void correct(const cv::Mat& src, cv::Mat& dst, double k1, double k2);
+
+    // Persist a table (per camera profile) and load it back into the cache.
+    // load returns nullptr if the file is missing or not a remap table.
+    static bool save(const std::string& path, const RemapTable& table);
+    TablePtr load(const std::string& path);
+
+    void setCapacity(size_t bytes);
+    size_t capacity() const { return capacityBytes; }
+    size_t cachedBytes() const;
+    void clear();
+
+private:
+    LensRemapCache() = default;
+
+    TablePtr table(Model model, cv::Size size, const std::vector<double>& params,
+                   const std::string& path = std::string());
+    static TablePtr readTable(const std::string& path);
+    static TablePtr buildTable(Model model, cv::Size size, const std::vector<double>& params);
+    static bool sameKey(const RemapTable& table, Model model, cv::Size size, const std::vector<double>& params);
+    TablePtr find(Model model, cv::Size size, const std::vector<double>& params);
+    void insert(const TablePtr& table);
+    void evict();
+
+    mutable std::mutex mutex;
+    std::list<TablePtr> entries;     // most recently used first
+    size_t capacityBytes = 256u << 20;
+    size_t usedBytes = 0;
+};
+
+#endif // LENSREMAPCACHE_H
@@ -0,0 +1,351 @@
+#include "SuperResolution.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <numeric>
+#include <vector>
+
+namespace {
+
+// Output rows per parallel task of the separable resampler
+const int BAND_ROWS = 32;
+
+// Fixed-length tap lists along one axis: output sample d reads
+// index[d * taps + t] with weight[d * taps + t]; indices are already clamped
+struct AxisTaps {
+    int taps = 0;
+    std::vector<int> index;
+    std::vector<float> weight;
+};
+
+// Gaussian PSF centered on each destination sample (pixel-center aligned)
+AxisTaps gaussianTaps(int srcLength, int dstLength, double sigma) {
+    const double ratio = static_cast<double>(srcLength) / dstLength;
+    const int radius = std::max(1, static_cast<int>(std::ceil(3.0 * sigma)));
+    AxisTaps axis;
+    axis.taps = 2 * radius + 2;
+    axis.index.resize(static_cast<size_t>(dstLength) * axis.taps);
+    axis.weight.resize(axis.index.size());
+
+    for (int d = 0; d < dstLength; d++) {
+        const double center = (d + 0.5) * ratio - 0.5;
+        const int first = static_cast<int>(std::floor(center)) - radius;
+        double total = 0.0;
+        for (int t = 0; t < axis.taps; t++) {
+            const int p = first + t;
+            const double w = std::exp(-(p - center) * (p - center) / (2.0 * sigma * sigma));
+            axis.index[d * axis.taps + t] = std::min(std::max(p, 0), srcLength - 1);
+            axis.weight[d * axis.taps + t] = static_cast<float>(w);
+            total += w;
+        }
+        for (int t = 0; t < axis.taps; t++) {
+            axis.weight[d * axis.taps + t] = static_cast<float>(axis.weight[d * axis.taps + t] / total);
+        }
+    }
+    return axis;
+}
+
+// Linear interpolation (pixel-center aligned)
+AxisTaps linearTaps(int srcLength, int dstLength) {
+    const double ratio = static_cast<double>(srcLength) / dstLength;
+    AxisTaps axis;
+    axis.taps = 2;
+    axis.index.resize(static_cast<size_t>(dstLength) * 2);
+    axis.weight.resize(axis.index.size());
+
+    for (int d = 0; d < dstLength; d++) {
+        const double u = (d + 0.5) * ratio - 0.5;
+        const int i0 = static_cast<int>(std::floor(u));
+        const float f = static_cast<float>(u - i0);
+        axis.index[2 * d] = std::min(std::max(i0, 0), srcLength - 1);
+        axis.index[2 * d + 1] = std::min(std::max(i0 + 1, 0), srcLength - 1);
+        axis.weight[2 * d] = 1.0f - f;
+        axis.weight[2 * d + 1] = f;
+    }
+    return axis;
+}
+
+// Separable resampling of a CV_32FC(n) image in bands of output rows. Each
+// band filters the source rows it needs horizontally into a local buffer,
+// then combines them vertically; rowFn(dstRow, values) consumes every
+// finished output row, so callers can fuse their per-pixel work into it.
+template <typename RowFn>
+void resampleBands(const cv::Mat& src, int dstRows, int dstCols,
+                   const AxisTaps& rows, const AxisTaps& cols, RowFn rowFn) {
+    const int cn = src.channels();
+    const int rowLength = dstCols * cn;
+    const int bands = (dstRows + BAND_ROWS - 1) / BAND_ROWS;
+
+    cv::parallel_for_(cv::Range(0, bands), [&](const cv::Range& range) {
+        std::vector<float> buffer;
+        std::vector<float> out(rowLength);
+        for (int band = range.start; band < range.end; band++) {
+            const int r0 = band * BAND_ROWS;
+            const int r1 = std::min(dstRows, r0 + BAND_ROWS);
+            const auto first = rows.index.begin() + static_cast<size_t>(r0) * rows.taps;
+            const auto last = rows.index.begin() + static_cast<size_t>(r1) * rows.taps;
+            const int srcFirst = *std::min_element(first, last);
+            const int srcLast = *std::max_element(first, last);
+            buffer.resize(static_cast<size_t>(srcLast - srcFirst + 1) * rowLength);
+
+            // Horizontal pass over the source rows of this band
+            for (int r = srcFirst; r <= srcLast; r++) {
+                const float* s = src.ptr<float>(r);
+                float* h = &buffer[static_cast<size_t>(r - srcFirst) * rowLength];
+                for (int x = 0; x < dstCols; x++) {
+                    const int* idx = &cols.index[static_cast<size_t>(x) * cols.taps];
+                    const float* w = &cols.weight[static_cast<size_t>(x) * cols.taps];
+                    for (int k = 0; k < cn; k++) {
+                        float acc = 0.0f;
+                        for (int t = 0; t < cols.taps; t++) {
+                            acc += w[t] * s[idx[t] * cn + k];
+                        }
+                        h[x * cn + k] = acc;
+                    }
+                }
+            }
+
+            // Vertical pass
+            for (int y = r0; y < r1; y++) {
+                const int* idx = &rows.index[static_cast<size_t>(y) * rows.taps];
+                const float* w = &rows.weight[static_cast<size_t>(y) * rows.taps];
+                std::fill(out.begin(), out.end(), 0.0f);
+                for (int t = 0; t < rows.taps; t++) {
+                    const float* h = &buffer[static_cast<size_t>(idx[t] - srcFirst) * rowLength];
+                    const float wt = w[t];
+                    for (int x = 0; x < rowLength; x++) {
+                        out[x] += wt * h[x];
+                    }
+                }
+                rowFn(y, out.data());
+            }
+        }
+    });
+}
+
+// Step back by 2 until the index is inside [0, n); keeps the parity, so
+// clamped reads stay on the already known lattice
+inline int clampParity(int i, int n) {
+    while (i < 0) i += 2;
+    while (i >= n) i -= 2;
+    return i;
+}
+
+inline float cubicMidpoint(float a, float b, float c, float d) {
+    return (-a + 9.0f * b + 9.0f * c - d) * (1.0f / 16.0f);
+}
+
+// One directional cubic 2x step on a CV_32FC(n) image
+void edgeDirected2x(const cv::Mat& src, cv::Mat& dst) {
+    const int cn = src.channels();
+    const int H = src.rows * 2;
+    const int W = src.cols * 2;
+    dst.create(H, W, src.type());
+
+    cv::parallel_for_(cv::Range(0, src.rows), [&](const cv::Range& range) {
+        for (int i = range.start; i < range.end; i++) {
+            const float* s = src.ptr<float>(i);
+            float* d = dst.ptr<float>(2 * i);
+            for (int j = 0; j < src.cols; j++) {
+                std::copy(s + j * cn, s + (j + 1) * cn, d + 2 * j * cn);
+            }
+        }
+    });
+
+    auto at = [&](int y, int x) {
+        return dst.ptr<float>(clampParity(y, H)) + clampParity(x, W) * cn;
+    };
+    auto luma = [&](int y, int x) {
+        const float* p = at(y, x);
+        float sum = 0.0f;
+        for (int k = 0; k < cn; k++) sum += p[k];
+        return sum / cn;
+    };
+
+    // Interpolate along A or B, whichever varies less; blend when neither
+    // direction clearly dominates
+    const float EDGE_RATIO = 1.15f;
+    auto blend = [&](float* out, float varA, float varB,
+                     const float* a0, const float* a1, const float* a2, const float* a3,
+                     const float* b0, const float* b1, const float* b2, const float* b3) {
+        float wA, wB;
+        if (1.0f + varA > EDGE_RATIO * (1.0f + varB)) {
+            wA = 0.0f;
+            wB = 1.0f;
+        } else if (1.0f + varB > EDGE_RATIO * (1.0f + varA)) {
+            wA = 1.0f;
+            wB = 0.0f;
+        } else {
+            wA = 1.0f / (1.0f + std::pow(varA, 5.0f));
+            wB = 1.0f / (1.0f + std::pow(varB, 5.0f));
+            float total = wA + wB;
+            wA /= total;
+            wB /= total;
+        }
+        for (int k = 0; k < cn; k++) {
+            out[k] = wA * cubicMidpoint(a0[k], a1[k], a2[k], a3[k]) +
+                     wB * cubicMidpoint(b0[k], b1[k], b2[k], b3[k]);
+        }
+    };
+
+    // Pass 1: centers of source squares (odd, odd) along the diagonals
+    cv::parallel_for_(cv::Range(0, H / 2), [&](const cv::Range& range) {
+        for (int r = range.start; r < range.end; r++) {
+            const int y = 2 * r + 1;
+            float* row = dst.ptr<float>(y);
+            for (int x = 1; x < W; x += 2) {
+                float varMain = 0.0f, varAnti = 0.0f;
+                for (int a = -1; a <= 1; a++) {
+                    for (int b = -1; b <= 1; b++) {
+                        varMain += std::abs(luma(y - 1 + 2 * a, x - 1 + 2 * b) - luma(y + 1 + 2 * a, x + 1 + 2 * b));
+                        varAnti += std::abs(luma(y - 1 + 2 * a, x + 1 + 2 * b) - luma(y + 1 + 2 * a, x - 1 + 2 * b));
+                    }
+                }
+                blend(row + x * cn, varMain, varAnti,
+                      at(y - 3, x - 3), at(y - 1, x - 1), at(y + 1, x + 1), at(y + 3, x + 3),
+                      at(y - 3, x + 3), at(y - 1, x + 1), at(y + 1, x - 1), at(y + 3, x - 3));
+            }
+        }
+    });
+
+    // Pass 2: the remaining pixels, whose horizontal and vertical
+    // neighbours are now all known
+    cv::parallel_for_(cv::Range(0, H), [&](const cv::Range& range) {
+        for (int y = range.start; y < range.end; y++) {
+            float* row = dst.ptr<float>(y);
+            for (int x = (y % 2 == 0) ? 1 : 0; x < W; x += 2) {
+                float varH = std::abs(luma(y, x - 3) - luma(y, x - 1)) +
+                             std::abs(luma(y, x - 1) - luma(y, x + 1)) +
+                             std::abs(luma(y, x + 1) - luma(y, x + 3));
+                float varV = std::abs(luma(y - 3, x) - luma(y - 1, x)) +
+                             std::abs(luma(y - 1, x) - luma(y + 1, x)) +
+                             std::abs(luma(y + 1, x) - luma(y + 3, x));
+                for (int side = -1; side <= 1; side += 2) {
+                    varH += std::abs(luma(y + side, x - 2) - luma(y + side, x)) +
+                            std::abs(luma(y + side, x) - luma(y + side, x + 2));
+                    varV += std::abs(luma(y - 2, x + side) - luma(y, x + side)) +
+                            std::abs(luma(y, x + side) - luma(y + 2, x + side));
+                }
+                blend(row + x * cn, varH, varV,
+                      at(y, x - 3), at(y, x - 1), at(y, x + 1), at(y, x + 3),
+                      at(y - 3, x), at(y - 1, x), at(y + 1, x), at(y + 3, x));
+            }
+        }
+    });
+}
+
+// Edge-directed estimate on float data
+void edgeDirectedFloat(const cv::Mat& src32, cv::Mat& dst32, cv::Size size) {
+    cv::Mat current = src32;
+    while (current.cols < size.width || current.rows < size.height) {
+        cv::Mat doubled;
+        edgeDirected2x(current, doubled);
+        current = doubled;
+    }
+    if (current.size() == size) {
+        dst32 = current;
+    } else {
+        cv::resize(current, dst32, size, 0, 0, cv::INTER_AREA);
+    }
+}
+
+double elapsedMs(std::chrono::high_resolution_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+} // namespace
+
+namespace SuperResolution {
+
+void edgeDirectedUpscale(const cv::Mat& src, cv::Mat& dst, cv::Size size) {
+    cv::Mat src32, dst32;
+    src.convertTo(src32, CV_32F);
+    edgeDirectedFloat(src32, dst32, size);
+    dst32.convertTo(dst, src.depth());
+}
+
+void backProjectionUpscale(const cv::Mat& src, cv::Mat& dst, cv::Size size,
+                           const Options& options, Report* report) {
+    auto totalStart = std::chrono::high_resolution_clock::now();
+    Report result;
+
+    cv::Mat observed, estimate;
+    src.convertTo(observed, CV_32F);
+    edgeDirectedFloat(observed, estimate, size);
+    if (estimate.data == observed.data) {
+        estimate = estimate.clone();
+    }
+    result.initialMs = elapsedMs(totalStart);
+
+    // D(B(.)) to the observed grid and U(.) back to the estimate grid
+    const int lowRows = observed.rows, lowCols = observed.cols;
+    const AxisTaps downRows = gaussianTaps(size.height, lowRows, options.blurSigma * size.height / lowRows);
+    const AxisTaps downCols = gaussianTaps(size.width, lowCols, options.blurSigma * size.width / lowCols);
+    const AxisTaps upRows = linearTaps(lowRows, size.height);
+    const AxisTaps upCols = linearTaps(lowCols, size.width);
+
+    const int cn = observed.channels();
+    const float step = static_cast<float>(options.stepSize);
+    cv::Mat residual(observed.size(), observed.type());
+    cv::Mat previousEstimate;
+    std::vector<double> rowError(lowRows);
+
+    auto iterationStart = std::chrono::high_resolution_clock::now();
+    double previous = 0.0;
+    for (int it = 0; ; it++) {
+        // residual = observed - D(B(estimate)), squared error per row
+        resampleBands(estimate, lowRows, lowCols, downRows, downCols, [&](int y, const float* simulated) {
+            const float* obs = observed.ptr<float>(y);
+            float* res = residual.ptr<float>(y);
+            double sum = 0.0;
+            for (int x = 0; x < lowCols * cn; x++) {
+                res[x] = obs[x] - simulated[x];
+                sum += double(res[x]) * res[x];
+            }
+            rowError[y] = sum;
+        });
+        double rms = std::sqrt(std::accumulate(rowError.begin(), rowError.end(), 0.0) /
+                               (static_cast<double>(lowRows) * lowCols * cn));
+        if (it == 0) result.initialResidual = rms;
+
+        // An update that made the residual worse is undone
+        if (it > 0 && rms > previous) {
+            std::swap(estimate, previousEstimate);
+            result.iterations = it - 1;
+            result.stalled = true;
+            break;
+        }
+        result.finalResidual = rms;
+
+        // Below tolerance, or no longer improving by at least 1%
+        if (rms < options.tolerance) {
+            result.converged = true;
+            break;
+        }
+        if (it > 0 && rms > 0.99 * previous) {
+            result.stalled = true;
+            break;
+        }
+        if (it >= options.iterations) {
+            break;
+        }
+        previous = rms;
+        estimate.copyTo(previousEstimate);
+
+        // estimate += step * U(residual), kept in the 8-bit range
+        resampleBands(residual, size.height, size.width, upRows, upCols, [&](int y, const float* correction) {
+            float* e = estimate.ptr<float>(y);
+            for (int x = 0; x < size.width * cn; x++) {
+                e[x] = std::min(255.0f, std::max(0.0f, e[x] + step * correction[x]));
+            }
+        });
+        result.iterations = it + 1;
+    }
+    result.iterationMs = elapsedMs(iterationStart);
+
+    estimate.convertTo(dst, src.depth());
+    result.totalMs = elapsedMs(totalStart);
+    if (report) *report = result;
+}
+
+} // namespace SuperResolution
@@ -12,7 +12,7 @@ BrushTool::BrushTool(QObject* parent)
 void BrushTool::startStroke(const QPoint& pos, const cv::Size& imageSize) {
     // Initialize mask if needed
     if (mask.empty() || mask.size() != imageSize) {
-        mask = cv::Mat::zeros(imageSize, CV_8UC1);
+        mask = PackedMask(imageSize);
     }
     
     // Validate coordinates are within bounds
@@ -24,8 +24,7 @@ void BrushTool::startStroke(const QPoint& pos, const cv::Size& imageSize) {
     lastPoint = pos;
     
     // Draw initial point
-    cv::circle(mask, cv::Point(pos.x(), pos.y()), brushSize, 
-               eraseMode ? cv::Scalar(0) : cv::Scalar(255), -1);
+    drawBrushStroke(pos, pos);
     
     emit maskUpdated();
 }
@@ -34,7 +33,7 @@ void BrushTool::continueStroke(const QPoint& pos) {
     if (!isDrawing || mask.empty()) return;
     
     // Validate coordinates
-    if (pos.x() < 0 || pos.y() < 0 || pos.x() >= mask.cols || pos.y() >= mask.rows) {
+    if (pos.x() < 0 || pos.y() < 0 || pos.x() >= mask.size().width || pos.y() >= mask.size().height) {
         return;
     }
     
@@ -52,27 +51,38 @@ void BrushTool::endStroke() {
 void BrushTool::drawBrushStroke(const QPoint& from, const QPoint& to) {
     if (mask.empty()) return;
     
-    // Clamp points to image bounds
-    int x1 = std::max(0, std::min(from.x(), mask.cols - 1));
-    int y1 = std::max(0, std::min(from.y(), mask.rows - 1));
-    int x2 = std::max(0, std::min(to.x(), mask.cols - 1));
-    int y2 = std::max(0, std::min(to.y(), mask.rows - 1));
+    const cv::Size size = mask.size();
     
-    cv::Point p1(x1, y1);
-    cv::Point p2(x2, y2);
+    // Clamp points to image bounds
+    int x1 = std::max(0, std::min(from.x(), size.width - 1));
+    int y1 = std::max(0, std::min(from.y(), size.height - 1));
+    int x2 = std::max(0, std::min(to.x(), size.width - 1));
+    int y2 = std::max(0, std::min(to.y(), size.height - 1));
+    
+    // Rasterize the stroke into a patch covering only its bounding box,
+    // then set or clear those bits of the mask
+    int pad = brushSize + 2;
+    cv::Rect bounds = cv::Rect(cv::Point(std::min(x1, x2) - pad, std::min(y1, y2) - pad),
+                               cv::Point(std::max(x1, x2) + pad + 1, std::max(y1, y2) + pad + 1)) &
+                      cv::Rect(0, 0, size.width, size.height);
+    cv::Mat patch = cv::Mat::zeros(bounds.size(), CV_8UC1);
+    
+    cv::Point p1 = cv::Point(x1, y1) - bounds.tl();
+    cv::Point p2 = cv::Point(x2, y2) - bounds.tl();
     
     // Draw thick line with rounded ends
-    cv::line(mask, p1, p2, eraseMode ? cv::Scalar(0) : cv::Scalar(255), 
-             brushSize * 2, cv::LINE_AA);
+    cv::line(patch, p1, p2, cv::Scalar(255), brushSize * 2, cv::LINE_AA);
     
     // Draw circles at endpoints for smooth stroke
-    cv::circle(mask, p1, brushSize, eraseMode ? cv::Scalar(0) : cv::Scalar(255), -1);
-    cv::circle(mask, p2, brushSize, eraseMode ? cv::Scalar(0) : cv::Scalar(255), -1);
+    cv::circle(patch, p1, brushSize, cv::Scalar(255), -1);
+    cv::circle(patch, p2, brushSize, cv::Scalar(255), -1);
+    
+    mask.paint(patch, bounds.tl(), !eraseMode);
 }
 
 void BrushTool::clearMask() {
     if (!mask.empty()) {
-        mask = cv::Mat::zeros(mask.size(), CV_8UC1);
+        mask = PackedMask(mask.size());
         emit maskUpdated();
     }
 }
@@ -89,16 +99,8 @@ cv::Mat BrushTool::applyMaskToResult(const cv::Mat& original, const cv::Mat& pro
     
     cv::Mat result = original.clone();
     
-    // Convert mask to 3-channel if needed
-    cv::Mat mask3ch;
-    if (original.channels() == 3) {
-        cv::cvtColor(mask, mask3ch, cv::COLOR_GRAY2BGR);
-    } else {
-        mask3ch = mask;
-    }
-    
     // Copy processed pixels only where mask is white (255)
-    processed.copyTo(result, mask);
+    processed.copyTo(result, mask.toMat());
     
     return result;
 }
@@ -109,9 +111,9 @@ cv::Mat BrushTool::getMaskOverlay(const cv::Mat& image, const cv::Scalar& color)
     }
     
     // Resize mask if sizes don't match
-    cv::Mat resizedMask = mask;
-    if (mask.size() != image.size()) {
-        cv::resize(mask, resizedMask, image.size(), 0, 0, cv::INTER_NEAREST);
+    cv::Mat resizedMask = mask.toMat();
+    if (resizedMask.size() != image.size()) {
+        cv::resize(resizedMask, resizedMask, image.size(), 0, 0, cv::INTER_NEAREST);
     }
     
     cv::Mat overlay = image.clone();
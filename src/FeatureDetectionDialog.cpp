@@ -4,11 +4,12 @@
 #include <QHBoxLayout>
 #include <QGroupBox>
 #include <QMessageBox>
+#include <QFileDialog>
 #include <QStackedWidget>
 #include <opencv2/features2d.hpp>
 
 FeatureDetectionDialog::FeatureDetectionDialog(const cv::Mat& image, QWidget *parent)
-    : QDialog(parent), inputImage(image.clone()), applied(false), featureCount(0) {
+    : QDialog(parent), inputImage(image.clone()), applied(false), featureCount(0), lastCollectMs(0.0) {
     
     setWindowTitle("Feature Detection - Phase 19");
     setMinimumSize(1000, 700);
@@ -120,9 +121,22 @@ void FeatureDetectionDialog::setupUI() {
     harrisThreshLayout->addWidget(harrisThresholdLabel);
     harrisLayout->addLayout(harrisThreshLayout);
     
+    QHBoxLayout* harrisNmsLayout = new QHBoxLayout();
+    QLabel* harrisNmsLabel = new QLabel("NMS Radius:");
+    harrisNmsLabel->setStyleSheet("color: #c4b5fd;");
+    harrisNmsRadiusSpin = new QSpinBox();
+    harrisNmsRadiusSpin->setRange(1, 50);
+    harrisNmsRadiusSpin->setValue(5);
+    connect(harrisNmsRadiusSpin, QOverload<int>::of(&QSpinBox::valueChanged),
+            this, &FeatureDetectionDialog::onParameterChanged);
+    harrisNmsLayout->addWidget(harrisNmsLabel);
+    harrisNmsLayout->addWidget(harrisNmsRadiusSpin);
+    harrisNmsLayout->addStretch();
+    harrisLayout->addLayout(harrisNmsLayout);
+    
     QLabel* harrisInfo = new QLabel(
         "Harris detector finds corners based on intensity gradient.\n"
-        "Lower threshold = more corners detected."
+        "Lower threshold = more corners; a stronger corner within the NMS radius suppresses weaker ones."
     );
     harrisInfo->setStyleSheet("color: #a78bfa; font-size: 9pt; padding: 10px;");
     harrisLayout->addWidget(harrisInfo);
@@ -326,6 +340,35 @@ void FeatureDetectionDialog::setupUI() {
     stackedParams->addWidget(orbParams);
     
     paramsLayout->addWidget(stackedParams);
+    
+    // Keypoint distribution, shared by all methods
+    QHBoxLayout* gridLayout = new QHBoxLayout();
+    QLabel* gridCellLabel = new QLabel("Grid Cell:");
+    gridCellLabel->setStyleSheet("color: #c4b5fd;");
+    gridCellSpin = new QSpinBox();
+    gridCellSpin->setRange(0, 1024);
+    gridCellSpin->setValue(64);
+    gridCellSpin->setSingleStep(16);
+    gridCellSpin->setSuffix(" px");
+    gridCellSpin->setSpecialValueText("Off");
+    gridCellSpin->setToolTip("Keypoints are ranked within grid cells; feature limits take every cell's best first");
+    connect(gridCellSpin, QOverload<int>::of(&QSpinBox::valueChanged),
+            this, &FeatureDetectionDialog::onParameterChanged);
+    QLabel* maxPerCellLabel = new QLabel("Max per Cell:");
+    maxPerCellLabel->setStyleSheet("color: #c4b5fd;");
+    maxPerCellSpin = new QSpinBox();
+    maxPerCellSpin->setRange(0, 1000);
+    maxPerCellSpin->setValue(0);
+    maxPerCellSpin->setSpecialValueText("Unlimited");
+    connect(maxPerCellSpin, QOverload<int>::of(&QSpinBox::valueChanged),
+            this, &FeatureDetectionDialog::onParameterChanged);
+    gridLayout->addWidget(gridCellLabel);
+    gridLayout->addWidget(gridCellSpin);
+    gridLayout->addSpacing(20);
+    gridLayout->addWidget(maxPerCellLabel);
+    gridLayout->addWidget(maxPerCellSpin);
+    gridLayout->addStretch();
+    paramsLayout->addLayout(gridLayout);
     mainLayout->addWidget(paramsGroup);
     
     // Store reference for method switching
@@ -357,6 +400,12 @@ void FeatureDetectionDialog::setupUI() {
     QHBoxLayout* buttonLayout = new QHBoxLayout();
     buttonLayout->addStretch();
     
+    exportButton = new QPushButton("Export Keypoints...");
+    exportButton->setMinimumWidth(140);
+    exportButton->setEnabled(false);
+    connect(exportButton, &QPushButton::clicked, this, [this]() { exportKeypoints(); });
+    buttonLayout->addWidget(exportButton);
+    
     resetButton = new QPushButton("Reset");
     resetButton->setMinimumWidth(100);
     connect(resetButton, &QPushButton::clicked, this, &FeatureDetectionDialog::onResetClicked);
@@ -402,161 +451,166 @@ void FeatureDetectionDialog::updatePreview() {
             featureCountLabel->setText(QString("Features Detected: %1").arg(featureCount));
         }
     } catch (const cv::Exception& e) {
+        lastResult = FeatureDetector::Result();
+        exportButton->setEnabled(false);
+        infoLabel->setText(QString("Error: %1").arg(e.what()));
+        infoLabel->setStyleSheet("color: #ff6b6b; padding: 5px;");
+    } catch (const std::exception& e) {
+        lastResult = FeatureDetector::Result();
+        exportButton->setEnabled(false);
         infoLabel->setText(QString("Error: %1").arg(e.what()));
         infoLabel->setStyleSheet("color: #ff6b6b; padding: 5px;");
     }
 }
 
-void FeatureDetectionDialog::detectHarrisCorners() {
-    cv::Mat gray, harris, harrisNorm, harrisScaled;
-    
-    // Convert to grayscale
-    if (inputImage.channels() == 3) {
-        cv::cvtColor(inputImage, gray, cv::COLOR_BGR2GRAY);
-    } else {
-        gray = inputImage.clone();
+FeatureDetector::Options FeatureDetectionDialog::gridOptions(FeatureDetector::Method method) const {
+    FeatureDetector::Options options;
+    options.method = method;
+    options.cellSize = gridCellSpin->value();
+    options.maxPerCell = maxPerCellSpin->value();
+    return options;
+}
+
+void FeatureDetectionDialog::runDetection(const FeatureDetector::Options& options) {
+    // Responses are recomputed only when a parameter that shapes them
+    // changed; thresholds become a cut through the presorted candidates
+    FeatureDetector::CandidateSet& cache = candidateCache[static_cast<int>(options.method)];
+    lastCollectMs = 0.0;
+    if (!FeatureDetector::canSelect(cache, options)) {
+        cache = FeatureDetector::collect(inputImage, options);
+        lastCollectMs = cache.collectMs;
     }
-    
-    // Harris corner detection
-    int blockSize = harrisBlockSizeSpin->value();
-    int apertureSize = harrisApertureSpin->value();
+    lastResult = FeatureDetector::select(cache, options);
+}
+
+void FeatureDetectionDialog::showDetection(const QString& summary) {
+    QString timing = lastCollectMs > 0.0
+        ? QString(" - responses %1 ms + select %2 ms over %3 tiles")
+              .arg(lastCollectMs, 0, 'f', 1).arg(lastResult.detectMs, 0, 'f', 1).arg(lastResult.tiles)
+        : QString(" - select %1 ms from cached responses").arg(lastResult.detectMs, 0, 'f', 1);
+    if (!lastResult.descriptors.empty()) {
+        timing += QString(", descriptors %1 ms").arg(lastResult.describeMs, 0, 'f', 1);
+    }
+    infoLabel->setText(summary + timing);
+    infoLabel->setStyleSheet("color: #a78bfa; padding: 5px;");
+    exportButton->setEnabled(!lastResult.keypoints.empty());
+}
+
+void FeatureDetectionDialog::detectHarrisCorners() {
+    // Harris parameters
     double k = harrisKSlider->value() / 100.0;
+    FeatureDetector::Options options = gridOptions(FeatureDetector::Method::Harris);
+    options.blockSize = harrisBlockSizeSpin->value();
+    options.apertureSize = harrisApertureSpin->value();
+    options.harrisK = k;
+    options.threshold = harrisThresholdSlider->value();
+    options.nmsRadius = harrisNmsRadiusSpin->value();
     
-    cv::cornerHarris(gray, harris, blockSize, apertureSize, k);
-    
-    // Normalize and convert
-    cv::normalize(harris, harrisNorm, 0, 255, cv::NORM_MINMAX);
-    cv::convertScaleAbs(harrisNorm, harrisScaled);
-    
-    // Threshold to get corners
-    int threshold = harrisThresholdSlider->value();
+    // Local maxima of the response above the normalized threshold
+    runDetection(options);
     
     // Draw corners on image
     previewImage = inputImage.clone();
-    featureCount = 0;
-    
-    for (int i = 0; i < harrisNorm.rows; i++) {
-        for (int j = 0; j < harrisNorm.cols; j++) {
-            if (harrisNorm.at<float>(i, j) > threshold) {
-                cv::circle(previewImage, cv::Point(j, i), 5, cv::Scalar(0, 255, 0), 2);
-                featureCount++;
-            }
-        }
+    for (const cv::KeyPoint& kp : lastResult.keypoints) {
+        cv::circle(previewImage, kp.pt, 5, cv::Scalar(0, 255, 0), 2);
     }
     
-    detectionType = QString("Harris Corners (k=%.2f)").arg(k);
-    infoLabel->setText(QString("Harris corner detection: %1 corners found").arg(featureCount));
-    infoLabel->setStyleSheet("color: #a78bfa; padding: 5px;");
+    featureCount = static_cast<int>(lastResult.keypoints.size());
+    detectionType = QString("Harris Corners (k=%1)").arg(k, 0, 'f', 2);
+    showDetection(QString("Harris corner detection: %1 corners found").arg(featureCount));
 }
 
 void FeatureDetectionDialog::detectShiTomasiCorners() {
-    cv::Mat gray;
-    
-    // Convert to grayscale
-    if (inputImage.channels() == 3) {
-        cv::cvtColor(inputImage, gray, cv::COLOR_BGR2GRAY);
-    } else {
-        gray = inputImage.clone();
-    }
-    
-    // Shi-Tomasi parameters
-    int maxCorners = shiTomasiMaxCornersSpin->value();
+    // Shi-Tomasi parameters; min distance is the suppression radius
     double qualityLevel = shiTomasiQualitySlider->value() / 100.0;
-    double minDistance = shiTomasiMinDistanceSpin->value();
-    int blockSize = shiTomasiBlockSizeSpin->value();
+    FeatureDetector::Options options = gridOptions(FeatureDetector::Method::ShiTomasi);
+    options.maxFeatures = shiTomasiMaxCornersSpin->value();
+    options.threshold = qualityLevel;
+    options.nmsRadius = shiTomasiMinDistanceSpin->value();
+    options.blockSize = shiTomasiBlockSizeSpin->value();
+    options.apertureSize = 3;
     
-    // Detect corners
-    std::vector<cv::Point2f> corners;
-    cv::goodFeaturesToTrack(gray, corners, maxCorners, qualityLevel, minDistance, 
-                           cv::Mat(), blockSize, false, 0.04);
+    runDetection(options);
     
     // Draw corners
     previewImage = inputImage.clone();
-    featureCount = static_cast<int>(corners.size());
-    
-    for (const auto& corner : corners) {
-        cv::circle(previewImage, corner, 5, cv::Scalar(0, 255, 0), 2);
+    for (const cv::KeyPoint& kp : lastResult.keypoints) {
+        cv::circle(previewImage, kp.pt, 5, cv::Scalar(0, 255, 0), 2);
     }
     
-    detectionType = QString("Shi-Tomasi Corners (quality=%.2f)").arg(qualityLevel);
-    infoLabel->setText(QString("Shi-Tomasi detection: %1 good features found").arg(featureCount));
-    infoLabel->setStyleSheet("color: #a78bfa; padding: 5px;");
+    featureCount = static_cast<int>(lastResult.keypoints.size());
+    detectionType = QString("Shi-Tomasi Corners (quality=%1)").arg(qualityLevel, 0, 'f', 2);
+    showDetection(QString("Shi-Tomasi detection: %1 good features found").arg(featureCount));
 }
 
 void FeatureDetectionDialog::detectFASTCorners() {
-    cv::Mat gray;
-    
-    // Convert to grayscale
-    if (inputImage.channels() == 3) {
-        cv::cvtColor(inputImage, gray, cv::COLOR_BGR2GRAY);
-    } else {
-        gray = inputImage.clone();
-    }
-    
     // FAST parameters
     int threshold = fastThresholdSpin->value();
-    bool nonMaxSuppression = fastNonMaxSuppressionCheck->isChecked();
-    
-    cv::FastFeatureDetector::DetectorType fastType = cv::FastFeatureDetector::TYPE_9_16;
+    FeatureDetector::Options options = gridOptions(FeatureDetector::Method::FAST);
+    options.fastThreshold = threshold;
+    options.fastNonMaxSuppression = fastNonMaxSuppressionCheck->isChecked();
     switch (fastTypeCombo->currentIndex()) {
-        case 0: fastType = cv::FastFeatureDetector::TYPE_9_16; break;
-        case 1: fastType = cv::FastFeatureDetector::TYPE_7_12; break;
-        case 2: fastType = cv::FastFeatureDetector::TYPE_5_8; break;
+        case 0: options.fastType = cv::FastFeatureDetector::TYPE_9_16; break;
+        case 1: options.fastType = cv::FastFeatureDetector::TYPE_7_12; break;
+        case 2: options.fastType = cv::FastFeatureDetector::TYPE_5_8; break;
     }
     
-    // Detect FAST corners
-    std::vector<cv::KeyPoint> keypoints;
-    cv::Ptr<cv::FastFeatureDetector> detector = cv::FastFeatureDetector::create(
-        threshold, nonMaxSuppression, fastType
-    );
-    detector->detect(gray, keypoints);
+    runDetection(options);
     
     // Draw keypoints
     previewImage = inputImage.clone();
-    cv::drawKeypoints(previewImage, keypoints, previewImage, cv::Scalar(0, 255, 0),
+    cv::drawKeypoints(previewImage, lastResult.keypoints, previewImage, cv::Scalar(0, 255, 0),
                      cv::DrawMatchesFlags::DRAW_OVER_OUTIMG);
     
-    featureCount = static_cast<int>(keypoints.size());
+    featureCount = static_cast<int>(lastResult.keypoints.size());
     detectionType = QString("FAST Corners (threshold=%1)").arg(threshold);
-    infoLabel->setText(QString("FAST detection: %1 corners found").arg(featureCount));
-    infoLabel->setStyleSheet("color: #a78bfa; padding: 5px;");
+    showDetection(QString("FAST detection: %1 corners found").arg(featureCount));
 }
 
 void FeatureDetectionDialog::detectORBFeatures() {
-    cv::Mat gray;
-    
-    // Convert to grayscale
-    if (inputImage.channels() == 3) {
-        cv::cvtColor(inputImage, gray, cv::COLOR_BGR2GRAY);
-    } else {
-        gray = inputImage.clone();
-    }
-    
-    // ORB parameters
+    // ORB parameters; FAST runs at cv::ORB's default threshold on every level
     int nfeatures = orbMaxFeaturesSpin->value();
-    float scaleFactor = orbScaleFactorSlider->value() / 100.0f;
-    int nlevels = orbLevelsSpin->value();
-    int edgeThreshold = orbEdgeThresholdSpin->value();
-    
-    // Create ORB detector
-    cv::Ptr<cv::ORB> orb = cv::ORB::create(
-        nfeatures, scaleFactor, nlevels, edgeThreshold
-    );
+    FeatureDetector::Options options = gridOptions(FeatureDetector::Method::ORB);
+    options.maxFeatures = nfeatures;
+    options.scaleFactor = orbScaleFactorSlider->value() / 100.0f;
+    options.levels = orbLevelsSpin->value();
+    options.edgeThreshold = orbEdgeThresholdSpin->value();
+    options.fastThreshold = 20;
     
-    // Detect and compute
-    std::vector<cv::KeyPoint> keypoints;
-    cv::Mat descriptors;
-    orb->detectAndCompute(gray, cv::Mat(), keypoints, descriptors);
+    // Detect in tiles, then compute descriptors for the kept keypoints
+    runDetection(options);
     
     // Draw keypoints with rich info
     previewImage = inputImage.clone();
-    cv::drawKeypoints(previewImage, keypoints, previewImage, cv::Scalar(0, 255, 0),
-                     cv::DrawMatchesFlags::DRAW_RICH_KEYPOINTS);
+    cv::drawKeypoints(previewImage, lastResult.keypoints, previewImage, cv::Scalar(0, 255, 0),
+                     cv::DrawMatchesFlags::DRAW_OVER_OUTIMG | cv::DrawMatchesFlags::DRAW_RICH_KEYPOINTS);
     
-    featureCount = static_cast<int>(keypoints.size());
+    featureCount = static_cast<int>(lastResult.keypoints.size());
     detectionType = QString("ORB Features (max=%1)").arg(nfeatures);
-    infoLabel->setText(QString("ORB detection: %1 features with descriptors").arg(featureCount));
-    infoLabel->setStyleSheet("color: #a78bfa; padding: 5px;");
+    showDetection(QString("ORB detection: %1 features with descriptors").arg(featureCount));
+}
+
+void FeatureDetectionDialog::exportKeypoints() {
+    if (lastResult.keypoints.empty()) {
+        QMessageBox::warning(this, "No Keypoints", "No keypoints to export!");
+        return;
+    }
+    
+    QString filename = QFileDialog::getSaveFileName(this,
+        "Export Keypoints",
+        "",
+        "Keypoint Files (*.nkp);;All Files (*)");
+    
+    if (filename.isEmpty()) return;
+    
+    if (FeatureDetector::save(filename.toStdString(), lastResult.keypoints, lastResult.descriptors)) {
+        QMessageBox::information(this, "Export Successful",
+            QString("Exported %1 keypoints%2.").arg(featureCount)
+                .arg(lastResult.descriptors.empty() ? "" : " with descriptors"));
+    } else {
+        QMessageBox::critical(this, "Export Failed",
+            "Failed to write the keypoint file!");
+    }
 }
 
 void FeatureDetectionDialog::onApplyClicked() {
@@ -575,6 +629,7 @@ void FeatureDetectionDialog::onResetClicked() {
     harrisApertureSpin->setValue(3);
     harrisKSlider->setValue(4);
     harrisThresholdSlider->setValue(100);
+    harrisNmsRadiusSpin->setValue(5);
     
     shiTomasiMaxCornersSpin->setValue(100);
     shiTomasiQualitySlider->setValue(1);
@@ -590,6 +645,9 @@ void FeatureDetectionDialog::onResetClicked() {
     orbLevelsSpin->setValue(8);
     orbEdgeThresholdSpin->setValue(31);
     
+    gridCellSpin->setValue(64);
+    maxPerCellSpin->setValue(0);
+    
     updatePreview();
 }
 #include "moc_FeatureDetectionDialog.cpp"
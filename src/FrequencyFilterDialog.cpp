@@ -6,9 +6,14 @@
 #include <QMessageBox>
 #include <QStackedWidget>
 #include <cmath>
+#include <algorithm>
 
 FrequencyFilterDialog::FrequencyFilterDialog(const cv::Mat& image, QWidget *parent)
-    : QDialog(parent), inputImage(image.clone()), applied(false) {
+    : QDialog(parent), inputImage(image.clone()), spectraColorMode(-1), filteredPlaneCount(0), applied(false) {
+    
+    dftSize = FrequencyDomain::optimalSize(inputImage.size());
+    // At most three planes are filtered (B, G, R); engines allocate on first use
+    engines.resize(3);
     
     setWindowTitle("Advanced Frequency Filters - Phase 19");
     setMinimumSize(1100, 750);
@@ -44,6 +49,21 @@ void FrequencyFilterDialog::setupUI() {
             this, &FrequencyFilterDialog::onFilterTypeChanged);
     filterLayout->addWidget(filterLabel);
     filterLayout->addWidget(filterTypeCombo, 1);
+    
+    // Order matches ImageProcessor::FrequencyColorMode
+    QLabel* colorModeLabel = new QLabel("Color:");
+    colorModeLabel->setStyleSheet("color: #c4b5fd; font-weight: bold;");
+    colorModeCombo = new QComboBox();
+    colorModeCombo->addItem("Grayscale");
+    colorModeCombo->addItem("Luminance (YCrCb)");
+    colorModeCombo->addItem("Luminance (Lab)");
+    colorModeCombo->addItem("All Channels (BGR)");
+    colorModeCombo->setCurrentIndex(ImageProcessor::FREQ_LUMINANCE_YCRCB);
+    colorModeCombo->setEnabled(inputImage.channels() >= 3);
+    connect(colorModeCombo, QOverload<int>::of(&QComboBox::currentIndexChanged),
+            this, &FrequencyFilterDialog::onParameterChanged);
+    filterLayout->addWidget(colorModeLabel);
+    filterLayout->addWidget(colorModeCombo);
     mainLayout->addLayout(filterLayout);
     
     // Parameters area with stacked widget
@@ -306,115 +326,128 @@ void FrequencyFilterDialog::updatePreview() {
     }
 }
 
-void FrequencyFilterDialog::shiftDFT(cv::Mat& fImage) {
-    int cx = fImage.cols / 2;
-    int cy = fImage.rows / 2;
-
-    cv::Mat tmp;
-    cv::Mat q0(fImage, cv::Rect(0, 0, cx, cy));
-    cv::Mat q1(fImage, cv::Rect(cx, 0, cx, cy));
-    cv::Mat q2(fImage, cv::Rect(0, cy, cx, cy));
-    cv::Mat q3(fImage, cv::Rect(cx, cy, cx, cy));
-
-    q0.copyTo(tmp);
-    q3.copyTo(q0);
-    tmp.copyTo(q3);
+const std::vector<cv::Mat>& FrequencyFilterDialog::forwardSpectra(bool logDomain) {
+    int colorMode = colorModeCombo->currentIndex();
+    if (colorMode != spectraColorMode) {
+        spectra.clear();
+        logSpectra.clear();
+        filteredPlaneCount = ImageProcessor::splitFrequencyPlanes(
+            inputImage, static_cast<ImageProcessor::FrequencyColorMode>(colorMode), colorPlanes);
+        spectraColorMode = colorMode;
+    }
+    
+    // Keep one set of spectra alive; the other domain is recomputed on demand
+    (logDomain ? spectra : logSpectra).clear();
+    std::vector<cv::Mat>& cached = logDomain ? logSpectra : spectra;
+    if (!cached.empty()) {
+        return cached;
+    }
+    
+    cached.resize(filteredPlaneCount);
+    cv::parallel_for_(cv::Range(0, filteredPlaneCount), [&](const cv::Range& range) {
+        for (int k = range.start; k < range.end; k++) {
+            cv::Mat floatImg;
+            if (logDomain) {
+                // Add small constant to avoid log(0)
+                cv::log(colorPlanes[k] + 1.0, floatImg);
+            } else {
+                floatImg = colorPlanes[k];
+            }
+            
+            // Replicated padding keeps the wrap-around seam mild
+            FrequencyDomain& engine = engines[k];
+            engine.prepare(inputImage.size());
+            engine.forward(floatImg, cv::BORDER_REPLICATE).copyTo(cached[k]);
+        }
+    });
+    return cached;
+}
 
-    q1.copyTo(tmp);
-    q2.copyTo(q1);
-    tmp.copyTo(q2);
+cv::Mat FrequencyFilterDialog::buildPackedFilter(int filterIndex, double param1, double param2, double param3,
+                                                 const std::function<float(double)>& response) {
+    for (size_t k = 0; k < filterCache.size(); k++) {
+        const CachedFilter& entry = filterCache[k];
+        if (entry.filterIndex == filterIndex && entry.params[0] == param1 &&
+            entry.params[1] == param2 && entry.params[2] == param3 && entry.mask.size() == dftSize) {
+            std::rotate(filterCache.begin(), filterCache.begin() + k, filterCache.begin() + k + 1);
+            return filterCache.front().mask;
+        }
+    }
+    
+    cv::Mat filter;
+    FrequencyDomain::radialMask(inputImage.size(), response, filter);
+    
+    filterCache.insert(filterCache.begin(), CachedFilter{filterIndex, {param1, param2, param3}, filter});
+    // Evict least recently used masks past the byte budget, always keeping the new one
+    size_t cachedBytes = 0;
+    size_t kept = 0;
+    while (kept < filterCache.size()) {
+        const cv::Mat& mask = filterCache[kept].mask;
+        cachedBytes += mask.total() * mask.elemSize();
+        if (kept > 0 && cachedBytes > MAX_CACHED_FILTER_BYTES) {
+            break;
+        }
+        kept++;
+    }
+    filterCache.resize(kept);
+    return filter;
 }
 
 void FrequencyFilterDialog::createFrequencyFilter(cv::Mat& filter, int type, double cutoff, int order) {
-    int rows = filter.rows;
-    int cols = filter.cols;
-    int cx = cols / 2;
-    int cy = rows / 2;
-    
-    for (int i = 0; i < rows; i++) {
-        for (int j = 0; j < cols; j++) {
-            double distance = std::sqrt((i - cy) * (i - cy) + (j - cx) * (j - cx));
-            
-            if (type == 0) { // Butterworth Lowpass
-                double value = 1.0 / (1.0 + std::pow(distance / cutoff, 2.0 * order));
-                filter.at<float>(i, j) = static_cast<float>(value);
-            } else if (type == 1) { // Butterworth Highpass
-                if (distance == 0) distance = 0.01;
-                double value = 1.0 / (1.0 + std::pow(cutoff / distance, 2.0 * order));
-                filter.at<float>(i, j) = static_cast<float>(value);
-            } else if (type == 2) { // Gaussian Lowpass
-                double value = std::exp(-(distance * distance) / (2.0 * cutoff * cutoff));
-                filter.at<float>(i, j) = static_cast<float>(value);
-            } else if (type == 3) { // Gaussian Highpass
-                double value = 1.0 - std::exp(-(distance * distance) / (2.0 * cutoff * cutoff));
-                filter.at<float>(i, j) = static_cast<float>(value);
-            }
+    filter = buildPackedFilter(type, cutoff, order, 0.0, [type, cutoff, order](double distance) {
+        if (type == 0) { // Butterworth Lowpass
+            return static_cast<float>(1.0 / (1.0 + std::pow(distance / cutoff, 2.0 * order)));
+        } else if (type == 1) { // Butterworth Highpass
+            if (distance == 0) distance = 0.01;
+            return static_cast<float>(1.0 / (1.0 + std::pow(cutoff / distance, 2.0 * order)));
+        } else if (type == 2) { // Gaussian Lowpass
+            return static_cast<float>(std::exp(-(distance * distance) / (2.0 * cutoff * cutoff)));
+        } else { // Gaussian Highpass
+            return static_cast<float>(1.0 - std::exp(-(distance * distance) / (2.0 * cutoff * cutoff)));
         }
-    }
+    });
 }
 
 void FrequencyFilterDialog::createBandFilter(cv::Mat& filter, int type, double centerFreq, double bandwidth) {
-    int rows = filter.rows;
-    int cols = filter.cols;
-    int cx = cols / 2;
-    int cy = rows / 2;
-    
-    for (int i = 0; i < rows; i++) {
-        for (int j = 0; j < cols; j++) {
-            double distance = std::sqrt((i - cy) * (i - cy) + (j - cx) * (j - cx));
-            double diff = std::abs(distance - centerFreq);
+    filter = buildPackedFilter(4 + type, centerFreq, bandwidth, 0.0, [type, centerFreq, bandwidth](double distance) {
+        double diff = std::abs(distance - centerFreq);
+        double pass = std::exp(-(diff * diff) / (2.0 * bandwidth * bandwidth));
+        return static_cast<float>(type == 0 ? pass : 1.0 - pass); // Bandpass / Bandreject
+    });
+}
+
+void FrequencyFilterDialog::applyFrequencyFilter(const cv::Mat& filter, cv::Mat& output, bool homomorphic) {
+    const std::vector<cv::Mat>& planeSpectra = forwardSpectra(homomorphic);
+    
+    // Unfiltered planes (chroma) are shared as they are
+    std::vector<cv::Mat> planes = colorPlanes;
+    
+    // The planes share one mask and run concurrently, so color costs about
+    // the same wall time as gray
+    cv::parallel_for_(cv::Range(0, filteredPlaneCount), [&](const cv::Range& range) {
+        for (int k = range.start; k < range.end; k++) {
+            // The filter is real, so scaling every packed element applies it to
+            // both the real and imaginary parts of its frequency
+            // The inverse stays in the plane's engine; merging below reads it
+            // before the next call overwrites it
+            FrequencyDomain& engine = engines[k];
+            engine.prepare(inputImage.size());
+            cv::multiply(planeSpectra[k], filter, engine.spectrum());
             
-            if (type == 0) { // Bandpass
-                double value = std::exp(-(diff * diff) / (2.0 * bandwidth * bandwidth));
-                filter.at<float>(i, j) = static_cast<float>(value);
-            } else { // Bandreject
-                double value = 1.0 - std::exp(-(diff * diff) / (2.0 * bandwidth * bandwidth));
-                filter.at<float>(i, j) = static_cast<float>(value);
+            cv::Mat& inverse = engine.inverse();
+            if (homomorphic) {
+                cv::exp(inverse, inverse);
             }
+            planes[k] = inverse;
         }
-    }
-}
-
-void FrequencyFilterDialog::applyFrequencyFilter(const cv::Mat& input, cv::Mat& output, const cv::Mat& filter) {
-    cv::Mat gray;
-    if (input.channels() == 3) {
-        cv::cvtColor(input, gray, cv::COLOR_BGR2GRAY);
-    } else {
-        gray = input.clone();
-    }
-    
-    // Convert to float
-    cv::Mat floatImg;
-    gray.convertTo(floatImg, CV_32F);
-    
-    // DFT
-    cv::Mat dftInput;
-    cv::dft(floatImg, dftInput, cv::DFT_COMPLEX_OUTPUT);
-    shiftDFT(dftInput);
-    
-    // Split into real and imaginary
-    std::vector<cv::Mat> planes;
-    cv::split(dftInput, planes);
-    
-    // Apply filter to both planes
-    planes[0] = planes[0].mul(filter);
-    planes[1] = planes[1].mul(filter);
-    
-    // Merge
-    cv::Mat filteredDFT;
-    cv::merge(planes, filteredDFT);
-    
-    // Inverse shift and DFT
-    shiftDFT(filteredDFT);
-    cv::Mat inverse;
-    cv::idft(filteredDFT, inverse, cv::DFT_SCALE | cv::DFT_REAL_OUTPUT);
+    });
     
     // Normalize
-    cv::normalize(inverse, inverse, 0, 255, cv::NORM_MINMAX);
-    inverse.convertTo(output, CV_8U);
+    ImageProcessor::mergeFrequencyPlanes(planes, filteredPlaneCount,
+        static_cast<ImageProcessor::FrequencyColorMode>(spectraColorMode), output);
     
     // Convert back to color if needed
-    if (input.channels() == 3) {
+    if (inputImage.channels() == 3 && output.channels() == 1) {
         cv::cvtColor(output, output, cv::COLOR_GRAY2BGR);
     }
 }
@@ -423,12 +456,9 @@ void FrequencyFilterDialog::applyButterworthLowpass() {
     double cutoff = cutoffFreqSlider->value();
     int order = filterOrderSpin->value();
     
-    int rows = inputImage.rows;
-    int cols = inputImage.cols;
-    cv::Mat filter = cv::Mat::zeros(rows, cols, CV_32F);
-    
+    cv::Mat filter;
     createFrequencyFilter(filter, 0, cutoff, order);
-    applyFrequencyFilter(inputImage, previewImage, filter);
+    applyFrequencyFilter(filter, previewImage);
     
     filterType = QString("Butterworth Lowpass (D0=%1, n=%2)").arg(cutoff).arg(order);
     infoLabel->setText(QString("Butterworth lowpass applied (cutoff=%1, order=%2)").arg(cutoff).arg(order));
@@ -439,12 +469,9 @@ void FrequencyFilterDialog::applyButterworthHighpass() {
     double cutoff = cutoffFreqSlider->value();
     int order = filterOrderSpin->value();
     
-    int rows = inputImage.rows;
-    int cols = inputImage.cols;
-    cv::Mat filter = cv::Mat::zeros(rows, cols, CV_32F);
-    
+    cv::Mat filter;
     createFrequencyFilter(filter, 1, cutoff, order);
-    applyFrequencyFilter(inputImage, previewImage, filter);
+    applyFrequencyFilter(filter, previewImage);
     
     filterType = QString("Butterworth Highpass (D0=%1, n=%2)").arg(cutoff).arg(order);
     infoLabel->setText(QString("Butterworth highpass applied (cutoff=%1, order=%2)").arg(cutoff).arg(order));
@@ -454,12 +481,9 @@ void FrequencyFilterDialog::applyButterworthHighpass() {
 void FrequencyFilterDialog::applyGaussianLowpass() {
     double cutoff = cutoffFreqSlider->value();
     
-    int rows = inputImage.rows;
-    int cols = inputImage.cols;
-    cv::Mat filter = cv::Mat::zeros(rows, cols, CV_32F);
-    
+    cv::Mat filter;
     createFrequencyFilter(filter, 2, cutoff, 0);
-    applyFrequencyFilter(inputImage, previewImage, filter);
+    applyFrequencyFilter(filter, previewImage);
     
     filterType = QString("Gaussian Lowpass (?=%1)").arg(cutoff);
     infoLabel->setText(QString("Gaussian lowpass applied (sigma=%1)").arg(cutoff));
@@ -469,12 +493,9 @@ void FrequencyFilterDialog::applyGaussianLowpass() {
 void FrequencyFilterDialog::applyGaussianHighpass() {
     double cutoff = cutoffFreqSlider->value();
     
-    int rows = inputImage.rows;
-    int cols = inputImage.cols;
-    cv::Mat filter = cv::Mat::zeros(rows, cols, CV_32F);
-    
+    cv::Mat filter;
     createFrequencyFilter(filter, 3, cutoff, 0);
-    applyFrequencyFilter(inputImage, previewImage, filter);
+    applyFrequencyFilter(filter, previewImage);
     
     filterType = QString("Gaussian Highpass (?=%1)").arg(cutoff);
     infoLabel->setText(QString("Gaussian highpass applied (sigma=%1)").arg(cutoff));
@@ -485,12 +506,9 @@ void FrequencyFilterDialog::applyBandpassFilter() {
     double centerFreq = centerFreqSlider->value();
     double bandwidth = bandwidthSlider->value();
     
-    int rows = inputImage.rows;
-    int cols = inputImage.cols;
-    cv::Mat filter = cv::Mat::zeros(rows, cols, CV_32F);
-    
+    cv::Mat filter;
     createBandFilter(filter, 0, centerFreq, bandwidth);
-    applyFrequencyFilter(inputImage, previewImage, filter);
+    applyFrequencyFilter(filter, previewImage);
     
     filterType = QString("Bandpass (Center=%1, BW=%2)").arg(centerFreq).arg(bandwidth);
     infoLabel->setText(QString("Bandpass filter applied (center=%1, bandwidth=%2)").arg(centerFreq).arg(bandwidth));
@@ -501,12 +519,9 @@ void FrequencyFilterDialog::applyBandrejectFilter() {
     double centerFreq = centerFreqSlider->value();
     double bandwidth = bandwidthSlider->value();
     
-    int rows = inputImage.rows;
-    int cols = inputImage.cols;
-    cv::Mat filter = cv::Mat::zeros(rows, cols, CV_32F);
-    
+    cv::Mat filter;
     createBandFilter(filter, 1, centerFreq, bandwidth);
-    applyFrequencyFilter(inputImage, previewImage, filter);
+    applyFrequencyFilter(filter, previewImage);
     
     filterType = QString("Bandreject (Center=%1, BW=%2)").arg(centerFreq).arg(bandwidth);
     infoLabel->setText(QString("Bandreject filter applied (center=%1, bandwidth=%2)").arg(centerFreq).arg(bandwidth));
@@ -518,66 +533,13 @@ void FrequencyFilterDialog::applyHomomorphicFilter() {
     double gammaHigh = gammaHighSlider->value() / 100.0;
     double cutoff = homoCutoffSlider->value();
     
-    cv::Mat gray;
-    if (inputImage.channels() == 3) {
-        cv::cvtColor(inputImage, gray, cv::COLOR_BGR2GRAY);
-    } else {
-        gray = inputImage.clone();
-    }
-    
-    // Add small constant to avoid log(0)
-    cv::Mat floatImg;
-    gray.convertTo(floatImg, CV_32F);
-    floatImg += 1.0;
-    
-    // Take logarithm
-    cv::log(floatImg, floatImg);
-    
-    // DFT
-    cv::Mat dftInput;
-    cv::dft(floatImg, dftInput, cv::DFT_COMPLEX_OUTPUT);
-    shiftDFT(dftInput);
-    
-    // Create homomorphic filter
-    int rows = gray.rows;
-    int cols = gray.cols;
-    int cx = cols / 2;
-    int cy = rows / 2;
-    
-    cv::Mat filter = cv::Mat::zeros(rows, cols, CV_32F);
-    for (int i = 0; i < rows; i++) {
-        for (int j = 0; j < cols; j++) {
-            double distance = std::sqrt((i - cy) * (i - cy) + (j - cx) * (j - cx));
-            double h = (gammaHigh - gammaLow) * (1.0 - std::exp(-(distance * distance) / (2.0 * cutoff * cutoff))) + gammaLow;
-            filter.at<float>(i, j) = static_cast<float>(h);
-        }
-    }
-    
-    // Apply filter
-    std::vector<cv::Mat> planes;
-    cv::split(dftInput, planes);
-    planes[0] = planes[0].mul(filter);
-    planes[1] = planes[1].mul(filter);
-    
-    cv::Mat filteredDFT;
-    cv::merge(planes, filteredDFT);
-    
-    // Inverse DFT
-    shiftDFT(filteredDFT);
-    cv::Mat inverse;
-    cv::idft(filteredDFT, inverse, cv::DFT_SCALE | cv::DFT_REAL_OUTPUT);
-    
-    // Exponentiate
-    cv::exp(inverse, inverse);
+    cv::Mat filter = buildPackedFilter(6, gammaLow, gammaHigh, cutoff, [gammaLow, gammaHigh, cutoff](double distance) {
+        double h = (gammaHigh - gammaLow) * (1.0 - std::exp(-(distance * distance) / (2.0 * cutoff * cutoff))) + gammaLow;
+        return static_cast<float>(h);
+    });
     
-    // Normalize
-    cv::normalize(inverse, inverse, 0, 255, cv::NORM_MINMAX);
-    inverse.convertTo(previewImage, CV_8U);
-    
-    // Convert back to color if needed
-    if (inputImage.channels() == 3) {
-        cv::cvtColor(previewImage, previewImage, cv::COLOR_GRAY2BGR);
-    }
+    // Log-domain spectrum; exponentiated back after the inverse DFT
+    applyFrequencyFilter(filter, previewImage, true);
     
     filterType = QString("Homomorphic (?L=%.2f, ?H=%.2f)").arg(gammaLow).arg(gammaHigh);
     infoLabel->setText(QString("Homomorphic filter applied (?L=%.2f, ?H=%.2f, cutoff=%1)")
@@ -607,6 +569,8 @@ void FrequencyFilterDialog::onResetClicked() {
     gammaHighSlider->setValue(150);
     homoCutoffSlider->setValue(30);
     
+    colorModeCombo->setCurrentIndex(ImageProcessor::FREQ_LUMINANCE_YCRCB);
+    
     updatePreview();
 }
 #include "moc_FrequencyFilterDialog.cpp"
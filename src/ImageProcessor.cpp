@@ -1,5 +1,12 @@
 #include "ImageProcessor.h"
+#include "transforms/FrequencyDomain.h"
+#include "transforms/LensRemapCache.h"
 #include <QImage>
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <numeric>
+#include <stdexcept>
 
 void ImageProcessor::convertToGrayscale(const cv::Mat& src, cv::Mat& dst) {
     if (src.channels() == 3) {
@@ -104,119 +111,162 @@ void ImageProcessor::applyMorphGradient(const cv::Mat& src, cv::Mat& dst, int ke
     cv::morphologyEx(src, dst, cv::MORPH_GRADIENT, element);
 }
 
-void ImageProcessor::applyFFT(const cv::Mat& src, cv::Mat& magnitude, cv::Mat& phase) {
-    cv::Mat gray;
-    if (src.channels() == 3) {
-        cv::cvtColor(src, gray, cv::COLOR_BGR2GRAY);
+int ImageProcessor::splitFrequencyPlanes(const cv::Mat& src, FrequencyColorMode mode, std::vector<cv::Mat>& planes) {
+    planes.clear();
+    int filteredCount = 1;
+    
+    if (src.channels() == 1 || mode == FREQ_GRAY) {
+        cv::Mat gray;
+        if (src.channels() == 1) {
+            gray = src;
+        } else {
+            cv::cvtColor(src, gray, src.channels() == 4 ? cv::COLOR_BGRA2GRAY : cv::COLOR_BGR2GRAY);
+        }
+        planes.push_back(gray);
+    } else if (mode == FREQ_ALL_CHANNELS) {
+        // Alpha (if any) stays the last, unfiltered plane
+        cv::split(src, planes);
+        filteredCount = 3;
     } else {
-        gray = src.clone();
+        // Luminance is channel 0 of both YCrCb and Lab
+        cv::Mat converted;
+        cv::cvtColor(src, converted, mode == FREQ_LUMINANCE_LAB ? cv::COLOR_BGR2Lab : cv::COLOR_BGR2YCrCb);
+        cv::split(converted, planes);
     }
     
-    // Expand to optimal size
-    cv::Mat padded;
-    int m = cv::getOptimalDFTSize(gray.rows);
-    int n = cv::getOptimalDFTSize(gray.cols);
-    cv::copyMakeBorder(gray, padded, 0, m - gray.rows, 0, n - gray.cols, 
-                      cv::BORDER_CONSTANT, cv::Scalar::all(0));
-    
-    // Prepare for DFT
-    cv::Mat planes[] = {cv::Mat_<float>(padded), cv::Mat::zeros(padded.size(), CV_32F)};
-    cv::Mat complexImg;
-    cv::merge(planes, 2, complexImg);
-    
-    // Perform DFT
-    cv::dft(complexImg, complexImg);
+    for (int k = 0; k < filteredCount; k++) {
+        planes[k].convertTo(planes[k], CV_32F);
+    }
+    return filteredCount;
+}
+
+void ImageProcessor::mergeFrequencyPlanes(std::vector<cv::Mat>& planes, int filteredCount,
+                                          FrequencyColorMode mode, cv::Mat& dst) {
+    // One shared range for all filtered planes; per-plane normalization
+    // would shift the color balance
+    double low = DBL_MAX, high = -DBL_MAX;
+    for (int k = 0; k < filteredCount; k++) {
+        double minVal, maxVal;
+        cv::minMaxLoc(planes[k], &minVal, &maxVal);
+        low = std::min(low, minVal);
+        high = std::max(high, maxVal);
+    }
+    double scale = (high > low) ? 255.0 / (high - low) : 0.0;
+    for (int k = 0; k < filteredCount; k++) {
+        cv::Mat scaled;
+        planes[k].convertTo(scaled, CV_8U, scale, -low * scale);
+        planes[k] = scaled;
+    }
     
-    // Split into magnitude and phase
-    cv::split(complexImg, planes);
-    cv::magnitude(planes[0], planes[1], magnitude);
-    cv::phase(planes[0], planes[1], phase);
+    if (planes.size() == 1) {
+        dst = planes[0];
+        return;
+    }
     
-    // Switch to logarithmic scale for visualization
-    magnitude += cv::Scalar::all(1);
-    cv::log(magnitude, magnitude);
-    cv::normalize(magnitude, magnitude, 0, 255, cv::NORM_MINMAX);
-    magnitude.convertTo(magnitude, CV_8U);
+    cv::Mat merged;
+    cv::merge(planes, merged);
+    if (mode == FREQ_LUMINANCE_YCRCB) {
+        cv::cvtColor(merged, dst, cv::COLOR_YCrCb2BGR);
+    } else if (mode == FREQ_LUMINANCE_LAB) {
+        cv::cvtColor(merged, dst, cv::COLOR_Lab2BGR);
+    } else {
+        dst = merged;
+    }
 }
 
-void ImageProcessor::applyLowPassFilter(const cv::Mat& src, cv::Mat& dst, int radius) {
-    cv::Mat gray;
-    if (src.channels() == 3) {
-        cv::cvtColor(src, gray, cv::COLOR_BGR2GRAY);
-    } else {
-        gray = src.clone();
+// The caller's workspace with at least 'count' engines, or a temporary one
+static ImageProcessor::FrequencyWorkspace& frequencyWorkspace(ImageProcessor::FrequencyWorkspace* workspace,
+                                                              ImageProcessor::FrequencyWorkspace& temporary,
+                                                              int count) {
+    ImageProcessor::FrequencyWorkspace& ws = workspace ? *workspace : temporary;
+    if (static_cast<int>(ws.engines.size()) < count) {
+        ws.engines.resize(count);
     }
-    
-    // Expand to optimal size
-    cv::Mat padded;
-    int m = cv::getOptimalDFTSize(gray.rows);
-    int n = cv::getOptimalDFTSize(gray.cols);
-    cv::copyMakeBorder(gray, padded, 0, m - gray.rows, 0, n - gray.cols, 
-                      cv::BORDER_CONSTANT, cv::Scalar::all(0));
-    
-    // Perform DFT
-    cv::Mat planes[] = {cv::Mat_<float>(padded), cv::Mat::zeros(padded.size(), CV_32F)};
-    cv::Mat complexImg;
-    cv::merge(planes, 2, complexImg);
-    cv::dft(complexImg, complexImg);
-    
-    // Create low-pass filter mask
-    cv::Mat mask = cv::Mat::zeros(complexImg.size(), CV_32F);
-    cv::Point center(mask.cols / 2, mask.rows / 2);
-    cv::circle(mask, center, radius, cv::Scalar(1), -1);
-    
-    // Apply filter in frequency domain
-    cv::Mat maskPlanes[] = {mask, mask};
-    cv::Mat maskComplex;
-    cv::merge(maskPlanes, 2, maskComplex);
-    cv::mulSpectrums(complexImg, maskComplex, complexImg, 0);
-    
-    // Inverse DFT
-    cv::idft(complexImg, complexImg);
-    cv::split(complexImg, planes);
-    cv::normalize(planes[0], dst, 0, 255, cv::NORM_MINMAX);
-    dst.convertTo(dst, CV_8U);
-    dst = dst(cv::Rect(0, 0, gray.cols, gray.rows));
+    return ws;
 }
 
-void ImageProcessor::applyHighPassFilter(const cv::Mat& src, cv::Mat& dst, int radius) {
-    cv::Mat gray;
-    if (src.channels() == 3) {
-        cv::cvtColor(src, gray, cv::COLOR_BGR2GRAY);
+// Filter the leading planes with one shared packed mask, concurrently.
+// Every plane has its own engine; the filtered plane keeps that engine's
+// output buffer, so the result is not copied.
+static void filterPlanesWithMask(std::vector<cv::Mat>& planes, int count, const cv::Mat& mask,
+                                 std::vector<FrequencyDomain>& engines) {
+    cv::parallel_for_(cv::Range(0, count), [&](const cv::Range& range) {
+        for (int k = range.start; k < range.end; k++) {
+            FrequencyDomain& engine = engines[k];
+            engine.prepare(planes[k].size());
+            FrequencyDomain::multiplyMask(engine.forward(planes[k]), mask);
+            planes[k] = engine.inverse();
+        }
+    });
+}
+
+void ImageProcessor::applyFFT(const cv::Mat& src, cv::Mat& magnitude, cv::Mat& phase, FrequencyColorMode mode,
+                              FrequencyWorkspace* workspace) {
+    std::vector<cv::Mat> planes;
+    int count = splitFrequencyPlanes(src, mode, planes);
+    FrequencyWorkspace temporary;
+    std::vector<FrequencyDomain>& engines = frequencyWorkspace(workspace, temporary, count).engines;
+    
+    std::vector<cv::Mat> magnitudes(count), phases(count);
+    cv::parallel_for_(cv::Range(0, count), [&](const cv::Range& range) {
+        for (int k = range.start; k < range.end; k++) {
+            FrequencyDomain& engine = engines[k];
+            engine.prepare(planes[k].size());
+            
+            cv::Mat complexImg;
+            engine.forwardComplex(planes[k], complexImg);
+            
+            // Split into magnitude and phase
+            cv::Mat complexPlanes[2];
+            cv::split(complexImg, complexPlanes);
+            cv::magnitude(complexPlanes[0], complexPlanes[1], magnitudes[k]);
+            cv::phase(complexPlanes[0], complexPlanes[1], phases[k]);
+            
+            // Switch to logarithmic scale for visualization, DC in the center
+            magnitudes[k] += cv::Scalar::all(1);
+            cv::log(magnitudes[k], magnitudes[k]);
+            FrequencyDomain::shiftQuadrants(magnitudes[k]);
+            FrequencyDomain::shiftQuadrants(phases[k]);
+        }
+    });
+    
+    // One spectrum per filtered plane (gray, luminance, or B/G/R as color)
+    mergeFrequencyPlanes(magnitudes, count, FREQ_ALL_CHANNELS, magnitude);
+    if (count == 1) {
+        phase = phases[0];
     } else {
-        gray = src.clone();
+        cv::merge(phases, phase);
     }
+}
+
+void ImageProcessor::applyLowPassFilter(const cv::Mat& src, cv::Mat& dst, int radius, FrequencyColorMode mode,
+                                        FrequencyWorkspace* workspace) {
+    std::vector<cv::Mat> planes;
+    int count = splitFrequencyPlanes(src, mode, planes);
+    FrequencyWorkspace temporary;
+    FrequencyWorkspace& ws = frequencyWorkspace(workspace, temporary, count);
     
-    // Expand to optimal size
-    cv::Mat padded;
-    int m = cv::getOptimalDFTSize(gray.rows);
-    int n = cv::getOptimalDFTSize(gray.cols);
-    cv::copyMakeBorder(gray, padded, 0, m - gray.rows, 0, n - gray.cols, 
-                      cv::BORDER_CONSTANT, cv::Scalar::all(0));
-    
-    // Perform DFT
-    cv::Mat planes[] = {cv::Mat_<float>(padded), cv::Mat::zeros(padded.size(), CV_32F)};
-    cv::Mat complexImg;
-    cv::merge(planes, 2, complexImg);
-    cv::dft(complexImg, complexImg);
-    
-    // Create high-pass filter mask (inverse of low-pass)
-    cv::Mat mask = cv::Mat::ones(complexImg.size(), CV_32F);
-    cv::Point center(mask.cols / 2, mask.rows / 2);
-    cv::circle(mask, center, radius, cv::Scalar(0), -1);
-    
-    // Apply filter in frequency domain
-    cv::Mat maskPlanes[] = {mask, mask};
-    cv::Mat maskComplex;
-    cv::merge(maskPlanes, 2, maskComplex);
-    cv::mulSpectrums(complexImg, maskComplex, complexImg, 0);
-    
-    // Inverse DFT
-    cv::idft(complexImg, complexImg);
-    cv::split(complexImg, planes);
-    cv::normalize(planes[0], dst, 0, 255, cv::NORM_MINMAX);
-    dst.convertTo(dst, CV_8U);
-    dst = dst(cv::Rect(0, 0, gray.cols, gray.rows));
+    // Ideal low-pass mask, shared by every plane
+    FrequencyDomain::radialMask(planes[0].size(),
+                                [radius](double distance) { return distance <= radius ? 1.0f : 0.0f; }, ws.mask);
+    
+    filterPlanesWithMask(planes, count, ws.mask, ws.engines);
+    mergeFrequencyPlanes(planes, count, mode, dst);
+}
+
+void ImageProcessor::applyHighPassFilter(const cv::Mat& src, cv::Mat& dst, int radius, FrequencyColorMode mode,
+                                         FrequencyWorkspace* workspace) {
+    std::vector<cv::Mat> planes;
+    int count = splitFrequencyPlanes(src, mode, planes);
+    FrequencyWorkspace temporary;
+    FrequencyWorkspace& ws = frequencyWorkspace(workspace, temporary, count);
+    
+    // Ideal high-pass mask (inverse of low-pass), shared by every plane
+    FrequencyDomain::radialMask(planes[0].size(),
+                                [radius](double distance) { return distance <= radius ? 0.0f : 1.0f; }, ws.mask);
+    
+    filterPlanesWithMask(planes, count, ws.mask, ws.engines);
+    mergeFrequencyPlanes(planes, count, mode, dst);
 }
 
 void ImageProcessor::flipHorizontal(const cv::Mat& src, cv::Mat& dst) {
@@ -236,8 +286,46 @@ void ImageProcessor::applySkew(const cv::Mat& src, cv::Mat& dst) {
 }
 
 void ImageProcessor::applySkew(const cv::Mat& src, cv::Mat& dst, double skewX, double skewY) {
-    int rows = src.rows;
-    int cols = src.cols;
+    cv::Matx33d M = skewMatrix(src.size(), skewX, skewY);
+    cv::warpAffine(src, dst, cv::Mat(M).rowRange(0, 2), src.size());
+}
+
+void ImageProcessor::translate(const cv::Mat& src, cv::Mat& dst, int tx, int ty) {
+    cv::Mat M = (cv::Mat_<float>(2, 3) << 1, 0, tx, 0, 1, ty);
+    cv::warpAffine(src, dst, M, src.size());
+}
+
+void ImageProcessor::rotate(const cv::Mat& src, cv::Mat& dst, double angle) {
+    cv::Point2f center(src.cols / 2.0f, src.rows / 2.0f);
+    cv::Mat M = cv::getRotationMatrix2D(center, angle, 1.0);
+    cv::warpAffine(src, dst, M, src.size());
+}
+
+void ImageProcessor::zoom(const cv::Mat& src, cv::Mat& dst, double scale) {
+    cv::resize(src, dst, cv::Size(), scale, scale, cv::INTER_LINEAR);
+}
+
+// Lift a 2x3 affine matrix to 3x3
+static cv::Matx33d affineToHomography(const cv::Mat& affine) {
+    cv::Mat M;
+    affine.convertTo(M, CV_64F);
+    return cv::Matx33d(M.at<double>(0, 0), M.at<double>(0, 1), M.at<double>(0, 2),
+                       M.at<double>(1, 0), M.at<double>(1, 1), M.at<double>(1, 2),
+                       0.0, 0.0, 1.0);
+}
+
+cv::Matx33d ImageProcessor::flipMatrix(cv::Size size, int flipCode) {
+    // cv::flip codes: 0 = around the x axis, > 0 = around y, < 0 = both
+    double sx = (flipCode != 0) ? -1.0 : 1.0;
+    double sy = (flipCode <= 0) ? -1.0 : 1.0;
+    return cv::Matx33d(sx, 0.0, (sx < 0) ? size.width - 1.0 : 0.0,
+                       0.0, sy, (sy < 0) ? size.height - 1.0 : 0.0,
+                       0.0, 0.0, 1.0);
+}
+
+cv::Matx33d ImageProcessor::skewMatrix(cv::Size size, double skewX, double skewY) {
+    int rows = size.height;
+    int cols = size.width;
     
     cv::Point2f srcTri[3];
     cv::Point2f dstTri[3];
@@ -250,23 +338,28 @@ void ImageProcessor::applySkew(const cv::Mat& src, cv::Mat& dst, double skewX, d
     dstTri[1] = cv::Point2f(cols - 1.0f + cols * skewX, rows * skewY);
     dstTri[2] = cv::Point2f(0, rows - 1.0f);
     
-    cv::Mat warpMat = cv::getAffineTransform(srcTri, dstTri);
-    cv::warpAffine(src, dst, warpMat, src.size());
+    return affineToHomography(cv::getAffineTransform(srcTri, dstTri));
 }
 
-void ImageProcessor::translate(const cv::Mat& src, cv::Mat& dst, int tx, int ty) {
-    cv::Mat M = (cv::Mat_<float>(2, 3) << 1, 0, tx, 0, 1, ty);
-    cv::warpAffine(src, dst, M, src.size());
+cv::Matx33d ImageProcessor::translationMatrix(int tx, int ty) {
+    return cv::Matx33d(1.0, 0.0, tx,
+                       0.0, 1.0, ty,
+                       0.0, 0.0, 1.0);
 }
 
-void ImageProcessor::rotate(const cv::Mat& src, cv::Mat& dst, double angle) {
-    cv::Point2f center(src.cols / 2.0f, src.rows / 2.0f);
-    cv::Mat M = cv::getRotationMatrix2D(center, angle, 1.0);
-    cv::warpAffine(src, dst, M, src.size());
+cv::Matx33d ImageProcessor::rotationMatrix(cv::Size size, double angle) {
+    cv::Point2f center(size.width / 2.0f, size.height / 2.0f);
+    return affineToHomography(cv::getRotationMatrix2D(center, angle, 1.0));
 }
 
-void ImageProcessor::zoom(const cv::Mat& src, cv::Mat& dst, double scale) {
-    cv::resize(src, dst, cv::Size(), scale, scale, cv::INTER_LINEAR);
+cv::Matx33d ImageProcessor::zoomMatrix(cv::Size size, double scale, cv::Size& outputSize) {
+    // Same canvas and pixel-center alignment as cv::resize with fx = fy = scale
+    outputSize = cv::Size(cv::saturate_cast<int>(size.width * scale),
+                          cv::saturate_cast<int>(size.height * scale));
+    double offset = 0.5 * (scale - 1.0);
+    return cv::Matx33d(scale, 0.0, offset,
+                       0.0, scale, offset,
+                       0.0, 0.0, 1.0);
 }
 
 // ============================================================================
@@ -514,59 +607,27 @@ void ImageProcessor::applyVariableThreshold(const cv::Mat& src, cv::Mat& dst, do
 // IMAGE RESTORATION
 // ============================================================================
 
-void ImageProcessor::applyWienerFilter(const cv::Mat& src, cv::Mat& dst, const cv::Mat& psf, double noiseVariance) {
+void ImageProcessor::applyWienerFilter(const cv::Mat& src, cv::Mat& dst, const cv::Mat& psf, double noiseVariance,
+                                       FrequencyWorkspace* workspace) {
     // Convert to grayscale if needed
     cv::Mat gray;
     if (src.channels() == 3) {
         cv::cvtColor(src, gray, cv::COLOR_BGR2GRAY);
     } else {
-        gray = src.clone();
+        gray = src;
     }
     
-    // Convert to float
-    cv::Mat floatImg;
-    gray.convertTo(floatImg, CV_32F);
-    
-    // Perform FFT on image
-    cv::Mat planes[] = {floatImg, cv::Mat::zeros(floatImg.size(), CV_32F)};
-    cv::Mat complexImg;
-    cv::merge(planes, 2, complexImg);
-    cv::dft(complexImg, complexImg);
-    
-    // Perform FFT on PSF
-    cv::Mat psfPadded = cv::Mat::zeros(floatImg.size(), CV_32F);
-    psf.copyTo(psfPadded(cv::Rect(0, 0, psf.cols, psf.rows)));
-    cv::Mat psfPlanes[] = {psfPadded, cv::Mat::zeros(psfPadded.size(), CV_32F)};
-    cv::Mat complexPSF;
-    cv::merge(psfPlanes, 2, complexPSF);
-    cv::dft(complexPSF, complexPSF);
+    // Replicated padding keeps the image border from ringing
+    FrequencyWorkspace temporary;
+    FrequencyDomain& engine = frequencyWorkspace(workspace, temporary, 1).engines[0];
+    engine.prepare(gray.size());
+    cv::Mat& spectrum = engine.forward(gray, cv::BORDER_REPLICATE);
     
     // Wiener filter: H*(f) / (|H(f)|^2 + K)
-    cv::Mat result = cv::Mat::zeros(complexImg.size(), CV_32FC2);
-    for (int i = 0; i < complexImg.rows; i++) {
-        for (int j = 0; j < complexImg.cols; j++) {
-            cv::Vec2f h = complexPSF.at<cv::Vec2f>(i, j);
-            cv::Vec2f g = complexImg.at<cv::Vec2f>(i, j);
-            
-            float h_conj_real = h[0];
-            float h_conj_imag = -h[1];
-            float h_mag_sq = h[0]*h[0] + h[1]*h[1];
-            
-            float denom = h_mag_sq + noiseVariance;
-            if (denom > 0) {
-                result.at<cv::Vec2f>(i, j)[0] = (h_conj_real * g[0] - h_conj_imag * g[1]) / denom;
-                result.at<cv::Vec2f>(i, j)[1] = (h_conj_real * g[1] + h_conj_imag * g[0]) / denom;
-            }
-        }
-    }
+    engine.wienerDivide(spectrum, engine.transferFunction(psf), noiseVariance);
     
     // Inverse FFT
-    cv::idft(result, result);
-    
-    // Extract magnitude
-    cv::Mat restoredPlanes[2];
-    cv::split(result, restoredPlanes);
-    cv::normalize(restoredPlanes[0], dst, 0, 255, cv::NORM_MINMAX);
+    cv::normalize(engine.inverse(), dst, 0, 255, cv::NORM_MINMAX);
     dst.convertTo(dst, CV_8U);
 }
 
@@ -590,7 +651,314 @@ void ImageProcessor::applyInverseFilter(const cv::Mat& src, cv::Mat& dst, const
     applyWienerFilter(src, dst, psf, epsilon);
 }
 
-void ImageProcessor::restoreMotionBlur(const cv::Mat& src, cv::Mat& dst, int length, double angle) {
+// Working state of one channel during Richardson-Lucy; buffers are swapped,
+// not reallocated, between iterations
+struct RichardsonLucyChannel {
+    cv::Mat observed;
+    cv::Mat estimate, previous, next;
+    cv::Mat predicted;
+    cv::Mat step, previousStep;     // RL step history for the extrapolation
+    cv::Mat blurred, correction;
+    cv::Mat gradX, gradY, divergence;
+    FrequencyDomain engine;         // DFT buffers and PSF spectrum, reused every iteration
+    bool converged = false;
+};
+
+// div(grad u / |grad u|) with forward differences for the gradient and
+// backward differences for the divergence (zero flux at the border)
+static void totalVariationDivergence(const cv::Mat& u, cv::Mat& gradX, cv::Mat& gradY, cv::Mat& divergence) {
+    const float EPS2 = 1e-6f;
+    const int rows = u.rows;
+    const int cols = u.cols;
+    gradX.create(u.size(), CV_32F);
+    gradY.create(u.size(), CV_32F);
+    divergence.create(u.size(), CV_32F);
+    
+    for (int i = 0; i < rows; i++) {
+        const float* row = u.ptr<float>(i);
+        const float* below = u.ptr<float>(std::min(i + 1, rows - 1));
+        float* gx = gradX.ptr<float>(i);
+        float* gy = gradY.ptr<float>(i);
+        for (int j = 0; j < cols; j++) {
+            float dx = (j + 1 < cols) ? row[j + 1] - row[j] : 0.0f;
+            float dy = below[j] - row[j];
+            float norm = std::sqrt(dx * dx + dy * dy + EPS2);
+            gx[j] = dx / norm;
+            gy[j] = dy / norm;
+        }
+    }
+    
+    for (int i = 0; i < rows; i++) {
+        const float* gx = gradX.ptr<float>(i);
+        const float* gy = gradY.ptr<float>(i);
+        const float* gyAbove = gradY.ptr<float>(std::max(i - 1, 0));
+        float* div = divergence.ptr<float>(i);
+        for (int j = 0; j < cols; j++) {
+            float dxx = gx[j] - (j > 0 ? gx[j - 1] : 0.0f);
+            float dyy = gy[j] - (i > 0 ? gyAbove[j] : 0.0f);
+            div[j] = dxx + dyy;
+        }
+    }
+}
+
+// One (accelerated) RL-TV iteration; returns the relative L1 change
+static double richardsonLucyIteration(RichardsonLucyChannel& ch, const cv::Mat& psf,
+                                      const ImageProcessor::DeconvolutionOptions& options, int iteration) {
+    const double EPSILON = 1e-6;
+    
+    // The PSF spectrum is cached by the engine while the PSF and size are unchanged
+    FrequencyDomain& engine = ch.engine;
+    engine.prepare(ch.estimate.size());
+    const cv::Mat& transfer = engine.transferFunction(psf);
+    
+    // Biggs-Andrews: extrapolate along the last step, with the step size
+    // taken from the correlation of the last two RL steps
+    if (options.accelerate && iteration >= 2) {
+        double denom = ch.previousStep.dot(ch.previousStep);
+        double alpha = (denom > 0) ? ch.step.dot(ch.previousStep) / denom : 0.0;
+        alpha = std::max(0.0, std::min(alpha, 0.95));
+        cv::addWeighted(ch.estimate, 1.0 + alpha, ch.previous, -alpha, 0.0, ch.predicted);
+        cv::max(ch.predicted, 0.0, ch.predicted);
+    } else {
+        ch.estimate.copyTo(ch.predicted);
+    }
+    
+    // ratio = observed / (predicted * psf)
+    FrequencyDomain::multiplySpectrum(engine.forward(ch.predicted, cv::BORDER_REPLICATE), transfer);
+    engine.inverse(ch.blurred);
+    cv::max(ch.blurred, EPSILON, ch.blurred);
+    cv::divide(ch.observed, ch.blurred, ch.blurred);
+    
+    // correction = ratio correlated with the psf
+    FrequencyDomain::multiplySpectrum(engine.forward(ch.blurred, cv::BORDER_REPLICATE), transfer, true);
+    engine.inverse(ch.correction);
+    cv::multiply(ch.predicted, ch.correction, ch.next);
+    
+    // TV: divide by (1 - lambda * div(grad u / |grad u|)), kept away from zero
+    if (options.tvWeight > 0) {
+        totalVariationDivergence(ch.predicted, ch.gradX, ch.gradY, ch.divergence);
+        ch.divergence.convertTo(ch.divergence, -1, -options.tvWeight, 1.0);
+        cv::max(ch.divergence, 0.1, ch.divergence);
+        cv::divide(ch.next, ch.divergence, ch.next);
+    }
+    cv::max(ch.next, 0.0, ch.next);
+    
+    std::swap(ch.step, ch.previousStep);
+    cv::subtract(ch.next, ch.predicted, ch.step);
+    
+    double change = cv::norm(ch.next, ch.estimate, cv::NORM_L1) /
+                    std::max(cv::norm(ch.estimate, cv::NORM_L1), EPSILON);
+    
+    std::swap(ch.previous, ch.estimate);
+    std::swap(ch.estimate, ch.next);
+    return change;
+}
+
+ImageProcessor::DeconvolutionResult ImageProcessor::applyRichardsonLucy(const cv::Mat& src, cv::Mat& dst,
+                                                                      const cv::Mat& psf,
+                                                                      const DeconvolutionOptions& options) {
+    cv::Mat kernel;
+    psf.convertTo(kernel, CV_32F);
+    double total = cv::sum(kernel)[0];
+    if (kernel.empty() || total <= 0) {
+        throw std::runtime_error("Richardson-Lucy needs a PSF with a positive sum");
+    }
+    kernel /= total;
+    
+    // Color channels are restored; alpha is passed through
+    std::vector<cv::Mat> planes;
+    cv::split(src, planes);
+    const int count = std::min(3, static_cast<int>(planes.size()));
+    const double scale = (src.depth() == CV_8U) ? 1.0 / 255.0 : 1.0;
+    
+    std::vector<RichardsonLucyChannel> channels(count);
+    for (int c = 0; c < count; c++) {
+        planes[c].convertTo(channels[c].observed, CV_32F, scale);
+        cv::max(channels[c].observed, 1e-6, channels[c].estimate);
+        channels[c].previous = channels[c].estimate.clone();
+    }
+    
+    DeconvolutionResult result;
+    for (int iteration = 0; iteration < options.maxIterations; iteration++) {
+        // Channels advance in lock-step so progress stays on this thread
+        cv::parallel_for_(cv::Range(0, count), [&](const cv::Range& range) {
+            for (int c = range.start; c < range.end; c++) {
+                if (channels[c].converged) continue;
+                double change = richardsonLucyIteration(channels[c], kernel, options, iteration);
+                channels[c].converged = (change < options.tolerance);
+            }
+        });
+        result.iterations = iteration + 1;
+        
+        bool allConverged = std::all_of(channels.begin(), channels.end(),
+                                        [](const RichardsonLucyChannel& ch) { return ch.converged; });
+        if (allConverged) {
+            result.converged = true;
+            break;
+        }
+        if (options.progress && !options.progress(iteration + 1, options.maxIterations)) {
+            result.cancelled = true;
+            break;
+        }
+    }
+    
+    for (int c = 0; c < count; c++) {
+        channels[c].estimate.convertTo(planes[c], src.depth(), 1.0 / scale);
+    }
+    if (planes.size() == 1) {
+        dst = planes[0];
+    } else {
+        cv::merge(planes, dst);
+    }
+    return result;
+}
+
+ImageProcessor::MotionBlurEstimate ImageProcessor::estimateMotionBlur(const cv::Mat& src) {
+    auto startTime = std::chrono::high_resolution_clock::now();
+    
+    // Analysis window: half resolution when the image is large enough, so
+    // a 12 MP frame only touches its central 1024 x 1024 pixels
+    const int WINDOW = 512;
+    const int minSide = std::min(src.cols, src.rows);
+    const int factor = (minSide >= 2 * WINDOW) ? 2 : 1;
+    const int side = std::min(WINDOW, minSide / factor) & ~1;
+    if (side < 64) {
+        throw std::runtime_error("Image is too small to estimate motion blur");
+    }
+    
+    const int cropSide = side * factor;
+    cv::Mat region = src(cv::Rect((src.cols - cropSide) / 2, (src.rows - cropSide) / 2, cropSide, cropSide));
+    cv::Mat gray;
+    if (region.channels() == 3) {
+        cv::cvtColor(region, gray, cv::COLOR_BGR2GRAY);
+    } else if (region.channels() == 4) {
+        cv::cvtColor(region, gray, cv::COLOR_BGRA2GRAY);
+    } else {
+        gray = region;
+    }
+    cv::Mat small;
+    if (factor > 1) {
+        cv::resize(gray, small, cv::Size(side, side), 0, 0, cv::INTER_AREA);
+    } else {
+        small = gray;
+    }
+    small.convertTo(small, CV_32F);
+    
+    // Windowed, zero-mean input keeps the image border from adding a cross
+    // to the spectrum, which would bias the angle towards 0 and 90 degrees
+    cv::Mat window;
+    cv::createHanningWindow(window, small.size(), CV_32F);
+    small -= cv::mean(small)[0];
+    small = small.mul(window);
+    
+    // Cepstrum: inverse DFT of log(1 + |F|); negated so the blur peak is a maximum
+    cv::Mat spectrum, planes[2];
+    cv::dft(small, spectrum, cv::DFT_COMPLEX_OUTPUT);
+    cv::split(spectrum, planes);
+    cv::magnitude(planes[0], planes[1], planes[0]);
+    cv::log(planes[0] + 1.0f, planes[0]);
+    planes[1].setTo(0);
+    cv::merge(planes, 2, spectrum);
+    cv::Mat cepstrum;
+    cv::idft(spectrum, cepstrum, cv::DFT_SCALE | cv::DFT_REAL_OUTPUT);
+    FrequencyDomain::shiftQuadrants(cepstrum);
+    cepstrum = -cepstrum;
+    
+    // Mean over rings of equal radius, so the radial decay of the cepstrum
+    // does not favour short lengths
+    const int center = side / 2;
+    const int maxRadius = side / 4;
+    std::vector<double> ringSum(maxRadius + 2, 0.0);
+    std::vector<int> ringCount(maxRadius + 2, 0);
+    for (int y = center - maxRadius - 1; y <= center + maxRadius + 1; y++) {
+        const float* row = cepstrum.ptr<float>(y);
+        for (int x = center - maxRadius - 1; x <= center + maxRadius + 1; x++) {
+            int r = cvRound(std::sqrt(double((x - center) * (x - center) + (y - center) * (y - center))));
+            if (r <= maxRadius + 1) {
+                ringSum[r] += row[x];
+                ringCount[r]++;
+            }
+        }
+    }
+    std::vector<float> ringMean(maxRadius + 2);
+    for (int r = 0; r <= maxRadius + 1; r++) {
+        ringMean[r] = ringCount[r] ? static_cast<float>(ringSum[r] / ringCount[r]) : 0.0f;
+    }
+    
+    auto score = [&](double angleDeg, double length) {
+        double theta = angleDeg * CV_PI / 180.0;
+        float x = static_cast<float>(center + length * std::cos(theta));
+        float y = static_cast<float>(center + length * std::sin(theta));
+        int x0 = static_cast<int>(std::floor(x));
+        int y0 = static_cast<int>(std::floor(y));
+        float fx = x - x0;
+        float fy = y - y0;
+        const float* r0 = cepstrum.ptr<float>(y0);
+        const float* r1 = cepstrum.ptr<float>(y0 + 1);
+        float value = (r0[x0] * (1 - fx) + r0[x0 + 1] * fx) * (1 - fy) +
+                      (r1[x0] * (1 - fx) + r1[x0 + 1] * fx) * fy;
+        int r = static_cast<int>(length);
+        float t = static_cast<float>(length - r);
+        return value - (ringMean[r] * (1 - t) + ringMean[r + 1] * t);
+    };
+    
+    struct Candidate {
+        float score = -FLT_MAX;
+        double angle = 0.0;
+        double length = 0.0;
+    };
+    
+    // Best candidate over an (angle, length) grid, one angle per task
+    auto search = [&](double angle0, double angleStep, int angleCount,
+                      double length0, double lengthStep, int lengthCount,
+                      double* sum, double* sumSq) {
+        std::vector<Candidate> best(angleCount);
+        std::vector<double> sums(angleCount, 0.0), sumsSq(angleCount, 0.0);
+        cv::parallel_for_(cv::Range(0, angleCount), [&](const cv::Range& range) {
+            for (int a = range.start; a < range.end; a++) {
+                double angle = angle0 + a * angleStep;
+                for (int l = 0; l < lengthCount; l++) {
+                    double length = length0 + l * lengthStep;
+                    if (length < 2.0 || length > maxRadius) continue;
+                    float s = score(angle, length);
+                    sums[a] += s;
+                    sumsSq[a] += double(s) * s;
+                    if (s > best[a].score) {
+                        best[a].score = s;
+                        best[a].angle = angle;
+                        best[a].length = length;
+                    }
+                }
+            }
+        });
+        if (sum) *sum = std::accumulate(sums.begin(), sums.end(), 0.0);
+        if (sumSq) *sumSq = std::accumulate(sumsSq.begin(), sumsSq.end(), 0.0);
+        return *std::max_element(best.begin(), best.end(),
+                                 [](const Candidate& a, const Candidate& b) { return a.score < b.score; });
+    };
+    
+    // Coarse: 2 degrees x 0.5 px; fine: 0.1 degrees x 0.05 px around the peak
+    const int coarseLengths = (maxRadius - 2) * 2 + 1;
+    double sum = 0.0, sumSq = 0.0;
+    Candidate coarse = search(0.0, 2.0, 90, 2.0, 0.5, coarseLengths, &sum, &sumSq);
+    Candidate fine = search(coarse.angle - 2.0, 0.1, 41, coarse.length - 0.5, 0.05, 21, nullptr, nullptr);
+    
+    const double samples = 90.0 * coarseLengths;
+    const double mean = sum / samples;
+    const double stddev = std::sqrt(std::max(sumSq / samples - mean * mean, 1e-12));
+    
+    MotionBlurEstimate estimate;
+    estimate.length = fine.length * factor;
+    estimate.angle = std::fmod(fine.angle + 180.0, 180.0);
+    estimate.confidence = (coarse.score - mean) / stddev;
+    estimate.elapsedMs = std::chrono::duration<double, std::milli>(
+        std::chrono::high_resolution_clock::now() - startTime).count();
+    return estimate;
+}
+
+ImageProcessor::DeconvolutionResult ImageProcessor::restoreMotionBlur(const cv::Mat& src, cv::Mat& dst,
+                                                                    int length, double angle,
+                                                                    const DeconvolutionOptions* highQuality) {
     // Create motion blur PSF
     cv::Mat psf = cv::Mat::zeros(length, length, CV_32F);
     double angleRad = angle * CV_PI / 180.0;
@@ -604,18 +972,30 @@ void ImageProcessor::restoreMotionBlur(const cv::Mat& src, cv::Mat& dst, int len
         }
     }
     
+    if (highQuality) {
+        return applyRichardsonLucy(src, dst, psf, *highQuality);
+    }
+    
     // Apply Wiener restoration
     applyWienerFilter(src, dst, psf, 0.01);
+    return DeconvolutionResult();
 }
 
-void ImageProcessor::restoreAtmosphericBlur(const cv::Mat& src, cv::Mat& dst, double k) {
+ImageProcessor::DeconvolutionResult ImageProcessor::restoreAtmosphericBlur(const cv::Mat& src, cv::Mat& dst,
+                                                                         double k,
+                                                                         const DeconvolutionOptions* highQuality) {
     // Create Gaussian PSF for atmospheric blur
     int kernelSize = 15;
     cv::Mat psf = cv::getGaussianKernel(kernelSize, k * kernelSize, CV_32F);
     psf = psf * psf.t();
     
+    if (highQuality) {
+        return applyRichardsonLucy(src, dst, psf, *highQuality);
+    }
+    
     // Apply restoration
     applyWienerFilter(src, dst, psf, 0.001);
+    return DeconvolutionResult();
 }
 
 // ============================================================================
@@ -623,32 +1003,8 @@ void ImageProcessor::restoreAtmosphericBlur(const cv::Mat& src, cv::Mat& dst, do
 // ============================================================================
 
 void ImageProcessor::correctBarrelDistortion(const cv::Mat& src, cv::Mat& dst, double k1, double k2) {
-    cv::Mat map_x, map_y;
-    map_x.create(src.size(), CV_32FC1);
-    map_y.create(src.size(), CV_32FC1);
-    
-    float cx = src.cols / 2.0f;
-    float cy = src.rows / 2.0f;
-    float maxRadius = sqrt(cx*cx + cy*cy);
-    
-    for (int i = 0; i < src.rows; i++) {
-        for (int j = 0; j < src.cols; j++) {
-            float x = (j - cx) / maxRadius;
-            float y = (i - cy) / maxRadius;
-            float r = sqrt(x*x + y*y);
-            
-            // Barrel distortion formula: rd = r * (1 + k1*r^2 + k2*r^4)
-            float r_dist = r * (1.0f + k1*r*r + k2*r*r*r*r);
-            
-            float x_dist = x * r_dist / (r + 1e-6);
-            float y_dist = y * r_dist / (r + 1e-6);
-            
-            map_x.at<float>(i, j) = x_dist * maxRadius + cx;
-            map_y.at<float>(i, j) = y_dist * maxRadius + cy;
-        }
-    }
-    
-    cv::remap(src, dst, map_x, map_y, cv::INTER_LINEAR, cv::BORDER_CONSTANT);
+    // Fixed-point remap tables are built once per (size, k1, k2) and reused
+    LensRemapCache::instance().correct(src, dst, k1, k2);
 }
 
 void ImageProcessor::correctPincushionDistortion(const cv::Mat& src, cv::Mat& dst, double k1, double k2) {
@@ -1,4 +1,5 @@
 #include "LayerManager.h"
+#include <algorithm>
 
 LayerManager::LayerManager(QObject *parent)
     : QObject(parent) {
@@ -8,13 +9,15 @@ LayerManager::~LayerManager() {
 }
 
 void LayerManager::addLayer(const QString& name, const QString& type, const cv::Mat& image,
-                            std::function<cv::Mat(const cv::Mat&)> operation) {
+                            std::function<cv::Mat(const cv::Mat&)> operation,
+                            LayerGeometry geometry) {
     ProcessingLayer layer;
     layer.name = name;
     layer.type = type;
     layer.image = image.clone();
     layer.visible = true;
     layer.operation = operation;
+    layer.geometry = geometry;
     
     layers.append(layer);
     
@@ -51,7 +54,19 @@ cv::Mat LayerManager::rebuildFromLayers(const cv::Mat& original, int upToLayer)
     int endLayer = (upToLayer < 0) ? layers.size() : (upToLayer + 1 < layers.size() ? upToLayer + 1 : layers.size());
     
     for (int i = 0; i < endLayer; ++i) {
-        if (layers[i].operation) {
+        // Consecutive geometric layers are resampled once, not once per layer
+        int runEnd = i;
+        while (runEnd + 1 < endLayer && layers[runEnd].geometry && layers[runEnd + 1].geometry) {
+            ++runEnd;
+        }
+        if (runEnd > i) {
+            try {
+                result = applyGeometricRun(result, i, runEnd);
+            } catch (...) {
+                result = layers[runEnd].image.clone();
+            }
+            i = runEnd;
+        } else if (layers[i].operation) {
             // Use the operation function to replay the transformation
             try {
                 result = layers[i].operation(result);
@@ -74,4 +89,73 @@ cv::Mat LayerManager::rebuildFromLayers(const cv::Mat& original, int upToLayer)
     return result;
 }
 
+cv::Mat LayerManager::applyGeometricRun(const cv::Mat& input, int first, int last) const {
+    // Compose the run; canvases[k] is the output canvas of step k
+    cv::Size size = input.size();
+    std::vector<cv::Matx33d> steps;
+    std::vector<cv::Size> canvases;
+    cv::Matx33d total = cv::Matx33d::eye();
+    for (int i = first; i <= last; ++i) {
+        cv::Size outputSize = size;
+        cv::Matx33d step = layers[i].geometry(size, outputSize);
+        steps.push_back(step);
+        canvases.push_back(outputSize);
+        total = step * total;
+        size = outputSize;
+    }
+    
+    cv::Mat result;
+    if (total(2, 0) == 0.0 && total(2, 1) == 0.0 && total(2, 2) == 1.0) {
+        cv::Mat affine = cv::Mat(total).rowRange(0, 2);
+        cv::warpAffine(input, result, affine, size);
+    } else {
+        cv::warpPerspective(input, result, cv::Mat(total), size);
+    }
+    
+    // Replaying step by step would have cut off whatever fell outside an
+    // intermediate canvas. Intersect those canvases, mapped to the output,
+    // and clear everything outside.
+    auto canvasPolygon = [](const cv::Size& canvas) {
+        return std::vector<cv::Point2f>{
+            cv::Point2f(-0.5f, -0.5f), cv::Point2f(canvas.width - 0.5f, -0.5f),
+            cv::Point2f(canvas.width - 0.5f, canvas.height - 0.5f), cv::Point2f(-0.5f, canvas.height - 0.5f)};
+    };
+    auto orient = [](std::vector<cv::Point2f>& polygon) {
+        if (polygon.size() >= 3 && cv::contourArea(polygon, true) < 0) {
+            std::reverse(polygon.begin(), polygon.end());
+        }
+    };
+    
+    std::vector<cv::Point2f> visible = canvasPolygon(size);
+    orient(visible);
+    const double fullArea = cv::contourArea(visible);
+    cv::Matx33d toOutput = cv::Matx33d::eye();
+    for (int k = static_cast<int>(steps.size()) - 2; k >= 0 && !visible.empty(); --k) {
+        toOutput = toOutput * steps[k + 1];
+        std::vector<cv::Point2f> mapped;
+        cv::perspectiveTransform(canvasPolygon(canvases[k]), mapped, cv::Mat(toOutput));
+        orient(mapped);
+        std::vector<cv::Point2f> clipped;
+        if (cv::intersectConvexConvex(visible, mapped, clipped) <= 0) {
+            clipped.clear();
+        }
+        visible = clipped;
+    }
+    
+    if (visible.empty()) {
+        result.setTo(cv::Scalar::all(0));
+    } else if (cv::contourArea(visible) < fullArea - 0.5) {
+        const int SHIFT = 4;
+        std::vector<cv::Point> fixedPoint;
+        for (const cv::Point2f& p : visible) {
+            fixedPoint.emplace_back(cvRound(p.x * (1 << SHIFT)), cvRound(p.y * (1 << SHIFT)));
+        }
+        cv::Mat mask = cv::Mat::zeros(size, CV_8U);
+        cv::fillConvexPoly(mask, fixedPoint, cv::Scalar(255), cv::LINE_8, SHIFT);
+        result.setTo(cv::Scalar::all(0), mask == 0);
+    }
+    
+    return result;
+}
+
 #include "moc_LayerManager.cpp"
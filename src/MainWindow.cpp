@@ -19,6 +19,10 @@
 #include "ROIShape.h"
 #include "ROIDialog.h"
 #include "filters/ImageFilters.h"
+#include "transforms/LensProfile.h"
+#include "transforms/SuperResolution.h"
+#include "segmentation/ConnectedComponents.h"
+#include "features/ImageRegistration.h"
 #include "color/ColorSpace.h"
 #include "ImageMetrics.h"
 #include "Theme.h"
@@ -28,11 +32,20 @@
 #include "FeatureDetectionDialog.h"  // Phase 19
 #include "FrequencyFilterDialog.h"  // Phase 19 - Frequency Filters
 #include <QApplication>
+#include <QProgressDialog>
+#include <QDir>
+#include <QFileInfo>
+#include <QStandardPaths>
+#include <QSlider>
+#include <QSpinBox>
+#include <QActionGroup>
 #include <QScreen>
 #include <QVBoxLayout>
 #include <QTextEdit>
 #include <QHBoxLayout>
 #include <algorithm>
+#include <chrono>
+#include <stdexcept>
 #include "color/ColorSpace.h"
 #include "color/ColorProcessor.h"  // Add this line
 #include "ImageMetrics.h"
@@ -140,6 +153,8 @@ void MainWindow::createMenuBar() {
     ADD_MENU_ACTION(transformMenu, "Flip Vertically", applyFlipY);
     ADD_MENU_ACTION(transformMenu, "Flip Both Axes", applyFlipXY);
     transformMenu->addSeparator();
+    ADD_MENU_ACTION(transformMenu, "Align Second Image (Feature Registration)...", registerSecondImage);
+    transformMenu->addSeparator();
     
     // Crop submenu
     QAction *cropModeAction = transformMenu->addAction("Toggle Crop Mode");
@@ -193,6 +208,7 @@ void MainWindow::createMenuBar() {
     ADD_MENU_ACTION(filtersMenu, "Pyramidal Smoothing", applyPyramidalFilter);
     ADD_MENU_ACTION(filtersMenu, "Circular Smoothing", applyCircularFilter);
     ADD_MENU_ACTION(filtersMenu, "Cone Smoothing", applyConeFilter);
+    ADD_MENU_ACTION(filtersMenu, "Custom Kernel / PSF...", applyCustomKernelFilter);
     filtersMenu->addSeparator();
 
     // Phase 13: Basic Edge Detectors  
@@ -221,6 +237,7 @@ void MainWindow::createMenuBar() {
     // Phase 16: Segmentation Menu - NEW
     QMenu *segmentMenu = menuBar->addMenu("Segmentation");
     ADD_MENU_ACTION(segmentMenu, "Thresholding...", showThresholdingDialog);
+    ADD_MENU_ACTION(segmentMenu, "Blob Analysis (Connected Components)...", analyzeBlobs);
     segmentMenu->addSeparator();
     ADD_MENU_ACTION(segmentMenu, "Region-Based Segmentation...", showAdvancedSegmentationDialog);
     segmentMenu->addSeparator();
@@ -259,6 +276,9 @@ void MainWindow::createMenuBar() {
     ADD_MENU_ACTION(distortionMenu, "Pincushion Distortion...", correctPincushion);
     ADD_MENU_ACTION(distortionMenu, "Perspective Transform...", correctPerspective);
     ADD_MENU_ACTION(distortionMenu, "Keystone Correction...", correctKeystone);
+    distortionMenu->addSeparator();
+    ADD_MENU_ACTION(distortionMenu, "Lens Profile Correction...", correctLensProfile);
+    ADD_MENU_ACTION(distortionMenu, "Undistort Folder with Lens Profile...", undistortFolderWithProfile);
     
     // View Menu - NEW
     QMenu *viewMenu = menuBar->addMenu("View");
@@ -323,8 +343,26 @@ void MainWindow::createMenuBar() {
     QAction *edgeAction = methodMenu->addAction("Edge-Based Selection");
     connect(edgeAction, &QAction::triggered, this, [this]() { setSelectionMethod(4); });
     
+    QMenu *combineMenu = selectionMenu->addMenu("Combine New Selections");
+    QActionGroup *combineGroup = new QActionGroup(this);
+    const std::pair<const char*, SelectionCombine> combineModes[] = {
+        {"Replace", SelectionCombine::Replace},
+        {"Add (Union)", SelectionCombine::Add},
+        {"Subtract", SelectionCombine::Subtract},
+        {"Intersect", SelectionCombine::Intersect}
+    };
+    for (const auto& entry : combineModes) {
+        QAction *combineAction = combineMenu->addAction(entry.first);
+        combineAction->setCheckable(true);
+        combineAction->setChecked(entry.second == selectionTool->getCombineMode());
+        combineGroup->addAction(combineAction);
+        SelectionCombine mode = entry.second;
+        connect(combineAction, &QAction::triggered, this, [this, mode]() { selectionTool->setCombineMode(mode); });
+    }
+    
     selectionMenu->addSeparator();
     ADD_MENU_ACTION(selectionMenu, "Clear Selection", clearSelection);
+    ADD_MENU_ACTION(selectionMenu, "Invert Selection", invertSelection);
     
     selectionMenu->addSeparator();
     QAction *saveSelAction = selectionMenu->addAction("Save Selection as Layer");
@@ -548,6 +586,13 @@ void MainWindow::applySimpleFilter(
 }
 
 void MainWindow::updateDisplay() {
+    // Processing paths end here, and they may have rewritten the processed
+    // image in place, so the magic wand index built from it is dropped
+    selectionTool->releaseMagicWandTree();
+    refreshDisplay();
+}
+
+void MainWindow::refreshDisplay() {
     if (imageLoaded && !originalImage.empty()) {
         originalCanvas->setImage(originalImage);
         
@@ -751,7 +796,7 @@ void MainWindow::applyWienerRestoration() {
     
     double noiseVariance = 0.01;
     
-    ImageProcessor::applyWienerFilter(currentImage, processedImage, psf, noiseVariance);
+    ImageProcessor::applyWienerFilter(currentImage, processedImage, psf, noiseVariance, &frequencyWorkspace);
     recentlyProcessed = true;
     
     if (!processedImage.empty()) {
@@ -765,19 +810,86 @@ void MainWindow::applyWienerRestoration() {
     updateStatus("Wiener restoration applied successfully!", "success");
 }
 
+// Asks for Wiener or RL-TV and runs 'restore' accordingly. The iterative
+// path shows a cancellable progress dialog; returns false when the user
+// cancelled either the choice or the deconvolution.
+static bool runRestoration(QWidget* parent, const QString& title,
+                           const std::function<ImageProcessor::DeconvolutionResult(
+                               const ImageProcessor::DeconvolutionOptions*)>& restore,
+                           QString& methodInfo) {
+    QStringList methods = {"Fast (Wiener)", "High quality (Richardson-Lucy + TV)"};
+    bool ok;
+    QString method = QInputDialog::getItem(parent, title, "Restoration method:", methods, 0, false, &ok);
+    if (!ok) return false;
+    
+    if (method == methods[0]) {
+        restore(nullptr);
+        methodInfo = "Wiener";
+        return true;
+    }
+    
+    ImageProcessor::DeconvolutionOptions options;
+    QProgressDialog progress("Deconvolving...", "Cancel", 0, options.maxIterations, parent);
+    progress.setWindowTitle(title);
+    progress.setWindowModality(Qt::WindowModal);
+    progress.setMinimumDuration(0);
+    options.progress = [&progress](int iteration, int) {
+        progress.setValue(iteration);
+        QApplication::processEvents();
+        return !progress.wasCanceled();
+    };
+    
+    ImageProcessor::DeconvolutionResult result = restore(&options);
+    progress.setValue(options.maxIterations);
+    if (result.cancelled) return false;
+    
+    methodInfo = QString("Richardson-Lucy + TV, %1 iterations%2")
+                     .arg(result.iterations)
+                     .arg(result.converged ? ", converged" : "");
+    return true;
+}
+
 void MainWindow::applyMotionBlurRestoration() {
     if (!checkImageLoaded("restore motion blur")) return;
     
+    // Prefill the parameters with a blind estimate from the image
+    int suggestedLength = 15;
+    double suggestedAngle = 45.0;
+    QString estimateInfo;
+    try {
+        ImageProcessor::MotionBlurEstimate estimate = ImageProcessor::estimateMotionBlur(currentImage);
+        suggestedLength = std::max(5, std::min(50, cvRound(estimate.length)));
+        suggestedAngle = estimate.angle;
+        estimateInfo = QString("\n(estimated %1 px at %2°, confidence %3, %4 ms)")
+                           .arg(estimate.length, 0, 'f', 1)
+                           .arg(estimate.angle, 0, 'f', 1)
+                           .arg(estimate.confidence, 0, 'f', 1)
+                           .arg(estimate.elapsedMs, 0, 'f', 0);
+    } catch (const std::exception& e) {
+        updateStatus(QString("Motion blur estimation skipped: %1").arg(e.what()), "warning");
+    }
+    
     bool ok;
     int length = QInputDialog::getInt(this, "Motion Blur Parameters", 
-                                      "Enter blur length (pixels):", 15, 5, 50, 1, &ok);
+                                      "Enter blur length (pixels):" + estimateInfo,
+                                      suggestedLength, 5, 50, 1, &ok);
     if (!ok) return;
     
     double angle = QInputDialog::getDouble(this, "Motion Blur Parameters",
-                                          "Enter blur angle (degrees):", 45, 0, 360, 1, &ok);
+                                          "Enter blur angle (degrees):" + estimateInfo,
+                                          suggestedAngle, 0, 360, 1, &ok);
     if (!ok) return;
     
-    ImageProcessor::restoreMotionBlur(currentImage, processedImage, length, angle);
+    QString methodInfo;
+    bool applied = runRestoration(this, "Motion Blur Restoration",
+        [&](const ImageProcessor::DeconvolutionOptions* highQuality) {
+            return ImageProcessor::restoreMotionBlur(currentImage, processedImage, length, angle, highQuality);
+        }, methodInfo);
+    if (!applied) {
+        processedImage.release();
+        updateStatus("Motion blur restoration cancelled", "warning");
+        return;
+    }
     recentlyProcessed = true;
     
     if (!processedImage.empty()) {
@@ -790,7 +902,7 @@ void MainWindow::applyMotionBlurRestoration() {
     }
     
     updateDisplay();
-    updateStatus("Motion blur restoration applied successfully!", "success");
+    updateStatus(QString("Motion blur restoration applied (%1)").arg(methodInfo), "success");
 }
 
 void MainWindow::applyAtmosphericRestoration() {
@@ -801,7 +913,16 @@ void MainWindow::applyAtmosphericRestoration() {
                                        "Enter turbulence parameter (k):", 0.001, 0.0001, 0.01, 4, &ok);
     if (!ok) return;
     
-    ImageProcessor::restoreAtmosphericBlur(currentImage, processedImage, k);
+    QString methodInfo;
+    bool applied = runRestoration(this, "Atmospheric Restoration",
+        [&](const ImageProcessor::DeconvolutionOptions* highQuality) {
+            return ImageProcessor::restoreAtmosphericBlur(currentImage, processedImage, k, highQuality);
+        }, methodInfo);
+    if (!applied) {
+        processedImage.release();
+        updateStatus("Atmospheric restoration cancelled", "warning");
+        return;
+    }
     recentlyProcessed = true;
     
     if (!processedImage.empty()) {
@@ -814,7 +935,7 @@ void MainWindow::applyAtmosphericRestoration() {
     }
     
     updateDisplay();
-    updateStatus("Atmospheric restoration applied successfully!", "success");
+    updateStatus(QString("Atmospheric restoration applied (%1)").arg(methodInfo), "success");
 }
 
 // ===== Distortion Correction Functions =====
@@ -847,6 +968,101 @@ void MainWindow::correctBarrel() {
     updateStatus("Barrel distortion corrected successfully!", "success");
 }
 
+// Remap tables of lens profiles persist here across sessions (LensProfile::undistort)
+static std::string lensTableCacheDir() {
+    return QDir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation))
+        .filePath("lens_tables").toStdString();
+}
+
+bool MainWindow::chooseLensProfile() {
+    QString fileName = QFileDialog::getOpenFileName(this, "Open Lens Profile", lensProfilePath,
+        "Lens Profiles (*.yml *.yaml *.json *.xml);;All Files (*)");
+    if (fileName.isEmpty()) return false;
+    lensProfilePath = fileName;
+    return true;
+}
+
+void MainWindow::correctLensProfile() {
+    if (!checkImageLoaded("correct lens distortion")) return;
+    if (!chooseLensProfile()) return;
+    
+    try {
+        LensProfile profile = LensProfile::load(lensProfilePath.toStdString());
+        const std::string tableCacheDir = lensTableCacheDir();
+        profile.undistort(currentImage, processedImage, tableCacheDir);
+        recentlyProcessed = true;
+        
+        if (!processedImage.empty()) {
+            currentImage = processedImage.clone();
+            rightSidebar->addLayer(
+                QString("Lens Correction (%1)").arg(QString::fromStdString(profile.name)),
+                "distortion", processedImage,
+                [profile, tableCacheDir](const cv::Mat& input) {
+                    cv::Mat result;
+                    profile.undistort(input, result, tableCacheDir);
+                    return result;
+                });
+            rightSidebar->updateHistogram(processedImage);
+            updateUndoButtonState();
+        }
+        
+        updateDisplay();
+        updateStatus(QString("Lens distortion corrected with profile '%1'")
+                         .arg(QString::fromStdString(profile.name)), "success");
+    } catch (const std::exception& e) {
+        updateStatus(QString("Lens correction failed: %1").arg(e.what()), "error");
+    }
+}
+
+void MainWindow::undistortFolderWithProfile() {
+    if (!chooseLensProfile()) return;
+    
+    QString inputDir = QFileDialog::getExistingDirectory(this, "Select Folder to Undistort");
+    if (inputDir.isEmpty()) return;
+    QString outputDir = QFileDialog::getExistingDirectory(this, "Select Output Folder", inputDir);
+    if (outputDir.isEmpty()) return;
+    if (QDir(inputDir) == QDir(outputDir)) {
+        updateStatus("Choose an output folder different from the input folder", "warning");
+        return;
+    }
+    
+    try {
+        LensProfile profile = LensProfile::load(lensProfilePath.toStdString());
+        
+        QProgressDialog progress("Undistorting images...", "Cancel", 0, 100, this);
+        progress.setWindowTitle("Lens Profile Correction");
+        progress.setWindowModality(Qt::WindowModal);
+        progress.setMinimumDuration(0);
+        
+        auto start = std::chrono::high_resolution_clock::now();
+        std::vector<std::string> failures;
+        int written = profile.undistortFolder(inputDir.toStdString(), outputDir.toStdString(),
+            [&progress](int done, int total) {
+                progress.setMaximum(total);
+                progress.setValue(done);
+                QApplication::processEvents();
+                return !progress.wasCanceled();
+            }, &failures, lensTableCacheDir());
+        double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+        
+        for (const std::string& failure : failures) {
+            qDebug() << "[Lens]" << QString::fromStdString(failure);
+        }
+        QString message = QString("Undistorted %1 images with '%2' in %3 s")
+                              .arg(written)
+                              .arg(QString::fromStdString(profile.name))
+                              .arg(seconds, 0, 'f', 1);
+        if (!failures.empty()) {
+            message += QString(", %1 skipped (first: %2)")
+                           .arg(failures.size())
+                           .arg(QString::fromStdString(failures.front()));
+        }
+        updateStatus(message, progress.wasCanceled() || !failures.empty() ? "warning" : "success");
+    } catch (const std::exception& e) {
+        updateStatus(QString("Batch lens correction failed: %1").arg(e.what()), "error");
+    }
+}
+
 void MainWindow::correctPincushion() {
     if (!checkImageLoaded("correct pincushion distortion")) return;
     
@@ -1201,7 +1417,10 @@ void MainWindow::applyTranslation() {
         if (!processedImage.empty()) {
             currentImage = processedImage.clone();
             rightSidebar->addLayer(QString("Translation (%1, %2)").arg(tx).arg(ty), 
-                                  "transform", processedImage, operation);
+                                  "transform", processedImage, operation,
+                                  [tx, ty](const cv::Size&, cv::Size&) {
+                                      return ImageProcessor::translationMatrix(tx, ty);
+                                  });
             rightSidebar->updateHistogram(processedImage);
             updateUndoButtonState();  // Update undo button state
         }
@@ -1246,7 +1465,10 @@ void MainWindow::applyRotation() {
         if (!processedImage.empty()) {
             currentImage = processedImage.clone();
             rightSidebar->addLayer(QString("Rotation %1°").arg(angle, 0, 'f', 1), 
-                                  "transform", processedImage, operation);
+                                  "transform", processedImage, operation,
+                                  [angle](const cv::Size& size, cv::Size&) {
+                                      return ImageProcessor::rotationMatrix(size, angle);
+                                  });
             rightSidebar->updateHistogram(processedImage);
             updateUndoButtonState();  // Update undo button state
         }
@@ -1290,7 +1512,10 @@ void MainWindow::applySkew() {
         if (!processedImage.empty()) {
             currentImage = processedImage.clone();
             rightSidebar->addLayer(QString("Skew (%.2f, %.2f)").arg(skewX).arg(skewY), 
-                                  "transform", processedImage, operation);
+                                  "transform", processedImage, operation,
+                                  [skewX, skewY](const cv::Size& size, cv::Size&) {
+                                      return ImageProcessor::skewMatrix(size, skewX, skewY);
+                                  });
             rightSidebar->updateHistogram(processedImage);
             updateUndoButtonState();  // Update undo button state
         }
@@ -1333,7 +1558,10 @@ void MainWindow::applyZoom() {
         if (!processedImage.empty()) {
             currentImage = processedImage.clone();
             rightSidebar->addLayer(QString("Zoom %1x").arg(scale, 0, 'f', 2), 
-                                  "transform", processedImage, operation);
+                                  "transform", processedImage, operation,
+                                  [scale](const cv::Size& size, cv::Size& outputSize) {
+                                      return ImageProcessor::zoomMatrix(size, scale, outputSize);
+                                  });
             rightSidebar->updateHistogram(processedImage);
             updateUndoButtonState();  // Update undo button state
         }
@@ -1391,6 +1619,9 @@ void MainWindow::showResolutionEnhancementDialog() {
             
             double scale = dialog.getScaleFactor();
             ResolutionEnhancementDialog::InterpolationMethod method = dialog.getMethod();
+            SuperResolution::Options srOptions;
+            srOptions.iterations = dialog.getIterations();
+            srOptions.tolerance = dialog.getTolerance();
             
             QString methodName;
             switch (method) {
@@ -1399,13 +1630,14 @@ void MainWindow::showResolutionEnhancementDialog() {
                 case ResolutionEnhancementDialog::Bicubic: methodName = "Bicubic"; break;
                 case ResolutionEnhancementDialog::Lanczos4: methodName = "Lanczos4"; break;
                 case ResolutionEnhancementDialog::EdgeDirected: methodName = "Edge-Directed"; break;
+                case ResolutionEnhancementDialog::BackProjection: methodName = "Back-Projection"; break;
             }
             
             rightSidebar->addLayer(
                 QString("Resolution %1x (%2)").arg(scale, 0, 'f', 2).arg(methodName),
                 "transform",
                 processedImage,
-                [scale, method](const cv::Mat& input) {
+                [scale, method, srOptions](const cv::Mat& input) {
                     cv::Mat result;
                     cv::Size newSize(
                         static_cast<int>(input.cols * scale),
@@ -1428,6 +1660,9 @@ void MainWindow::showResolutionEnhancementDialog() {
                         case ResolutionEnhancementDialog::EdgeDirected:
                             cv::resize(input, result, newSize, 0, 0, cv::INTER_LANCZOS4);
                             break;
+                        case ResolutionEnhancementDialog::BackProjection:
+                            SuperResolution::backProjectionUpscale(input, result, newSize, srOptions);
+                            break;
                     }
                     return result;
                 }
@@ -1454,7 +1689,10 @@ void MainWindow::applyFlipX() {
     
     if (!processedImage.empty()) {
         currentImage = processedImage.clone();
-        rightSidebar->addLayer("Flip Horizontal", "transform", processedImage, operation);
+        rightSidebar->addLayer("Flip Horizontal", "transform", processedImage, operation,
+                               [](const cv::Size& size, cv::Size&) {
+                                   return ImageProcessor::flipMatrix(size, 1);
+                               });
         rightSidebar->updateHistogram(processedImage);
         updateUndoButtonState();  // Update undo button state
     }
@@ -1477,7 +1715,10 @@ void MainWindow::applyFlipY() {
     
     if (!processedImage.empty()) {
         currentImage = processedImage.clone();
-        rightSidebar->addLayer("Flip Vertical", "transform", processedImage, operation);
+        rightSidebar->addLayer("Flip Vertical", "transform", processedImage, operation,
+                               [](const cv::Size& size, cv::Size&) {
+                                   return ImageProcessor::flipMatrix(size, 0);
+                               });
         rightSidebar->updateHistogram(processedImage);
         updateUndoButtonState();  // Update undo button state
     }
@@ -1500,7 +1741,10 @@ void MainWindow::applyFlipXY() {
     
     if (!processedImage.empty()) {
         currentImage = processedImage.clone();
-        rightSidebar->addLayer("Flip Both", "transform", processedImage, operation);
+        rightSidebar->addLayer("Flip Both", "transform", processedImage, operation,
+                               [](const cv::Size& size, cv::Size&) {
+                                   return ImageProcessor::flipMatrix(size, -1);
+                               });
         rightSidebar->updateHistogram(processedImage);
         updateUndoButtonState();  // Update undo button state
     }
@@ -1998,6 +2242,55 @@ void MainWindow::applyConeFilter() {
     );
 }
 
+void MainWindow::applyCustomKernelFilter() {
+    if (!checkImageLoaded("apply a custom kernel")) return;
+    
+    // The kernel (e.g. a measured PSF) comes from a grayscale image and is
+    // normalized to unit sum, so the image keeps its brightness
+    QString fileName = QFileDialog::getOpenFileName(this, "Open Kernel / PSF Image", QString(),
+        "Images (*.png *.jpg *.jpeg *.bmp *.tif *.tiff);;All Files (*)");
+    if (fileName.isEmpty()) return;
+    
+    cv::Mat kernel = cv::imread(fileName.toStdString(), cv::IMREAD_GRAYSCALE);
+    if (kernel.empty()) {
+        updateStatus("Could not read the kernel image", "error");
+        return;
+    }
+    kernel.convertTo(kernel, CV_32F);
+    double total = cv::sum(kernel)[0];
+    if (total <= 0) {
+        updateStatus("Kernel image is empty (all zero)", "error");
+        return;
+    }
+    kernel /= total;
+    
+    ImageFilters::ConvolutionReport report;
+    applySimpleFilter(
+        [&kernel, &report](const cv::Mat& src, cv::Mat& dst) {
+            ImageFilters::applyCustomKernel(src, dst, kernel, false, &report);
+        },
+        [kernel](const cv::Mat& input) {
+            cv::Mat result;
+            ImageFilters::applyCustomKernel(input, result, kernel, false);
+            return result;
+        },
+        QString("Custom Kernel %1x%2").arg(kernel.cols).arg(kernel.rows), "filter",
+        "Custom kernel applied successfully!"
+    );
+    
+    // Which strategy ran, its time and the estimates it was picked from
+    QString method = ImageFilters::methodName(report.method);
+    if (report.method == ImageFilters::ConvolutionReport::FFT_BLOCKS) {
+        method += QString(", tile %1").arg(report.fftTileSize);
+    }
+    updateStatus(QString("Custom %1x%2 kernel: %3 in %4 ms (est. MAC/px direct %5, separable %6, FFT %7)")
+        .arg(kernel.cols).arg(kernel.rows).arg(method)
+        .arg(report.elapsedMs, 0, 'f', 1)
+        .arg(report.directCost, 0, 'f', 0)
+        .arg(report.separableCost > 0 ? QString::number(report.separableCost, 'f', 0) : QString("n/a"))
+        .arg(report.fftCost, 0, 'f', 0), "success");
+}
+
 void MainWindow::applyErosion() {
     applySimpleFilter(
         [](const cv::Mat& src, cv::Mat& dst) { 
@@ -2072,7 +2365,7 @@ void MainWindow::showFFTSpectrum() {
     if (!checkImageLoaded("show FFT spectrum")) return;
     
     cv::Mat magnitude, phase;
-    ImageProcessor::applyFFT(currentImage, magnitude, phase);
+    ImageProcessor::applyFFT(currentImage, magnitude, phase, ImageProcessor::FREQ_GRAY, &frequencyWorkspace);
     
     QDialog *fftDialog = new QDialog(this);
     fftDialog->setWindowTitle("FFT Spectrum");
@@ -2110,12 +2403,12 @@ void MainWindow::showFFTSpectrum() {
 
 void MainWindow::applyLowPassFilter() {
     applySimpleFilter(
-        [](const cv::Mat& src, cv::Mat& dst) { 
-            ImageProcessor::applyLowPassFilter(src, dst, 30); 
+        [this](const cv::Mat& src, cv::Mat& dst) { 
+            ImageProcessor::applyLowPassFilter(src, dst, 30, ImageProcessor::FREQ_LUMINANCE_YCRCB, &frequencyWorkspace); 
         },
-        [](const cv::Mat& input) {
+        [this](const cv::Mat& input) {
             cv::Mat result;
-            ImageProcessor::applyLowPassFilter(input, result, 30);
+            ImageProcessor::applyLowPassFilter(input, result, 30, ImageProcessor::FREQ_LUMINANCE_YCRCB, &frequencyWorkspace);
             return result;
         },
         "Low-Pass Filter", "fft", "Low-pass filter applied successfully!"
@@ -2124,12 +2417,12 @@ void MainWindow::applyLowPassFilter() {
 
 void MainWindow::applyHighPassFilter() {
     applySimpleFilter(
-        [](const cv::Mat& src, cv::Mat& dst) { 
-            ImageProcessor::applyHighPassFilter(src, dst, 30); 
+        [this](const cv::Mat& src, cv::Mat& dst) { 
+            ImageProcessor::applyHighPassFilter(src, dst, 30, ImageProcessor::FREQ_LUMINANCE_YCRCB, &frequencyWorkspace); 
         },
-        [](const cv::Mat& input) {
+        [this](const cv::Mat& input) {
             cv::Mat result;
-            ImageProcessor::applyHighPassFilter(input, result, 30);
+            ImageProcessor::applyHighPassFilter(input, result, 30, ImageProcessor::FREQ_LUMINANCE_YCRCB, &frequencyWorkspace);
             return result;
         },
         "High-Pass Filter", "fft", "High-pass filter applied successfully!"
@@ -2621,7 +2914,7 @@ void MainWindow::toggleSelectionMode() {
         updateStatus(QString("Selection mode enabled - Method: %1")
             .arg(selectionTool->getModeName()), "success");
         
-        updateDisplay();
+        refreshDisplay();
     } else {
         // Disable mouse events on processed canvas
         processedCanvas->setMouseEventsEnabled(false);
@@ -2632,12 +2925,15 @@ void MainWindow::toggleSelectionMode() {
         disconnect(processedCanvas, &ImageCanvas::mouseReleased, this, &MainWindow::onSelectionMouseRelease);
         
         updateStatus("Selection mode disabled", "info");
-        updateDisplay();
+        refreshDisplay();
     }
 }
 
 void MainWindow::setSelectionMethod(int method) {
-    selectionTool->clearMask();
+    // Switching methods keeps the selection when new ones combine with it
+    if (selectionTool->getCombineMode() == SelectionCombine::Replace) {
+        selectionTool->clearMask();
+    }
     
     switch (method) {
         case 0: selectionTool->setMode(SelectionMode::Rectangle); break;
@@ -2653,15 +2949,21 @@ void MainWindow::setSelectionMethod(int method) {
     }
     
     updateStatus(QString("Selection method: %1").arg(selectionTool->getModeName()), "info");
-    updateDisplay();
+    refreshDisplay();
 }
 
 void MainWindow::clearSelection() {
     selectionTool->clearMask();
-    updateDisplay();
+    refreshDisplay();
     updateStatus("Selection cleared", "info");
 }
 
+void MainWindow::invertSelection() {
+    if (processedImage.empty()) return;
+    selectionTool->invertSelection(cv::Size(processedImage.cols, processedImage.rows));
+    refreshDisplay();
+}
+
 void MainWindow::applyMagicWand() {
     if (!imageLoaded) {
         QMessageBox::information(this, "Magic Wand",
@@ -2748,7 +3050,7 @@ void MainWindow::loadSelectionFromLayer(int layerIndex) {
     }
     
     updateStatus(QString("Selection loaded from layer: %1").arg(layer.name), "success");
-    updateDisplay();
+    refreshDisplay();
 }
 
 void MainWindow::onSelectionMousePress(const QPoint& pos) {
@@ -2768,15 +3070,26 @@ void MainWindow::onSelectionMousePress(const QPoint& pos) {
             break;
             
         case SelectionMode::MagicWand: {
-            bool ok;
-            int tolerance = QInputDialog::getInt(this, "Magic Wand Tolerance",
-                "Enter color tolerance (0-255):", 30, 0, 255, 1, &ok);
-            if (ok) {
-                qDebug() << "Calling magicWandSelect with image size:" << processedImage.cols << "x" << processedImage.rows;
-                selectionTool->magicWandSelect(processedImage, pos, tolerance);
+            // Select at the last tolerance right away, then tune it live
+            PackedMask previousSelection = selectionTool->getSelection();
+            qDebug() << "Calling magicWandSelect with image size:" << processedImage.cols << "x" << processedImage.rows;
+            if (!selectionTool->magicWandBuildsTree(processedImage)) {
+                selectionTool->magicWandSelect(processedImage, pos, selectionTool->getMagicWandTolerance());
+            } else {
+                // The first click on an image indexes all of it, which takes seconds on large images
+                updateStatus("Magic wand: indexing the image...", "info");
+                statusLabel->repaint();
+                QApplication::setOverrideCursor(Qt::WaitCursor);
+                selectionTool->magicWandSelect(processedImage, pos, selectionTool->getMagicWandTolerance());
+                QApplication::restoreOverrideCursor();
+            }
+            if (chooseMagicWandTolerance()) {
                 qDebug() << "Has mask after magic wand:" << selectionTool->hasMask();
                 updateStatus(QString("Magic wand selected at (%1, %2) with tolerance %3")
-                    .arg(pos.x()).arg(pos.y()).arg(tolerance), "success");
+                    .arg(pos.x()).arg(pos.y()).arg(selectionTool->getMagicWandTolerance()), "success");
+            } else {
+                selectionTool->setSelection(previousSelection);
+                refreshDisplay();
             }
             break;
         }
@@ -2793,6 +3106,48 @@ void MainWindow::onSelectionMousePress(const QPoint& pos) {
     }
 }
 
+bool MainWindow::chooseMagicWandTolerance() {
+    QDialog dialog(this);
+    dialog.setWindowTitle("Magic Wand Tolerance");
+    
+    QVBoxLayout *layout = new QVBoxLayout(&dialog);
+    layout->addWidget(new QLabel("Color tolerance (0-255), the selection follows the slider:"));
+    
+    QSlider *slider = new QSlider(Qt::Horizontal);
+    slider->setRange(0, 255);
+    slider->setValue(selectionTool->getMagicWandTolerance());
+    QSpinBox *spin = new QSpinBox();
+    spin->setRange(0, 255);
+    spin->setValue(slider->value());
+    
+    QHBoxLayout *valueLayout = new QHBoxLayout();
+    valueLayout->addWidget(slider);
+    valueLayout->addWidget(spin);
+    layout->addLayout(valueLayout);
+    
+    // Each step only re-selects in the cached component tree (or flood
+    // fills again on images too large for one)
+    connect(slider, &QSlider::valueChanged, &dialog, [this, spin](int value) {
+        spin->setValue(value);
+        selectionTool->setMagicWandTolerance(value, processedImage);
+    });
+    connect(spin, QOverload<int>::of(&QSpinBox::valueChanged), slider, &QSlider::setValue);
+    
+    QPushButton *okBtn = new QPushButton("OK");
+    okBtn->setProperty("class", "accent");
+    QPushButton *cancelBtn = new QPushButton("Cancel");
+    connect(okBtn, &QPushButton::clicked, &dialog, &QDialog::accept);
+    connect(cancelBtn, &QPushButton::clicked, &dialog, &QDialog::reject);
+    
+    QHBoxLayout *btnLayout = new QHBoxLayout();
+    btnLayout->addStretch();
+    btnLayout->addWidget(okBtn);
+    btnLayout->addWidget(cancelBtn);
+    layout->addLayout(btnLayout);
+    
+    return dialog.exec() == QDialog::Accepted;
+}
+
 void MainWindow::onSelectionMouseMove(const QPoint& pos) {
     if (!selectionMode || !imageLoaded) return;
     
@@ -2821,7 +3176,7 @@ void MainWindow::onSelectionMouseRelease(const QPoint& pos) {
 
 void MainWindow::onSelectionUpdated() {
     if (!imageLoaded || !selectionMode) return;
-    updateDisplay();
+    refreshDisplay();
 }
 
 void MainWindow::onSelectionCompleted() {
@@ -2830,7 +3185,7 @@ void MainWindow::onSelectionCompleted() {
     QString modeName = selectionTool->getModeName();
     updateStatus(QString("%1 selection completed! Apply filters to process selected area only.")
         .arg(modeName), "success");
-    updateDisplay();
+    refreshDisplay();
 }
 
 // ============================================================================
@@ -3366,6 +3721,191 @@ void MainWindow::showThresholdingDialog() {
     }
 }
 
+// Labels 'input' and renders the blobs in pseudo-color with their moment
+// ellipses. With labelImage the input (single-channel 16U/32S) is a label
+// image and passes through unchanged; otherwise it is reduced to 8-bit gray,
+// which is used as is when already binary and Otsu-split otherwise.
+static cv::Mat renderBlobs(const cv::Mat& input, const ConnectedComponents::Options& options,
+                           bool labelImage, ConnectedComponents::Result* details = nullptr) {
+    cv::Mat gray;
+    if (labelImage) {
+        if (input.channels() != 1 || (input.depth() != CV_16U && input.depth() != CV_32S)) {
+            throw std::runtime_error("A label image must be single-channel 16-bit or 32-bit integer");
+        }
+        gray = input;
+    } else {
+        if (input.channels() == 4) {
+            cv::cvtColor(input, gray, cv::COLOR_BGRA2GRAY);
+        } else if (input.channels() == 3) {
+            cv::cvtColor(input, gray, cv::COLOR_BGR2GRAY);
+        } else {
+            gray = input;
+        }
+        
+        // Otsu only accepts 8-bit input, so other depths are stretched first
+        if (gray.depth() != CV_8U) {
+            cv::Mat stretched;
+            cv::normalize(gray, stretched, 0, 255, cv::NORM_MINMAX, CV_8U);
+            gray = stretched;
+        }
+        
+        double maxValue = 0.0;
+        cv::minMaxLoc(gray, nullptr, &maxValue);
+        if (cv::countNonZero((gray != 0) & (gray != maxValue)) > 0) {
+            cv::threshold(gray, gray, 0, 255, cv::THRESH_BINARY | cv::THRESH_OTSU);
+        }
+    }
+    
+    ConnectedComponents::Result result = ConnectedComponents::analyze(gray, options);
+    cv::Mat rendered;
+    ConnectedComponents::colorize(result.labels, rendered);
+    
+    // Outlines only help while they stay readable
+    if (result.blobs.size() <= 5000) {
+        for (const ConnectedComponents::Blob& blob : result.blobs) {
+            if (blob.ellipse.size.width >= 3.0f) {
+                cv::ellipse(rendered, blob.ellipse, cv::Scalar(255, 255, 255), 1, cv::LINE_AA);
+            }
+        }
+    }
+    
+    if (details) {
+        *details = std::move(result);
+    }
+    return rendered;
+}
+
+void MainWindow::analyzeBlobs() {
+    if (!checkImageLoaded("analyze blobs")) return;
+    
+    QStringList connectivities = {"8-connected", "4-connected"};
+    bool ok;
+    QString connectivity = QInputDialog::getItem(this, "Blob Analysis", "Connectivity:",
+                                                 connectivities, 0, false, &ok);
+    if (!ok) return;
+    
+    int minArea = QInputDialog::getInt(this, "Blob Analysis",
+                                       "Minimum blob area (pixels):", 1, 1, 100000000, 1, &ok);
+    if (!ok) return;
+    
+    int maxArea = QInputDialog::getInt(this, "Blob Analysis",
+                                       "Maximum blob area (pixels, 0 = no limit):", 0, 0, 100000000, 1, &ok);
+    if (!ok) return;
+    
+    ConnectedComponents::Options options;
+    options.connectivity = (connectivity == connectivities[1]) ? 4 : 8;
+    options.minArea = minArea;
+    options.maxArea = maxArea;
+    
+    // Integer images may hold labels or intensities; only the user knows which
+    bool labelImage = false;
+    if (currentImage.channels() == 1 && (currentImage.depth() == CV_16U || currentImage.depth() == CV_32S)) {
+        labelImage = QMessageBox::question(this, "Blob Analysis",
+                                           "Is this a label image (each value marks one region)?\n"
+                                           "Choose No to threshold it as intensities.")
+                     == QMessageBox::Yes;
+    }
+    
+    try {
+        ConnectedComponents::Result result;
+        processedImage = renderBlobs(currentImage, options, labelImage, &result);
+        recentlyProcessed = true;
+        
+        if (!processedImage.empty()) {
+            currentImage = processedImage.clone();
+            rightSidebar->addLayer(
+                QString("Blob Analysis (%1 blobs)").arg(result.blobs.size()),
+                "segmentation", processedImage,
+                [options, labelImage](const cv::Mat& input) {
+                    return renderBlobs(input, options, labelImage);
+                });
+            rightSidebar->updateHistogram(processedImage);
+            updateUndoButtonState();
+        }
+        
+        updateDisplay();
+        updateStatus(QString("%1 blobs (%2 components before size filter): labeled in %3 ms, measured in %4 ms")
+                         .arg(result.blobs.size())
+                         .arg(result.componentCount)
+                         .arg(result.labelMs, 0, 'f', 1)
+                         .arg(result.statsMs, 0, 'f', 1), "success");
+        
+        if (!result.blobs.empty() &&
+            QMessageBox::question(this, "Blob Analysis",
+                                  QString("Export the measurements of %1 blobs to CSV?").arg(result.blobs.size()))
+                == QMessageBox::Yes) {
+            QString fileName = QFileDialog::getSaveFileName(this, "Export Blob Measurements", "",
+                                                            "CSV Files (*.csv);;All Files (*)");
+            if (!fileName.isEmpty()) {
+                if (ConnectedComponents::writeCsv(fileName.toStdString(), result.blobs)) {
+                    updateStatus(QString("Blob measurements exported to %1").arg(fileName), "success");
+                } else {
+                    updateStatus("Failed to export blob measurements", "error");
+                }
+            }
+        }
+    } catch (const std::exception& e) {
+        updateStatus(QString("Blob analysis failed: %1").arg(e.what()), "error");
+    }
+}
+
+void MainWindow::registerSecondImage() {
+    if (!checkImageLoaded("register a second image")) return;
+    
+    QString fileName = QFileDialog::getOpenFileName(this,
+        "Select Image to Align",
+        "",
+        "Images (*.png *.jpg *.jpeg *.bmp *.tiff *.tif)");
+    if (fileName.isEmpty()) return;
+    
+    cv::Mat moving = cv::imread(fileName.toStdString());
+    if (moving.empty()) {
+        updateStatus("Failed to load the image to align", "error");
+        return;
+    }
+    
+    bool ok;
+    int maxFeatures = QInputDialog::getInt(this, "Feature Registration",
+                                           "ORB features per image:", 5000, 500, 50000, 500, &ok);
+    if (!ok) return;
+    
+    ImageRegistration::Options options;
+    options.maxFeatures = maxFeatures;
+    
+    try {
+        // The original image is the reference, so the metrics compare the
+        // aligned shot against it directly
+        ImageRegistration::Report report;
+        cv::Mat aligned;
+        if (!ImageRegistration::align(originalImage, moving, aligned, options, &report)) {
+            updateStatus(QString("Registration failed: %1 matches, only %2 consistent")
+                             .arg(report.matches)
+                             .arg(report.inliers), "warning");
+            return;
+        }
+        
+        processedImage = aligned;
+        recentlyProcessed = true;
+        currentImage = processedImage.clone();
+        rightSidebar->addLayer(
+            QString("Registered: %1").arg(QFileInfo(fileName).fileName()),
+            "transform", processedImage, nullptr);
+        rightSidebar->updateHistogram(processedImage);
+        updateUndoButtonState();
+        updateDisplay();
+        
+        updateStatus(QString("Aligned with %1 of %2 matches - detect %3 ms, match %4 ms, RANSAC %5 ms (%6 hypotheses)")
+                         .arg(report.inliers)
+                         .arg(report.matches)
+                         .arg(report.detectMs, 0, 'f', 1)
+                         .arg(report.matchMs, 0, 'f', 1)
+                         .arg(report.ransacMs, 0, 'f', 1)
+                         .arg(report.iterations), "success");
+    } catch (const std::exception& e) {
+        updateStatus(QString("Registration failed: %1").arg(e.what()), "error");
+    }
+}
+
 // ============================================================================
 // PHASE 17: ADVANCED SEGMENTATION - REGION-BASED
 // ============================================================================
@@ -191,8 +191,9 @@ void RightSidebarWidget::updateHistogram(const cv::Mat& image) {
 }
 
 void RightSidebarWidget::addLayer(const QString& name, const QString& type, const cv::Mat& image,
-                                   std::function<cv::Mat(const cv::Mat&)> operation) {
-    layerManager->addLayer(name, type, image, operation);
+                                   std::function<cv::Mat(const cv::Mat&)> operation,
+                                   LayerGeometry geometry) {
+    layerManager->addLayer(name, type, image, operation, geometry);
     updateLayersList();
 }
 
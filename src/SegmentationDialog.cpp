@@ -1,10 +1,18 @@
 #include "SegmentationDialog.h"
 #include "Theme.h"
+#include "color/ColorQuantizer.h"
+#include "segmentation/MeanShiftFilter.h"
 #include <QVBoxLayout>
 #include <QHBoxLayout>
 #include <QGroupBox>
 #include <QMessageBox>
 #include <QStackedWidget>
+#include <QTableWidget>
+#include <QHeaderView>
+#include <QFileDialog>
+#include <QProgressDialog>
+#include <QApplication>
+#include <chrono>
 
 SegmentationDialog::SegmentationDialog(const cv::Mat& image, QWidget *parent)
     : QDialog(parent), inputImage(image.clone()), applied(false) {
@@ -91,7 +99,7 @@ void SegmentationDialog::setupUI() {
     QLabel* clustersLabel = new QLabel("Number of Clusters (K):");
     clustersLabel->setStyleSheet("color: #c4b5fd;");
     kmeansClustersSpin = new QSpinBox();
-    kmeansClustersSpin->setRange(2, 20);
+    kmeansClustersSpin->setRange(2, 64);
     kmeansClustersSpin->setValue(3);
     connect(kmeansClustersSpin, QOverload<int>::of(&QSpinBox::valueChanged),
             this, &SegmentationDialog::onParameterChanged);
@@ -183,10 +191,19 @@ void SegmentationDialog::setupUI() {
     grabCutIterLayout->addStretch();
     grabCutLayout->addLayout(grabCutIterLayout);
     
+    grabCutCoarseCheck = new QCheckBox("Coarse-to-fine (fast on large images)");
+    grabCutCoarseCheck->setStyleSheet("color: #c4b5fd;");
+    grabCutCoarseCheck->setChecked(true);
+    connect(grabCutCoarseCheck, &QCheckBox::toggled,
+            this, &SegmentationDialog::onParameterChanged);
+    grabCutLayout->addWidget(grabCutCoarseCheck);
+    
     QLabel* grabCutInfo = new QLabel(
         "GrabCut extracts foreground from background.\n"
         "Uses center 80% as foreground region automatically.\n"
-        "More iterations = better refinement (slower)."
+        "More iterations = better refinement (slower).\n"
+        "Coarse-to-fine iterates on a reduced copy and re-solves only\n"
+        "a narrow band around the boundary at full resolution."
     );
     grabCutInfo->setStyleSheet("color: #a78bfa; font-size: 9pt; padding: 10px;");
     grabCutLayout->addWidget(grabCutInfo);
@@ -260,6 +277,12 @@ void SegmentationDialog::setupUI() {
     
     // Buttons
     QHBoxLayout* buttonLayout = new QHBoxLayout();
+    statsButton = new QPushButton("Region Statistics...");
+    statsButton->setMinimumWidth(140);
+    statsButton->setEnabled(false);
+    connect(statsButton, &QPushButton::clicked, this, [this]() { showRegionStatistics(); });
+    buttonLayout->addWidget(statsButton);
+    
     buttonLayout->addStretch();
     
     resetButton = new QPushButton("Reset");
@@ -291,6 +314,7 @@ void SegmentationDialog::onParameterChanged() {
 
 void SegmentationDialog::updatePreview() {
     int method = methodCombo->currentIndex();
+    regionTable = RegionStatistics::Table();
     
     try {
         switch (method) {
@@ -309,7 +333,11 @@ void SegmentationDialog::updatePreview() {
     } catch (const cv::Exception& e) {
         infoLabel->setText(QString("Error: %1").arg(e.what()));
         infoLabel->setStyleSheet("color: #ff6b6b; padding: 5px;");
+    } catch (const std::exception& e) {
+        infoLabel->setText(QString("Error: %1").arg(e.what()));
+        infoLabel->setStyleSheet("color: #ff6b6b; padding: 5px;");
     }
+    statsButton->setEnabled(!regionTable.regions.empty());
 }
 
 void SegmentationDialog::applyWatershed() {
@@ -375,39 +403,10 @@ void SegmentationDialog::applyWatershed() {
     // Apply watershed
     cv::watershed(inputCopy, markers32s);
     
-    // Create colored output
-    previewImage = cv::Mat::zeros(markers32s.size(), CV_8UC3);
-    
-    // Find unique labels
-    double minVal, maxVal;
-    cv::minMaxLoc(markers32s, &minVal, &maxVal);
-    int numLabels = static_cast<int>(maxVal);
-    
-    // Generate random colors for each label
-    std::vector<cv::Vec3b> colors(numLabels + 1);
-    colors[0] = cv::Vec3b(0, 0, 0); // Background
-    colors[1] = cv::Vec3b(128, 128, 128); // Sure background
-    
-    for (int i = 2; i <= numLabels; i++) {
-        colors[i] = cv::Vec3b(
-            (i * 50) % 256,
-            (i * 100) % 256,
-            (i * 150) % 256
-        );
-    }
-    
-    // Color the regions
-    for (int i = 0; i < markers32s.rows; i++) {
-        for (int j = 0; j < markers32s.cols; j++) {
-            int label = markers32s.at<int>(i, j);
-            if (label == -1) {
-                // Boundary
-                previewImage.at<cv::Vec3b>(i, j) = cv::Vec3b(0, 255, 0);
-            } else if (label >= 0 && label <= numLabels) {
-                previewImage.at<cv::Vec3b>(i, j) = colors[label];
-            }
-        }
-    }
+    // Paint each basin with its mean color, boundaries in green
+    regionTable = RegionStatistics::compute(markers32s, inputCopy);
+    RegionStatistics::paintMeans(markers32s, regionTable, previewImage);
+    int numLabels = static_cast<int>(regionTable.regions.size());
     
     segmentationType = QString("Watershed (%1 regions)").arg(numLabels);
     infoLabel->setText(QString("Watershed segmentation: %1 regions found (Threshold: %2%)")
@@ -417,38 +416,20 @@ void SegmentationDialog::applyWatershed() {
 
 void SegmentationDialog::applyKMeans() {
     int k = kmeansClustersSpin->value();
-    int iterations = kmeansIterationsSpin->value();
-    
-    cv::Mat data;
-    inputImage.reshape(1, inputImage.rows * inputImage.cols).convertTo(data, CV_32F);
-    
-    cv::Mat labels, centers;
-    cv::kmeans(data, k, labels,
-               cv::TermCriteria(cv::TermCriteria::EPS + cv::TermCriteria::MAX_ITER, iterations, 1.0),
-               3, cv::KMEANS_PP_CENTERS, centers);
-    
-    // Reconstruct image
-    centers.convertTo(centers, CV_8U);
-    previewImage = cv::Mat::zeros(inputImage.size(), inputImage.type());
     
-    for (int i = 0; i < inputImage.rows * inputImage.cols; i++) {
-        int clusterIdx = labels.at<int>(i);
-        int row = i / inputImage.cols;
-        int col = i % inputImage.cols;
-        
-        if (inputImage.channels() == 1) {
-            previewImage.at<uchar>(row, col) = centers.at<uchar>(clusterIdx);
-        } else {
-            previewImage.at<cv::Vec3b>(row, col) = cv::Vec3b(
-                centers.at<uchar>(clusterIdx, 0),
-                centers.at<uchar>(clusterIdx, 1),
-                centers.at<uchar>(clusterIdx, 2)
-            );
-        }
-    }
+    // Clusters the compressed color histogram rather than every pixel
+    ColorQuantizer::Options options;
+    options.maxIterations = kmeansIterationsSpin->value();
+    cv::Mat labels;
+    ColorQuantizer::Result result = ColorQuantizer::kmeans(inputImage, previewImage, k, options, &labels);
+    regionTable = RegionStatistics::compute(labels, inputImage);
     
     segmentationType = QString("K-Means (K=%1)").arg(k);
-    infoLabel->setText(QString("K-Means clustering: %1 clusters, %2 iterations").arg(k).arg(iterations));
+    infoLabel->setText(QString("K-Means clustering: %1 clusters, %2 iterations over %3 colors "
+                               "(histogram %4 ms, clustering %5 ms, recolor %6 ms)")
+        .arg(result.centers.rows).arg(result.iterations).arg(result.histogramColors)
+        .arg(result.histogramMs, 0, 'f', 1).arg(result.clusterMs, 0, 'f', 1)
+        .arg(result.recolorMs, 0, 'f', 1));
     infoLabel->setStyleSheet("color: #a78bfa; padding: 5px;");
 }
 
@@ -456,15 +437,44 @@ void SegmentationDialog::applyMeanShift() {
     int sp = spatialRadiusSpin->value();
     int sr = colorRadiusSpin->value();
     
-    cv::Mat inputCopy = inputImage.clone();
-    if (inputCopy.channels() == 1) {
-        cv::cvtColor(inputCopy, inputCopy, cv::COLOR_GRAY2BGR);
+    // The filter never writes into its source, so BGR input is used as is
+    cv::Mat inputCopy = inputImage;
+    if (inputImage.channels() == 1) {
+        cv::cvtColor(inputImage, inputCopy, cv::COLOR_GRAY2BGR);
+    } else if (inputImage.channels() == 4) {
+        cv::cvtColor(inputImage, inputCopy, cv::COLOR_BGRA2BGR);
     }
     
-    cv::pyrMeanShiftFiltering(inputCopy, previewImage, sp, sr);
+    MeanShiftFilter::Options options;
+    options.spatialRadius = sp;
+    options.colorRadius = sr;
+    
+    // Only shown when a run takes noticeably long; cancelling keeps the old preview
+    QProgressDialog progress("Mean shift filtering...", "Cancel", 0, 100, this);
+    progress.setWindowTitle("Mean Shift Segmentation");
+    progress.setWindowModality(Qt::WindowModal);
+    progress.setMinimumDuration(500);
+    
+    MeanShiftFilter::Report report;
+    cv::Mat filtered;
+    bool finished = MeanShiftFilter::filter(inputCopy, filtered, options,
+        [&progress](int done, int total) {
+            progress.setMaximum(total);
+            progress.setValue(done);
+            QApplication::processEvents();
+            return !progress.wasCanceled();
+        }, &report);
+    
+    if (!finished) {
+        infoLabel->setText(QString("Mean Shift cancelled after %1 of %2 tiles").arg(report.tilesDone).arg(report.tiles));
+        infoLabel->setStyleSheet("color: #fbbf24; padding: 5px;");
+        return;
+    }
+    previewImage = filtered;
     
     segmentationType = QString("Mean Shift (sp=%1,sr=%2)").arg(sp).arg(sr);
-    infoLabel->setText(QString("Mean Shift: Spatial=%1, Color=%2").arg(sp).arg(sr));
+    infoLabel->setText(QString("Mean Shift: Spatial=%1, Color=%2 (%3 tiles, %4 ms)")
+        .arg(sp).arg(sr).arg(report.tiles).arg(report.elapsedMs, 0, 'f', 0));
     infoLabel->setStyleSheet("color: #a78bfa; padding: 5px;");
 }
 
@@ -482,19 +492,55 @@ void SegmentationDialog::applyGrabCut() {
                   inputCopy.cols - 2 * margin, 
                   inputCopy.rows - 2 * margin);
     
-    cv::Mat mask, bgModel, fgModel;
-    cv::grabCut(inputCopy, mask, rect, bgModel, fgModel, iterations, cv::GC_INIT_WITH_RECT);
+    bool coarseToFine = grabCutCoarseCheck->isChecked();
+    cv::Mat mask;
+    QString details;
+    if (coarseToFine) {
+        // The input never changes while the dialog is open, so the cached
+        // models stay valid until it closes
+        if (!grabCutEngine.hasImage()) {
+            grabCutEngine.setImage(inputCopy, rect);
+        }
+        CoarseToFineGrabCut::Report report;
+        grabCutEngine.segment(iterations, mask, &report);
+        details = QString("coarse-to-fine, level %1, %2 ms (%3 new iterations, refined band %4% in %5 tiles)")
+            .arg(report.level).arg(report.totalMs, 0, 'f', 0)
+            .arg(iterations - report.cachedIterations)
+            .arg(report.bandFraction * 100.0, 0, 'f', 1).arg(report.tilesRefined);
+    } else {
+        auto start = std::chrono::high_resolution_clock::now();
+        cv::Mat bgModel, fgModel;
+        cv::grabCut(inputCopy, mask, rect, bgModel, fgModel, iterations, cv::GC_INIT_WITH_RECT);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+        details = QString("full resolution, %1 ms").arg(ms, 0, 'f', 0);
+    }
     
     // Create binary mask
     cv::Mat binMask = (mask == cv::GC_FGD) | (mask == cv::GC_PR_FGD);
-    binMask.convertTo(binMask, CV_8U, 255);
+    
+    // Boundary agreement with the other mode at the same iteration count
+    const int tolerance = 3;
+    if (!lastGrabCutMask.empty() && lastGrabCutCoarse != coarseToFine && lastGrabCutIterations == iterations) {
+        double score = CoarseToFineGrabCut::boundaryFScore(binMask, lastGrabCutMask, tolerance);
+        details += QString(", boundary F-score vs %1: %2 at %3 px")
+            .arg(lastGrabCutCoarse ? "coarse-to-fine" : "full resolution")
+            .arg(score, 0, 'f', 3).arg(tolerance);
+    }
+    lastGrabCutMask = binMask;
+    lastGrabCutCoarse = coarseToFine;
+    lastGrabCutIterations = iterations;
+    
+    // Label 0 = background, 1 = foreground
+    cv::Mat labels;
+    binMask.convertTo(labels, CV_32S, 1.0 / 255.0);
+    regionTable = RegionStatistics::compute(labels, inputCopy);
     
     // Apply mask
     previewImage = cv::Mat::zeros(inputCopy.size(), inputCopy.type());
     inputCopy.copyTo(previewImage, binMask);
     
     segmentationType = QString("GrabCut (iter=%1)").arg(iterations);
-    infoLabel->setText(QString("GrabCut foreground extraction: %1 iterations").arg(iterations));
+    infoLabel->setText(QString("GrabCut foreground extraction: %1 iterations (%2)").arg(iterations).arg(details));
     infoLabel->setStyleSheet("color: #a78bfa; padding: 5px;");
 }
 
@@ -517,31 +563,8 @@ void SegmentationDialog::applySuperpixelSLIC() {
     slic->getLabels(labels);
     
     // Color each superpixel with average color
-    int numLabels = slic->getNumberOfSuperpixels();
-    std::vector<cv::Vec3d> sums(numLabels, cv::Vec3d(0, 0, 0));
-    std::vector<int> counts(numLabels, 0);
-    
-    for (int i = 0; i < labels.rows; i++) {
-        for (int j = 0; j < labels.cols; j++) {
-            int label = labels.at<int>(i, j);
-            cv::Vec3b color = inputCopy.at<cv::Vec3b>(i, j);
-            sums[label] += cv::Vec3d(color[0], color[1], color[2]);
-            counts[label]++;
-        }
-    }
-    
-    previewImage = cv::Mat::zeros(inputCopy.size(), CV_8UC3);
-    for (int i = 0; i < labels.rows; i++) {
-        for (int j = 0; j < labels.cols; j++) {
-            int label = labels.at<int>(i, j);
-            cv::Vec3d avg = sums[label] / counts[label];
-            previewImage.at<cv::Vec3b>(i, j) = cv::Vec3b(
-                static_cast<uchar>(avg[0]),
-                static_cast<uchar>(avg[1]),
-                static_cast<uchar>(avg[2])
-            );
-        }
-    }
+    regionTable = RegionStatistics::compute(labels, inputCopy);
+    RegionStatistics::paintMeans(labels, regionTable, previewImage);
     
     // Draw contours
     cv::Mat mask;
@@ -564,29 +587,19 @@ void SegmentationDialog::applySuperpixelSLIC() {
     int gridSize = static_cast<int>(std::sqrt(inputCopy.rows * inputCopy.cols / static_cast<double>(regions)));
     if (gridSize < 1) gridSize = 1;
     
-    previewImage = inputCopy.clone();
-    
-    // Draw grid lines
-    for (int y = 0; y < inputCopy.rows; y += gridSize) {
-        cv::line(previewImage, cv::Point(0, y), cv::Point(inputCopy.cols, y), cv::Scalar(0, 255, 0), 1);
-    }
-    for (int x = 0; x < inputCopy.cols; x += gridSize) {
-        cv::line(previewImage, cv::Point(x, 0), cv::Point(x, inputCopy.rows), cv::Scalar(0, 255, 0), 1);
-    }
-    
-    // Average colors in each grid cell
-    for (int y = 0; y < inputCopy.rows; y += gridSize) {
-        for (int x = 0; x < inputCopy.cols; x += gridSize) {
-            int endY = std::min(y + gridSize, inputCopy.rows);
-            int endX = std::min(x + gridSize, inputCopy.cols);
-            
-            cv::Rect roi(x, y, endX - x, endY - y);
-            cv::Scalar avgColor = cv::mean(inputCopy(roi));
-            previewImage(roi).setTo(avgColor);
+    // Grid cells as a label map, painted with their average colors
+    int cellsPerRow = (inputCopy.cols + gridSize - 1) / gridSize;
+    cv::Mat labels(inputCopy.size(), CV_32S);
+    for (int y = 0; y < labels.rows; y++) {
+        int* row = labels.ptr<int>(y);
+        for (int x = 0; x < labels.cols; x++) {
+            row[x] = (y / gridSize) * cellsPerRow + x / gridSize;
         }
     }
+    regionTable = RegionStatistics::compute(labels, inputCopy);
+    RegionStatistics::paintMeans(labels, regionTable, previewImage);
     
-    // Redraw grid
+    // Draw grid
     for (int y = 0; y < inputCopy.rows; y += gridSize) {
         cv::line(previewImage, cv::Point(0, y), cv::Point(inputCopy.cols, y), cv::Scalar(0, 255, 0), 1);
     }
@@ -594,13 +607,117 @@ void SegmentationDialog::applySuperpixelSLIC() {
         cv::line(previewImage, cv::Point(x, 0), cv::Point(x, inputCopy.rows), cv::Scalar(0, 255, 0), 1);
     }
     
-    int actualRegions = (inputCopy.rows / gridSize + 1) * (inputCopy.cols / gridSize + 1);
+    int actualRegions = static_cast<int>(regionTable.regions.size());
     segmentationType = QString("Grid Superpixels (regions?%1)").arg(actualRegions);
     infoLabel->setText(QString("Grid-based superpixels (OpenCV ximgproc not available): %1 regions").arg(actualRegions));
     infoLabel->setStyleSheet("color: #fbbf24; padding: 5px;");
 #endif
 }
 
+void SegmentationDialog::showRegionStatistics() {
+    if (regionTable.regions.empty()) return;
+    
+    // Large label maps (connected components on noise) are listed in part;
+    // the CSV export always holds every region
+    const int maxRows = 5000;
+    const int rowCount = std::min(maxRows, static_cast<int>(regionTable.regions.size()));
+    const int channels = regionTable.channels;
+    
+    QDialog dialog(this);
+    dialog.setWindowTitle("Region Statistics - " + segmentationType);
+    dialog.resize(900, 500);
+    QVBoxLayout* layout = new QVBoxLayout(&dialog);
+    
+    QLabel* summary = new QLabel(QString("%1 regions (statistics computed in %2 ms)%3")
+        .arg(regionTable.regions.size()).arg(regionTable.elapsedMs, 0, 'f', 1)
+        .arg(rowCount < static_cast<int>(regionTable.regions.size())
+             ? QString(", first %1 shown").arg(rowCount) : QString()));
+    summary->setStyleSheet("color: #c4b5fd; padding: 5px 15px; font-size: 10pt;");
+    layout->addWidget(summary);
+    
+    QStringList headers;
+    headers << "Label" << "Area" << "Bounding Box" << "Centroid";
+    static const char* channelNames[] = {"B", "G", "R", "A"};
+    for (int c = 0; c < channels; c++) {
+        headers << (channels > 1 ? QString("Mean %1").arg(channelNames[c]) : QString("Mean"));
+    }
+    for (int c = 0; c < channels; c++) {
+        headers << (channels > 1 ? QString("Std Dev %1").arg(channelNames[c]) : QString("Std Dev"));
+    }
+    headers << "Neighbors";
+    
+    QTableWidget* table = new QTableWidget(rowCount, headers.size(), &dialog);
+    table->setHorizontalHeaderLabels(headers);
+    table->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    table->verticalHeader()->setVisible(false);
+    table->setStyleSheet(
+        "QTableWidget {"
+        "    background-color: rgba(45, 37, 71, 0.5);"
+        "    color: #f3e8ff;"
+        "    border: 2px solid rgba(91, 75, 115, 0.5);"
+        "    border-radius: 10px;"
+        "    gridline-color: rgba(232, 121, 249, 0.2);"
+        "}"
+        "QHeaderView::section {"
+        "    background-color: rgba(91, 75, 115, 0.6);"
+        "    color: #e879f9;"
+        "    padding: 10px;"
+        "    border: none;"
+        "    font-weight: bold;"
+        "}"
+    );
+    
+    for (int i = 0; i < rowCount; i++) {
+        const RegionStatistics::Region& region = regionTable.regions[i];
+        int col = 0;
+        table->setItem(i, col++, new QTableWidgetItem(QString::number(region.label)));
+        table->setItem(i, col++, new QTableWidgetItem(QString::number(region.area)));
+        table->setItem(i, col++, new QTableWidgetItem(QString("%1, %2  %3x%4")
+            .arg(region.bounds.x).arg(region.bounds.y).arg(region.bounds.width).arg(region.bounds.height)));
+        table->setItem(i, col++, new QTableWidgetItem(QString("%1, %2")
+            .arg(region.centroid.x, 0, 'f', 1).arg(region.centroid.y, 0, 'f', 1)));
+        for (int c = 0; c < channels; c++) {
+            table->setItem(i, col++, new QTableWidgetItem(QString::number(region.mean[c], 'f', 2)));
+        }
+        for (int c = 0; c < channels; c++) {
+            table->setItem(i, col++, new QTableWidgetItem(QString::number(std::sqrt(region.variance[c]), 'f', 2)));
+        }
+        table->setItem(i, col++, new QTableWidgetItem(QString::number(region.neighbors.size())));
+    }
+    table->resizeColumnsToContents();
+    layout->addWidget(table);
+    
+    QHBoxLayout* buttons = new QHBoxLayout();
+    buttons->addStretch();
+    QPushButton* exportButton = new QPushButton("Export CSV");
+    exportButton->setMinimumWidth(100);
+    connect(exportButton, &QPushButton::clicked, &dialog, [this, &dialog]() {
+        QString filename = QFileDialog::getSaveFileName(&dialog,
+            "Export Region Statistics",
+            "",
+            "CSV Files (*.csv);;All Files (*)");
+        if (filename.isEmpty()) return;
+        
+        if (RegionStatistics::writeCsv(filename.toStdString(), regionTable)) {
+            QMessageBox::information(&dialog, "Export Successful",
+                QString("Statistics for %1 regions exported to CSV.").arg(regionTable.regions.size()));
+        } else {
+            QMessageBox::critical(&dialog, "Export Failed",
+                "Failed to export region statistics to CSV!");
+        }
+    });
+    buttons->addWidget(exportButton);
+    
+    QPushButton* closeButton = new QPushButton("Close");
+    closeButton->setProperty("class", "accent");
+    closeButton->setMinimumWidth(100);
+    connect(closeButton, &QPushButton::clicked, &dialog, &QDialog::accept);
+    buttons->addWidget(closeButton);
+    layout->addLayout(buttons);
+    
+    dialog.exec();
+}
+
 void SegmentationDialog::onApplyClicked() {
     if (!previewImage.empty()) {
         segmentedImage = previewImage.clone();
@@ -619,6 +736,7 @@ void SegmentationDialog::onResetClicked() {
     spatialRadiusSpin->setValue(20);
     colorRadiusSpin->setValue(40);
     grabCutIterationsSpin->setValue(5);
+    grabCutCoarseCheck->setChecked(true);
     slicRegionsSpin->setValue(200);
     slicCompactnessSpin->setValue(10);
     
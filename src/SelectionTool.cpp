@@ -5,8 +5,12 @@
 SelectionTool::SelectionTool(QObject* parent)
     : QObject(parent)
     , currentMode(SelectionMode::Rectangle)
+    , combineMode(SelectionCombine::Replace)
     , isSelectingRect(false)
     , magicWandTolerance(30)
+    , wandData(nullptr)
+    , wandType(-1)
+    , wandSeed(-1, -1)
 {
 }
 
@@ -41,34 +45,28 @@ void SelectionTool::endRectangle(const cv::Size& imageSize) {
     
     // Create mask with proper image size
     if (rectStart != rectEnd && imageSize.width > 0 && imageSize.height > 0) {
-        mask = cv::Mat::zeros(imageSize, CV_8UC1);
-        
-        int x1 = std::max(0, std::min(rectStart.x(), rectEnd.x()));
-        int y1 = std::max(0, std::min(rectStart.y(), rectEnd.y()));
-        int x2 = std::min(imageSize.width - 1, std::max(rectStart.x(), rectEnd.x()));
-        int y2 = std::min(imageSize.height - 1, std::max(rectStart.y(), rectEnd.y()));
-        
-        if (x2 > x1 && y2 > y1) {
-            cv::Rect rect(x1, y1, x2 - x1, y2 - y1);
-            mask(rect).setTo(255);
-            qDebug() << "Rectangle: mask non-zero pixels =" << cv::countNonZero(mask) 
-                     << "rect:" << x1 << y1 << x2 << y2;
-        }
+        commitSelection(createRectangleMask(imageSize));
+        qDebug() << "Rectangle: mask non-zero pixels =" << selection.count();
     }
     
+    // The rectangle is part of the selection now; keeping it would combine it again
+    rectStart = QPoint();
+    rectEnd = QPoint();
     emit selectionCompleted();
 }
 
-void SelectionTool::createRectangleMask(const cv::Size& imageSize) {
-    mask = cv::Mat::zeros(imageSize, CV_8UC1);
+PackedMask SelectionTool::createRectangleMask(const cv::Size& imageSize) const {
+    PackedMask shape(imageSize);
     
     int x1 = std::max(0, std::min(rectStart.x(), rectEnd.x()));
     int y1 = std::max(0, std::min(rectStart.y(), rectEnd.y()));
     int x2 = std::min(imageSize.width - 1, std::max(rectStart.x(), rectEnd.x()));
     int y2 = std::min(imageSize.height - 1, std::max(rectStart.y(), rectEnd.y()));
     
-    cv::Rect rect(x1, y1, x2 - x1, y2 - y1);
-    mask(rect).setTo(255);
+    if (x2 > x1 && y2 > y1) {
+        shape.fill(cv::Rect(x1, y1, x2 - x1, y2 - y1));
+    }
+    return shape;
 }
 
 // ==================== POLYGON SELECTION ====================
@@ -86,21 +84,12 @@ void SelectionTool::closePolygon(const cv::Size& imageSize) {
     
     // Create mask with proper image size
     if (imageSize.width > 0 && imageSize.height > 0) {
-        mask = cv::Mat::zeros(imageSize, CV_8UC1);
-        
-        // Convert QPoints to cv::Points
-        std::vector<cv::Point> cvPoints;
-        for (const QPoint& p : polygonPoints) {
-            cvPoints.push_back(cv::Point(p.x(), p.y()));
-        }
-        
-        // Fill polygon
-        std::vector<std::vector<cv::Point>> polygons = {cvPoints};
-        cv::fillPoly(mask, polygons, cv::Scalar(255));
-        
-        qDebug() << "Polygon: mask non-zero pixels =" << cv::countNonZero(mask);
+        commitSelection(createPolygonMask(imageSize));
+        qDebug() << "Polygon: mask non-zero pixels =" << selection.count();
     }
     
+    // Likewise for the polygon; the next point starts a new one
+    polygonPoints.clear();
     emit selectionCompleted();
 }
 
@@ -109,10 +98,8 @@ void SelectionTool::clearPolygon() {
     emit selectionUpdated();
 }
 
-void SelectionTool::createPolygonMask(const cv::Size& imageSize) {
-    if (polygonPoints.size() < 3) return;
-    
-    mask = cv::Mat::zeros(imageSize, CV_8UC1);
+PackedMask SelectionTool::createPolygonMask(const cv::Size& imageSize) const {
+    if (polygonPoints.size() < 3) return PackedMask(imageSize);
     
     // Convert QPoints to cv::Point
     std::vector<cv::Point> cvPoints;
@@ -120,9 +107,16 @@ void SelectionTool::createPolygonMask(const cv::Size& imageSize) {
         cvPoints.push_back(cv::Point(p.x(), p.y()));
     }
     
-    // Fill polygon
+    // Fill the polygon's bounding box only and pack it into place
+    cv::Rect bounds = cv::boundingRect(cvPoints) & cv::Rect(0, 0, imageSize.width, imageSize.height);
+    PackedMask shape(imageSize);
+    if (bounds.empty()) return shape;
+    
+    cv::Mat patch = cv::Mat::zeros(bounds.size(), CV_8UC1);
     std::vector<std::vector<cv::Point>> polygons = {cvPoints};
-    cv::fillPoly(mask, polygons, cv::Scalar(255));
+    cv::fillPoly(patch, polygons, cv::Scalar(255), cv::LINE_8, 0, -bounds.tl());
+    shape.paint(patch, bounds.tl());
+    return shape;
 }
 
 // ==================== MAGIC WAND (COLOR-BASED) ====================
@@ -138,44 +132,80 @@ void SelectionTool::magicWandSelect(const cv::Mat& image, const QPoint& seedPoin
         return;
     }
     
-    floodFillSelection(image, seed, tolerance);
+    PackedMask shape;
+    if (wandUsesTree(image)) {
+        // Rebuild only for a different image; in-place changes release the tree
+        if (wandTree.empty() || !isWandImage(image)) {
+            wandTree.build(image);
+            qDebug() << "Magic Wand: component tree of" << wandTree.nodeCount() << "nodes built in"
+                     << wandTree.buildMs() << "ms";
+        }
+        int pixels = wandTree.select(seed, tolerance, shape);
+        qDebug() << "Magic Wand: mask non-zero pixels =" << pixels;
+    } else {
+        wandTree.clear();
+        shape = floodFillShape(image, seed, tolerance);
+    }
+    wandData = image.data;
+    wandSize = image.size();
+    wandType = image.type();
+    wandSeed = seed;
+    wandBase = selection;
+    selection = combined(wandBase, shape);
     emit selectionCompleted();
 }
 
-void SelectionTool::floodFillSelection(const cv::Mat& image, const cv::Point& seed, int tolerance) {
-    mask = cv::Mat::zeros(image.size(), CV_8UC1);
+bool SelectionTool::wandUsesTree(const cv::Mat& image) const {
+    const int channels = image.channels();
+    return image.depth() == CV_8U && (channels == 1 || channels == 3 || channels == 4) &&
+           static_cast<long long>(image.rows) * image.cols <= MAX_WAND_TREE_PIXELS;
+}
+
+bool SelectionTool::isWandImage(const cv::Mat& image) const {
+    return wandData != nullptr && wandData == image.data && wandSize == image.size() && wandType == image.type();
+}
+
+bool SelectionTool::magicWandBuildsTree(const cv::Mat& image) const {
+    return wandUsesTree(image) && (wandTree.empty() || !isWandImage(image));
+}
+
+void SelectionTool::releaseMagicWandTree() {
+    wandTree.clear();
+    wandData = nullptr;
+    wandSize = cv::Size();
+    wandType = -1;
+    wandSeed = cv::Point(-1, -1);
+}
+
+void SelectionTool::setMagicWandTolerance(int tolerance, const cv::Mat& image) {
+    magicWandTolerance = tolerance;
+    if (wandSeed.x < 0) return;
     
-    // For grayscale images, use simpler approach
-    if (image.channels() == 1) {
-        cv::Mat floodMask = cv::Mat::zeros(image.rows + 2, image.cols + 2, CV_8UC1);
-        cv::Mat imageCopy = image.clone();
-        
-        int flags = 4 | (255 << 8) | cv::FLOODFILL_MASK_ONLY;
-        cv::Scalar loDiff(tolerance);
-        cv::Scalar upDiff(tolerance);
-        
-        cv::floodFill(imageCopy, floodMask, seed, cv::Scalar(255), nullptr, loDiff, upDiff, flags);
-        
-        // Extract the mask (remove border)
-        mask = floodMask(cv::Rect(1, 1, image.cols, image.rows)).clone();
-        
-        qDebug() << "Magic Wand grayscale: mask non-zero pixels =" << cv::countNonZero(mask);
+    PackedMask shape;
+    if (!wandTree.empty()) {
+        wandTree.select(wandSeed, tolerance, shape);
+    } else if (isWandImage(image)) {
+        shape = floodFillShape(image, wandSeed, tolerance);
     } else {
-        // For color images (shouldn't happen with grayscale requirement)
-        cv::Mat flooded = image.clone();
-        cv::Mat floodMask = cv::Mat::zeros(image.rows + 2, image.cols + 2, CV_8UC1);
-        
-        int flags = 4 | (255 << 8) | cv::FLOODFILL_MASK_ONLY;
-        cv::Scalar loDiff(tolerance, tolerance, tolerance);
-        cv::Scalar upDiff(tolerance, tolerance, tolerance);
-        
-        cv::floodFill(flooded, floodMask, seed, cv::Scalar(255), nullptr, loDiff, upDiff, flags);
-        
-        // Extract the mask (remove border)
-        mask = floodMask(cv::Rect(1, 1, image.cols, image.rows)).clone();
-        
-        qDebug() << "Magic Wand color: mask non-zero pixels =" << cv::countNonZero(mask);
+        return;
     }
+    selection = combined(wandBase, shape);
+    emit selectionUpdated();
+}
+
+PackedMask SelectionTool::floodFillShape(const cv::Mat& image, const cv::Point& seed, int tolerance) const {
+    // FLOODFILL_MASK_ONLY leaves the image untouched, so it is not copied
+    cv::Mat source = image;
+    cv::Mat floodMask = cv::Mat::zeros(image.rows + 2, image.cols + 2, CV_8UC1);
+    
+    int flags = 4 | (255 << 8) | cv::FLOODFILL_MASK_ONLY;
+    cv::Scalar diff = cv::Scalar::all(tolerance);
+    cv::floodFill(source, floodMask, seed, cv::Scalar(255), nullptr, diff, diff, flags);
+    
+    // Extract the mask (remove border)
+    cv::Mat mask = floodMask(cv::Rect(1, 1, image.cols, image.rows));
+    qDebug() << "Magic Wand flood fill: mask non-zero pixels =" << cv::countNonZero(mask);
+    return PackedMask::fromMat(mask);
 }
 
 // ==================== THRESHOLD-BASED SELECTION ====================
@@ -191,10 +221,11 @@ void SelectionTool::thresholdSelect(const cv::Mat& image, int minThreshold, int
     }
     
     // Create mask for pixels in range
-    mask = cv::Mat::zeros(image.size(), CV_8UC1);
+    cv::Mat mask;
     cv::inRange(gray, minThreshold, maxThreshold, mask);
+    commitSelection(PackedMask::fromMat(mask));
     
-    qDebug() << "Threshold: mask non-zero pixels =" << cv::countNonZero(mask);
+    qDebug() << "Threshold: mask non-zero pixels =" << selection.count();
     
     emit selectionCompleted();
 }
@@ -228,7 +259,6 @@ void SelectionTool::edgeBasedSelect(const cv::Mat& image, const QPoint& seedPoin
     cv::Mat invEdges = 255 - edges;
     
     // Flood fill from seed point
-    mask = cv::Mat::zeros(image.size(), CV_8UC1);
     cv::Mat floodMask = cv::Mat::zeros(image.rows + 2, image.cols + 2, CV_8UC1);
     
     // Copy inverted edges to floodMask interior
@@ -239,9 +269,9 @@ void SelectionTool::edgeBasedSelect(const cv::Mat& image, const QPoint& seedPoin
                   cv::Scalar(10), cv::Scalar(10), flags);
     
     // Extract mask
-    mask = floodMask(cv::Rect(1, 1, image.cols, image.rows)).clone();
+    commitSelection(PackedMask::fromMat(floodMask(cv::Rect(1, 1, image.cols, image.rows))));
     
-    qDebug() << "Edge-Based: mask non-zero pixels =" << cv::countNonZero(mask);
+    qDebug() << "Edge-Based: mask non-zero pixels =" << selection.count();
     
     emit selectionCompleted();
 }
@@ -249,50 +279,57 @@ void SelectionTool::edgeBasedSelect(const cv::Mat& image, const QPoint& seedPoin
 // ==================== MASK OPERATIONS ====================
 
 cv::Mat SelectionTool::getMask(const cv::Size& imageSize) const {
-    // Generate mask based on current mode
-    cv::Mat resultMask;
-    
-    switch (currentMode) {
-        case SelectionMode::Rectangle:
-            if (isSelectingRect || (rectStart != rectEnd)) {
-                const_cast<SelectionTool*>(this)->createRectangleMask(imageSize);
-            }
-            break;
-            
-        case SelectionMode::Polygon:
-            if (polygonPoints.size() >= 3) {
-                const_cast<SelectionTool*>(this)->createPolygonMask(imageSize);
-            }
-            break;
-            
-        default:
-            // Other modes generate mask directly
-            break;
+    // Finished shapes are already part of the selection; a rectangle still
+    // being dragged is combined as it stands
+    if (currentMode == SelectionMode::Rectangle && isSelectingRect && rectStart != rectEnd) {
+        return combined(selection, createRectangleMask(imageSize)).toMat();
     }
-    
-    return mask.clone();
+    return selection.toMat();
+}
+
+PackedMask SelectionTool::combined(const PackedMask& base, const PackedMask& shape) const {
+    if (base.empty() || base.size() != shape.size()) {
+        return shape;
+    }
+    switch (combineMode) {
+        case SelectionCombine::Add: return base | shape;
+        case SelectionCombine::Subtract: return base - shape;
+        case SelectionCombine::Intersect: return base & shape;
+        default: return shape;
+    }
+}
+
+void SelectionTool::invertSelection(const cv::Size& imageSize) {
+    if (selection.empty() || selection.size() != imageSize) {
+        selection = PackedMask(imageSize);
+    }
+    selection.invert();
+    wandSeed = cv::Point(-1, -1);
+    emit selectionCompleted();
 }
 
 void SelectionTool::clearMask() {
-    mask = cv::Mat();
+    selection = PackedMask();
+    wandBase = PackedMask();
     rectStart = QPoint();
     rectEnd = QPoint();
     polygonPoints.clear();
     isSelectingRect = false;
+    wandSeed = cv::Point(-1, -1);
     emit selectionUpdated();
 }
 
 cv::Mat SelectionTool::applyMaskToResult(const cv::Mat& original, const cv::Mat& processed) const {
-    if (mask.empty() || original.empty() || processed.empty()) {
+    if (selection.empty() || original.empty() || processed.empty()) {
         return processed.clone();
     }
     
-    if (mask.size() != original.size() || original.size() != processed.size()) {
+    if (selection.size() != original.size() || original.size() != processed.size()) {
         return processed.clone();
     }
     
     cv::Mat result = original.clone();
-    processed.copyTo(result, mask);
+    processed.copyTo(result, selection.toMat());
     
     return result;
 }
@@ -300,12 +337,12 @@ cv::Mat SelectionTool::applyMaskToResult(const cv::Mat& original, const cv::Mat&
 // ==================== LAYER INTEGRATION ====================
 
 cv::Mat SelectionTool::getMaskAsLayer() const {
-    if (mask.empty()) return cv::Mat();
+    if (selection.empty()) return cv::Mat();
     
     // Create a 3-channel visualization of the mask
     // Green for selected areas, transparent for unselected
-    cv::Mat layerVis = cv::Mat::zeros(mask.size(), CV_8UC3);
-    layerVis.setTo(cv::Scalar(0, 255, 0), mask);  // Green where mask is active
+    cv::Mat layerVis = cv::Mat::zeros(selection.size(), CV_8UC3);
+    layerVis.setTo(cv::Scalar(0, 255, 0), selection.toMat());  // Green where mask is active
     
     return layerVis;
 }
@@ -317,26 +354,26 @@ void SelectionTool::loadMaskFromLayer(const cv::Mat& layerMask) {
     }
     
     // Convert layer to mask (extract green channel or convert to grayscale)
+    cv::Mat mask;
     if (layerMask.channels() == 3) {
-        cv::Mat gray;
-        cv::cvtColor(layerMask, gray, cv::COLOR_BGR2GRAY);
-        mask = gray.clone();
+        cv::cvtColor(layerMask, mask, cv::COLOR_BGR2GRAY);
     } else {
-        mask = layerMask.clone();
+        mask = layerMask;
     }
     
     // Threshold to ensure binary mask
     cv::threshold(mask, mask, 127, 255, cv::THRESH_BINARY);
+    commitSelection(PackedMask::fromMat(mask));
     
-    qDebug() << "Loaded mask from layer. Non-zero pixels:" << cv::countNonZero(mask);
+    qDebug() << "Loaded mask from layer. Non-zero pixels:" << selection.count();
     emit selectionCompleted();
 }
 
 QString SelectionTool::getSelectionDescription() const {
     if (!hasMask()) return "No selection";
     
-    int pixels = cv::countNonZero(mask);
-    double percentage = (pixels * 100.0) / (mask.rows * mask.cols);
+    long long pixels = selection.count();
+    double percentage = (pixels * 100.0) / (static_cast<double>(selection.size().width) * selection.size().height);
     
     QString modeName = getModeName();
     return QString("%1 (%2 pixels, %3%)")
@@ -355,9 +392,28 @@ cv::Mat SelectionTool::getOverlay(const cv::Mat& image) const {
         cv::cvtColor(overlay, overlay, cv::COLOR_GRAY2BGR);
     }
     
+    // While a rectangle or polygon is being drawn in Replace mode, only that
+    // shape is shown, since it will replace the current selection
+    bool drawingShape = (currentMode == SelectionMode::Rectangle && isSelectingRect) ||
+                        (currentMode == SelectionMode::Polygon && !polygonPoints.empty());
+    if ((!drawingShape || combineMode != SelectionCombine::Replace) &&
+        !selection.empty() && selection.size() == overlay.size()) {
+        cv::Mat mask = selection.toMat();
+        
+        // Create bright green overlay
+        cv::Mat colorMask = cv::Mat::zeros(mask.size(), CV_8UC3);
+        colorMask.setTo(cv::Scalar(0, 255, 0), mask);
+        cv::addWeighted(overlay, 0.4, colorMask, 0.6, 0, overlay);
+        
+        // Draw red border around selection for better visibility
+        std::vector<std::vector<cv::Point>> contours;
+        cv::findContours(mask, contours, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE);
+        cv::drawContours(overlay, contours, -1, cv::Scalar(0, 0, 255), 3);
+    }
+    
     switch (currentMode) {
         case SelectionMode::Rectangle: {
-            if (isSelectingRect || (rectStart != rectEnd)) {
+            if (isSelectingRect) {
                 int x1 = std::min(rectStart.x(), rectEnd.x());
                 int y1 = std::min(rectStart.y(), rectEnd.y());
                 int x2 = std::max(rectStart.x(), rectEnd.x());
@@ -400,21 +456,8 @@ cv::Mat SelectionTool::getOverlay(const cv::Mat& image) const {
             break;
         }
         
-        default: {
-            // For other modes, show mask overlay with high visibility
-            if (!mask.empty() && mask.size() == overlay.size()) {
-                // Create bright green overlay
-                cv::Mat colorMask = cv::Mat::zeros(mask.size(), CV_8UC3);
-                colorMask.setTo(cv::Scalar(0, 255, 0), mask);
-                cv::addWeighted(overlay, 0.4, colorMask, 0.6, 0, overlay);
-                
-                // Draw red border around selection for better visibility
-                std::vector<std::vector<cv::Point>> contours;
-                cv::findContours(mask.clone(), contours, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE);
-                cv::drawContours(overlay, contours, -1, cv::Scalar(0, 0, 255), 3);
-            }
+        default:
             break;
-        }
     }
     
     return overlay;
@@ -1,14 +1,16 @@
 #include "WaveletDialog.h"
 #include "ImageCanvas.h"
 #include "Theme.h"
+#include "compression/WaveletCodec.h"
 #include <QVBoxLayout>
 #include <QHBoxLayout>
 #include <QGroupBox>
 #include <QMessageBox>
 #include <QStackedWidget>
+#include <chrono>
 
 WaveletDialog::WaveletDialog(const cv::Mat& image, QWidget *parent)
-    : QDialog(parent), originalImage(image.clone()), applied(false) {
+    : QDialog(parent), originalImage(image.clone()), applied(false), codecStreamType(-1) {
     
     setWindowTitle("Wavelet Transform - Phase 20");
     setMinimumSize(1200, 800);
@@ -36,6 +38,7 @@ void WaveletDialog::setupUI() {
     operationCombo->addItem("Wavelet Denoising");
     operationCombo->addItem("Decomposition (1 Level)");
     operationCombo->addItem("Decomposition Visualization");
+    operationCombo->addItem("Progressive Codec vs JPEG");
     connect(operationCombo, QOverload<int>::of(&QComboBox::currentIndexChanged),
             this, &WaveletDialog::onOperationChanged);
     opLayout->addWidget(opLabel);
@@ -51,6 +54,8 @@ void WaveletDialog::setupUI() {
     waveletTypeCombo->addItem("Daubechies-2 (DB2)");
     waveletTypeCombo->addItem("Daubechies-4 (DB4)");
     waveletTypeCombo->addItem("Daubechies-6 (DB6)");
+    waveletTypeCombo->addItem("CDF 5/3 (Lifting, Reversible)");
+    waveletTypeCombo->addItem("CDF 9/7 (Lifting)");
     connect(waveletTypeCombo, QOverload<int>::of(&QComboBox::currentIndexChanged),
             this, &WaveletDialog::onWaveletTypeChanged);
     waveletLayout->addWidget(waveletLabel);
@@ -89,6 +94,23 @@ void WaveletDialog::setupUI() {
     thresholdLayout->addWidget(thresholdLabel);
     denoiseLayout->addLayout(thresholdLayout);
     
+    autoThresholdCheck = new QCheckBox("Automatic threshold (BayesShrink per sub-band, color)");
+    autoThresholdCheck->setStyleSheet("color: #c4b5fd;");
+    autoThresholdCheck->setChecked(false);
+    connect(autoThresholdCheck, &QCheckBox::toggled, this, [this](bool checked) {
+        thresholdSlider->setEnabled(!checked);
+        onParameterChanged();
+    });
+    denoiseLayout->addWidget(autoThresholdCheck);
+    
+    stationaryCheck = new QCheckBox("Shift-invariant (stationary transform)");
+    stationaryCheck->setStyleSheet("color: #c4b5fd;");
+    stationaryCheck->setChecked(false);
+    connect(stationaryCheck, &QCheckBox::toggled, this, [this](bool) {
+        onParameterChanged();
+    });
+    denoiseLayout->addWidget(stationaryCheck);
+    
     QHBoxLayout* methodLayout = new QHBoxLayout();
     QLabel* methodLabel = new QLabel("Thresholding Method:");
     methodLabel->setStyleSheet("color: #c4b5fd;");
@@ -119,6 +141,8 @@ void WaveletDialog::setupUI() {
         "Threshold: Controls noise removal strength (higher = more aggressive).\n"
         "Soft: Shrinks coefficients gradually (smoother results).\n"
         "Hard: Removes coefficients below threshold completely.\n"
+        "Automatic: Estimates noise from the image and picks a threshold per sub-band;\n"
+        "color images are denoised per channel in YCrCb.\n"
         "Levels: Number of wavelet decomposition levels (1-5)."
     );
     denoiseInfo->setStyleSheet("color: #a78bfa; font-size: 9pt; padding: 10px;");
@@ -145,6 +169,38 @@ void WaveletDialog::setupUI() {
     
     stackedParams->addWidget(decompositionParams);
     
+    // === PROGRESSIVE CODEC PARAMETERS ===
+    codecParams = new QWidget();
+    QVBoxLayout* codecLayout = new QVBoxLayout(codecParams);
+    
+    QHBoxLayout* bitrateLayout = new QHBoxLayout();
+    QLabel* bitrateLabelText = new QLabel("Bitrate (bits/pixel):");
+    bitrateLabelText->setStyleSheet("color: #c4b5fd;");
+    bitrateSlider = new QSlider(Qt::Horizontal);
+    bitrateSlider->setRange(2, 200);
+    bitrateSlider->setValue(50);
+    bitrateLabel = new QLabel("0.50");
+    bitrateLabel->setStyleSheet("color: #a78bfa; min-width: 60px;");
+    connect(bitrateSlider, &QSlider::valueChanged, this, [this](int value) {
+        bitrateLabel->setText(QString::number(value / 100.0, 'f', 2));
+        onParameterChanged();
+    });
+    bitrateLayout->addWidget(bitrateLabelText);
+    bitrateLayout->addWidget(bitrateSlider);
+    bitrateLayout->addWidget(bitrateLabel);
+    codecLayout->addLayout(bitrateLayout);
+    
+    QLabel* codecInfo = new QLabel(
+        "Embedded SPIHT bit-plane codec: the stream is encoded once and any prefix decodes.\n"
+        "The preview decodes only the first (bitrate x pixels) bits of the stream.\n"
+        "JPEG is encoded at the highest quality that fits the same byte budget."
+    );
+    codecInfo->setStyleSheet("color: #a78bfa; font-size: 9pt; padding: 10px;");
+    codecLayout->addWidget(codecInfo);
+    codecLayout->addStretch();
+    
+    stackedParams->addWidget(codecParams);
+    
     paramsLayout->addWidget(stackedParams);
     mainLayout->addWidget(paramsGroup);
     
@@ -153,6 +209,8 @@ void WaveletDialog::setupUI() {
             [this, stackedParams](int index) {
         if (index == 0) {
             stackedParams->setCurrentWidget(denoiseParams);
+        } else if (index == 3) {
+            stackedParams->setCurrentWidget(codecParams);
         } else {
             stackedParams->setCurrentWidget(decompositionParams);
         }
@@ -237,8 +295,10 @@ void WaveletDialog::updatePreview() {
             performDenoising();
         } else if (opIndex == 1) {
             performDecomposition();
-        } else {
+        } else if (opIndex == 2) {
             performReconstruction();
+        } else {
+            performCodecComparison();
         }
         
         if (!processedImage.empty()) {
@@ -261,6 +321,64 @@ void WaveletDialog::performDenoising() {
     double threshold = thresholdSlider->value();
     int levels = levelsSpinBox->value();
     
+    if (stationaryCheck->isChecked()) {
+        try {
+            // Undecimated: no block artifacts at dyadic boundaries, at the
+            // cost of full-size sub-bands for every level
+            bool autoThreshold = autoThresholdCheck->isChecked();
+            size_t peakBytes = 0;
+            cv::Mat denoised;
+            WaveletTransform::denoiseStationary(originalImage, denoised, autoThreshold ? -1.0 : threshold,
+                                                tMethod, levels, wType, &peakBytes);
+            denoised.convertTo(processedImage, CV_8U);
+            
+            operationType = QString("Stationary Wavelet Denoising (%1, %2, levels=%3)")
+                .arg(WaveletTransform::getWaveletName(wType).c_str())
+                .arg(autoThreshold ? QString("BayesShrink") : QString("threshold=%1").arg(threshold))
+                .arg(levels);
+            
+            // One combined band per finished level plus the approximation
+            // and four working planes
+            infoLabel->setText(QString("%1 - peak working memory: %2 MB (%3 image-size planes per channel)")
+                .arg(operationType).arg(peakBytes / (1024.0 * 1024.0), 0, 'f', 1)
+                .arg(levels + 4));
+            infoLabel->setStyleSheet("color: #a78bfa; padding: 5px;");
+        } catch (const cv::Exception& e) {
+            infoLabel->setText(QString("OpenCV Error: %1").arg(e.what()));
+            infoLabel->setStyleSheet("color: #ff6b6b; padding: 5px;");
+            qDebug() << "OpenCV Exception:" << e.what();
+        } catch (const std::exception& e) {
+            infoLabel->setText(QString("Error: %1").arg(e.what()));
+            infoLabel->setStyleSheet("color: #ff6b6b; padding: 5px;");
+            qDebug() << "Exception:" << e.what();
+        }
+        return;
+    }
+    
+    if (autoThresholdCheck->isChecked()) {
+        try {
+            cv::Mat denoised;
+            double sigma = WaveletTransform::denoiseBayesShrink(originalImage, denoised, tMethod, levels, wType);
+            denoised.convertTo(processedImage, CV_8U);
+            
+            operationType = QString("Wavelet Denoising (%1, BayesShrink, levels=%2)")
+                .arg(WaveletTransform::getWaveletName(wType).c_str())
+                .arg(levels);
+            
+            infoLabel->setText(QString("%1 - estimated noise sigma: %2").arg(operationType).arg(sigma, 0, 'f', 2));
+            infoLabel->setStyleSheet("color: #a78bfa; padding: 5px;");
+        } catch (const cv::Exception& e) {
+            infoLabel->setText(QString("OpenCV Error: %1").arg(e.what()));
+            infoLabel->setStyleSheet("color: #ff6b6b; padding: 5px;");
+            qDebug() << "OpenCV Exception:" << e.what();
+        } catch (const std::exception& e) {
+            infoLabel->setText(QString("Error: %1").arg(e.what()));
+            infoLabel->setStyleSheet("color: #ff6b6b; padding: 5px;");
+            qDebug() << "Exception:" << e.what();
+        }
+        return;
+    }
+    
     // Convert to grayscale if needed
     cv::Mat grayImage;
     if (originalImage.channels() == 3) {
@@ -282,7 +400,7 @@ void WaveletDialog::performDenoising() {
         cv::Mat denoised;
         WaveletTransform::denoise(grayImage, denoised, threshold, tMethod, levels, wType);
         
-        // denoise() might return CV_64F, convert to CV_8U first
+        // denoise() returns the input depth, convert to CV_8U if needed
         if (denoised.depth() != CV_8U) {
             denoised.convertTo(processedImage, CV_8U);
         } else {
@@ -338,7 +456,7 @@ void WaveletDialog::performDecomposition() {
         cv::Mat reconstructed;
         WaveletTransform::idwt2D(approx, horiz, vert, diag, reconstructed, wType);
         
-        // Convert from CV_64F to CV_8U first
+        // Convert from CV_32F to CV_8U first
         reconstructed.convertTo(processedImage, CV_8U);
         
         // Then convert to BGR if original was color
@@ -408,6 +526,85 @@ void WaveletDialog::performReconstruction() {
     }
 }
 
+void WaveletDialog::performCodecComparison() {
+    WaveletTransform::WaveletType wType = static_cast<WaveletTransform::WaveletType>(waveletTypeCombo->currentIndex());
+    
+    // Reference in the codec's output format (8-bit gray or BGR)
+    cv::Mat reference;
+    if (originalImage.channels() == 4) {
+        cv::cvtColor(originalImage, reference, cv::COLOR_BGRA2BGR);
+    } else {
+        reference = originalImage;
+    }
+    if (reference.depth() != CV_8U) {
+        reference.convertTo(reference, CV_8U);
+    }
+    
+    const double pixels = (double)reference.total();
+    const double bpp = bitrateSlider->value() / 100.0;
+    const size_t budget = WaveletCodec::HEADER_SIZE + (size_t)(bpp * pixels / 8.0);
+    
+    try {
+        if (codecStream.empty() || codecStreamType != (int)wType) {
+            size_t maxBudget = WaveletCodec::HEADER_SIZE +
+                               (size_t)(bitrateSlider->maximum() / 100.0 * pixels / 8.0);
+            codecStream = WaveletCodec::encode(reference, 5, wType, maxBudget);
+            codecStreamType = (int)wType;
+        }
+        
+        auto start = std::chrono::high_resolution_clock::now();
+        cv::Mat decoded = WaveletCodec::decode(codecStream, budget);
+        auto end = std::chrono::high_resolution_clock::now();
+        double decodeMs = std::chrono::duration<double, std::milli>(end - start).count();
+        size_t waveletBytes = std::min(budget, codecStream.size());
+        double waveletPsnr = cv::PSNR(reference, decoded);
+        
+        // JPEG: highest quality whose file fits the same budget
+        std::vector<uchar> jpegBytes, buffer;
+        int jpegQuality = 1;
+        int low = 1, high = 100;
+        while (low <= high) {
+            int mid = (low + high) / 2;
+            cv::imencode(".jpg", reference, buffer, {cv::IMWRITE_JPEG_QUALITY, mid});
+            if (buffer.size() <= budget) {
+                jpegQuality = mid;
+                jpegBytes = buffer;
+                low = mid + 1;
+            } else {
+                high = mid - 1;
+            }
+        }
+        if (jpegBytes.empty()) {
+            cv::imencode(".jpg", reference, jpegBytes, {cv::IMWRITE_JPEG_QUALITY, 1});
+        }
+        cv::Mat jpegDecoded = cv::imdecode(jpegBytes, reference.channels() == 1 ? cv::IMREAD_GRAYSCALE : cv::IMREAD_COLOR);
+        double jpegPsnr = cv::PSNR(reference, jpegDecoded);
+        
+        processedImage = decoded;
+        
+        operationType = QString("Wavelet Codec (%1, %2 bpp)")
+            .arg(WaveletTransform::getWaveletName(wType).c_str())
+            .arg(bpp, 0, 'f', 2);
+        
+        infoLabel->setText(QString("Wavelet: %1 KB, PSNR %2 dB (decoded in %3 ms)  |  JPEG q=%4: %5 KB, PSNR %6 dB")
+            .arg(waveletBytes / 1024.0, 0, 'f', 1)
+            .arg(waveletPsnr, 0, 'f', 2)
+            .arg(decodeMs, 0, 'f', 0)
+            .arg(jpegQuality)
+            .arg(jpegBytes.size() / 1024.0, 0, 'f', 1)
+            .arg(jpegPsnr, 0, 'f', 2));
+        infoLabel->setStyleSheet("color: #a78bfa; padding: 5px;");
+    } catch (const cv::Exception& e) {
+        infoLabel->setText(QString("OpenCV Error: %1").arg(e.what()));
+        infoLabel->setStyleSheet("color: #ff6b6b; padding: 5px;");
+        qDebug() << "OpenCV Exception:" << e.what();
+    } catch (const std::exception& e) {
+        infoLabel->setText(QString("Error: %1").arg(e.what()));
+        infoLabel->setStyleSheet("color: #ff6b6b; padding: 5px;");
+        qDebug() << "Exception:" << e.what();
+    }
+}
+
 void WaveletDialog::onApplyClicked() {
     if (!processedImage.empty()) {
         applied = true;
@@ -419,8 +616,11 @@ void WaveletDialog::onApplyClicked() {
 
 void WaveletDialog::onResetClicked() {
     thresholdSlider->setValue(20);
+    autoThresholdCheck->setChecked(false);
+    stationaryCheck->setChecked(false);
     thresholdMethodCombo->setCurrentIndex(0);
     levelsSpinBox->setValue(3);
+    bitrateSlider->setValue(50);
     waveletTypeCombo->setCurrentIndex(0);
     operationCombo->setCurrentIndex(0);
     
@@ -1,8 +1,17 @@
 #include "WaveletTransform.h"
 #include <cmath>
+#include <cstring>
 #include <algorithm>
 #include <stdexcept>
 
+// CDF 9/7 lifting coefficients (Daubechies & Sweldens factorization)
+static const float CDF97_ALPHA = -1.586134342f;
+static const float CDF97_BETA  = -0.05298011854f;
+static const float CDF97_GAMMA =  0.8829110762f;
+static const float CDF97_DELTA =  0.4435068522f;
+static const float CDF97_K     =  1.149604398f;
+static const float SQRT2       =  1.4142135623730951f;
+
 // Get wavelet filter coefficients
 void WaveletTransform::getWaveletFilters(WaveletType type, std::vector<double>& lowpass, std::vector<double>& highpass) {
     lowpass.clear();
@@ -37,45 +46,339 @@ void WaveletTransform::getWaveletFilters(WaveletType type, std::vector<double>&
                 highpass[i] = ((i % 2) == 0 ? 1 : -1) * lowpass[11 - i];
             }
             break;
+        default:
+            // CDF wavelets are implemented as lifting steps, not filters
+            break;
     }
 }
 
-// 1D convolution with downsampling
-void WaveletTransform::convolve1D(const std::vector<double>& signal, const std::vector<double>& filter,
-                                  std::vector<double>& output, int stride) {
-    int signalLen = signal.size();
-    int filterLen = filter.size();
-    int outputLen = (signalLen + stride - 1) / stride;
-    output.resize(outputLen);
+void WaveletTransform::getFloatFilters(WaveletType type, std::vector<float>& lowpass, std::vector<float>& highpass) {
+    lowpass.clear();
+    highpass.clear();
+    if (isLifting(type)) {
+        return;
+    }
     
-    for (int i = 0; i < outputLen; i++) {
-        double sum = 0.0;
-        int signalPos = i * stride;
+    std::vector<double> lo, hi;
+    getWaveletFilters(type, lo, hi);
+    lowpass.assign(lo.begin(), lo.end());
+    highpass.assign(hi.begin(), hi.end());
+}
+
+bool WaveletTransform::isLifting(WaveletType type) {
+    return type == HAAR || type == CDF53 || type == CDF97;
+}
+
+// ============================================================================
+// LIFTING STEPS
+// ============================================================================
+// Every step works on 'n' interleaved lines of 'width' floats (width == 1 for a
+// row, a column strip for the vertical pass) so the inner loop is a plain
+// vectorizable AXPY. Boundaries use whole-sample symmetric extension.
+
+// Odd lines: x[i] += a * (x[i-1] + x[i+1])
+static void liftOdd(float* x, int n, int width, float a) {
+    for (int i = 1; i < n; i += 2) {
+        float* cur = x + (size_t)i * width;
+        const float* left = cur - width;
+        const float* right = (i + 1 < n) ? cur + width : left;
+        for (int c = 0; c < width; c++) {
+            cur[c] += a * (left[c] + right[c]);
+        }
+    }
+}
+
+// Even lines: x[i] += a * (x[i-1] + x[i+1])
+static void liftEven(float* x, int n, int width, float a) {
+    for (int i = 0; i < n; i += 2) {
+        float* cur = x + (size_t)i * width;
+        const float* right = cur + width;
+        const float* left = (i > 0) ? cur - width : right;
+        for (int c = 0; c < width; c++) {
+            cur[c] += a * (left[c] + right[c]);
+        }
+    }
+}
+
+// Integer 5/3 predict: d = odd - floor((left + right) / 2)
+static void liftOdd53(float* x, int n, int width, float sign) {
+    for (int i = 1; i < n; i += 2) {
+        float* cur = x + (size_t)i * width;
+        const float* left = cur - width;
+        const float* right = (i + 1 < n) ? cur + width : left;
+        for (int c = 0; c < width; c++) {
+            cur[c] -= sign * std::floor(0.5f * (left[c] + right[c]));
+        }
+    }
+}
+
+// Integer 5/3 update: s = even + floor((left + right + 2) / 4)
+static void liftEven53(float* x, int n, int width, float sign) {
+    for (int i = 0; i < n; i += 2) {
+        float* cur = x + (size_t)i * width;
+        const float* right = cur + width;
+        const float* left = (i > 0) ? cur - width : right;
+        for (int c = 0; c < width; c++) {
+            cur[c] += sign * std::floor(0.25f * (left[c] + right[c]) + 0.5f);
+        }
+    }
+}
+
+static void scaleLines(float* x, int n, int width, float evenScale, float oddScale) {
+    for (int i = 0; i < n; i++) {
+        float* cur = x + (size_t)i * width;
+        float s = (i % 2 == 0) ? evenScale : oddScale;
+        for (int c = 0; c < width; c++) {
+            cur[c] *= s;
+        }
+    }
+}
+
+void WaveletTransform::liftForward(float* x, int n, int width, WaveletType type) {
+    switch (type) {
+        case HAAR:
+            // d = odd - even, s = even + d/2, then orthonormal scaling
+            for (int i = 1; i < n; i += 2) {
+                float* cur = x + (size_t)i * width;
+                const float* even = cur - width;
+                for (int c = 0; c < width; c++) cur[c] -= even[c];
+            }
+            for (int i = 0; i < n; i += 2) {
+                float* cur = x + (size_t)i * width;
+                const float* odd = cur + width;
+                for (int c = 0; c < width; c++) cur[c] += 0.5f * odd[c];
+            }
+            scaleLines(x, n, width, SQRT2, -1.0f / SQRT2);
+            break;
+        case CDF53:
+            liftOdd53(x, n, width, 1.0f);
+            liftEven53(x, n, width, 1.0f);
+            break;
+        case CDF97:
+            liftOdd(x, n, width, CDF97_ALPHA);
+            liftEven(x, n, width, CDF97_BETA);
+            liftOdd(x, n, width, CDF97_GAMMA);
+            liftEven(x, n, width, CDF97_DELTA);
+            scaleLines(x, n, width, CDF97_K, 1.0f / CDF97_K);
+            break;
+        default:
+            throw std::runtime_error("Wavelet type has no lifting factorization");
+    }
+}
+
+void WaveletTransform::liftInverse(float* x, int n, int width, WaveletType type) {
+    switch (type) {
+        case HAAR:
+            scaleLines(x, n, width, 1.0f / SQRT2, -SQRT2);
+            for (int i = 0; i < n; i += 2) {
+                float* cur = x + (size_t)i * width;
+                const float* odd = cur + width;
+                for (int c = 0; c < width; c++) cur[c] -= 0.5f * odd[c];
+            }
+            for (int i = 1; i < n; i += 2) {
+                float* cur = x + (size_t)i * width;
+                const float* even = cur - width;
+                for (int c = 0; c < width; c++) cur[c] += even[c];
+            }
+            break;
+        case CDF53:
+            liftEven53(x, n, width, -1.0f);
+            liftOdd53(x, n, width, -1.0f);
+            break;
+        case CDF97:
+            scaleLines(x, n, width, 1.0f / CDF97_K, CDF97_K);
+            liftEven(x, n, width, -CDF97_DELTA);
+            liftOdd(x, n, width, -CDF97_GAMMA);
+            liftEven(x, n, width, -CDF97_BETA);
+            liftOdd(x, n, width, -CDF97_ALPHA);
+            break;
+        default:
+            throw std::runtime_error("Wavelet type has no lifting factorization");
+    }
+}
+
+// ============================================================================
+// 1D TRANSFORMS OVER LINE BLOCKS
+// ============================================================================
+
+void WaveletTransform::forward1D(float* lines, float* work, int n, int width, WaveletType type,
+                                 const std::vector<float>& lowpass, const std::vector<float>& highpass) {
+    const size_t lineBytes = (size_t)width * sizeof(float);
+    const int half = n / 2;
+    
+    if (isLifting(type)) {
+        liftForward(lines, n, width, type);
+        
+        // Deinterleave: even lines -> low band, odd lines -> high band
+        for (int k = 0; k < half; k++) {
+            std::memcpy(work + (size_t)k * width, lines + (size_t)(2 * k) * width, lineBytes);
+            std::memcpy(work + (size_t)(half + k) * width, lines + (size_t)(2 * k + 1) * width, lineBytes);
+        }
+        std::memcpy(lines, work, (size_t)n * lineBytes);
+        return;
+    }
+    
+    // Periodized filter bank: extend once so the tap loop has no index checks
+    const int taps = (int)lowpass.size();
+    for (int i = 0; i < n + taps; i++) {
+        std::memcpy(work + (size_t)i * width, lines + (size_t)(i % n) * width, lineBytes);
+    }
+    
+    for (int k = 0; k < half; k++) {
+        float* low = lines + (size_t)k * width;
+        float* high = lines + (size_t)(half + k) * width;
+        std::fill(low, low + width, 0.0f);
+        std::fill(high, high + width, 0.0f);
         
-        for (int j = 0; j < filterLen; j++) {
-            int pos = signalPos - j;
-            if (pos < 0) pos = -pos;
-            if (pos >= signalLen) pos = 2 * signalLen - pos - 2;
-            if (pos >= 0 && pos < signalLen) {
-                sum += signal[pos] * filter[j];
+        const float* src = work + (size_t)(2 * k) * width;
+        for (int j = 0; j < taps; j++) {
+            const float* s = src + (size_t)j * width;
+            const float h = lowpass[j];
+            const float g = highpass[j];
+            for (int c = 0; c < width; c++) {
+                low[c] += h * s[c];
+                high[c] += g * s[c];
             }
         }
-        output[i] = sum;
     }
 }
 
-// Upsample signal by 2
-void WaveletTransform::upsample(const std::vector<double>& input, std::vector<double>& output) {
-    output.resize(input.size() * 2);
-    for (size_t i = 0; i < input.size(); i++) {
-        output[i * 2] = input[i];
-        output[i * 2 + 1] = 0.0;
+void WaveletTransform::inverse1D(float* lines, float* work, int n, int width, WaveletType type,
+                                 const std::vector<float>& lowpass, const std::vector<float>& highpass) {
+    const size_t lineBytes = (size_t)width * sizeof(float);
+    const int half = n / 2;
+    
+    if (isLifting(type)) {
+        for (int k = 0; k < half; k++) {
+            std::memcpy(work + (size_t)(2 * k) * width, lines + (size_t)k * width, lineBytes);
+            std::memcpy(work + (size_t)(2 * k + 1) * width, lines + (size_t)(half + k) * width, lineBytes);
+        }
+        liftInverse(work, n, width, type);
+        std::memcpy(lines, work, (size_t)n * lineBytes);
+        return;
+    }
+    
+    // Transpose of the periodized analysis: scatter into an extended buffer,
+    // then fold the wrapped tail back onto the start
+    const int taps = (int)lowpass.size();
+    std::fill(work, work + (size_t)(n + taps) * width, 0.0f);
+    
+    for (int k = 0; k < half; k++) {
+        const float* low = lines + (size_t)k * width;
+        const float* high = lines + (size_t)(half + k) * width;
+        float* dst = work + (size_t)(2 * k) * width;
+        for (int j = 0; j < taps; j++) {
+            float* d = dst + (size_t)j * width;
+            const float h = lowpass[j];
+            const float g = highpass[j];
+            for (int c = 0; c < width; c++) {
+                d[c] += h * low[c] + g * high[c];
+            }
+        }
     }
+    
+    for (int i = n; i < n + taps; i++) {
+        float* dst = work + (size_t)(i % n) * width;
+        const float* src = work + (size_t)i * width;
+        for (int c = 0; c < width; c++) {
+            dst[c] += src[c];
+        }
+    }
+    std::memcpy(lines, work, (size_t)n * lineBytes);
 }
 
-// 2D Discrete Wavelet Transform
-void WaveletTransform::dwt2D(const cv::Mat& input, cv::Mat& approx, cv::Mat& horiz,
-                             cv::Mat& vert, cv::Mat& diag, WaveletType type) {
+// ============================================================================
+// 2D PASSES
+// ============================================================================
+
+// Column strips are sized so a whole strip (all rows) stays in L2
+int WaveletTransform::columnStripWidth(int rows, int cols) {
+    const int targetFloats = 64 * 1024;
+    int width = targetFloats / std::max(rows, 1);
+    width = std::max(16, std::min(256, width));
+    width = (width / 16) * 16;
+    return std::min(width, cols);
+}
+
+void WaveletTransform::transformRows(cv::Mat& plane, WaveletType type, bool forward) {
+    std::vector<float> lowpass, highpass;
+    getFloatFilters(type, lowpass, highpass);
+    const int cols = plane.cols;
+    const int taps = (int)lowpass.size();
+    
+    cv::parallel_for_(cv::Range(0, plane.rows), [&](const cv::Range& range) {
+        std::vector<float> work((size_t)cols + taps);
+        for (int i = range.start; i < range.end; i++) {
+            float* row = plane.ptr<float>(i);
+            if (forward) {
+                forward1D(row, work.data(), cols, 1, type, lowpass, highpass);
+            } else {
+                inverse1D(row, work.data(), cols, 1, type, lowpass, highpass);
+            }
+        }
+    });
+}
+
+void WaveletTransform::transformColumns(cv::Mat& plane, WaveletType type, bool forward) {
+    std::vector<float> lowpass, highpass;
+    getFloatFilters(type, lowpass, highpass);
+    const int rows = plane.rows;
+    const int cols = plane.cols;
+    const int taps = (int)lowpass.size();
+    const int stripWidth = columnStripWidth(rows, cols);
+    const int numStrips = (cols + stripWidth - 1) / stripWidth;
+    
+    cv::parallel_for_(cv::Range(0, numStrips), [&](const cv::Range& range) {
+        std::vector<float> lines((size_t)rows * stripWidth);
+        std::vector<float> work((size_t)(rows + taps) * stripWidth);
+        
+        for (int s = range.start; s < range.end; s++) {
+            const int c0 = s * stripWidth;
+            const int width = std::min(stripWidth, cols - c0);
+            const size_t lineBytes = (size_t)width * sizeof(float);
+            
+            for (int i = 0; i < rows; i++) {
+                std::memcpy(lines.data() + (size_t)i * width, plane.ptr<float>(i) + c0, lineBytes);
+            }
+            
+            if (forward) {
+                forward1D(lines.data(), work.data(), rows, width, type, lowpass, highpass);
+            } else {
+                inverse1D(lines.data(), work.data(), rows, width, type, lowpass, highpass);
+            }
+            
+            for (int i = 0; i < rows; i++) {
+                std::memcpy(plane.ptr<float>(i) + c0, lines.data() + (size_t)i * width, lineBytes);
+            }
+        }
+    });
+}
+
+void WaveletTransform::forwardInPlace(cv::Mat& plane, WaveletType type) {
+    if (plane.type() != CV_32FC1) {
+        throw std::runtime_error("Wavelet plane must be CV_32FC1");
+    }
+    if (plane.rows < 2 || plane.cols < 2 || plane.rows % 2 != 0 || plane.cols % 2 != 0) {
+        throw std::runtime_error("Wavelet plane dimensions must be even");
+    }
+    
+    transformRows(plane, type, true);
+    transformColumns(plane, type, true);
+}
+
+void WaveletTransform::inverseInPlace(cv::Mat& plane, WaveletType type) {
+    if (plane.type() != CV_32FC1) {
+        throw std::runtime_error("Wavelet plane must be CV_32FC1");
+    }
+    if (plane.rows < 2 || plane.cols < 2 || plane.rows % 2 != 0 || plane.cols % 2 != 0) {
+        throw std::runtime_error("Wavelet plane dimensions must be even");
+    }
+    
+    transformColumns(plane, type, false);
+    transformRows(plane, type, false);
+}
+
+cv::Mat WaveletTransform::preparePlane(const cv::Mat& input, int multiple) {
     // IMPORTANT: Ensure input is grayscale (1-channel)
     cv::Mat grayInput;
     if (input.channels() == 3) {
@@ -83,255 +386,630 @@ void WaveletTransform::dwt2D(const cv::Mat& input, cv::Mat& approx, cv::Mat& hor
     } else if (input.channels() == 4) {
         cv::cvtColor(input, grayInput, cv::COLOR_BGRA2GRAY);
     } else {
-        grayInput = input.clone();
+        grayInput = input;
     }
     
-    // Extra safety check
     if (grayInput.channels() != 1) {
         throw std::runtime_error("Input must be single-channel grayscale image!");
     }
     
-    cv::Mat floatImg;
-    grayInput.convertTo(floatImg, CV_64F);
+    cv::Mat plane;
+    grayInput.convertTo(plane, CV_32F);
     
-    // Verify conversion
-    if (floatImg.channels() != 1) {
-        throw std::runtime_error("Float conversion failed - still multi-channel!");
+    int padRows = (multiple - plane.rows % multiple) % multiple;
+    int padCols = (multiple - plane.cols % multiple) % multiple;
+    if (padRows > 0 || padCols > 0) {
+        cv::Mat padded;
+        cv::copyMakeBorder(plane, padded, 0, padRows, 0, padCols, cv::BORDER_REPLICATE);
+        plane = padded;
     }
     
-    int rows = floatImg.rows;
-    int cols = floatImg.cols;
+    return plane;
+}
+
+// 2D Discrete Wavelet Transform
+void WaveletTransform::dwt2D(const cv::Mat& input, cv::Mat& approx, cv::Mat& horiz,
+                             cv::Mat& vert, cv::Mat& diag, WaveletType type) {
+    cv::Mat plane = preparePlane(input, 2);
+    forwardInPlace(plane, type);
     
-    std::vector<double> lowpass, highpass;
-    getWaveletFilters(type, lowpass, highpass);
+    int halfRows = plane.rows / 2;
+    int halfCols = plane.cols / 2;
     
-    int halfCols = (cols + 1) / 2;
-    cv::Mat temp1(rows, halfCols, CV_64F);
-    cv::Mat temp2(rows, halfCols, CV_64F);
+    approx = plane(cv::Rect(0, 0, halfCols, halfRows));
+    vert = plane(cv::Rect(halfCols, 0, halfCols, halfRows));
+    horiz = plane(cv::Rect(0, halfRows, halfCols, halfRows));
+    diag = plane(cv::Rect(halfCols, halfRows, halfCols, halfRows));
+}
+
+// 2D Inverse Discrete Wavelet Transform
+void WaveletTransform::idwt2D(const cv::Mat& approx, const cv::Mat& horiz,
+                              const cv::Mat& vert, const cv::Mat& diag,
+                              cv::Mat& recon, WaveletType type) {
+    if (horiz.size() != approx.size() || vert.size() != approx.size() || diag.size() != approx.size()) {
+        throw std::runtime_error("All wavelet sub-bands must have the same size");
+    }
+    
+    int halfRows = approx.rows;
+    int halfCols = approx.cols;
+    cv::Mat plane(halfRows * 2, halfCols * 2, CV_32F);
     
-    // Apply filters to rows
-    for (int i = 0; i < rows; i++) {
-        std::vector<double> row(cols);
-        for (int j = 0; j < cols; j++) {
-            row[j] = floatImg.at<double>(i, j);
+    cv::Mat quadrant = plane(cv::Rect(0, 0, halfCols, halfRows));
+    approx.convertTo(quadrant, CV_32F);
+    quadrant = plane(cv::Rect(halfCols, 0, halfCols, halfRows));
+    vert.convertTo(quadrant, CV_32F);
+    quadrant = plane(cv::Rect(0, halfRows, halfCols, halfRows));
+    horiz.convertTo(quadrant, CV_32F);
+    quadrant = plane(cv::Rect(halfCols, halfRows, halfCols, halfRows));
+    diag.convertTo(quadrant, CV_32F);
+    
+    inverseInPlace(plane, type);
+    recon = plane;
+}
+
+// Apply threshold to coefficients
+void WaveletTransform::applyThreshold(cv::Mat& coeffs, double threshold, ThresholdMethod method) {
+    const float t = (float)threshold;
+    
+    cv::parallel_for_(cv::Range(0, coeffs.rows), [&](const cv::Range& range) {
+        for (int i = range.start; i < range.end; i++) {
+            float* row = coeffs.ptr<float>(i);
+            for (int j = 0; j < coeffs.cols; j++) {
+                float val = row[j];
+                float absVal = std::abs(val);
+                
+                if (absVal < t) {
+                    row[j] = 0.0f;
+                } else if (method == SOFT) {
+                    row[j] = (val > 0 ? 1.0f : -1.0f) * (absVal - t);
+                }
+            }
         }
-        
-        std::vector<double> low, high;
-        convolve1D(row, lowpass, low, 2);
-        convolve1D(row, highpass, high, 2);
-        
-        // Safely copy with bounds checking
-        int actualSize = std::min((int)low.size(), halfCols);
-        for (int j = 0; j < actualSize; j++) {
-            temp1.at<double>(i, j) = low[j];
-            temp2.at<double>(i, j) = high[j];
+    });
+}
+
+// Robust noise estimate: median(|HH1|) / 0.6745, median by selection
+double WaveletTransform::estimateNoiseSigma(const cv::Mat& diag) {
+    std::vector<float> magnitudes;
+    magnitudes.reserve(diag.total());
+    for (int i = 0; i < diag.rows; i++) {
+        const float* row = diag.ptr<float>(i);
+        for (int j = 0; j < diag.cols; j++) {
+            magnitudes.push_back(std::abs(row[j]));
         }
     }
     
-    // Apply filters to columns
-    int halfRows = (rows + 1) / 2;
+    if (magnitudes.empty()) {
+        return 0.0;
+    }
+    
+    auto mid = magnitudes.begin() + magnitudes.size() / 2;
+    std::nth_element(magnitudes.begin(), mid, magnitudes.end());
+    return *mid / 0.6745;
+}
+
+// BayesShrink: T = sigma_n^2 / sigma_x, sigma_x^2 = max(var(Y) - sigma_n^2, 0)
+double WaveletTransform::bayesShrinkThreshold(const cv::Mat& band, double noiseSigma) {
+    if (band.empty()) {
+        return 0.0;
+    }
     
-    approx = cv::Mat(halfRows, halfCols, CV_64F);
-    horiz = cv::Mat(halfRows, halfCols, CV_64F);
-    vert = cv::Mat(halfRows, halfCols, CV_64F);
-    diag = cv::Mat(halfRows, halfCols, CV_64F);
+    double noiseVar = noiseSigma * noiseSigma;
+    double bandVar = cv::norm(band, cv::NORM_L2SQR) / (double)band.total();
+    double signalVar = bandVar - noiseVar;
     
-    for (int j = 0; j < halfCols; j++) {
-        std::vector<double> col1(rows), col2(rows);
-        for (int i = 0; i < rows; i++) {
-            col1[i] = temp1.at<double>(i, j);
-            col2[i] = temp2.at<double>(i, j);
+    // Sub-band is pure noise: remove it entirely
+    if (signalVar <= 1e-12) {
+        return cv::norm(band, cv::NORM_INF);
+    }
+    
+    return noiseVar / std::sqrt(signalVar);
+}
+
+// The gain of a band is the RMS norm of its analysis rows. Transforming
+// one period of impulses touches every row of a period exactly once, so the
+// summed squared coefficients give that norm. Lifting is linear apart from
+// the 5/3 rounding, which a large impulse makes negligible.
+void WaveletTransform::bandNoiseGains(WaveletType type, int levels, std::vector<double>& lowGain,
+                                      std::vector<double>& highGain) {
+    std::vector<float> lowpass, highpass;
+    getFloatFilters(type, lowpass, highpass);
+    const int period = 1 << levels;
+    const int n = period * 32;
+    const float impulse = 4096.0f;
+    
+    std::vector<double> lowEnergy(levels, 0.0), highEnergy(levels, 0.0);
+    std::vector<float> line(n), work((size_t)n + lowpass.size());
+    for (int p = 0; p < period; p++) {
+        std::fill(line.begin(), line.end(), 0.0f);
+        line[n / 2 + p] = impulse;
+        for (int level = 0; level < levels; level++) {
+            const int len = n >> level;
+            forward1D(line.data(), work.data(), len, 1, type, lowpass, highpass);
+            for (int k = 0; k < len / 2; k++) {
+                lowEnergy[level] += (double)line[k] * line[k];
+                highEnergy[level] += (double)line[len / 2 + k] * line[len / 2 + k];
+            }
         }
+    }
+    
+    lowGain.resize(levels);
+    highGain.resize(levels);
+    for (int level = 0; level < levels; level++) {
+        const double rows = (double)(period >> (level + 1));
+        lowGain[level] = std::sqrt(lowEnergy[level] / rows) / impulse;
+        highGain[level] = std::sqrt(highEnergy[level] / rows) / impulse;
+    }
+}
+
+double WaveletTransform::denoisePlane(cv::Mat& plane, double threshold, ThresholdMethod method,
+                                      int levels, WaveletType type) {
+    double noiseSigma = 0.0;
+    std::vector<double> lowGain, highGain;
+    if (threshold < 0.0) {
+        bandNoiseGains(type, levels, lowGain, highGain);
+    }
+    
+    for (int level = 0; level < levels; level++) {
+        cv::Mat band = plane(cv::Rect(0, 0, plane.cols >> level, plane.rows >> level));
+        forwardInPlace(band, type);
         
-        std::vector<double> ll, lh, hl, hh;
-        convolve1D(col1, lowpass, ll, 2);
-        convolve1D(col1, highpass, lh, 2);
-        convolve1D(col2, lowpass, hl, 2);
-        convolve1D(col2, highpass, hh, 2);
+        int halfRows = band.rows / 2;
+        int halfCols = band.cols / 2;
+        cv::Mat vt = band(cv::Rect(halfCols, 0, halfCols, halfRows));
+        cv::Mat hz = band(cv::Rect(0, halfRows, halfCols, halfRows));
+        cv::Mat dg = band(cv::Rect(halfCols, halfRows, halfCols, halfRows));
         
-        // Safely copy with bounds checking
-        int actualRowSize = std::min((int)ll.size(), halfRows);
-        for (int i = 0; i < actualRowSize; i++) {
-            approx.at<double>(i, j) = ll[i];
-            horiz.at<double>(i, j) = lh[i];
-            vert.at<double>(i, j) = hl[i];
-            diag.at<double>(i, j) = hh[i];
+        if (threshold >= 0.0) {
+            // Apply thresholding to detail coefficients
+            applyThreshold(hz, threshold, method);
+            applyThreshold(vt, threshold, method);
+            applyThreshold(dg, threshold, method);
+        } else {
+            // Sigma is estimated once, in image units, and scaled into each
+            // band by its filter gain
+            if (level == 0) {
+                noiseSigma = estimateNoiseSigma(dg) / (highGain[0] * highGain[0]);
+            }
+            double mixedSigma = noiseSigma * lowGain[level] * highGain[level];
+            double diagSigma = noiseSigma * highGain[level] * highGain[level];
+            applyThreshold(hz, bayesShrinkThreshold(hz, mixedSigma), method);
+            applyThreshold(vt, bayesShrinkThreshold(vt, mixedSigma), method);
+            applyThreshold(dg, bayesShrinkThreshold(dg, diagSigma), method);
         }
     }
+    
+    // Reconstruct from coarsest to finest
+    for (int level = levels - 1; level >= 0; level--) {
+        cv::Mat band = plane(cv::Rect(0, 0, plane.cols >> level, plane.rows >> level));
+        inverseInPlace(band, type);
+    }
+    
+    return noiseSigma;
 }
 
-// 2D Inverse Discrete Wavelet Transform
-void WaveletTransform::idwt2D(const cv::Mat& approx, const cv::Mat& horiz,
-                              const cv::Mat& vert, const cv::Mat& diag,
-                              cv::Mat& recon, WaveletType type) {
-    // Calculate target reconstruction size
-    int targetRows = approx.rows * 2;
-    int targetCols = approx.cols * 2;
+// Wavelet denoising
+void WaveletTransform::denoise(const cv::Mat& input, cv::Mat& output, double threshold,
+                               ThresholdMethod method, int levels, WaveletType type) {
+    levels = std::max(1, levels);
     
-    std::vector<double> lowpass, highpass;
-    getWaveletFilters(type, lowpass, highpass);
+    // Pad once so every level has even dimensions; all levels are then
+    // transformed in place inside this single buffer
+    cv::Mat plane = preparePlane(input, 1 << levels);
+    denoisePlane(plane, std::max(0.0, threshold), method, levels, type);
     
-    std::vector<double> lowpassRev(lowpass.rbegin(), lowpass.rend());
-    std::vector<double> highpassRev(highpass.rbegin(), highpass.rend());
+    // Crop the padding and convert back to original depth
+    plane(cv::Rect(0, 0, input.cols, input.rows)).convertTo(output, input.depth());
+}
+
+void WaveletTransform::splitDecorrelated(const cv::Mat& input, std::vector<cv::Mat>& channels, cv::Mat& alpha) {
+    channels.clear();
+    alpha.release();
     
-    // Temporary matrices for column reconstruction
-    cv::Mat temp1(targetRows, approx.cols, CV_64F, cv::Scalar(0));
-    cv::Mat temp2(targetRows, approx.cols, CV_64F, cv::Scalar(0));
+    // Split copies, so the denoised planes never write into the caller's image
+    if (input.channels() < 3) {
+        cv::split(input, channels);
+        return;
+    }
     
-    // Reconstruct columns
-    for (int j = 0; j < approx.cols; j++) {
-        std::vector<double> ll(approx.rows), lh(horiz.rows);
-        std::vector<double> hl(vert.rows), hh(diag.rows);
-        
-        for (int i = 0; i < approx.rows; i++) {
-            ll[i] = approx.at<double>(i, j);
-            lh[i] = horiz.at<double>(i, j);
-            hl[i] = vert.at<double>(i, j);
-            hh[i] = diag.at<double>(i, j);
-        }
-        
-        std::vector<double> llUp, lhUp, hlUp, hhUp;
-        upsample(ll, llUp);
-        upsample(lh, lhUp);
-        upsample(hl, hlUp);
-        upsample(hh, hhUp);
-        
-        std::vector<double> col1, col2;
-        convolve1D(llUp, lowpassRev, col1, 1);
-        convolve1D(lhUp, highpassRev, col2, 1);
-        
-        // Safely copy with bounds checking
-        int safeRows = std::min(targetRows, std::min((int)col1.size(), (int)col2.size()));
-        for (int i = 0; i < safeRows; i++) {
-            temp1.at<double>(i, j) = col1[i] + col2[i];
+    cv::Mat bgr = input;
+    if (input.channels() == 4) {
+        cv::extractChannel(input, alpha, 3);
+        cv::cvtColor(input, bgr, cv::COLOR_BGRA2BGR);
+    }
+    cv::Mat ycrcb;
+    cv::cvtColor(bgr, ycrcb, cv::COLOR_BGR2YCrCb);
+    cv::split(ycrcb, channels);
+}
+
+void WaveletTransform::mergeDecorrelated(std::vector<cv::Mat>& channels, const cv::Mat& alpha,
+                                         bool isColor, cv::Mat& output) {
+    if (!isColor) {
+        if (channels.size() == 1) {
+            output = channels[0];
+        } else {
+            cv::merge(channels, output);
         }
-        
-        convolve1D(hlUp, lowpassRev, col1, 1);
-        convolve1D(hhUp, highpassRev, col2, 1);
-        
-        safeRows = std::min(targetRows, std::min((int)col1.size(), (int)col2.size()));
-        for (int i = 0; i < safeRows; i++) {
-            temp2.at<double>(i, j) = col1[i] + col2[i];
+        return;
+    }
+    
+    cv::Mat ycrcb;
+    cv::merge(channels, ycrcb);
+    cv::cvtColor(ycrcb, output, cv::COLOR_YCrCb2BGR);
+    if (!alpha.empty()) {
+        cv::cvtColor(output, output, cv::COLOR_BGR2BGRA);
+        cv::insertChannel(alpha, output, 3);
+    }
+}
+
+// Adaptive (BayesShrink) wavelet denoising, color aware
+double WaveletTransform::denoiseBayesShrink(const cv::Mat& input, cv::Mat& output,
+                                            ThresholdMethod method, int levels, WaveletType type) {
+    levels = std::max(1, levels);
+    const int multiple = 1 << levels;
+    
+    // Decorrelate color so chroma noise is estimated separately from luma
+    std::vector<cv::Mat> channels;
+    cv::Mat alpha;
+    splitDecorrelated(input, channels, alpha);
+    
+    // One buffer per channel; channels run concurrently
+    std::vector<double> sigmas(channels.size(), 0.0);
+    cv::parallel_for_(cv::Range(0, (int)channels.size()), [&](const cv::Range& range) {
+        for (int c = range.start; c < range.end; c++) {
+            cv::Mat plane = preparePlane(channels[c], multiple);
+            sigmas[c] = denoisePlane(plane, -1.0, method, levels, type);
+            cv::Mat denoised;
+            plane(cv::Rect(0, 0, input.cols, input.rows)).convertTo(denoised, input.depth());
+            channels[c] = denoised;
         }
+    });
+    
+    mergeDecorrelated(channels, alpha, input.channels() >= 3, output);
+    return sigmas[0];
+}
+
+// ============================================================================
+// STATIONARY (A TROUS) TRANSFORM
+// ============================================================================
+
+void WaveletTransform::getStationaryFilters(WaveletType type, AtrousFilter& lowpass, AtrousFilter& highpass,
+                                            AtrousFilter& synthLowpass, AtrousFilter& synthHighpass) {
+    if (type == CDF53) {
+        // LeGall 5/3, zero phase
+        lowpass.taps = {-0.125f, 0.25f, 0.75f, 0.25f, -0.125f};
+        lowpass.origin = 2;
+        synthLowpass.taps = {0.5f, 1.0f, 0.5f};
+        synthLowpass.origin = 1;
+    } else if (type == CDF97) {
+        lowpass.taps = {0.026748757411f, -0.016864118443f, -0.078223266529f, 0.266864118443f,
+                        0.602949018236f, 0.266864118443f, -0.078223266529f, -0.016864118443f,
+                        0.026748757411f};
+        lowpass.origin = 4;
+        synthLowpass.taps = {-0.091271763114f, -0.057543526229f, 0.591271763114f, 1.115087052457f,
+                             0.591271763114f, -0.057543526229f, -0.091271763114f};
+        synthLowpass.origin = 3;
+    } else {
+        // Orthogonal: synthesis is the time reverse of analysis
+        std::vector<double> lo, hi;
+        getWaveletFilters(type, lo, hi);
+        lowpass.taps.assign(lo.begin(), lo.end());
+        lowpass.origin = (int)lo.size() / 2 - 1;
+        synthLowpass.taps.assign(lo.rbegin(), lo.rend());
+        synthLowpass.origin = (int)lo.size() - 1 - lowpass.origin;
     }
     
-    // Reconstruct rows
-    recon = cv::Mat(targetRows, targetCols, CV_64F, cv::Scalar(0));
+    // Quadrature mirrors: g(n) = (-1)^n h~(n), g~(n) = (-1)^n h(n)
+    highpass = synthLowpass;
+    for (size_t k = 0; k < highpass.taps.size(); k++) {
+        if (std::abs((int)k - highpass.origin) % 2 == 1) highpass.taps[k] = -highpass.taps[k];
+    }
+    synthHighpass = lowpass;
+    for (size_t k = 0; k < synthHighpass.taps.size(); k++) {
+        if (std::abs((int)k - synthHighpass.origin) % 2 == 1) synthHighpass.taps[k] = -synthHighpass.taps[k];
+    }
     
-    for (int i = 0; i < targetRows; i++) {
-        std::vector<double> row1(approx.cols), row2(approx.cols);
-        for (int j = 0; j < approx.cols; j++) {
-            row1[j] = temp1.at<double>(i, j);
-            row2[j] = temp2.at<double>(i, j);
+    // Undecimated perfect reconstruction: x = (h~*h*x + g~*g*x) / 2
+    for (float& t : synthLowpass.taps) t *= 0.5f;
+    for (float& t : synthHighpass.taps) t *= 0.5f;
+}
+
+// Symmetric (whole-sample) extension keeps the symmetric CDF filters exactly
+// invertible; orthogonal filters need periodic extension for that
+int WaveletTransform::extendIndex(int index, int length, bool symmetric) {
+    if (length == 1) {
+        return 0;
+    }
+    if (!symmetric) {
+        index %= length;
+        return index < 0 ? index + length : index;
+    }
+    while (index < 0 || index >= length) {
+        if (index < 0) index = -index;
+        if (index >= length) index = 2 * length - 2 - index;
+    }
+    return index;
+}
+
+// out[n] += sum_k taps[k] * center[n - (k - origin) * step]
+void WaveletTransform::filterLine(const float* center, const AtrousFilter& filter, int step,
+                                  int length, float* out) {
+    for (size_t k = 0; k < filter.taps.size(); k++) {
+        const float w = filter.taps[k];
+        const float* src = center - ((int)k - filter.origin) * step;
+        for (int n = 0; n < length; n++) {
+            out[n] += w * src[n];
         }
+    }
+}
+
+static int filterReach(const std::vector<int>& reaches) {
+    return *std::max_element(reaches.begin(), reaches.end());
+}
+
+void WaveletTransform::atrousRows(const cv::Mat& src, const AtrousFilter& lowpass, const AtrousFilter& highpass,
+                                  int dilation, bool symmetric, cv::Mat& low, cv::Mat& high) {
+    const int cols = src.cols;
+    const int cn = src.channels();
+    const int reach = dilation * filterReach({lowpass.origin, (int)lowpass.taps.size() - 1 - lowpass.origin,
+                                              highpass.origin, (int)highpass.taps.size() - 1 - highpass.origin});
+    low.create(src.size(), src.type());
+    high.create(src.size(), src.type());
+    
+    cv::parallel_for_(cv::Range(0, src.rows), [&](const cv::Range& range) {
+        // Extended copy of the row so the tap loops need no bounds checks
+        std::vector<float> ext((size_t)(cols + 2 * reach) * cn);
+        float* center = ext.data() + (size_t)reach * cn;
         
-        std::vector<double> row1Up, row2Up;
-        upsample(row1, row1Up);
-        upsample(row2, row2Up);
+        for (int i = range.start; i < range.end; i++) {
+            const float* row = src.ptr<float>(i);
+            std::memcpy(center, row, (size_t)cols * cn * sizeof(float));
+            for (int x = 1; x <= reach; x++) {
+                std::memcpy(center - (size_t)x * cn, row + (size_t)extendIndex(-x, cols, symmetric) * cn, cn * sizeof(float));
+                std::memcpy(center + (size_t)(cols - 1 + x) * cn, row + (size_t)extendIndex(cols - 1 + x, cols, symmetric) * cn, cn * sizeof(float));
+            }
+            
+            float* lowRow = low.ptr<float>(i);
+            float* highRow = high.ptr<float>(i);
+            std::fill(lowRow, lowRow + (size_t)cols * cn, 0.0f);
+            std::fill(highRow, highRow + (size_t)cols * cn, 0.0f);
+            filterLine(center, lowpass, dilation * cn, cols * cn, lowRow);
+            filterLine(center, highpass, dilation * cn, cols * cn, highRow);
+        }
+    });
+}
+
+void WaveletTransform::atrousRowsMerge(const cv::Mat& low, const cv::Mat& high, const AtrousFilter& lowpass,
+                                       const AtrousFilter& highpass, int dilation, bool symmetric, cv::Mat& dst) {
+    const cv::Mat& shape = low.empty() ? high : low;
+    const int cols = shape.cols;
+    const int cn = shape.channels();
+    const int reach = dilation * filterReach({lowpass.origin, (int)lowpass.taps.size() - 1 - lowpass.origin,
+                                              highpass.origin, (int)highpass.taps.size() - 1 - highpass.origin});
+    dst.create(shape.size(), shape.type());
+    
+    cv::parallel_for_(cv::Range(0, shape.rows), [&](const cv::Range& range) {
+        std::vector<float> ext((size_t)(cols + 2 * reach) * cn);
+        float* center = ext.data() + (size_t)reach * cn;
         
-        std::vector<double> recon1, recon2;
-        convolve1D(row1Up, lowpassRev, recon1, 1);
-        convolve1D(row2Up, highpassRev, recon2, 1);
+        // Extends one input row and adds its filtered contribution to out
+        auto addFiltered = [&](const float* row, const AtrousFilter& filter, float* out) {
+            std::memcpy(center, row, (size_t)cols * cn * sizeof(float));
+            for (int x = 1; x <= reach; x++) {
+                std::memcpy(center - (size_t)x * cn, row + (size_t)extendIndex(-x, cols, symmetric) * cn, cn * sizeof(float));
+                std::memcpy(center + (size_t)(cols - 1 + x) * cn, row + (size_t)extendIndex(cols - 1 + x, cols, symmetric) * cn, cn * sizeof(float));
+            }
+            filterLine(center, filter, dilation * cn, cols * cn, out);
+        };
         
-        // Safely copy with bounds checking
-        int safeCols = std::min(targetCols, std::min((int)recon1.size(), (int)recon2.size()));
-        for (int j = 0; j < safeCols; j++) {
-            recon.at<double>(i, j) = recon1[j] + recon2[j];
+        for (int i = range.start; i < range.end; i++) {
+            float* out = dst.ptr<float>(i);
+            std::fill(out, out + (size_t)cols * cn, 0.0f);
+            if (!low.empty()) addFiltered(low.ptr<float>(i), lowpass, out);
+            if (!high.empty()) addFiltered(high.ptr<float>(i), highpass, out);
         }
-    }
+    });
 }
 
-// Apply threshold to coefficients
-void WaveletTransform::applyThreshold(cv::Mat& coeffs, double threshold, ThresholdMethod method) {
-    for (int i = 0; i < coeffs.rows; i++) {
-        for (int j = 0; j < coeffs.cols; j++) {
-            double val = coeffs.at<double>(i, j);
-            double absVal = std::abs(val);
+// Column filtering as whole-row AXPYs: output row i gathers the input rows
+// i - offset * dilation, so every inner loop is contiguous
+void WaveletTransform::atrousColumns(const cv::Mat& src, const AtrousFilter& lowpass, const AtrousFilter& highpass,
+                                     int dilation, bool symmetric, cv::Mat& low, cv::Mat& high) {
+    const int rows = src.rows;
+    const int length = src.cols * src.channels();
+    low.create(src.size(), src.type());
+    high.create(src.size(), src.type());
+    
+    cv::parallel_for_(cv::Range(0, rows), [&](const cv::Range& range) {
+        for (int i = range.start; i < range.end; i++) {
+            float* lowRow = low.ptr<float>(i);
+            float* highRow = high.ptr<float>(i);
+            std::fill(lowRow, lowRow + length, 0.0f);
+            std::fill(highRow, highRow + length, 0.0f);
             
-            if (method == SOFT) {
-                if (absVal < threshold) {
-                    coeffs.at<double>(i, j) = 0.0;
-                } else {
-                    coeffs.at<double>(i, j) = (val > 0 ? 1 : -1) * (absVal - threshold);
-                }
-            } else {
-                if (absVal < threshold) {
-                    coeffs.at<double>(i, j) = 0.0;
-                }
+            for (size_t k = 0; k < lowpass.taps.size(); k++) {
+                const float w = lowpass.taps[k];
+                const float* in = src.ptr<float>(extendIndex(i - ((int)k - lowpass.origin) * dilation, rows, symmetric));
+                for (int n = 0; n < length; n++) lowRow[n] += w * in[n];
+            }
+            for (size_t k = 0; k < highpass.taps.size(); k++) {
+                const float w = highpass.taps[k];
+                const float* in = src.ptr<float>(extendIndex(i - ((int)k - highpass.origin) * dilation, rows, symmetric));
+                for (int n = 0; n < length; n++) highRow[n] += w * in[n];
             }
         }
-    }
+    });
 }
 
-// Wavelet denoising
-void WaveletTransform::denoise(const cv::Mat& input, cv::Mat& output, double threshold,
-                               ThresholdMethod method, int levels, WaveletType type) {
-    // Ensure input is grayscale
-    cv::Mat grayInput;
-    if (input.channels() == 3) {
-        cv::cvtColor(input, grayInput, cv::COLOR_BGR2GRAY);
-    } else if (input.channels() == 4) {
-        cv::cvtColor(input, grayInput, cv::COLOR_BGRA2GRAY);
-    } else {
-        grayInput = input.clone();
-    }
+void WaveletTransform::atrousColumnsMerge(const cv::Mat& low, const cv::Mat& high, const AtrousFilter& lowpass,
+                                          const AtrousFilter& highpass, int dilation, bool symmetric, cv::Mat& dst) {
+    const cv::Mat& shape = low.empty() ? high : low;
+    const int rows = shape.rows;
+    const int length = shape.cols * shape.channels();
+    dst.create(shape.size(), shape.type());
+    
+    cv::parallel_for_(cv::Range(0, rows), [&](const cv::Range& range) {
+        for (int i = range.start; i < range.end; i++) {
+            float* out = dst.ptr<float>(i);
+            std::fill(out, out + length, 0.0f);
+            
+            for (size_t k = 0; k < lowpass.taps.size() && !low.empty(); k++) {
+                const float w = lowpass.taps[k];
+                const float* in = low.ptr<float>(extendIndex(i - ((int)k - lowpass.origin) * dilation, rows, symmetric));
+                for (int n = 0; n < length; n++) out[n] += w * in[n];
+            }
+            for (size_t k = 0; k < highpass.taps.size() && !high.empty(); k++) {
+                const float w = highpass.taps[k];
+                const float* in = high.ptr<float>(extendIndex(i - ((int)k - highpass.origin) * dilation, rows, symmetric));
+                for (int n = 0; n < length; n++) out[n] += w * in[n];
+            }
+        }
+    });
+}
+
+WaveletTransform::StationaryDecomposition WaveletTransform::swt2D(const cv::Mat& input, int levels, WaveletType type) {
+    levels = std::max(1, levels);
+    
+    StationaryDecomposition result;
+    result.type = type;
+    
+    AtrousFilter lowpass, highpass, synthLowpass, synthHighpass;
+    getStationaryFilters(type, lowpass, highpass, synthLowpass, synthHighpass);
+    const bool symmetric = (type == CDF53 || type == CDF97);
     
-    cv::Mat current = grayInput.clone();
-    std::vector<std::vector<cv::Mat>> decompositions;
-    std::vector<cv::Size> originalSizes;  // Store original size at each level
+    // 'current' holds the running approximation and is overwritten in place by
+    // each level; rowLow/rowHigh are the only scratch planes
+    cv::Mat current;
+    input.convertTo(current, CV_32F);
+    cv::Mat rowLow, rowHigh;
     
-    // Multi-level decomposition
     for (int level = 0; level < levels; level++) {
-        originalSizes.push_back(current.size());  // Store size before decomposition
+        const int dilation = 1 << level;
+        StationaryLevel detail;
         
-        cv::Mat ap, hz, vt, dg;
-        dwt2D(current, ap, hz, vt, dg, type);
+        atrousRows(current, lowpass, highpass, dilation, symmetric, rowLow, rowHigh);
+        atrousColumns(rowLow, lowpass, highpass, dilation, symmetric, current, detail.horiz);
+        atrousColumns(rowHigh, lowpass, highpass, dilation, symmetric, detail.vert, detail.diag);
         
-        // Apply thresholding to detail coefficients
-        applyThreshold(hz, threshold, method);
-        applyThreshold(vt, threshold, method);
-        applyThreshold(dg, threshold, method);
-        
-        std::vector<cv::Mat> levelData = {ap, hz, vt, dg};
-        decompositions.push_back(levelData);
+        result.details.push_back(detail);
+    }
+    
+    result.approx = current;
+    
+    // 3 detail planes per level + approximation + 2 scratch planes
+    const size_t planeBytes = current.total() * current.elemSize();
+    result.peakBytes = planeBytes * (3 * (size_t)levels + 3);
+    return result;
+}
+
+cv::Mat WaveletTransform::iswt2D(const StationaryDecomposition& decomposition) {
+    AtrousFilter lowpass, highpass, synthLowpass, synthHighpass;
+    getStationaryFilters(decomposition.type, lowpass, highpass, synthLowpass, synthHighpass);
+    const bool symmetric = (decomposition.type == CDF53 || decomposition.type == CDF97);
+    
+    cv::Mat current = decomposition.approx.clone();
+    cv::Mat rowLow, rowHigh;
+    
+    for (int level = (int)decomposition.details.size() - 1; level >= 0; level--) {
+        const int dilation = 1 << level;
+        const StationaryLevel& detail = decomposition.details[level];
         
-        current = ap;
+        atrousColumnsMerge(current, detail.horiz, synthLowpass, synthHighpass, dilation, symmetric, rowLow);
+        atrousColumnsMerge(detail.vert, detail.diag, synthLowpass, synthHighpass, dilation, symmetric, rowHigh);
+        atrousRowsMerge(rowLow, rowHigh, synthLowpass, synthHighpass, dilation, symmetric, current);
     }
     
-    // Reconstruct from coarsest to finest
-    cv::Mat rc = decompositions[levels - 1][0].clone();
+    return current;
+}
+
+// The synthesis step is linear, so level j rebuilds as A(c) + B(H, V, D):
+// A passes the coarser approximation through the synthesis lowpass, B is
+// the same step with a zero approximation. B is evaluated as soon as the
+// level's bands are thresholded, leaving one plane per level instead of three.
+cv::Mat WaveletTransform::denoiseStationaryPlane(const cv::Mat& input, double threshold, ThresholdMethod method,
+                                                 int levels, WaveletType type, size_t& peakBytes) {
+    levels = std::max(1, levels);
     
-    // Reconstruct level by level from coarsest to finest
-    for (int level = levels - 1; level >= 0; level--) {
-        cv::Mat hz = decompositions[level][1];
-        cv::Mat vt = decompositions[level][2];
-        cv::Mat dg = decompositions[level][3];
+    AtrousFilter lowpass, highpass, synthLowpass, synthHighpass;
+    getStationaryFilters(type, lowpass, highpass, synthLowpass, synthHighpass);
+    const bool symmetric = (type == CDF53 || type == CDF97);
+    
+    cv::Mat current;
+    input.convertTo(current, CV_32F);
+    std::vector<cv::Mat> combined(levels);
+    cv::Mat rowLow, rowHigh, horiz, diag;
+    
+    for (int level = 0; level < levels; level++) {
+        const int dilation = 1 << level;
         
-        cv::Mat reconstructed;
-        idwt2D(rc, hz, vt, dg, reconstructed, type);
+        // rowLow is free once the low rows are split, so it takes the vertical band
+        atrousRows(current, lowpass, highpass, dilation, symmetric, rowLow, rowHigh);
+        atrousColumns(rowLow, lowpass, highpass, dilation, symmetric, current, horiz);
+        atrousColumns(rowHigh, lowpass, highpass, dilation, symmetric, rowLow, diag);
+        cv::Mat& vert = rowLow;
         
-        // Crop/pad to original size at this level
-        cv::Size targetSize = originalSizes[level];
-        if (reconstructed.rows != targetSize.height || reconstructed.cols != targetSize.width) {
-            // Crop if larger
-            int cropRows = std::min(reconstructed.rows, targetSize.height);
-            int cropCols = std::min(reconstructed.cols, targetSize.width);
-            cv::Rect roi(0, 0, cropCols, cropRows);
-            reconstructed = reconstructed(roi).clone();
-            
-            // Pad if smaller (shouldn't happen, but just in case)
-            if (reconstructed.rows < targetSize.height || reconstructed.cols < targetSize.width) {
-                cv::Mat padded(targetSize, reconstructed.type(), cv::Scalar(0));
-                reconstructed.copyTo(padded(cv::Rect(0, 0, reconstructed.cols, reconstructed.rows)));
-                reconstructed = padded;
-            }
+        if (threshold >= 0.0) {
+            applyThreshold(horiz, threshold, method);
+            applyThreshold(vert, threshold, method);
+            applyThreshold(diag, threshold, method);
+        } else {
+            // Undecimated filters are not orthonormal across levels,
+            // so noise is estimated per level from its own diagonal band
+            double sigma = estimateNoiseSigma(diag);
+            applyThreshold(horiz, bayesShrinkThreshold(horiz, sigma), method);
+            applyThreshold(vert, bayesShrinkThreshold(vert, sigma), method);
+            applyThreshold(diag, bayesShrinkThreshold(diag, sigma), method);
         }
         
-        rc = reconstructed;
+        atrousColumnsMerge(cv::Mat(), horiz, synthLowpass, synthHighpass, dilation, symmetric, rowHigh);
+        atrousColumnsMerge(vert, diag, synthLowpass, synthHighpass, dilation, symmetric, horiz);
+        atrousRowsMerge(rowHigh, horiz, synthLowpass, synthHighpass, dilation, symmetric, diag);
+        combined[level] = diag;
+        diag = cv::Mat();
+    }
+    
+    // The last level holds the approximation, four working planes and one
+    // combined band per earlier level
+    peakBytes = current.total() * current.elemSize() * ((size_t)levels + 4);
+    horiz.release();
+    
+    for (int level = levels - 1; level >= 0; level--) {
+        const int dilation = 1 << level;
+        atrousColumnsMerge(current, cv::Mat(), synthLowpass, synthHighpass, dilation, symmetric, rowLow);
+        atrousRowsMerge(rowLow, cv::Mat(), synthLowpass, synthHighpass, dilation, symmetric, rowHigh);
+        cv::add(rowHigh, combined[level], current);
+        combined[level].release();
     }
     
-    // Convert back to original type
-    rc.convertTo(output, input.type());
+    return current;
+}
+
+void WaveletTransform::denoiseStationary(const cv::Mat& input, cv::Mat& output, double threshold,
+                                         ThresholdMethod method, int levels, WaveletType type,
+                                         size_t* peakBytes) {
+    std::vector<cv::Mat> channels;
+    cv::Mat alpha;
+    splitDecorrelated(input, channels, alpha);
+    
+    // Channels are decomposed concurrently, so their working sets add up
+    std::vector<size_t> channelPeaks(channels.size(), 0);
+    cv::parallel_for_(cv::Range(0, (int)channels.size()), [&](const cv::Range& range) {
+        for (int c = range.start; c < range.end; c++) {
+            cv::Mat denoised;
+            denoiseStationaryPlane(channels[c], threshold, method, levels, type, channelPeaks[c])
+                .convertTo(denoised, input.depth());
+            channels[c] = denoised;
+        }
+    });
+    
+    mergeDecorrelated(channels, alpha, input.channels() >= 3, output);
+    
+    if (peakBytes) {
+        *peakBytes = 0;
+        for (size_t bytes : channelPeaks) {
+            *peakBytes += bytes;
+        }
+    }
 }
 
 // Visualize wavelet decomposition
@@ -365,6 +1043,8 @@ std::string WaveletTransform::getWaveletName(WaveletType type) {
         case DB2: return "Daubechies-2";
         case DB4: return "Daubechies-4";
         case DB6: return "Daubechies-6";
+        case CDF53: return "CDF 5/3";
+        case CDF97: return "CDF 9/7";
         default: return "Unknown";
     }
 }